@@ -44,6 +44,9 @@ namespace Memory{
 	const int REQUEST_POOL_SIZE = 1024;
 	const double REQUEST_POOL_LOW_RATIO = 0.1;
 
+	/* Bytes of history kept per request, older entries are overwritten */
+	const int REQUEST_HISTORY_SIZE = 256;
+
 	/* CPU Controller */
 	const int CPU_CONT_PENDING_REQ_SIZE = 128;
 	const int CPU_CONT_ICACHE_BUF_SIZE = 32;
@@ -63,5 +66,12 @@ namespace Memory{
 
 	/* Average wait dealy for retrying (general) */
 	const int AVG_WAIT_DELAY = 5;
+
+	/*
+	 * Event queue timing wheel, number of cycles covered by the wheel
+	 * (must be a power of 2) and number of events allocated at a time
+	 */
+	const int EVENT_WHEEL_SIZE = 1024;
+	const int EVENT_POOL_CHUNK = 256;
 }
 #endif // CACHECONSTANTS_H
@@ -37,6 +37,7 @@
 #include <cacheController.h>
 
 #include <machine.h>
+#include <warm-state.h>
 
 /* Remove following comments to debug this file's code
 
@@ -62,7 +63,7 @@ CacheController::CacheController(W8 coreid, const char *name,
 {
     memoryHierarchy_->add_cache_mem_controller(this);
 
-    cacheLines_ = get_cachelines(type);
+    cacheLines_ = create_cachelines(type, name);
 
     if(!memoryHierarchy_->get_machine().get_option(name, "last_private", isLowestPrivate_)) {
         isLowestPrivate_ = false;
@@ -883,6 +884,46 @@ void CacheController::do_prefetch(MemoryRequest *request, int additional_delay)
 		   new_entry);
 }
 
+/**
+ * @brief Insert or update the line of an access made while
+ * fast-forwarding
+ *
+ * These caches have no coherence, L1 caches belong to their core and all
+ * other levels see the accesses of every core.
+ */
+void CacheController::warm_access(W8 coreid, W64 physaddr, bool is_icache,
+		bool is_write, bool shared)
+{
+	if(type_ == L1_I_CACHE || type_ == L1_D_CACHE) {
+		if(idx != coreid || (type_ == L1_I_CACHE) != is_icache)
+			return;
+	}
+
+	CacheLine *line = cacheLines_->probe(physaddr);
+
+	if(!line || line->state == LINE_NOT_VALID) {
+		W64 oldTag = InvalidTag<W64>::INVALID;
+		line = cacheLines_->insert(physaddr, oldTag);
+		line->init(cacheLines_->tagOf(physaddr));
+		line->state = LINE_VALID;
+	}
+
+	if(is_write && wt_disabled_)
+		line->state = LINE_MODIFIED;
+}
+
+void CacheController::save_warm_state(WarmStateFile &ws)
+{
+	ws.save(get_name(), cacheLines_->state_base(),
+			cacheLines_->state_size());
+}
+
+void CacheController::load_warm_state(WarmStateFile &ws)
+{
+	ws.restore(get_name(), cacheLines_->state_base(),
+			cacheLines_->state_size());
+}
+
 /**
  * @brief Dump Cache Configuration in YAML Format
  *
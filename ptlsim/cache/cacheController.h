@@ -212,6 +212,10 @@ class CacheController : public Controller
 
 		void annul_request(MemoryRequest *request);
 		void dump_configuration(YAML::Emitter &out) const;
+		void warm_access(W8 coreid, W64 physaddr, bool is_icache,
+				bool is_write, bool shared);
+		void save_warm_state(WarmStateFile &ws);
+		void load_warm_state(WarmStateFile &ws);
 
 		// Callback functions for signals of cache
 		bool cache_hit_cb(void *arg);
@@ -0,0 +1,319 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#ifdef MEM_TEST
+#include <test.h>
+#else
+#include <ptlsim.h>
+#endif
+
+#include <memoryHierarchy.h>
+#include <cacheLines.h>
+
+using namespace Memory;
+
+static inline bool is_pow2(W64 value)
+{
+    return value && !(value & (value - 1));
+}
+
+DynamicCacheLines::DynamicCacheLines(int setCount, int wayCount,
+        int lineSize, int latency, int readPorts, int writePorts)
+    : setCount_(setCount)
+    , wayCount_(wayCount)
+    , lineSize_(lineSize)
+    , latency_(latency)
+    , readPortUsed_(0)
+    , writePortUsed_(0)
+    , readPorts_(readPorts)
+    , writePorts_(writePorts)
+    , lastAccessCycle_(0)
+{
+    assert(is_pow2(setCount_));
+    assert(is_pow2(wayCount_) && wayCount_ <= 64);
+    assert(is_pow2(lineSize_));
+
+    lineBits_ = lsbindex(lineSize_);
+    setMask_ = setCount_ - 1;
+    allWays_ = (wayCount_ < 64) ? ((1ULL << wayCount_) - 1) : -1ULL;
+
+    /* Each set starts on a 32 byte boundary for vector loads of tags */
+    mruOffset_ = sizeof(W64) * wayCount_;
+    linesOffset_ = mruOffset_ + sizeof(W64);
+    setStride_ = ceil(linesOffset_ + sizeof(CacheLine) * wayCount_, 32);
+
+    void *mem = NULL;
+    int rc = posix_memalign(&mem, 32, W64(setStride_) * setCount_);
+    assert(rc == 0);
+    sets_ = (byte*)mem;
+}
+
+DynamicCacheLines::~DynamicCacheLines()
+{
+    free(sets_);
+}
+
+void DynamicCacheLines::init()
+{
+    foreach(i, setCount_) {
+        W64 *tags = tags_of(i);
+        CacheLine *lines = lines_of(i);
+
+        foreach(j, wayCount_) {
+            tags[j] = InvalidTag<W64>::INVALID;
+            lines[j].init(-1);
+        }
+
+        mru_of(i) = 0;
+    }
+}
+
+W64 DynamicCacheLines::tagOf(W64 address)
+{
+    return line_tag(address);
+}
+
+/*
+ * Same policy as FullyAssociativeTags: the first way without its MRU bit
+ * set is the victim. Probes only set the MRU bit, inserts clear the map
+ * once all bits are set.
+ */
+int DynamicCacheLines::victim(int set) const
+{
+    W64 unused = ~mru_of(set) & allWays_;
+
+    return unused ? lsbindex64(unused) : 0;
+}
+
+void DynamicCacheLines::use(int set, int way)
+{
+    mru_of(set) |= (1ULL << way);
+}
+
+CacheLine* DynamicCacheLines::probe(MemoryRequest *request)
+{
+    return probe(request->get_physical_address());
+}
+
+CacheLine* DynamicCacheLines::insert(MemoryRequest *request, W64& oldTag)
+{
+    return insert(request->get_physical_address(), oldTag);
+}
+
+CacheLine* DynamicCacheLines::probe(W64 physAddress)
+{
+    int set = set_of(physAddress);
+    int way = match(set, line_tag(physAddress));
+
+    if(way < 0)
+        return NULL;
+
+    use(set, way);
+    return &lines_of(set)[way];
+}
+
+CacheLine* DynamicCacheLines::insert(W64 physAddress, W64& oldTag)
+{
+    W64 tag = line_tag(physAddress);
+    int set = set_of(physAddress);
+    int way = match(set, tag);
+
+    if(way < 0) {
+        way = victim(set);
+        if(mru_of(set) == allWays_)
+            mru_of(set) = 0;
+        oldTag = tags_of(set)[way];
+        tags_of(set)[way] = tag;
+    }
+
+    use(set, way);
+    if(mru_of(set) == allWays_) {
+        mru_of(set) = 0;
+        use(set, way);
+    }
+
+    return &lines_of(set)[way];
+}
+
+int DynamicCacheLines::invalidate(MemoryRequest *request)
+{
+    W64 physAddress = request->get_physical_address();
+    int set = set_of(physAddress);
+    int way = match(set, line_tag(physAddress));
+
+    if(way < 0)
+        return -1;
+
+    tags_of(set)[way] = InvalidTag<W64>::INVALID;
+    mru_of(set) &= ~(1ULL << way);
+    lines_of(set)[way].reset();
+
+    return way;
+}
+
+bool DynamicCacheLines::get_port(MemoryRequest *request)
+{
+    bool rc = false;
+
+    if(lastAccessCycle_ < sim_cycle) {
+        lastAccessCycle_ = sim_cycle;
+        writePortUsed_ = 0;
+        readPortUsed_ = 0;
+    }
+
+    switch(request->get_type()) {
+        case MEMORY_OP_READ:
+            rc = (readPortUsed_ < readPorts_) ? ++readPortUsed_ : 0;
+            break;
+        case MEMORY_OP_WRITE:
+        case MEMORY_OP_UPDATE:
+        case MEMORY_OP_EVICT:
+            rc = (writePortUsed_ < writePorts_) ? ++writePortUsed_ : 0;
+            break;
+        default:
+            memdebug("Unknown type of memory request: " <<
+                    request->get_type() << endl);
+            assert(0);
+    };
+    return rc;
+}
+
+void DynamicCacheLines::print(ostream& os) const
+{
+    foreach(i, setCount_) {
+        foreach(j, wayCount_) {
+            os << lines_of(i)[j];
+        }
+    }
+}
+
+/*
+ * Parse a size with an optional K, M or G suffix, like the SIZE parameter
+ * of cache configurations.
+ */
+static W64 parse_cache_size(const char *str)
+{
+    char *end;
+    W64 size = strtoull(str, &end, 0);
+
+    switch(*end) {
+        case 'k': case 'K': size <<= 10; break;
+        case 'm': case 'M': size <<= 20; break;
+        case 'g': case 'G': size <<= 30; break;
+    }
+
+    return size;
+}
+
+/*
+ * 'cache-config' is a comma separated list of entries in the form
+ * "<name prefix>:<param>=<value>[:<param>=<value>...]", for example
+ * "L2_:size=4M:assoc=16,L1_D_0:latency=3". An entry applies to every cache
+ * controller whose name starts with the prefix, later entries win.
+ */
+static bool get_cache_overrides(const char *name, W64& size, int& ways,
+        int& lineSize, int& latency, int& readPorts, int& writePorts)
+{
+    bool found = false;
+    dynarray<char*> entries;
+    stringbuf spec;
+
+    spec << config.cache_config;
+    entries.tokenize(spec.buf, ",");
+
+    foreach(i, entries.count()) {
+        dynarray<char*> fields;
+        fields.tokenize(entries[i], ":");
+
+        if(fields.count() < 2 ||
+                strncmp(name, fields[0], strlen(fields[0])) != 0)
+            continue;
+
+        for(int j = 1; j < fields.count(); j++) {
+            char *value = strchr(fields[j], '=');
+            if(!value)
+                continue;
+            *value++ = 0;
+
+            if(!strcmp(fields[j], "size"))
+                size = parse_cache_size(value);
+            else if(!strcmp(fields[j], "assoc"))
+                ways = atoi(value);
+            else if(!strcmp(fields[j], "line_size"))
+                lineSize = atoi(value);
+            else if(!strcmp(fields[j], "latency"))
+                latency = atoi(value);
+            else if(!strcmp(fields[j], "read_ports"))
+                readPorts = atoi(value);
+            else if(!strcmp(fields[j], "write_ports"))
+                writePorts = atoi(value);
+            else
+                continue;
+
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+CacheLinesBase* Memory::create_cachelines(int type, const char *name)
+{
+    CacheLinesBase *lines = get_cachelines(type);
+
+    if(config.cache_config == "")
+        return lines;
+
+    W64 size = lines->get_size();
+    int ways = lines->get_way_count();
+    int lineSize = lines->get_line_size();
+    int latency = lines->get_access_latency();
+    int readPorts = lines->get_read_ports();
+    int writePorts = lines->get_write_ports();
+
+    if(!get_cache_overrides(name, size, ways, lineSize, latency,
+                readPorts, writePorts))
+        return lines;
+
+    W64 sets = (lineSize > 0 && ways > 0) ? size / (lineSize * ways) : 0;
+
+    if(!is_pow2(sets) || !is_pow2(ways) || ways > 64 || !is_pow2(lineSize)) {
+        stringbuf err;
+        err << "::ERROR::Invalid geometry for cache '" << name
+            << "': size " << size << " assoc " << ways
+            << " line_size " << lineSize
+            << " (sets and ways must be powers of 2, ways <= 64)" << endl;
+        ptl_logfile << err;
+        cerr << err;
+        assert(0);
+        return lines;
+    }
+
+    delete lines;
+
+    ptl_logfile << "Cache ", name, ": ", sets, " sets, ", ways, " ways, ",
+                lineSize, " byte lines, latency ", latency, endl;
+
+    return new DynamicCacheLines(sets, ways, lineSize, latency,
+            readPorts, writePorts);
+}
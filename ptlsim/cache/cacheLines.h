@@ -30,6 +30,10 @@
 
 #include <logic.h>
 
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
 namespace Memory {
 
     struct CacheLine
@@ -80,6 +84,9 @@ namespace Memory {
             virtual CacheLine* probe(MemoryRequest *request)=0;
             virtual CacheLine* insert(MemoryRequest *request,
                     W64& oldTag)=0;
+            // Same as above for accesses without a MemoryRequest
+            virtual CacheLine* probe(W64 physAddress)=0;
+            virtual CacheLine* insert(W64 physAddress, W64& oldTag)=0;
             virtual int invalidate(MemoryRequest *request)=0;
             virtual bool get_port(MemoryRequest *request)=0;
             virtual void print(ostream& os) const =0;
@@ -89,6 +96,13 @@ namespace Memory {
 			virtual int get_set_count() const=0;
 			virtual int get_way_count() const=0;
 			virtual int get_line_size() const=0;
+			virtual int get_read_ports() const=0;
+			virtual int get_write_ports() const=0;
+            // Memory holding the tags, lines and replacement state, saved
+            // and restored as the warm state of the cache
+            virtual void* state_base()=0;
+            virtual W64 state_size() const=0;
+			virtual ~CacheLinesBase() {}
     };
 
     template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
@@ -116,6 +130,8 @@ namespace Memory {
             int latency() const { return LATENCY; };
             CacheLine* probe(MemoryRequest *request);
             CacheLine* insert(MemoryRequest *request, W64& oldTag);
+            CacheLine* probe(W64 physAddress);
+            CacheLine* insert(W64 physAddress, W64& oldTag);
             int invalidate(MemoryRequest *request);
             bool get_port(MemoryRequest *request);
             void print(ostream& os) const;
@@ -163,6 +179,22 @@ namespace Memory {
             int get_access_latency() const {
                 return LATENCY;
             }
+
+            int get_read_ports() const {
+                return readPorts_;
+            }
+
+            int get_write_ports() const {
+                return writePorts_;
+            }
+
+            void* state_base() {
+                return base_t::sets;
+            }
+
+            W64 state_size() const {
+                return sizeof(base_t::sets);
+            }
     };
 
     template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
@@ -215,16 +247,26 @@ namespace Memory {
     template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
         CacheLine* CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::probe(MemoryRequest *request)
         {
-            W64 physAddress = request->get_physical_address();
+            return probe(request->get_physical_address());
+        }
+
+    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
+        CacheLine* CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::insert(MemoryRequest *request, W64& oldTag)
+        {
+            return insert(request->get_physical_address(), oldTag);
+        }
+
+    template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
+        CacheLine* CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::probe(W64 physAddress)
+        {
             CacheLine *line = base_t::probe(physAddress);
 
             return line;
         }
 
     template <int SET_COUNT, int WAY_COUNT, int LINE_SIZE, int LATENCY>
-        CacheLine* CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::insert(MemoryRequest *request, W64& oldTag)
+        CacheLine* CacheLines<SET_COUNT, WAY_COUNT, LINE_SIZE, LATENCY>::insert(W64 physAddress, W64& oldTag)
         {
-            W64 physAddress = request->get_physical_address();
             CacheLine *line = base_t::select(physAddress, oldTag);
 
             return line;
@@ -276,6 +318,174 @@ namespace Memory {
             }
         }
 
+    /**
+     * @brief Cache lines with geometry chosen at run time
+     *
+     * Same replacement policy (MRU bit vector pseudo-LRU) and interface as
+     * CacheLines, but sets, ways, line size and latency are constructor
+     * arguments so caches can be resized from simconfig without
+     * regenerating cacheTypes.cpp. Sets and ways must be powers of 2 and
+     * ways at most 64.
+     *
+     * Tags of a set are stored contiguously, apart from the lines, so a
+     * lookup compares all ways of a set with SIMD instructions when the
+     * host supports them.
+     */
+    class DynamicCacheLines : public CacheLinesBase
+    {
+        private:
+            int setCount_;
+            int wayCount_;
+            int lineSize_;
+            int latency_;
+            int lineBits_;
+            W64 setMask_;
+            W64 allWays_;
+
+            /*
+             * One block per set: tags of all ways, the MRU bit vector and
+             * then the lines, so a lookup touches a single region of memory
+             */
+            byte *sets_;
+            int setStride_;
+            int mruOffset_;
+            int linesOffset_;
+
+            int readPortUsed_;
+            int writePortUsed_;
+            int readPorts_;
+            int writePorts_;
+            W64 lastAccessCycle_;
+
+            int set_of(W64 address) const {
+                return (address >> lineBits_) & setMask_;
+            }
+
+            W64 line_tag(W64 address) const {
+                return address & ~W64(lineSize_ - 1);
+            }
+
+            W64* tags_of(int set) const {
+                return (W64*)(sets_ + set * setStride_);
+            }
+
+            W64& mru_of(int set) const {
+                return *(W64*)(sets_ + set * setStride_ + mruOffset_);
+            }
+
+            CacheLine* lines_of(int set) const {
+                return (CacheLine*)(sets_ + set * setStride_ + linesOffset_);
+            }
+
+            inline int match(int set, W64 tag) const;
+            int victim(int set) const;
+            void use(int set, int way);
+
+        public:
+            DynamicCacheLines(int setCount, int wayCount, int lineSize,
+                    int latency, int readPorts, int writePorts);
+            ~DynamicCacheLines();
+
+            void init();
+            W64 tagOf(W64 address);
+            int latency() const { return latency_; };
+            CacheLine* probe(MemoryRequest *request);
+            CacheLine* insert(MemoryRequest *request, W64& oldTag);
+            CacheLine* probe(W64 physAddress);
+            CacheLine* insert(W64 physAddress, W64& oldTag);
+            int invalidate(MemoryRequest *request);
+            bool get_port(MemoryRequest *request);
+            void print(ostream& os) const;
+
+            int get_size() const {
+                return (setCount_ * wayCount_ * lineSize_);
+            }
+
+            int get_set_count() const {
+                return setCount_;
+            }
+
+            int get_way_count() const {
+                return wayCount_;
+            }
+
+            int get_line_size() const {
+                return lineSize_;
+            }
+
+            int get_line_bits() const {
+                return lineBits_;
+            }
+
+            int get_access_latency() const {
+                return latency_;
+            }
+
+            int get_read_ports() const {
+                return readPorts_;
+            }
+
+            int get_write_ports() const {
+                return writePorts_;
+            }
+
+            void* state_base() {
+                return sets_;
+            }
+
+            W64 state_size() const {
+                return W64(setCount_) * setStride_;
+            }
+    };
+
+    inline int DynamicCacheLines::match(int set, W64 tag) const
+    {
+        const W64 *tags = tags_of(set);
+        int way = 0;
+
+#if defined(__AVX2__)
+        __m256i key4 = _mm256_set1_epi64x(tag);
+        for(; way + 4 <= wayCount_; way += 4) {
+            __m256i cmp = _mm256_cmpeq_epi64(key4,
+                    _mm256_load_si256((const __m256i*)&tags[way]));
+            int mask = _mm256_movemask_pd(_mm256_castsi256_pd(cmp));
+            if(mask)
+                return way + lsbindex(mask);
+        }
+#endif
+
+#if defined(__SSE4_1__)
+        __m128i key2 = _mm_set1_epi64x(tag);
+        for(; way + 2 <= wayCount_; way += 2) {
+            __m128i cmp = _mm_cmpeq_epi64(key2,
+                    _mm_load_si128((const __m128i*)&tags[way]));
+            int mask = _mm_movemask_pd(_mm_castsi128_pd(cmp));
+            if(mask)
+                return way + lsbindex(mask);
+        }
+#endif
+
+        for(; way < wayCount_; way++) {
+            if(tags[way] == tag)
+                return way;
+        }
+
+        return -1;
+    }
+
+    /**
+     * @brief Create cache lines for a cache controller
+     *
+     * Uses the compiled geometry of the cache type unless the
+     * 'cache-config' simconfig option overrides it for this controller, in
+     * which case DynamicCacheLines is used.
+     *
+     * @param type Cache type from cacheTypes.h
+     * @param name Name of the cache controller
+     *
+     * @return New cache lines
+     */
+    CacheLinesBase* create_cachelines(int type, const char *name);
 };
 
 #endif // CACHE_LINES_H
@@ -66,6 +66,11 @@ namespace Memory {
                 virtual void invalidate_line(CacheLine *line)              = 0;
                 virtual void handle_response(CacheQueueEntry *entry,
                         Message &message) = 0;
+
+                /* Functional warming, see Controller::warm_access */
+                virtual void warm_line(CacheLine *line, bool is_write,
+                        bool shared)                                       = 0;
+                virtual void warm_snoop(CacheLine *line, bool is_write)    = 0;
 				virtual void dump_configuration(YAML::Emitter &out) const = 0;
 
                 CacheController* controller;
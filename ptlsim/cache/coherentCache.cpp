@@ -38,6 +38,7 @@
 #include <mesiLogic.h>
 
 #include <machine.h>
+#include <warm-state.h>
 
 using namespace Memory;
 using namespace Memory::CoherentCache;
@@ -55,7 +56,7 @@ CacheController::CacheController(W8 coreid, const char *name,
     memoryHierarchy_->add_cache_mem_controller(this);
     new_stats = new MESIStats(name, &memoryHierarchy->get_machine());
 
-    cacheLines_ = get_cachelines(type);
+    cacheLines_ = create_cachelines(type, name);
 
     if(!memoryHierarchy_->get_machine().get_option(name, "last_private", isLowestPrivate_)) {
         isLowestPrivate_ = false;
@@ -490,6 +491,7 @@ void CacheController::get_directory(Interconnect *interconn)
                                 sg->controller);
                         assert(cont);
                         directory_ = *cont;
+                        memoryHierarchy_->disable_warming();
                         break;
                     case INTERCONN_TYPE_UPPER:
                         cont = machine.controller_hash.get(
@@ -505,6 +507,66 @@ void CacheController::get_directory(Interconnect *interconn)
     }
 }
 
+/**
+ * @brief Update a line of this private cache accessed by another core
+ * while fast-forwarding
+ *
+ * @return true if this cache still holds the line
+ */
+bool CacheController::warm_snoop(W8 coreid, W64 physaddr, bool is_write)
+{
+    if(!is_private() || idx == coreid)
+        return false;
+
+    CacheLine *line = cacheLines_->probe(physaddr);
+
+    if(!line || !is_line_valid(line))
+        return false;
+
+    coherence_logic_->warm_snoop(line, is_write);
+
+    return is_line_valid(line);
+}
+
+/**
+ * @brief Insert or update the line of an access made while
+ * fast-forwarding, if this cache is on the path of the access
+ */
+void CacheController::warm_access(W8 coreid, W64 physaddr, bool is_icache,
+        bool is_write, bool shared)
+{
+    if(is_private() && idx != coreid)
+        return;
+
+    if((type_ == L1_I_CACHE && !is_icache) ||
+            (type_ == L1_D_CACHE && is_icache))
+        return;
+
+    CacheLine *line = cacheLines_->probe(physaddr);
+
+    if(!line || !is_line_valid(line)) {
+        /* Evicted lines are dropped, upper caches keep their copies */
+        W64 oldTag = InvalidTag<W64>::INVALID;
+        line = cacheLines_->insert(physaddr, oldTag);
+        line->init(cacheLines_->tagOf(physaddr));
+        coherence_logic_->invalidate_line(line);
+    }
+
+    coherence_logic_->warm_line(line, is_write, shared);
+}
+
+void CacheController::save_warm_state(WarmStateFile &ws)
+{
+    ws.save(get_name(), cacheLines_->state_base(),
+            cacheLines_->state_size());
+}
+
+void CacheController::load_warm_state(WarmStateFile &ws)
+{
+    ws.restore(get_name(), cacheLines_->state_base(),
+            cacheLines_->state_size());
+}
+
 void CacheController::register_upper_interconnect(Interconnect *interconnect)
 {
     upperInterconnect_ = interconnect;
@@ -275,6 +275,12 @@ namespace Memory {
                 void annul_request(MemoryRequest *request);
 				void dump_configuration(YAML::Emitter &out) const;
 
+                bool warm_snoop(W8 coreid, W64 physaddr, bool is_write);
+                void warm_access(W8 coreid, W64 physaddr, bool is_icache,
+                        bool is_write, bool shared);
+                void save_warm_state(WarmStateFile &ws);
+                void load_warm_state(WarmStateFile &ws);
+
                 // Callback functions for signals of cache
                 virtual bool cache_hit_cb(void *arg);
                 virtual bool cache_miss_cb(void *arg);
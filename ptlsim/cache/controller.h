@@ -31,6 +31,9 @@
 #include <globals.h>
 #include <superstl.h>
 #include <memoryRequest.h>
+#include <host-profile.h>
+
+class WarmStateFile;
 
 namespace Memory {
 
@@ -98,8 +101,13 @@ class Controller
 			name_ << name;
 			isPrivate_ = false;
 
-			handle_interconnect_.connect(signal_mem_ptr \
-					(*this, &Controller::handle_interconnect_cb));
+			handle_interconnect_.connect(SIGNAL_MEM_FN \
+					(*this, &Controller::handle_interconnect_profiled));
+		}
+
+		bool handle_interconnect_profiled(void* arg) {
+			host_profile_scope(HPROF_CONTROLLER);
+			return handle_interconnect_cb(arg);
 		}
 
         virtual ~Controller()
@@ -119,6 +127,28 @@ class Controller
 		virtual void annul_request(MemoryRequest* request) = 0;
 		virtual void dump_configuration(YAML::Emitter &out) const = 0;
 
+		/*
+		 * Functional warming while QEMU fast-forwards: an access of core
+		 * 'coreid' updates the cache lines with no timing, messages or
+		 * statistics. warm_snoop() is called first on every controller
+		 * and returns true if another core's private cache still holds
+		 * the line afterwards, then warm_access() fills the caches on
+		 * the path of the access.
+		 */
+		virtual bool warm_snoop(W8 coreid, W64 physaddr, bool is_write) {
+			return false;
+		}
+		virtual void warm_access(W8 coreid, W64 physaddr, bool is_icache,
+				bool is_write, bool shared) { }
+
+		/*
+		 * Warm state saved next to a checkpoint: the controller saves
+		 * its tag arrays as sections named after itself, and restores
+		 * them when the simulation starts from that checkpoint.
+		 */
+		virtual void save_warm_state(WarmStateFile &ws) { }
+		virtual void load_warm_state(WarmStateFile &ws) { }
+
 		int flush() {
 			return 0;
 		}
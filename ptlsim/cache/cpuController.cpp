@@ -155,27 +155,58 @@ int CPUController::access_fast_path(Interconnect *interconnect,
 		MemoryRequest *request)
 {
 	int fastPathLat = 0;
-    bool kernel_req = request->is_kernel();
 
 	if likely (interconnect == NULL) {
 		// From CPU
-		if unlikely (request->is_instruction()) {
-
-			bool bufferHit = is_icache_buffer_hit(request);
-			if(bufferHit)
-				return 0;
-
-			fastPathLat = int_L1_i_->access_fast_path(this, request);
-            N_STAT_UPDATE(stats.icache_latency, [fastPathLat]++, kernel_req);
-		} else {
-			fastPathLat = int_L1_d_->access_fast_path(this, request);
-            N_STAT_UPDATE(stats.dcache_latency, [fastPathLat]++, kernel_req);
-		}
+		fastPathLat = fast_path_latency(request);
 	}
 
     if unlikely (fastPathLat == 0)
 		return 0;
 
+	return queue_request(request, fastPathLat);
+}
+
+/**
+ * @brief Look up a core request in the instruction buffer and the L1
+ *
+ * @return 0 for a hit in the instruction buffer, the latency of an L1 hit,
+ * or -1 if the request has to be sent to the L1
+ */
+int CPUController::fast_path_latency(MemoryRequest *request)
+{
+	int fastPathLat;
+    bool kernel_req = request->is_kernel();
+
+	if unlikely (request->is_instruction()) {
+
+		bool bufferHit = is_icache_buffer_hit(request);
+		if(bufferHit)
+			return 0;
+
+		fastPathLat = int_L1_i_->access_fast_path(this, request);
+        N_STAT_UPDATE(stats.icache_latency, [fastPathLat]++, kernel_req);
+	} else {
+		fastPathLat = int_L1_d_->access_fast_path(this, request);
+        N_STAT_UPDATE(stats.dcache_latency, [fastPathLat]++, kernel_req);
+	}
+
+	return fastPathLat;
+}
+
+/**
+ * @brief Add a core request to the pending queue
+ *
+ * @param request Request of the core
+ * @param fastPathLat Latency of an L1 hit, or -1 to send the request to
+ * the L1
+ *
+ * @return -1, the core is woken up when the request completes
+ */
+int CPUController::queue_request(MemoryRequest *request, int fastPathLat)
+{
+    bool kernel_req = request->is_kernel();
+
 	request->incRefCounter();
 	ADD_HISTORY_ADD(request);
 
@@ -296,7 +327,7 @@ void CPUController::finalize_request(CPUControllerQueueEntry *queueEntry)
 			*queueEntry, endl);
 	MemoryRequest *request = queueEntry->request;
 
-	int req_latency = sim_cycle - request->get_init_cycles();
+	int req_latency = core_cycle() - request->get_init_cycles();
 	req_latency = (req_latency >= 200) ? 199 : req_latency;
     bool kernel_req = request->is_kernel();
 
@@ -327,7 +358,10 @@ void CPUController::finalize_request(CPUControllerQueueEntry *queueEntry)
      * clear the full flag in memory hierarchy
      */
 	if likely (!pendingRequests_.isFull()) {
-		memoryHierarchy_->set_controller_full(this, false);
+		/* Flags are shared by all cores, parallel workers leave them to
+		 * MemoryHierarchy::end_quantum() */
+		if likely (!parallel_sim_active)
+			memoryHierarchy_->set_controller_full(this, false);
 		N_STAT_UPDATE(stats.queueFull, ++, request->is_kernel());
 	}
 }
@@ -431,6 +465,43 @@ void CPUController::clock()
 	}
 }
 
+/**
+ * @brief First cycle in which clock() finalizes a pending request
+ *
+ * @return Cycle number, or -1 if no request is counting down
+ */
+W64 CPUController::next_clock()
+{
+	W64 next = -1;
+	CPUControllerQueueEntry* queueEntry;
+
+	foreach_list_mutable(pendingRequests_.list(), queueEntry, entry_t,
+			prev_t) {
+		if(queueEntry->cycles > 0)
+			next = min(next, sim_cycle + queueEntry->cycles - 1);
+	}
+
+	return next;
+}
+
+/**
+ * @brief Count down pending requests for cycles that are not clocked
+ *
+ * @param cycles Number of skipped cycles, less than the cycles left of
+ * any pending request
+ */
+void CPUController::skip_cycles(W64 cycles)
+{
+	CPUControllerQueueEntry* queueEntry;
+
+	foreach_list_mutable(pendingRequests_.list(), queueEntry, entry_t,
+			prev_t) {
+		if(queueEntry->cycles > 0)
+			assert(W64(queueEntry->cycles) > cycles);
+		queueEntry->cycles -= cycles;
+	}
+}
+
 void CPUController::print(ostream& os) const
 {
 	os << "---CPU-Controller: "<< get_name()<< endl;
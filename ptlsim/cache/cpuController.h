@@ -146,6 +146,8 @@ class CPUController : public Controller
 		int access_fast_path(Interconnect *interconnect,
 				MemoryRequest *request);
 		void clock();
+		W64 next_clock();
+		void skip_cycles(W64 cycles);
         void register_interconnect(Interconnect *interconnect, int type);
 		void register_interconnect_L1_d(Interconnect *interconnect);
 		void register_interconnect_L1_i(Interconnect *interconnect);
@@ -167,6 +169,15 @@ class CPUController : public Controller
 			return access_fast_path(NULL, request);
 		}
 
+		// access() in two steps, for parallel workers that only serve L1
+		// hits themselves (see MemoryHierarchy::access_cache)
+		int fast_path_latency(MemoryRequest *request);
+		int queue_request(MemoryRequest *request, int fastPathLat);
+
+		int pending_remaining() const {
+			return pendingRequests_.remaining();
+		}
+
 		bool is_full(bool fromInterconnect = false) const {
 			return pendingRequests_.isFull();
 		}
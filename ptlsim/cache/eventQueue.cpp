@@ -0,0 +1,303 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * Copyright 2009 Avadh Patel <apatel@cs.binghamton.edu>
+ * Copyright 2009 Furat Afram <fafram@cs.binghamton.edu>
+ *
+ */
+
+#include <eventQueue.h>
+#include <memoryStats.h>
+
+using namespace Memory;
+
+#define EVENT_WHEEL_MASK (EVENT_WHEEL_SIZE - 1)
+
+EventQueue::EventQueue()
+    : currentClock_(0)
+    , count_(0)
+    , wheelCount_(0)
+    , nextSeq_(0)
+    , freeList_(NULL)
+    , stats_(NULL)
+{
+    foreach(i, EVENT_WHEEL_SIZE) {
+        wheel_[i].head = NULL;
+        wheel_[i].tail = NULL;
+    }
+}
+
+EventQueue::~EventQueue()
+{
+    foreach(i, chunks_.count()) {
+        delete[] chunks_[i];
+    }
+    chunks_.clear();
+}
+
+Event* EventQueue::alloc_event()
+{
+    if unlikely (freeList_ == NULL) {
+        Event *chunk = new Event[EVENT_POOL_CHUNK];
+        chunks_.push(chunk);
+
+        foreach(i, EVENT_POOL_CHUNK) {
+            chunk[i].next_ = freeList_;
+            freeList_ = &chunk[i];
+        }
+    }
+
+    Event *event = freeList_;
+    freeList_ = event->next_;
+    event->init();
+    return event;
+}
+
+void EventQueue::free_event(Event *event)
+{
+    event->next_ = freeList_;
+    freeList_ = event;
+}
+
+void EventQueue::push_bucket(Event *event)
+{
+    Bucket &bucket = wheel_[event->clock_ & EVENT_WHEEL_MASK];
+
+    event->next_ = NULL;
+    if(bucket.tail)
+        bucket.tail->next_ = event;
+    else
+        bucket.head = event;
+    bucket.tail = event;
+
+    wheelCount_++;
+}
+
+void EventQueue::push_overflow(Event *event)
+{
+    int idx = overflow_.count();
+    overflow_.push(event);
+
+    while(idx > 0) {
+        int parent = (idx - 1) / 2;
+        if(!is_before(overflow_[idx], overflow_[parent]))
+            break;
+        swap(overflow_[idx], overflow_[parent]);
+        idx = parent;
+    }
+}
+
+Event* EventQueue::pop_overflow()
+{
+    Event *top = overflow_[0];
+    Event *last = overflow_.pop();
+    int size = overflow_.count();
+
+    if(size == 0)
+        return top;
+
+    overflow_[0] = last;
+
+    int idx = 0;
+    while(true) {
+        int left = 2 * idx + 1;
+        int right = left + 1;
+        int smallest = idx;
+
+        if(left < size && is_before(overflow_[left], overflow_[smallest]))
+            smallest = left;
+        if(right < size && is_before(overflow_[right], overflow_[smallest]))
+            smallest = right;
+
+        if(smallest == idx)
+            break;
+
+        swap(overflow_[idx], overflow_[smallest]);
+        idx = smallest;
+    }
+
+    return top;
+}
+
+/*
+ * Move overflow events that are now within the wheel horizon into their
+ * buckets. The heap pops them in (clock, seq) order and all of them are
+ * older than any event added directly to the same bucket later on, so FIFO
+ * order within a cycle is kept.
+ */
+void EventQueue::migrate_overflow()
+{
+    while(overflow_.count() > 0 &&
+            overflow_[0]->clock_ < currentClock_ + EVENT_WHEEL_SIZE) {
+        push_bucket(pop_overflow());
+    }
+}
+
+void EventQueue::add(Signal *signal, W64 clock, void *arg)
+{
+    Event *event = alloc_event();
+    event->setup(signal, max(clock, currentClock_), arg);
+    event->seq_ = nextSeq_++;
+
+    /*
+     * Keep migrating before inserting so an event that lands in the wheel
+     * can never overtake an older event of the same clock still waiting in
+     * the overflow heap.
+     */
+    migrate_overflow();
+
+    if(event->clock_ < currentClock_ + EVENT_WHEEL_SIZE) {
+        push_bucket(event);
+    } else {
+        push_overflow(event);
+        if(stats_) stats_->overflowed++;
+    }
+
+    count_++;
+    if(stats_) stats_->scheduled++;
+}
+
+int EventQueue::dispatch(W64 cycle)
+{
+    int executed = 0;
+
+    if(currentClock_ > cycle)
+        return 0;
+
+    if(stats_) {
+        W64 elapsed = cycle + 1 - currentClock_;
+        stats_->occupancy += W64(count_) * elapsed;
+        stats_->cycles += elapsed;
+    }
+
+    while(currentClock_ <= cycle) {
+        if(count_ == 0) {
+            currentClock_ = cycle + 1;
+            break;
+        }
+
+        // Wheel is empty, jump directly to the first overflow event
+        if(wheelCount_ == 0) {
+            W64 next = overflow_[0]->clock_;
+            if(next > cycle) {
+                currentClock_ = cycle + 1;
+                migrate_overflow();
+                break;
+            }
+            currentClock_ = next;
+            migrate_overflow();
+        }
+
+        Bucket &bucket = wheel_[currentClock_ & EVENT_WHEEL_MASK];
+
+        while(bucket.head) {
+            Event *event = bucket.head;
+            bucket.head = event->next_;
+            if(bucket.head == NULL)
+                bucket.tail = NULL;
+
+            wheelCount_--;
+            count_--;
+
+            assert(event->clock_ == currentClock_);
+            if unlikely (!event->execute()) {
+                assert(0);
+            }
+            free_event(event);
+            executed++;
+        }
+
+        currentClock_++;
+        migrate_overflow();
+    }
+
+    if(stats_) stats_->executed += W64(executed);
+
+    return executed;
+}
+
+void EventQueue::skip(W64 cycles, bool count_stats)
+{
+    assert(next_clock() >= currentClock_ + cycles);
+
+    if(count_stats && stats_) {
+        stats_->occupancy += W64(count_) * cycles;
+        stats_->cycles += cycles;
+    }
+
+    currentClock_ += cycles;
+    migrate_overflow();
+}
+
+W64 EventQueue::next_clock() const
+{
+    if(wheelCount_ > 0) {
+        W64 clock = currentClock_;
+        while(wheel_[clock & EVENT_WHEEL_MASK].head == NULL)
+            clock++;
+        return clock;
+    }
+
+    if(overflow_.count() > 0)
+        return overflow_[0]->clock_;
+
+    return -1;
+}
+
+void EventQueue::reset()
+{
+    foreach(i, EVENT_WHEEL_SIZE) {
+        Event *event = wheel_[i].head;
+        while(event) {
+            Event *next = event->next_;
+            free_event(event);
+            event = next;
+        }
+        wheel_[i].head = NULL;
+        wheel_[i].tail = NULL;
+    }
+
+    while(overflow_.count() > 0)
+        free_event(overflow_.pop());
+
+    count_ = 0;
+    wheelCount_ = 0;
+}
+
+ostream& EventQueue::print(ostream& os) const
+{
+    os << "EventQueue< count:" << count_ << " clock:" << currentClock_;
+    os << " overflow:" << overflow_.count() << " >" << endl;
+
+    foreach(i, EVENT_WHEEL_SIZE) {
+        Event *event = wheel_[(currentClock_ + i) & EVENT_WHEEL_MASK].head;
+        while(event) {
+            os << "  ", *event;
+            event = event->next_;
+        }
+    }
+
+    foreach(i, overflow_.count()) {
+        os << "  ", *overflow_[i];
+    }
+
+    return os;
+}
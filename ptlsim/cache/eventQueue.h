@@ -0,0 +1,224 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ * Copyright 2009 Avadh Patel <apatel@cs.binghamton.edu>
+ * Copyright 2009 Furat Afram <fafram@cs.binghamton.edu>
+ *
+ */
+
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <globals.h>
+#include <superstl.h>
+
+#include <cacheConstants.h>
+
+namespace Memory {
+
+struct EventQueueStats;
+
+class Event
+{
+    private:
+        // Callback is copied from the signal so dispatch does not have to
+        // load the signal
+        Delegate func_;
+        Signal *signal_;
+        W64    clock_;
+        void   *arg_;
+
+        // Insertion order, breaks ties between events of the same clock
+        W64    seq_;
+
+        // Link in a wheel bucket or in the free list
+        Event  *next_;
+
+        friend class EventQueue;
+
+    public:
+        void init() {
+            signal_ = NULL;
+            clock_ = -1;
+            arg_ = NULL;
+            seq_ = 0;
+            next_ = NULL;
+        }
+
+        void setup(Signal *signal, W64 clock, void *arg) {
+            func_ = signal->get_delegate();
+            signal_ = signal;
+            clock_ = clock;
+            arg_ = arg;
+        }
+
+        bool execute() {
+            return func_(arg_);
+        }
+
+        W64 get_clock() const {
+            return clock_;
+        }
+
+        ostream& print(ostream& os) const {
+            os << "Event< ";
+            if(signal_)
+                os << "Signal:" << signal_->get_name() << " ";
+            os << "Clock:" << clock_ << " ";
+            os << "arg:" << arg_ ;
+            os << ">" << endl, flush;
+            return os;
+        }
+
+        bool operator ==(const Event &event) const {
+            return clock_ == event.clock_;
+        }
+
+        bool operator >(const Event &event) const {
+            return clock_ > event.clock_;
+        }
+
+        bool operator <(const Event &event) const {
+            return clock_ < event.clock_;
+        }
+
+        bool operator >=(const Event &event) const {
+            return clock_ >= event.clock_;
+        }
+};
+
+static inline ostream& operator <<(ostream& os, const Event& event) {
+    return event.print(os);
+}
+
+/**
+ * @brief Timing wheel of memory hierarchy events
+ *
+ * Events due within EVENT_WHEEL_SIZE cycles of the current clock are
+ * appended to the bucket of their clock, so both insert and dispatch are
+ * O(1). Events further in the future wait in a binary heap ordered by
+ * (clock, insertion order) and move into the wheel once it has turned far
+ * enough. Events of the same clock are executed in the order they were
+ * added, like the old sorted list did.
+ *
+ * Event storage grows in chunks of EVENT_POOL_CHUNK and is never returned
+ * until the queue is destroyed, so there is no fixed limit on the number of
+ * pending events.
+ */
+class EventQueue
+{
+    public:
+        EventQueue();
+        ~EventQueue();
+
+        /**
+         * @brief Schedule an event
+         *
+         * @param signal Signal to emit
+         * @param clock Cycle in which the signal is emitted, clocks that are
+         * already dispatched are executed in the next dispatch
+         * @param arg Argument passed to the signal
+         */
+        void add(Signal *signal, W64 clock, void *arg);
+
+        /**
+         * @brief Execute all events with clock <= cycle
+         *
+         * Events that are added to a cycle while it is dispatched are
+         * executed in the same call.
+         *
+         * @param cycle Last cycle to dispatch
+         *
+         * @return Number of executed events
+         */
+        int dispatch(W64 cycle);
+
+        /**
+         * @brief Move past cycles that have no events without dispatching
+         *
+         * @param cycles Number of cycles to skip, must end before
+         * next_clock()
+         * @param count_stats Count the skipped cycles in the queue stats,
+         * callers that replay measured stats themselves pass false
+         */
+        void skip(W64 cycles, bool count_stats = false);
+
+        /**
+         * @brief Clock of the earliest pending event
+         *
+         * @return Clock of the next event or -1 if queue is empty
+         */
+        W64 next_clock() const;
+
+        void reset();
+
+        int count() const { return count_; }
+        bool empty() const { return count_ == 0; }
+
+        void set_stats(EventQueueStats *stats) { stats_ = stats; }
+
+        ostream& print(ostream& os) const;
+
+    private:
+        struct Bucket {
+            Event *head;
+            Event *tail;
+        };
+
+        Bucket wheel_[EVENT_WHEEL_SIZE];
+
+        // First cycle that is not dispatched yet
+        W64 currentClock_;
+
+        int count_;
+        int wheelCount_;
+        W64 nextSeq_;
+
+        // Min-heap of events beyond the wheel horizon
+        dynarray<Event*> overflow_;
+
+        Event *freeList_;
+        dynarray<Event*> chunks_;
+
+        EventQueueStats *stats_;
+
+        Event* alloc_event();
+        void free_event(Event *event);
+
+        void push_bucket(Event *event);
+        void push_overflow(Event *event);
+        Event* pop_overflow();
+        void migrate_overflow();
+
+        static bool is_before(const Event *a, const Event *b) {
+            if(a->clock_ != b->clock_)
+                return a->clock_ < b->clock_;
+            return a->seq_ < b->seq_;
+        }
+};
+
+static inline ostream& operator <<(ostream& os, const EventQueue& queue) {
+    return queue.print(os);
+}
+
+};
+
+#endif // EVENT_QUEUE_H
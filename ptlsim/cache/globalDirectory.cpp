@@ -9,6 +9,7 @@
  */
 
 #include <globalDirectory.h>
+#include <warm-state.h>
 
 /* Local variables and functions */
 static W16 line_bits = log2(DIR_LINE_SIZE);
@@ -18,67 +19,594 @@ static W64 get_line_addr(W64 addr)
     return addr >> line_bits;
 }
 
+static inline bool is_pow2(W64 value)
+{
+    return value && !(value & (value - 1));
+}
+
+
+/*
+ * Sharer formats
+ */
+
+SharerFormat::SharerFormat()
+{
+    setup(DIR_SHARERS_FULL, NUM_SIM_CORES, 0, 1);
+}
+
+/**
+ * @brief Configure the format
+ *
+ * @param format One of DIR_SHARERS_*
+ * @param caches Number of cache ids to track
+ * @param pointers Cache ids per entry for limited format
+ * @param group Caches per bit for coarse format, 0 for the smallest group
+ * that fits all caches in one word
+ */
+void SharerFormat::setup(int format, int caches, int pointers, int group)
+{
+    format_    = format;
+    caches_    = caches;
+    pointers_  = pointers;
+    groupBits_ = 0;
+
+    switch (format) {
+        case DIR_SHARERS_FULL:
+            words_ = (caches + 63) / 64;
+            break;
+        case DIR_SHARERS_LIMITED:
+            assert(pointers > 0 && pointers <= DIR_MAX_POINTERS);
+            assert(caches < DIR_POINTER_OVERFLOW);
+            words_ = 1;
+            break;
+        case DIR_SHARERS_COARSE:
+            if (group <= 0) {
+                group = 1;
+                while (group * 64 < caches)
+                    group <<= 1;
+            }
+            assert(is_pow2(group));
+            groupBits_ = lsbindex(group);
+            words_ = (((caches + group - 1) >> groupBits_) + 63) / 64;
+            break;
+        default:
+            assert(0);
+    }
+}
+
+const char* SharerFormat::get_name() const
+{
+    static const char* names[] = {"full", "limited", "coarse"};
+    return names[format_];
+}
+
+void SharerFormat::clear(W64 *s) const
+{
+    foreach (i, words_)
+        s[i] = 0;
+}
+
+void SharerFormat::copy(W64 *dst, const W64 *src) const
+{
+    foreach (i, words_)
+        dst[i] = src[i];
+}
+
+void SharerFormat::add(W64 *s, int id) const
+{
+    if (format_ == DIR_SHARERS_LIMITED) {
+        int count = limited_count(s);
+
+        if (count == DIR_POINTER_OVERFLOW || test(s, id))
+            return;
+
+        if (count == pointers_) {
+            *s = W64(DIR_POINTER_OVERFLOW) << 56;
+            return;
+        }
+
+        *s &= ~(0xffULL << 56);
+        *s |= (W64(id) << (count * 8)) | (W64(count + 1) << 56);
+        return;
+    }
+
+    int bit = id >> groupBits_;
+    s[bit >> 6] |= 1ULL << (bit & 63);
+}
+
+void SharerFormat::remove(W64 *s, int id) const
+{
+    if (format_ == DIR_SHARERS_LIMITED) {
+        int count = limited_count(s);
+
+        if (count == DIR_POINTER_OVERFLOW)
+            return;
+
+        foreach (i, count) {
+            if (limited_pointer(s, i) != id)
+                continue;
+
+            /* Move the last pointer into the free slot */
+            W64 last = limited_pointer(s, count - 1);
+            W64 value = *s & ((1ULL << ((count - 1) * 8)) - 1);
+            value &= ~(0xffULL << (i * 8));
+            if (i != count - 1)
+                value |= last << (i * 8);
+            *s = value | (W64(count - 1) << 56);
+            return;
+        }
+        return;
+    }
+
+    /* A bit of a coarse group may still cover other sharers */
+    if (groupBits_)
+        return;
+
+    s[id >> 6] &= ~(1ULL << (id & 63));
+}
+
+bool SharerFormat::test(const W64 *s, int id) const
+{
+    if (format_ == DIR_SHARERS_LIMITED) {
+        int count = limited_count(s);
+
+        if (count == DIR_POINTER_OVERFLOW)
+            return (id < caches_);
+
+        foreach (i, count) {
+            if (limited_pointer(s, i) == id)
+                return true;
+        }
+        return false;
+    }
+
+    int bit = id >> groupBits_;
+    return (s[bit >> 6] >> (bit & 63)) & 1;
+}
+
+bool SharerFormat::empty(const W64 *s) const
+{
+    foreach (i, words_) {
+        if (s[i])
+            return false;
+    }
+    return true;
+}
+
+bool SharerFormat::exact(const W64 *s) const
+{
+    if (format_ == DIR_SHARERS_LIMITED)
+        return limited_count(s) != DIR_POINTER_OVERFLOW;
+
+    if (format_ == DIR_SHARERS_COARSE && groupBits_)
+        return empty(s);
+
+    return true;
+}
+
+/**
+ * @brief Number of caches that may share the line
+ */
+int SharerFormat::count(const W64 *s) const
+{
+    if (format_ == DIR_SHARERS_LIMITED) {
+        int count = limited_count(s);
+        return (count == DIR_POINTER_OVERFLOW) ? caches_ : count;
+    }
+
+    int count = 0;
+    foreach (i, words_)
+        count += popcount64(s[i]);
+
+    return count << groupBits_;
+}
+
+/**
+ * @brief Lowest cache id that may share the line, -1 if none
+ */
+int SharerFormat::first(const W64 *s) const
+{
+    if (format_ == DIR_SHARERS_LIMITED) {
+        int count = limited_count(s);
+        int id = -1;
+
+        if (count == DIR_POINTER_OVERFLOW)
+            return 0;
+
+        foreach (i, count) {
+            int ptr = limited_pointer(s, i);
+            if (id < 0 || ptr < id)
+                id = ptr;
+        }
+        return id;
+    }
+
+    foreach (i, words_) {
+        if (s[i])
+            return ((i * 64) + lsbindex64(s[i])) << groupBits_;
+    }
+    return -1;
+}
 
 /**
  * @brief Reset the directory entry
  */
 void DirectoryEntry::reset()
 {
-    present.reset();
     tag   = -1;
-    owner = -1;
+    owner = DIR_NO_OWNER;
     dirty = 0;
 	locked = 0;
+    pending_evicts = 0;
+    if (present)
+        clear_sharers();
 }
 
 void DirectoryEntry::init(W64 tag_)
 {
     tag   = tag_;
     dirty = 0;
-    owner = -1;
+    owner = DIR_NO_OWNER;
 	locked = 0;
-    present.reset();
+    pending_evicts = 0;
+    clear_sharers();
 }
 
-Directory::Directory()
+bool DirectoryEntry::has_sharers() const
 {
-    entries = new base_t();
+    return !Directory::sharers().empty(present);
+}
+
+bool DirectoryEntry::is_sharer(int id) const
+{
+    return Directory::sharers().test(present, id);
+}
+
+bool DirectoryEntry::sharers_exact() const
+{
+    return Directory::sharers().exact(present);
+}
+
+int DirectoryEntry::sharer_count() const
+{
+    return Directory::sharers().count(present);
+}
+
+int DirectoryEntry::first_sharer() const
+{
+    return Directory::sharers().first(present);
+}
+
+void DirectoryEntry::add_sharer(int id)
+{
+    Directory::sharers().add(present, id);
+}
+
+void DirectoryEntry::remove_sharer(int id)
+{
+    Directory::sharers().remove(present, id);
+}
+
+void DirectoryEntry::clear_sharers()
+{
+    Directory::sharers().clear(present);
+}
+
+void DirectoryEntry::copy_sharers(const DirectoryEntry &e)
+{
+    Directory::sharers().copy(present, e.present);
+}
+
+ostream& DirectoryEntry::print(ostream &os) const
+{
+    os << "tag:" << (void*)tag << " dirty:" << dirty << " owner:" << owner;
+    os << " present:";
+
+    if (!sharers_exact())
+        os << "~";
+
+    foreach (i, NUM_SIM_CORES) {
+        if (is_sharer(i))
+            os << i << ",";
+    }
+
+    return os;
+}
+
+/*
+ * @brief Report a directory option that is out of range. Release builds
+ * have no assert, so the caller goes on with 'used' instead.
+ */
+static void directory_option_error(const char *name, const char *opt_name,
+        int value, const char *valid, int used)
+{
+    stringbuf err;
+    err << "::ERROR::Directory ", name, " option ", opt_name, " is ", value,
+        ", ", valid, "; using ", used, endl;
+    ptl_logfile << err;
+    cerr << err;
+    assert(0);
+}
+
+Directory::Directory(BaseMachine &machine, const char *name)
+    : portsUsed_(0)
+      , lastAccessCycle_(0)
+{
+    int ways;
+    int pointers;
+    int group;
+    stringbuf format;
+
+    if (!machine.get_option(name, "sets", setCount_))
+        setCount_ = DIR_SET;
+    if (!machine.get_option(name, "ways", ways))
+        ways = DIR_WAY;
+    if (!machine.get_option(name, "latency", latency_))
+        latency_ = DIR_ACCESS_DELAY;
+    if (!machine.get_option(name, "ports", ports_))
+        ports_ = 0;
+    if (!machine.get_option(name, "pointers", pointers))
+        pointers = 4;
+    if (!machine.get_option(name, "coarse_group", group))
+        group = 0;
+
+    if (!machine.get_option(name, "sharers", format))
+        format << "full";
+
+    if (setCount_ < 1 || !is_pow2(setCount_)) {
+        int sets = 1;
+        while (sets * 2 <= setCount_)
+            sets <<= 1;
+        directory_option_error(name, "sets", setCount_,
+                "it must be a power of two", sets);
+        setCount_ = sets;
+    }
+
+    if (ways < 1 || ways > 64) {
+        int clamped = (ways < 1) ? 1 : 64;
+        directory_option_error(name, "ways", ways,
+                "it must be between 1 and 64", clamped);
+        ways = clamped;
+    }
+
+    if (strcmp(format.buf, "limited") == 0 &&
+            (pointers < 1 || pointers > DIR_MAX_POINTERS)) {
+        int clamped = (pointers < 1) ? 1 : DIR_MAX_POINTERS;
+        stringbuf valid;
+        valid << "it must be between 1 and ", DIR_MAX_POINTERS;
+        directory_option_error(name, "pointers", pointers, valid.buf,
+                clamped);
+        pointers = clamped;
+    }
+
+    if (strcmp(format.buf, "coarse") == 0 &&
+            group != 0 && (group < 0 || !is_pow2(group))) {
+        directory_option_error(name, "coarse_group", group,
+                "it must be 0 or a power of two", 0);
+        group = 0;
+    }
+
+    if (strcmp(format.buf, "full") == 0) {
+        format_.setup(DIR_SHARERS_FULL, NUM_SIM_CORES, 0, 0);
+    } else if (strcmp(format.buf, "limited") == 0) {
+        format_.setup(DIR_SHARERS_LIMITED, NUM_SIM_CORES, pointers, 0);
+    } else if (strcmp(format.buf, "coarse") == 0) {
+        format_.setup(DIR_SHARERS_COARSE, NUM_SIM_CORES, 0, group);
+    } else {
+        stringbuf err;
+        err << "::ERROR::Unknown directory sharer format '" << format.buf <<
+            "' for " << name << ", use full, limited or coarse;" <<
+            " using full" << endl;
+        ptl_logfile << err;
+        cerr << err;
+        assert(0);
+        format_.setup(DIR_SHARERS_FULL, NUM_SIM_CORES, 0, 0);
+    }
+
+    wayCount_ = ways;
+
+    lineBits_ = lsbindex(DIR_LINE_SIZE);
+    setMask_  = setCount_ - 1;
+    allWays_  = (wayCount_ < 64) ? ((1ULL << wayCount_) - 1) : -1ULL;
+
+    int entries = setCount_ * wayCount_;
+    int words   = format_.get_words();
+
+    tags_     = new W64[entries];
+    mru_      = new W64[setCount_];
+    entries_  = new DirectoryEntry[entries];
+    sharers_  = new W64[W64(entries) * words];
+
+    foreach (i, entries) {
+        tags_[i] = InvalidTag<W64>::INVALID;
+        entries_[i].present = &sharers_[W64(i) * words];
+        entries_[i].reset();
+    }
+
+    foreach (i, setCount_)
+        mru_[i] = 0;
+
+    ptl_logfile << "Global directory: ", setCount_, " sets, ", wayCount_,
+                " ways, ", format_.get_name(), " sharers in ", words,
+                " words per entry", endl;
+}
+
+int Directory::match(int set, W64 tag) const
+{
+    const W64 *tags = &tags_[set * wayCount_];
+
+    foreach (way, wayCount_) {
+        if (tags[way] == tag)
+            return way;
+    }
+
+    return -1;
+}
+
+/*
+ * Same policy as the cache lines: the first way without its MRU bit set
+ * is the victim.
+ */
+int Directory::victim(int set) const
+{
+    W64 unused = ~mru_[set] & allWays_;
+
+    return unused ? lsbindex64(unused) : 0;
+}
+
+void Directory::use(int set, int way)
+{
+    mru_[set] |= (1ULL << way);
+    if (mru_[set] == allWays_)
+        mru_[set] = (1ULL << way);
 }
 
 DirectoryEntry* Directory::insert(MemoryRequest *req, W64& old_tag)
 {
     W64 phys_addr = req->get_physical_address();
-    DirectoryEntry* entry = entries->select(phys_addr, old_tag);
+    W64 tag = line_tag(phys_addr);
+    int set = set_of(phys_addr);
+    int way = match(set, tag);
+
+    if (way < 0) {
+        way = victim(set);
+        old_tag = tags_[set * wayCount_ + way];
+        tags_[set * wayCount_ + way] = tag;
+    }
 
-    return entry;
+    use(set, way);
+
+    return &entries_[set * wayCount_ + way];
 }
 
 DirectoryEntry* Directory::probe(MemoryRequest *req)
 {
     W64 phys_addr = req->get_physical_address();
-    DirectoryEntry* entry = entries->probe(phys_addr);
+    int set = set_of(phys_addr);
+    int way = match(set, line_tag(phys_addr));
 
-    return entry;
+    if (way < 0)
+        return NULL;
+
+    use(set, way);
+
+    return &entries_[set * wayCount_ + way];
 }
 
 int Directory::invalidate(MemoryRequest *req)
 {
-    return entries->invalidate(req->get_physical_address());
+    W64 phys_addr = req->get_physical_address();
+    int set = set_of(phys_addr);
+    int way = match(set, line_tag(phys_addr));
+
+    if (way < 0)
+        return -1;
+
+    tags_[set * wayCount_ + way] = InvalidTag<W64>::INVALID;
+    mru_[set] &= ~(1ULL << way);
+    entries_[set * wayCount_ + way].reset();
+
+    return way;
+}
+
+/**
+ * @brief Claim one of the directory lookup ports for this cycle
+ *
+ * @return false if all ports are used in this cycle
+ */
+bool Directory::get_port()
+{
+    if (ports_ == 0)
+        return true;
+
+    if (lastAccessCycle_ < sim_cycle) {
+        lastAccessCycle_ = sim_cycle;
+        portsUsed_ = 0;
+    }
+
+    if (portsUsed_ >= ports_)
+        return false;
+
+    portsUsed_++;
+    return true;
+}
+
+/**
+ * @brief Save tags, MRU bits, sharers, owner and dirty bit of all entries
+ *
+ * Locks and pending evictions belong to requests in flight and are not
+ * saved.
+ */
+void Directory::save_state(WarmStateFile &ws)
+{
+    int entries = setCount_ * wayCount_;
+    W64 words = format_.get_words();
+    dynarray<W8> owners(entries);
+    dynarray<W8> dirty(entries);
+
+    foreach (i, entries) {
+        owners.push(entries_[i].owner);
+        dirty.push(entries_[i].dirty);
+    }
+
+    ws.save("directory_tags", tags_, sizeof(W64) * entries);
+    ws.save("directory_mru", mru_, sizeof(W64) * setCount_);
+    ws.save("directory_sharers", sharers_, sizeof(W64) * entries * words);
+    ws.save("directory_owners", owners.data, entries);
+    ws.save("directory_dirty", dirty.data, entries);
+}
+
+void Directory::load_state(WarmStateFile &ws)
+{
+    int entries = setCount_ * wayCount_;
+    W64 words = format_.get_words();
+    dynarray<W8> owners;
+    dynarray<W8> dirty;
+
+    owners.resize(entries);
+    dirty.resize(entries);
+
+    /* Tags, sharers and owners are only usable together */
+    if (!ws.restore("directory_owners", owners.data, entries) ||
+            !ws.restore("directory_dirty", dirty.data, entries) ||
+            !ws.restore("directory_tags", tags_, sizeof(W64) * entries)) {
+        return;
+    }
+
+    ws.restore("directory_mru", mru_, sizeof(W64) * setCount_);
+
+    if (!ws.restore("directory_sharers", sharers_,
+                sizeof(W64) * entries * words)) {
+        memset(sharers_, 0, sizeof(W64) * entries * words);
+    }
+
+    foreach (i, entries) {
+        DirectoryEntry &e = entries_[i];
+        e.tag = tags_[i];
+        e.owner = owners[i];
+        e.dirty = dirty[i];
+        e.locked = 0;
+        e.pending_evicts = 0;
+    }
 }
 
 Directory* Directory::dir = NULL;
+SharerFormat Directory::format_;
 FixStateList<DirContBufferEntry, REQ_Q_SIZE>*
 DirectoryController::pendingRequests_ = NULL;
 
 /**
  * @brief Get the global directory
  *
+ * @param machine Machine of the directory controllers
+ * @param name Controller whose options configure the directory
+ *
  * @return reference to global Directory
  */
-Directory& Directory::get_directory()
+Directory& Directory::get_directory(BaseMachine &machine, const char *name)
 {
     if (dir == NULL) {
-        dir = new Directory();
+        dir = new Directory(machine, name);
         DirectoryController::pendingRequests_ =
             new FixStateList<DirContBufferEntry, REQ_Q_SIZE>();
     }
@@ -94,10 +622,18 @@ DirectoryController* DirectoryController::dir_controllers[NUM_SIM_CORES] = {0};
 DirectoryController::DirectoryController(W8 idx, const char *name,
         MemoryHierarchy *memoryHierarchy)
     : Controller(idx, name, memoryHierarchy)
-      , dir_(Directory::get_directory())
+      , dir_(Directory::get_directory(memoryHierarchy->get_machine(), name))
+      , new_stats(name, &memoryHierarchy->get_machine())
 {
     memoryHierarchy_->add_cache_mem_controller(this);
 
+    int words = Directory::sharers().get_words();
+    dummy_sharers_ = new W64[REQ_Q_SIZE * words];
+    foreach (i, REQ_Q_SIZE) {
+        dummy_entries[i].present = &dummy_sharers_[i * words];
+        dummy_entries[i].reset();
+    }
+
     req_handlers[MEMORY_OP_READ]   = &DirectoryController::
         handle_read_miss;
     req_handlers[MEMORY_OP_WRITE]  = &DirectoryController::
@@ -125,6 +661,11 @@ DirectoryController::DirectoryController(W8 idx, const char *name,
             &DirectoryController::send_msg_cb);
 }
 
+DirectoryController::~DirectoryController()
+{
+    delete[] dummy_sharers_;
+}
+
 bool DirectoryController::handle_interconnect_cb(void *arg)
 {
     Message *message = (Message*)arg;
@@ -201,7 +742,8 @@ bool DirectoryController::handle_read_miss(Message *msg)
         memdebug("Dir  request has completed, waking up dependents " <<
                 *queueEntry << endl);
         /* This request has completed.. So finalize it */
-        queueEntry->entry->present.set(queueEntry->cont->idx);
+        add_sharer(queueEntry->entry, queueEntry->cont->idx,
+                queueEntry->request);
         if (!queueEntry->shared) {
             queueEntry->entry->owner = queueEntry->cont->idx;
             queueEntry->entry->dirty = 0;
@@ -237,7 +779,8 @@ bool DirectoryController::handle_write_miss(Message *msg)
         memdebug("Dir  request has completed, waking up dependents " <<
                 *queueEntry << endl);
         /* This request has completed.. So finalize it */
-        queueEntry->entry->present.set(queueEntry->cont->idx);
+        add_sharer(queueEntry->entry, queueEntry->cont->idx,
+                queueEntry->request);
         queueEntry->entry->owner = queueEntry->cont->idx;
         queueEntry->entry->dirty = 1;
 
@@ -298,7 +841,10 @@ bool DirectoryController::read_miss_cb(void *arg)
     DirectoryEntry *dir_entry      = get_directory_entry(queueEntry->request);
     DirectoryController *sig_dir   = this;
 
-    if (!dir_entry) {
+    if (!dir_entry || !dir_.get_port()) {
+        if (dir_entry)
+            N_STAT_UPDATE(new_stats.port_conflicts, ++,
+                    queueEntry->request->is_kernel());
         // Retry after 1 cycle
         marss_add_event(&read_miss, 1, queueEntry);
         return true;
@@ -318,18 +864,18 @@ bool DirectoryController::read_miss_cb(void *arg)
 
         if (sig_dir == this && dir_entry->owner != queueEntry->cont->idx) {
             queueEntry->responder = controllers[dir_entry->owner];
-            marss_add_event(&send_response, DIR_ACCESS_DELAY,
+            marss_add_event(&send_response, dir_.get_latency(),
                     queueEntry);
         } else {
             queueEntry->responder = lower_cont;
             marss_add_event(&sig_dir->send_update,
-                    DIR_ACCESS_DELAY, queueEntry);
+                    dir_.get_latency(), queueEntry);
         }
 
         return true;
     }
 
-    if (dir_entry->present.nonzero() &&
+    if (dir_entry->has_sharers() && dir_entry->has_owner() &&
             dir_controllers[dir_entry->owner] == this) {
         // Set Owner as responder if its in local group, else
         // set lower cache as responder
@@ -338,11 +884,11 @@ bool DirectoryController::read_miss_cb(void *arg)
         queueEntry->responder = lower_cont;
     }
 
-    if (dir_entry->present.test(queueEntry->cont->idx))
+    if (dir_entry->is_sharer(queueEntry->cont->idx))
         queueEntry->responder = lower_cont;
 
     // Send response back
-    marss_add_event(&send_response, DIR_ACCESS_DELAY,
+    marss_add_event(&send_response, dir_.get_latency(),
             queueEntry);
 
     return true;
@@ -356,7 +902,10 @@ bool DirectoryController::write_miss_cb(void *arg)
     DirectoryEntry *dir_entry = get_directory_entry(queueEntry->request);
     DirectoryController *sig_dir = this;
 
-    if (!dir_entry || dir_entry->locked) {
+    if (!dir_entry || dir_entry->locked || !dir_.get_port()) {
+        if (dir_entry && !dir_entry->locked)
+            N_STAT_UPDATE(new_stats.port_conflicts, ++,
+                    queueEntry->request->is_kernel());
         // Retry after 1 cycle
         marss_add_event(&write_miss, 1, queueEntry);
         return true;
@@ -368,33 +917,34 @@ bool DirectoryController::write_miss_cb(void *arg)
     memdebug("Write miss handling in Directory with entry: " <<
             *dir_entry << endl);
 
-    if (dir_entry->present.iszero()) {
+    if (!dir_entry->has_sharers()) {
         // Line is not cached.
         queueEntry->responder = lower_cont;
         dir_entry->dirty      = 1;
         dir_entry->owner      = cont_id;
-    } else if (!dir_entry->present.test(cont_id)) {
+    } else if (!dir_entry->is_sharer(cont_id)) {
         // Its not present in requested cache
         queueEntry->responder = lower_cont;
-        sig_dir               = dir_controllers[dir_entry->owner];
+        sig_dir               = owner_dir(dir_entry);
         marss_add_event(&sig_dir->send_evict,
-                DIR_ACCESS_DELAY, queueEntry);
+                dir_.get_latency(), queueEntry);
         return true;
     } else {
         // Check if it was present in only requested cache
-        dir_entry->present.reset(cont_id);
+        dir_entry->remove_sharer(cont_id);
 
-        if (dir_entry->present.nonzero()) {
+        if (dir_entry->has_sharers()) {
             // Send evict msg to other caches
             queueEntry->responder = lower_cont;
-            sig_dir               = dir_controllers[dir_entry->owner];
+            sig_dir               = owner_dir(dir_entry);
             marss_add_event(&sig_dir->send_evict,
-                    DIR_ACCESS_DELAY, queueEntry);
+                    dir_.get_latency(), queueEntry);
             return true;
         }
 
         dir_entry->dirty = 1;
-        dir_entry->present.set(cont_id);
+        dir_entry->owner = cont_id;
+        dir_entry->add_sharer(cont_id);
 
         /* This line was present in only requested controller so
          * we send response back to same controller and set hasData
@@ -403,7 +953,7 @@ bool DirectoryController::write_miss_cb(void *arg)
     }
 
     marss_add_event(&send_response,
-            DIR_ACCESS_DELAY, queueEntry);
+            dir_.get_latency(), queueEntry);
 
     return true;
 }
@@ -481,27 +1031,37 @@ bool DirectoryController::evict_cb(void *arg)
 
     int cont_id = queueEntry->cont->idx;
 
-    dir_entry->present.reset(cont_id);
+    dir_entry->remove_sharer(cont_id);
 
     if (dir_entry->owner == cont_id) {
-        if (dir_entry->present.iszero()) {
-            dir_entry->owner = -1;
+        if (!dir_entry->has_sharers()) {
+            dir_entry->owner = DIR_NO_OWNER;
             dir_entry->dirty = 0;
+        } else if (dir_entry->sharers_exact()) {
+            dir_entry->owner = dir_entry->first_sharer();
         } else {
-            dir_entry->owner = dir_entry->present.lsb();
+            /* The owner wrote back its data, any remaining sharer only
+             * has a clean copy, so the lower cache responds from now on */
+            dir_entry->owner = DIR_NO_OWNER;
+            dir_entry->dirty = 0;
         }
     }
 
-    if (dir_entry->present.iszero() && queueEntry->origin != -1) {
-        // All cached lines are evicted.
+    if (queueEntry->dir_evict && queueEntry->origin != -1) {
         // If origin is present means, this was a cache_miss request
         DirContBufferEntry *origEntry = get_entry(queueEntry->origin);
-        if (origEntry) {
+        if (origEntry && --origEntry->pending_evicts == 0) {
+            // All cached lines are evicted.
+            dir_entry->clear_sharers();
             DirectoryController *sig_dir = dir_controllers[
                 origEntry->cont->idx];
             marss_add_event(&sig_dir->send_response, 1,
                     origEntry);
         }
+    } else if (queueEntry->dir_evict && dir_entry->pending_evicts) {
+        // Replaced line, its entry is free once all caches dropped it
+        if (--dir_entry->pending_evicts == 0)
+            dir_entry->clear_sharers();
     }
 
     // Remove this queue entry
@@ -565,28 +1125,59 @@ bool DirectoryController::send_evict_cb(void *arg)
     if (queueEntry->annuled)
         return true;
 
+    DirectoryEntry *dir_entry = queueEntry->entry;
+    bool kernel = queueEntry->request->is_kernel();
+
+    /* An inexact entry may name the requesting cache or caches that do
+     * not exist, neither of them gets an evict message */
+    int requester = (queueEntry->cont) ? queueEntry->cont->idx : -1;
+    int targets = 0;
+
+    foreach (i, NUM_SIM_CORES) {
+        if (i != requester && controllers[i] && dir_entry->is_sharer(i))
+            targets++;
+    }
+
     /* Check if we have enough free entries in queue */
-    if (pendingRequests_->remaining() <
-            (int)queueEntry->entry->present.popcount()) {
+    if (pendingRequests_->remaining() < targets) {
         marss_add_event(&send_evict, 1, queueEntry);
         return true;
     }
 
 	/* While handling this request, if all other cache lines are
 	 * evicted then send response to this request. */
-	if (queueEntry->entry->present.iszero()) {
-		DirectoryController *sig_dir = dir_controllers[
-			queueEntry->cont->idx];
-		marss_add_event(&sig_dir->send_response, 1, queueEntry);
+	if (targets == 0) {
+		dir_entry->clear_sharers();
+		if (queueEntry->cont) {
+			DirectoryController *sig_dir = dir_controllers[
+				queueEntry->cont->idx];
+			marss_add_event(&sig_dir->send_response, 1, queueEntry);
+		} else if (queueEntry->free_on_success) {
+			ADD_HISTORY_REM(queueEntry->request);
+			queueEntry->request->decRefCounter();
+			pendingRequests_->free(queueEntry);
+		}
 		return true;
 	}
 
-	queueEntry->entry->locked = 1;
+	dir_entry->locked = 1;
+
+    if (queueEntry->cont) {
+        queueEntry->pending_evicts = targets;
+        N_STAT_UPDATE(new_stats.write_invalidations, += targets, kernel);
+    } else {
+        dir_entry->pending_evicts = targets;
+        N_STAT_UPDATE(new_stats.replacement_invalidations, += targets,
+                kernel);
+    }
+
+    if (!dir_entry->sharers_exact())
+        N_STAT_UPDATE(new_stats.inexact_invalidations, += targets, kernel);
 
     /* Now for each cached entry, send evict message to that
      * controller */
     foreach (i, NUM_SIM_CORES) {
-        if (!queueEntry->entry->present.test(i))
+        if (i == requester || !controllers[i] || !dir_entry->is_sharer(i))
             continue;
 
         DirContBufferEntry *newEntry = pendingRequests_->alloc();
@@ -600,6 +1191,7 @@ bool DirectoryController::send_evict_cb(void *arg)
         newEntry->request->set_op_type(MEMORY_OP_EVICT);
         newEntry->entry  = queueEntry->entry;
         newEntry->origin = (queueEntry->cont) ? queueEntry->idx : -1;
+        newEntry->dir_evict = 1;
 
         ADD_HISTORY_ADD(newEntry->request);
 
@@ -626,9 +1218,10 @@ bool DirectoryController::send_response_cb(void *arg)
     memdebug("Dir: Sending response: " << *queueEntry << endl);
 
     assert(queueEntry->entry);
-    queueEntry->entry->present.reset(queueEntry->cont->idx);
-    queueEntry->shared = queueEntry->entry->present.nonzero();
-    queueEntry->entry->present.set(queueEntry->cont->idx);
+    queueEntry->entry->remove_sharer(queueEntry->cont->idx);
+    queueEntry->shared = queueEntry->entry->has_sharers();
+    add_sharer(queueEntry->entry, queueEntry->cont->idx,
+            queueEntry->request);
 
 	queueEntry->entry->locked = 0;
 
@@ -803,7 +1396,9 @@ DirectoryEntry* DirectoryController::get_directory_entry(
         /* If we are removing any entry with cached line then we
          * must send evict signal to those caches. */
         if ((old_tag != InvalidTag<W64>::INVALID && old_tag != (W64)-1) &&
-                entry->present.nonzero()) {
+                entry->has_sharers()) {
+            N_STAT_UPDATE(new_stats.replacements, ++, req->is_kernel());
+
             DirContBufferEntry *newEntry = pendingRequests_->alloc();
 
             assert(newEntry);
@@ -851,14 +1446,12 @@ DirectoryEntry* DirectoryController::get_dummy_entry(DirectoryEntry *entry,
 {
     foreach (i, REQ_Q_SIZE) {
         DirectoryEntry* d_entry = &dummy_entries[i];
-        if (d_entry->present.iszero()) {
+        if (!d_entry->has_sharers() && !d_entry->pending_evicts) {
             // This entry is free. So use it.
             d_entry->tag   = old_tag;
             d_entry->dirty = entry->dirty;
             d_entry->owner = entry->owner;
-
-            foreach (j, NUM_SIM_CORES)
-                d_entry->present.assign(j, entry->present[j]);
+            d_entry->copy_sharers(*entry);
 
             return d_entry;
         }
@@ -869,6 +1462,32 @@ DirectoryEntry* DirectoryController::get_dummy_entry(DirectoryEntry *entry,
     return NULL;
 }
 
+/**
+ * @brief Directory controller of the line owner, or this one if the line
+ * has no known owner
+ */
+DirectoryController* DirectoryController::owner_dir(DirectoryEntry *entry)
+{
+    if (entry->has_owner() && dir_controllers[entry->owner])
+        return dir_controllers[entry->owner];
+
+    return this;
+}
+
+/**
+ * @brief Add a sharer to a directory entry, counting overflows
+ */
+void DirectoryController::add_sharer(DirectoryEntry *entry, int id,
+        MemoryRequest *req)
+{
+    bool exact = entry->sharers_exact();
+
+    entry->add_sharer(id);
+
+    if (exact && !entry->sharers_exact())
+        N_STAT_UPDATE(new_stats.overflows, ++, req->is_kernel());
+}
+
 void DirectoryController::wakeup_dependent(DirContBufferEntry *queueEntry)
 {
     if (queueEntry->depends >= 0) {
@@ -955,6 +1574,22 @@ void DirectoryController::annul_request(MemoryRequest *request)
     }
 }
 
+/**
+ * @brief All directory controllers share one directory, the first one
+ * saves or restores it
+ */
+void DirectoryController::save_warm_state(WarmStateFile &ws)
+{
+    if (!ws.has("directory_tags"))
+        dir_.save_state(ws);
+}
+
+void DirectoryController::load_warm_state(WarmStateFile &ws)
+{
+    if (!ws.is_restored("directory_tags"))
+        dir_.load_state(ws);
+}
+
 /**
  * @brief Dump Directory Configuration in YAML Format
  *
@@ -965,10 +1600,14 @@ void DirectoryController::dump_configuration(YAML::Emitter &out) const
 	out << YAML::Key << get_name() << YAML::Value << YAML::BeginMap;
 
 	YAML_KEY_VAL(out, "type", "directory");
-	YAML_KEY_VAL(out, "size", DIR_SET * DIR_WAY);
-	YAML_KEY_VAL(out, "line_size", DIR_LINE_SIZE);
-	YAML_KEY_VAL(out, "sets", DIR_SET);
-	YAML_KEY_VAL(out, "ways", DIR_WAY);
+	YAML_KEY_VAL(out, "size", dir_.get_set_count() * dir_.get_way_count());
+	YAML_KEY_VAL(out, "line_size", dir_.get_line_size());
+	YAML_KEY_VAL(out, "sets", dir_.get_set_count());
+	YAML_KEY_VAL(out, "ways", dir_.get_way_count());
+	YAML_KEY_VAL(out, "latency", dir_.get_latency());
+	YAML_KEY_VAL(out, "ports", dir_.get_ports());
+	YAML_KEY_VAL(out, "sharers", Directory::sharers().get_name());
+	YAML_KEY_VAL(out, "sharer_words", Directory::sharers().get_words());
 
 	out << YAML::EndMap;
 }
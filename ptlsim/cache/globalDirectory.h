@@ -16,36 +16,117 @@
 
 #include <cpuController.h>
 #include <memoryHierarchy.h>
+#include <memoryStats.h>
 
 #include <machine.h>
 
 using namespace Memory;
 
+/* Defaults, each can be changed with an option of the controller */
 #define DIR_SET 4096
 #define DIR_WAY 16
 #define DIR_LINE_SIZE 64
 #define DIR_ACCESS_DELAY 10
 #define REQ_Q_SIZE 128
 
+#define DIR_NO_OWNER ((W8)-1)
+
+/* Limited pointer entries keep up to this many cache ids in one word */
+#define DIR_MAX_POINTERS 7
+#define DIR_POINTER_OVERFLOW 0xff
+
+enum {
+    DIR_SHARERS_FULL,
+    DIR_SHARERS_LIMITED,
+    DIR_SHARERS_COARSE,
+};
+
+/**
+ * @brief Encoding of the caches that share a directory line
+ *
+ * Sharers of an entry are stored in get_words() W64 words:
+ *
+ *  full    : one bit per cache, always exact.
+ *  limited : up to 'pointers' cache ids. When one more cache shares the
+ *            line the entry overflows and every cache is a possible
+ *            sharer until the line is invalidated.
+ *  coarse  : one bit per group of caches, every cache of a marked group
+ *            is a possible sharer.
+ *
+ * An inexact entry can not forget a single cache, removing a sharer from
+ * it does nothing. Invalidations go to every possible sharer, and once all
+ * of them acknowledged the directory clears the entry.
+ */
+class SharerFormat {
+    private:
+        int format_;
+        int caches_;
+        int words_;
+        int pointers_;
+        int groupBits_;
+
+        int limited_count(const W64 *s) const {
+            return (*s >> 56) & 0xff;
+        }
+
+        int limited_pointer(const W64 *s, int i) const {
+            return (*s >> (i * 8)) & 0xff;
+        }
+
+    public:
+        SharerFormat();
+
+        void setup(int format, int caches, int pointers, int group);
+
+        int get_format() const { return format_; }
+        int get_words() const { return words_; }
+        int get_pointers() const { return pointers_; }
+        int get_group() const { return 1 << groupBits_; }
+        const char* get_name() const;
+
+        void clear(W64 *s) const;
+        void copy(W64 *dst, const W64 *src) const;
+        void add(W64 *s, int id) const;
+        void remove(W64 *s, int id) const;
+        bool test(const W64 *s, int id) const;
+        bool empty(const W64 *s) const;
+        bool exact(const W64 *s) const;
+        int  count(const W64 *s) const;
+        int  first(const W64 *s) const;
+};
+
 /**
  * @brief A Directory entry containing information for one line
+ *
+ * The sharers are kept outside of the entry, in the format the directory
+ * was configured with. 'pending_evicts' is only used by the entries that
+ * hold a replaced line until all its sharers are invalidated.
  */
 struct DirectoryEntry {
-    bitvec<NUM_SIM_CORES> present;
-    bool dirty;
+    W64 *present;
     W64  tag;
+    bool dirty;
     W8   owner;
-	bool locked;
+    bool locked;
+    W16  pending_evicts;
 
-    DirectoryEntry() { reset(); }
+    DirectoryEntry() : present(NULL) { reset(); }
     void reset();
     void init(W64 tag_);
 
-    ostream& print(ostream &os) const {
-        os << "tag:" << (void*)tag << " dirty:" << dirty << " owner:" << owner;
-        os << " present:" << present;
-        return os;
-    }
+    bool has_owner() const { return owner != DIR_NO_OWNER; }
+
+    bool has_sharers() const;
+    bool is_sharer(int id) const;
+    bool sharers_exact() const;
+    int  sharer_count() const;
+    int  first_sharer() const;
+    void add_sharer(int id);
+    void remove_sharer(int id);
+    void clear_sharers();
+    void copy_sharers(const DirectoryEntry &e);
+
+    ostream& print(ostream &os) const;
 };
 
 static inline ostream& operator <<(ostream &os, const DirectoryEntry &e)
@@ -59,33 +140,73 @@ static inline ostream& operator <<(ostream &os, const DirectoryEntry &e)
  * This is a singleton class so there is only one Global directory.
  * All directory controllers get access to this directory and should
  * simulate appropriate access delay. This directory is a set-assoc
- * structure. The size of the directory is statically set.
+ * structure whose geometry, sharer format, latency and number of
+ * lookups per cycle are read from the options of the first directory
+ * controller:
  *
- * TODO:
- *	- Allow configuration options to dynamically set directory size.
- *	- Simulate limited port access
+ *  sets, ways   : Size of the directory (default 4096 x 16)
+ *  sharers      : 'full', 'limited' or 'coarse' (default full)
+ *  pointers     : Cache ids per entry in 'limited' format (default 4)
+ *  coarse_group : Caches per bit in 'coarse' format (default the
+ *                 smallest group that fits all caches in 64 bits)
+ *  latency      : Access delay in cycles (default 10)
+ *  ports        : Lookups per cycle, 0 for unlimited (default 0)
  */
 class Directory {
     private:
-        Directory();
+        Directory(BaseMachine &machine, const char *name);
         static Directory* dir;
+        static SharerFormat format_;
+
+        int setCount_;
+        int wayCount_;
+        int lineBits_;
+        W64 setMask_;
+        W64 allWays_;
+
+        /* Tags and MRU bits of each set, then all entries and sharers */
+        W64 *tags_;
+        W64 *mru_;
+        DirectoryEntry *entries_;
+        W64 *sharers_;
+
+        int latency_;
+        int ports_;
+        int portsUsed_;
+        W64 lastAccessCycle_;
+
+        int set_of(W64 addr) const {
+            return (addr >> lineBits_) & setMask_;
+        }
 
-        typedef AssociativeArray<W64, DirectoryEntry, DIR_SET,
-                DIR_WAY, DIR_LINE_SIZE> base_t;
-        typedef FullyAssociativeArray<W64, DirectoryEntry, DIR_WAY,
-                NullAssociativeArrayStatisticsCollector<W64,
-                DirectoryEntry> > Set;
+        W64 line_tag(W64 addr) const {
+            return addr & ~W64((1 << lineBits_) - 1);
+        }
 
-        base_t* entries;
+        int match(int set, W64 tag) const;
+        int victim(int set) const;
+        void use(int set, int way);
 
     public:
-        static Directory& get_directory();
+        static Directory& get_directory(BaseMachine &machine,
+                const char *name);
+        static const SharerFormat& sharers() { return format_; }
 
         DirectoryEntry *insert(MemoryRequest *req, W64&old_tag);
         DirectoryEntry *probe(MemoryRequest *req);
         int             invalidate(MemoryRequest *req);
+        bool            get_port();
 
-        W64 tag_of(W64 addr) { return base_t::tagof(addr); }
+        void save_state(WarmStateFile &ws);
+        void load_state(WarmStateFile &ws);
+
+        W64 tag_of(W64 addr) { return line_tag(addr); }
+
+        int get_latency() const { return latency_; }
+        int get_ports() const { return ports_; }
+        int get_set_count() const { return setCount_; }
+        int get_way_count() const { return wayCount_; }
+        int get_line_size() const { return 1 << lineBits_; }
 };
 
 struct DirContBufferEntry : public FixStateListObject
@@ -101,6 +222,8 @@ struct DirContBufferEntry : public FixStateListObject
     bool            hasData;
     int             depends;
     int             origin;
+    int             pending_evicts;
+    bool            dir_evict;
 
     void init() {
         request         = NULL;
@@ -109,6 +232,8 @@ struct DirContBufferEntry : public FixStateListObject
         annuled         = 0;
         depends         = -1;
         origin          = -1;
+        pending_evicts  = 0;
+        dir_evict       = 0;
         shared          = 0;
         hasData         = 0;
         responder       = NULL;
@@ -159,6 +284,9 @@ class DirectoryController : public Controller {
         Interconnect *interconn_;
 
         DirectoryEntry dummy_entries[REQ_Q_SIZE];
+        W64           *dummy_sharers_;
+
+        DirectoryStats new_stats;
 
         /* Simple function dispatcher to handle memory request */
         typedef bool (DirectoryController::*req_handler)(Message *msg);
@@ -180,6 +308,7 @@ class DirectoryController : public Controller {
     public:
         DirectoryController(W8 idx, const char *name,
                 MemoryHierarchy *memoryHierachy);
+        ~DirectoryController();
 
         static FixStateList<DirContBufferEntry, REQ_Q_SIZE> *pendingRequests_;
 
@@ -191,6 +320,8 @@ class DirectoryController : public Controller {
         bool is_full(bool flag=false) const;
         void annul_request(MemoryRequest *request);
 		void dump_configuration(YAML::Emitter &out) const;
+		void save_warm_state(WarmStateFile &ws);
+		void load_warm_state(WarmStateFile &ws);
 
         bool handle_read_miss(Message *message);
         bool handle_write_miss(Message *message);
@@ -215,6 +346,8 @@ class DirectoryController : public Controller {
         DirectoryEntry* get_directory_entry(MemoryRequest *req,
                 bool must_present=0);
         DirectoryEntry* get_dummy_entry(DirectoryEntry *entry, W64 old_tag);
+        DirectoryController* owner_dir(DirectoryEntry *entry);
+        void add_sharer(DirectoryEntry *entry, int id, MemoryRequest *req);
 };
 
 static inline ostream& operator << (ostream &os, const
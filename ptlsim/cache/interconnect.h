@@ -54,8 +54,13 @@ class Interconnect
 			, memoryHierarchy_(memoryHierarchy)
 		{
 			name_ << name;
-			controller_request_.connect(signal_mem_ptr(*this,
-						&Interconnect::controller_request_cb));
+			controller_request_.connect(SIGNAL_MEM_FN(*this,
+						&Interconnect::controller_request_profiled));
+		}
+
+		bool controller_request_profiled(void *arg) {
+			host_profile_scope(HPROF_INTERCONNECT);
+			return controller_request_cb(arg);
 		}
 
         virtual ~Interconnect()
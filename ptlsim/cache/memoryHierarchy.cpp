@@ -44,6 +44,7 @@
 
 #include <cpuController.h>
 #include <memoryController.h>
+#include <host-profile.h>
 
 #include <yaml/yaml.h>
 
@@ -52,6 +53,7 @@ using namespace Memory;
 MemoryHierarchy::MemoryHierarchy(BaseMachine& machine) :
     machine_(machine)
     , someStructIsFull_(false)
+    , warmingDisabled_(false)
 {
     coreNo_ = machine_.get_num_cores();
 
@@ -59,6 +61,26 @@ MemoryHierarchy::MemoryHierarchy(BaseMachine& machine) :
         RequestPool* pool = new RequestPool();
         requestPool_.push(pool);
     }
+
+    eventStats_ = new EventQueueStats("memory_events", &machine_);
+    eventStats_->set_default_stats(user_stats);
+    eventQueue_.set_stats(eventStats_);
+
+    foreach(i, NUM_SIM_CORES) {
+        deferredNext_[i] = 0;
+    }
+    replayEnd_ = 0;
+
+    traceWriter_ = NULL;
+    if(config.mem_trace_file.set()) {
+        traceWriter_ = new MemoryTraceWriter();
+        if(!traceWriter_->open(config.mem_trace_file)) {
+            ptl_logfile << "Unable to create memory trace ",
+                        config.mem_trace_file, endl;
+            delete traceWriter_;
+            traceWriter_ = NULL;
+        }
+    }
 }
 
 MemoryHierarchy::~MemoryHierarchy()
@@ -68,9 +90,73 @@ MemoryHierarchy::~MemoryHierarchy()
         delete pool;
     }
     requestPool_.clear();
+
+    eventQueue_.set_stats(NULL);
+    delete eventStats_;
+
+    if(traceWriter_) {
+        flush_trace();
+        delete traceWriter_;
+    }
+}
+
+/**
+ * @brief Write out the buffered memory trace records
+ *
+ * Called when the stats are flushed at the end of a simulation run, as
+ * QEMU may go on after '-stop' or quit on a guest poweroff without the
+ * hierarchy being deleted.
+ */
+void MemoryHierarchy::flush_trace()
+{
+    if(!traceWriter_)
+        return;
+
+    traceWriter_->flush();
+    ptl_logfile << "Memory trace: ", traceWriter_->get_count(),
+                " requests written to ", config.mem_trace_file, endl;
 }
 
 bool MemoryHierarchy::access_cache(MemoryRequest *request)
+{
+	if unlikely (parallel_sim_active) {
+		W8 coreid = request->get_coreid();
+		CPUController *cpuController = (CPUController*)cpuControllers_[coreid];
+		assert(cpuController != NULL);
+
+		/*
+		 * The core runs ahead of the rest of the hierarchy until the end
+		 * of the quantum. Its CPU controller and L1 caches are only used
+		 * by this worker, so hits in the instruction buffer and the L1
+		 * are served here with their normal latency, like in serial mode.
+		 * Everything else waits for the end of the quantum. The last two
+		 * entries of the pending queue are left to the main thread, which
+		 * sets the full flags of all controllers.
+		 */
+		int latency = cpuController->fast_path_latency(request);
+
+		if unlikely (traceWriter_)
+			defer(DEFERRED_TRACE, coreid, request, latency);
+
+		if(latency == 0)
+			return true;
+
+		if(latency > 0 && cpuController->pending_remaining() > 1) {
+			cpuController->queue_request(request, latency);
+			return false;
+		}
+
+		defer(DEFERRED_ACCESS, coreid, request, latency);
+		return (request->get_type() == MEMORY_OP_WRITE);
+	}
+
+	if unlikely (traceWriter_)
+		record_trace(request);
+
+	return issue_access(request);
+}
+
+bool MemoryHierarchy::issue_access(MemoryRequest *request)
 {
 	W8 coreid = request->get_coreid();
 	CPUController *cpuController = (CPUController*)cpuControllers_[coreid];
@@ -88,8 +174,104 @@ bool MemoryHierarchy::access_cache(MemoryRequest *request)
 	return false;
 }
 
-void MemoryHierarchy::clock()
+void MemoryHierarchy::record_trace(MemoryRequest *request)
+{
+	MemoryTraceRecord record;
+	record.cycle = sim_cycle;
+	record.physicalAddress = request->get_physical_address();
+	record.coreId = request->get_coreid();
+	record.threadId = request->get_threadid();
+	record.isInstruction = request->is_instruction();
+	record.isWrite = (request->get_type() == MEMORY_OP_WRITE);
+	traceWriter_->record(record);
+}
+
+/**
+ * @brief Queue a core request until the end of the parallel quantum
+ *
+ * Runs on a worker thread, each worker has its own queue. The request is
+ * held by a reference so its pool doesn't reuse it before it is issued.
+ *
+ * @param type What to do with the request, one of DEFERRED_*
+ * @param coreid Core that made the request
+ * @param request Request, or NULL for a flush
+ * @param latency L1 latency found by the worker, see
+ * CPUController::fast_path_latency()
+ */
+void MemoryHierarchy::defer(int type, int coreid, MemoryRequest *request,
+		int latency)
+{
+	assert(parallel_worker_id >= 0 && parallel_worker_id < NUM_SIM_CORES);
+
+	DeferredAccess& entry = deferred_[parallel_worker_id].push();
+	entry.cycle = core_cycle();
+	entry.type = type;
+	entry.coreid = coreid;
+	entry.latency = latency;
+	entry.request = request;
+
+	if(request)
+		request->incRefCounter();
+}
+
+/**
+ * @brief Issue the requests the workers made in the current cycle
+ *
+ * Called on the main thread at the end of a parallel quantum, once for
+ * each cycle of the quantum after clock_shared(), which is where the cores
+ * make their requests in serial mode. Workers are issued in core order, so
+ * the result doesn't depend on how the host scheduled them. The worker
+ * already looked the requests up in the L1, so they go straight to the
+ * pending queue of the CPU controller.
+ *
+ * @return Number of requests issued
+ */
+int MemoryHierarchy::issue_deferred()
+{
+	int issued = 0;
+
+	foreach(i, NUM_SIM_CORES) {
+		dynarray<DeferredAccess>& queue = deferred_[i];
+		int& next = deferredNext_[i];
+
+		while(next < queue.count() && queue[next].cycle <= sim_cycle) {
+			DeferredAccess& entry = queue[next++];
+
+			switch(entry.type) {
+				case DEFERRED_ACCESS:
+					((CPUController*)cpuControllers_[entry.coreid])->
+						queue_request(entry.request, entry.latency);
+					break;
+				case DEFERRED_ANNUL:
+					issue_annul(entry.coreid, entry.request);
+					break;
+				case DEFERRED_FLUSH:
+					issue_flush(entry.coreid);
+					break;
+				case DEFERRED_TRACE:
+					record_trace(entry.request);
+					break;
+			}
+
+			if(entry.request)
+				entry.request->decRefCounter();
+			issued++;
+		}
+
+		if(next && next == queue.count()) {
+			queue.clear();
+			next = 0;
+		}
+	}
+
+	return issued;
+}
+
+int MemoryHierarchy::clock()
 {
+	host_profile_scope(HPROF_MEMORY);
+	int executed = 0;
+
 	// First clock all the cpu controllers
 	foreach(i, cpuControllers_.count()) {
 		CPUController *cpuController = (CPUController*)(
@@ -97,17 +279,95 @@ void MemoryHierarchy::clock()
 		cpuController->clock();
 	}
 
-	Event *event;
-	while(!eventQueue_.empty()) {
-		event = eventQueue_.head();
-		if(event->get_clock() <= sim_cycle) {
-			memdebug("Executing event: ", *event);
-			eventQueue_.free(event);
-			assert(event->execute());
-		} else {
-			break;
-		}
+	executed = eventQueue_.dispatch(sim_cycle);
+
+	return executed;
+}
+
+/**
+ * @brief Clock the CPU controller of one core on its parallel worker
+ *
+ * Called before the core in each cycle of the quantum, like clock() does
+ * in serial mode.
+ */
+void MemoryHierarchy::clock_cpu_controller(int coreid)
+{
+	((CPUController*)cpuControllers_[coreid])->clock();
+}
+
+/**
+ * @brief Clock everything but the CPU controllers
+ *
+ * Used by the main thread to replay a parallel quantum, the workers
+ * already clocked their CPU controllers.
+ */
+int MemoryHierarchy::clock_shared()
+{
+	host_profile_scope(HPROF_MEMORY);
+
+	return eventQueue_.dispatch(sim_cycle);
+}
+
+/**
+ * @brief Prepare the replay of a parallel quantum
+ *
+ * Sets the full flags the workers left alone and remembers the end of the
+ * quantum, so the wakeups that come during the replay can be counted.
+ *
+ * @param end First cycle after the quantum
+ */
+void MemoryHierarchy::end_quantum(W64 end)
+{
+	foreach(i, cpuControllers_.count()) {
+		set_controller_full(cpuControllers_[i],
+				cpuControllers_[i]->is_full());
+	}
+
+	replayEnd_ = end;
+}
+
+/**
+ * @brief Count a core wakeup made while replaying a parallel quantum
+ *
+ * The core is already at the end of the quantum, so it only sees the
+ * wakeup there.
+ */
+void MemoryHierarchy::count_replay_wakeup()
+{
+	machine_.parallel_stats->late_wakeups++;
+	machine_.parallel_stats->wakeup_skew += replayEnd_ - sim_cycle;
+}
+
+W64 MemoryHierarchy::next_clock()
+{
+	W64 next = eventQueue_.next_clock();
+
+	foreach(i, cpuControllers_.count()) {
+		CPUController *cpuController = (CPUController*)(
+				cpuControllers_[i]);
+		next = min(next, cpuController->next_clock());
+	}
+
+	return next;
+}
+
+/**
+ * @brief Skip cycles in which clock() has nothing to do
+ *
+ * @param cycles Number of cycles to skip, must end before next_clock()
+ * @param count_stats Count the skipped cycles in the event queue stats.
+ * BaseMachine::skip_idle_cycles replays the stats of a measured idle cycle
+ * instead, so it passes false.
+ */
+void MemoryHierarchy::skip_cycles(W64 cycles, bool count_stats)
+{
+	foreach(i, cpuControllers_.count()) {
+		CPUController *cpuController = (CPUController*)(
+				cpuControllers_[i]);
+		cpuController->skip_cycles(cycles);
 	}
+
+	eventQueue_.skip(cycles, count_stats);
 }
 
 void MemoryHierarchy::reset()
@@ -115,7 +375,23 @@ void MemoryHierarchy::reset()
 	eventQueue_.reset();
 }
 
+/**
+ * @brief Flush the pending requests of one or all CPU controllers
+ *
+ * Workers of parallel simulation queue the flush after their earlier
+ * requests and get no delay back.
+ */
 int MemoryHierarchy::flush(uint8_t coreid)
+{
+	if unlikely (parallel_sim_active) {
+		defer(DEFERRED_FLUSH, coreid, NULL);
+		return 0;
+	}
+
+	return issue_flush(coreid);
+}
+
+int MemoryHierarchy::issue_flush(int coreid)
 {
 	int delay = 0;
 
@@ -131,6 +407,34 @@ int MemoryHierarchy::flush(uint8_t coreid)
 	return delay;
 }
 
+/**
+ * @brief Update the caches for an access made while QEMU fast-forwards
+ *
+ * @param coreid Core whose context made the access
+ * @param physaddr Physical address of the access
+ * @param is_icache True for instruction fetches
+ * @param is_write True for stores
+ */
+void MemoryHierarchy::warm_access(W8 coreid, W64 physaddr, bool is_icache,
+        bool is_write)
+{
+	bool shared = false;
+
+	if(warmingDisabled_)
+		return;
+
+	/* Other cores give up or share their copies first */
+	foreach(i, allControllers_.count()) {
+		shared |= allControllers_[i]->warm_snoop(coreid, physaddr,
+				is_write);
+	}
+
+	foreach(i, allControllers_.count()) {
+		allControllers_[i]->warm_access(coreid, physaddr, is_icache,
+				is_write, shared);
+	}
+}
+
 void MemoryHierarchy::set_controller_full(Controller* controller,
 		bool flag)
 {
@@ -193,6 +497,16 @@ bool MemoryHierarchy::is_cache_available(W8 coreid, W8 threadid,
 {
 	CPUController *cpuController = (CPUController*)cpuControllers_[coreid];
 	assert(cpuController != NULL);
+
+	/*
+	 * In a parallel quantum the queued requests stand for the entries
+	 * they will take in the CPU controller at the end of the quantum
+	 */
+	if unlikely (parallel_sim_active &&
+			deferred_[parallel_worker_id].count() >=
+			cpuController->pending_remaining())
+		return false;
+
 	return !(cpuController->is_full());
 }
 
@@ -254,71 +568,20 @@ void MemoryHierarchy::print_map(ostream& os)
 	os << "--End MemoryHierarchy Map\n";
 }
 
-void MemoryHierarchy::sort_event_queue(Event *event)
-{
-	// First make sure that given event is in tail of queue
-	assert(eventQueue_.tail() == event);
-
-	// No need to sort if only 1 event
-	if(eventQueue_.count() == 1)
-		return;
-
-	Event* entryEvent;
-	foreach_list_mutable(eventQueue_.list(), entryEvent, entry, preventry) {
-		if(*event < *entryEvent) {
-			eventQueue_.unlink(event);
-			eventQueue_.insert_after(event, (Event*)(entryEvent->prev));
-			return;
-		}
-	}
-
-	// Entry is already at the tail of queue, keep it there
-	return;
-}
-
-void MemoryHierarchy::sort_event_queue_tail(Event *event)
-{
-	// First make sure that given event is in tail of queue
-	assert(eventQueue_.tail() == event);
-
-	// No need to sort if only 1 event
-	if (eventQueue_.count() == 1)
-		return;
-
-	Event* entryEvent;
-	foreach_list_mutable_backwards(eventQueue_.list(), entryEvent, entry, preventry) {
-        if (entryEvent == event)
-            continue;
-
-        if (*event >= *entryEvent) {
-            eventQueue_.unlink(event);
-            eventQueue_.insert_after(event, (Event*)(entryEvent));
-            return;
-        }
-    }
-}
-
 void MemoryHierarchy::add_event(Signal *signal, int delay, void *arg)
 {
-	Event *event = eventQueue_.alloc();
-	if(eventQueue_.count() == 1)
-		assert(event == eventQueue_.head());
-	assert(event);
-	event->setup(signal, sim_cycle + delay, arg);
-
-	// If delay is 0, execute without sorting the queue
+	// If delay is 0, execute without queuing the event
 	if(delay == 0) {
-		memdebug("Executing event: ", *event);
-		assert(event->execute());
-
-		eventQueue_.free(event);
-        /* memdebug("Queue after add: \n", eventQueue_); */
+		memdebug("Executing event: Signal:", signal->get_name(), " arg:",
+				arg, endl);
+		assert(signal->emit(arg));
 		return;
 	}
 
-	memdebug("Adding event:", *event);
+	memdebug("Adding event: Signal:", signal->get_name(), " Clock:",
+			sim_cycle + delay, " arg:", arg, endl);
 
-    sort_event_queue(event);
+	eventQueue_.add(signal, sim_cycle + delay, arg);
 
 	return;
 }
@@ -345,8 +608,20 @@ void MemoryHierarchy::annul_request(W8 coreid,
 	 * address with pending requests and flush them.
      */
 	MemoryRequest* memRequest = get_free_request(coreid);
-	memRequest->init(coreid, threadid, physaddr, robid, sim_cycle, is_icache,
+	memRequest->init(coreid, threadid, physaddr, robid, core_cycle(), is_icache,
 			-1, -1, (is_write ? MEMORY_OP_WRITE : MEMORY_OP_READ));
+
+	/* Annul after the requests the worker queued before */
+	if unlikely (parallel_sim_active) {
+		defer(DEFERRED_ANNUL, coreid, memRequest);
+		return;
+	}
+
+	issue_annul(coreid, memRequest);
+}
+
+void MemoryHierarchy::issue_annul(int coreid, MemoryRequest *memRequest)
+{
 	cpuControllers_[coreid]->annul_request(memRequest);
 	//foreach(i, allControllers_.count()) {
 	//	allControllers_[i]->annul_request(memRequest);
@@ -397,6 +672,7 @@ int MemoryHierarchy::get_core_pending_offchip_miss(W8 coreid)
  */
 bool MemoryHierarchy::grab_lock(W64 lockaddr, W8 ctx_id)
 {
+    ParallelSection section(parallel_interlock_lock);
     bool ret = false;
     MemoryInterlockEntry* lock = interlocks.select_and_lock(lockaddr);
 
@@ -416,6 +692,7 @@ bool MemoryHierarchy::grab_lock(W64 lockaddr, W8 ctx_id)
  */
 void MemoryHierarchy::invalidate_lock(W64 lockaddr, W8 ctx_id)
 {
+    ParallelSection section(parallel_interlock_lock);
     MemoryInterlockEntry* lock = interlocks.probe(lockaddr);
 
     assert(lock);
@@ -433,6 +710,7 @@ void MemoryHierarchy::invalidate_lock(W64 lockaddr, W8 ctx_id)
  */
 bool MemoryHierarchy::probe_lock(W64 lockaddr, W8 ctx_id)
 {
+    ParallelSection section(parallel_interlock_lock);
     bool ret = false;
     MemoryInterlockEntry* lock = interlocks.probe(lockaddr);
 
@@ -450,3 +728,5 @@ namespace Memory {
 MemoryInterlockBuffer interlocks;
 
 };
+
+ParallelLock parallel_interlock_lock;
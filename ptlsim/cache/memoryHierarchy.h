@@ -36,6 +36,8 @@
 #include <memoryRequest.h>
 #include <controller.h>
 #include <interconnect.h>
+#include <eventQueue.h>
+#include <memoryTrace.h>
 
 #include <statsBuilder.h>
 
@@ -56,7 +58,6 @@
 #define memdebug(...) (0)
 #endif
 
-#define ENABLE_MEM_REQUEST_HISTORY
 #ifdef ENABLE_MEM_REQUEST_HISTORY
 #define ADD_HISTORY(req, ...) req->get_history() << __VA_ARGS__
 #define ADD_HISTORY_ADD(req) ADD_HISTORY(req, "{+", get_name(), "} ")
@@ -78,81 +79,14 @@
 
 #define SET_SIGNAL_CB(name, name_postfix, signal, cb) \
 { \
-    stringbuf *sg_n = new stringbuf(); \
-    *sg_n << name, name_postfix; \
-    signal.set_name(sg_n->buf); \
-    signal.connect(signal_mem_ptr(*this, cb)); \
+    stringbuf sg_n; \
+    sg_n << name, name_postfix; \
+    signal.set_name(sg_n.buf); \
+    signal.connect(SIGNAL_MEM_FN(*this, cb)); \
 }
 
 namespace Memory {
 
-  class Event : public FixStateListObject
-	{
-		private:
-			Signal *signal_;
-			W64    clock_;
-			void   *arg_;
-
-		public:
-			void init() {
-				signal_ = NULL;
-				clock_ = -1;
-				arg_ = NULL;
-			}
-
-			void setup(Signal *signal, W64 clock, void *arg) {
-				signal_ = signal;
-				clock_ = clock;
-				arg_ = arg;
-			}
-
-			bool execute() {
-				return signal_->emit(arg_);
-			}
-
-			W64 get_clock() {
-				return clock_;
-			}
-
-			ostream& print(ostream& os) const {
-				os << "Event< ";
-				if(signal_)
-					os << "Signal:" << signal_->get_name() << " ";
-				os << "Clock:" << clock_ << " ";
-				os << "arg:" << arg_ ;
-				os << ">" << endl, flush;
-				return os;
-			}
-
-			bool operator ==(Event &event) {
-				if(clock_ == event.clock_)
-					return true;
-				return false;
-			}
-
-			bool operator >(Event &event) {
-				if(clock_ > event.clock_)
-					return true;
-				return false;
-			}
-
-			bool operator <(Event &event) {
-				if(clock_ < event.clock_)
-					return true;
-				return false;
-			}
-
-            bool operator >=(Event &event) {
-                if (clock_ >= event.clock_)
-                    return true;
-                return false;
-            }
-	};
-
-  static inline ostream& operator <<(ostream& os, const Event& event) {
-      return event.print(os);
-  }
-
   struct MemoryInterlockEntry {
       W8 ctx_id;
 
@@ -186,6 +120,9 @@ namespace Memory {
     // New Core wakeup function that uses Signal of MemoryRequest
     // if Signal is not setup, it uses old wrapper functions
     void core_wakeup(MemoryRequest *request) {
+        if unlikely (sim_cycle < replayEnd_)
+            count_replay_wakeup();
+
         if(request->get_coreSignal()) {
             request->get_coreSignal()->emit((void*)request);
             return;
@@ -200,13 +137,38 @@ namespace Memory {
 			bool is_icache,
 			bool is_write);
 
-    void clock();
+    int clock();
+
+    // parallel simulation, see BaseMachine::run_parallel: workers clock
+    // their own CPU controller, the main thread replays the quantum with
+    // clock_shared() and issues the requests the workers made in each cycle
+    void clock_cpu_controller(int coreid);
+    int clock_shared();
+    void end_quantum(W64 end);
+    int issue_deferred();
+
+    // First cycle in which clock() has work to do, -1 if none
+    W64 next_clock();
+    void skip_cycles(W64 cycles, bool count_stats);
 
     void reset();
 
+    // write out buffered records of the memory trace
+    void flush_trace();
+
 	// return the number of cycle used to flush the caches
     int flush(uint8_t coreid);
 
+    // functional warming of the caches, see Controller::warm_access
+    void warm_access(W8 coreid, W64 physaddr, bool is_icache,
+            bool is_write);
+
+    // directory entries are not warmed, so caches that use a directory
+    // disable functional warming
+    void disable_warming() {
+        warmingDisabled_ = true;
+    }
+
 	// for debugging
     void dump_info(ostream& os);
 	void print_map(ostream& os);
@@ -214,6 +176,8 @@ namespace Memory {
 	// Add event into event queue
 	void add_event(Signal *signal, int delay, void *arg);
 
+	// each core has its own pool, so workers of parallel simulation
+	// don't share it
 	MemoryRequest* get_free_request(int id) {
 		return requestPool_[id]->get_free_request();
 	}
@@ -269,6 +233,7 @@ namespace Memory {
 	dynarray<bool> controllersFullFlags_;
 	dynarray<bool> interconnectsFullFlags_;
 	bool someStructIsFull_;
+	bool warmingDisabled_;
 
     // number of cores
     int coreNo_;
@@ -280,10 +245,38 @@ namespace Memory {
 	FixStateList<Message, 128> messageQueue_;
 
 	// Event Queue
-	FixStateList<Event, 2048> eventQueue_;
+	EventQueue eventQueue_;
+	EventQueueStats *eventStats_;
+
+	// Binary trace of the core requests, see config 'mem-trace'
+	MemoryTraceWriter *traceWriter_;
+
+	// Requests of each parallel worker that wait for the end of the
+	// quantum, in the order the worker made them
+	enum { DEFERRED_ACCESS, DEFERRED_ANNUL, DEFERRED_FLUSH,
+		DEFERRED_TRACE };
+
+	struct DeferredAccess {
+		W64 cycle;
+		int type;
+		int coreid;
+		int latency;
+		MemoryRequest *request;
+	};
+
+	dynarray<DeferredAccess> deferred_[NUM_SIM_CORES];
+	int deferredNext_[NUM_SIM_CORES];
+
+	// First cycle after the quantum being replayed
+	W64 replayEnd_;
 
-	void sort_event_queue(Event *event);
-	void sort_event_queue_tail(Event *event);
+	void defer(int type, int coreid, MemoryRequest *request,
+			int latency = -1);
+	void count_replay_wakeup();
+	void record_trace(MemoryRequest *request);
+	bool issue_access(MemoryRequest *request);
+	void issue_annul(int coreid, MemoryRequest *request);
+	int issue_flush(int coreid);
 
     // Temp Stats
     Stats *stats;
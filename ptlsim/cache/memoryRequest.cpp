@@ -63,8 +63,9 @@ void MemoryRequest::init(W8 coreId,
 	opType_ = opType;
 	isData_ = !isInstruction;
 
-	if(history) delete history;
-	history = new stringbuf();
+#ifdef ENABLE_MEM_REQUEST_HISTORY
+	history_.clear();
+#endif
 
 	memdebug("Init ", *this, endl);
 }
@@ -82,8 +83,9 @@ void MemoryRequest::init(MemoryRequest *request)
 	opType_ = request->opType_;
 	isData_ = request->isData_;
 
-	if(history) delete history;
-	history = new stringbuf();
+#ifdef ENABLE_MEM_REQUEST_HISTORY
+	history_.clear();
+#endif
 
 	memdebug("Init ", *this, endl);
 }
@@ -129,6 +131,28 @@ RequestPool::RequestPool()
 	foreach(i, REQUEST_POOL_SIZE) {
 		freeRequestList_.enqueue((selfqueuelink*)&((*this)[i]));
 	}
+
+#ifdef ENABLE_MEM_REQUEST_HISTORY
+	historyArena_ = NULL;
+#ifndef MEM_TEST
+	if(!config.mem_request_history)
+		return;
+#endif
+
+	historyArena_ = new char[REQUEST_POOL_SIZE * REQUEST_HISTORY_SIZE];
+	foreach(i, REQUEST_POOL_SIZE) {
+		(*this)[i].get_history().set_buffer(
+				&historyArena_[i * REQUEST_HISTORY_SIZE]);
+	}
+#endif
+}
+
+RequestPool::~RequestPool()
+{
+#ifdef ENABLE_MEM_REQUEST_HISTORY
+	if(historyArena_)
+		delete[] historyArena_;
+#endif
 }
 
 MemoryRequest* RequestPool::get_free_request()
@@ -33,6 +33,12 @@
 #include <statelist.h>
 #include <cacheConstants.h>
 
+/*
+ * Define to record the path of each request through the memory hierarchy
+ * (printed with the request). Recording also needs 'mem-request-history'.
+ */
+//#define ENABLE_MEM_REQUEST_HISTORY
+
 namespace Memory {
 
 enum OP_TYPE {
@@ -50,6 +56,69 @@ static const char* memory_op_names[NUM_MEMORY_OP] = {
 	"memory_op_evict"
 };
 
+#ifdef ENABLE_MEM_REQUEST_HISTORY
+/**
+ * @brief History of a memory request
+ *
+ * Each request owns a REQUEST_HISTORY_SIZE slice of its RequestPool arena
+ * and writes into it as a ring, so only the most recent entries are kept
+ * and recording never allocates. Without an arena nothing is recorded.
+ */
+class RequestHistory
+{
+	public:
+		RequestHistory()
+			: buf_(NULL)
+			, written_(0)
+		{}
+
+		void set_buffer(char *buf) { buf_ = buf; }
+
+		void clear() { written_ = 0; }
+
+		RequestHistory& operator <<(const char *str) {
+			if(!buf_)
+				return *this;
+
+			while(*str) {
+				buf_[written_ % REQUEST_HISTORY_SIZE] = *str++;
+				written_++;
+			}
+			return *this;
+		}
+
+		RequestHistory& operator ,(const char *str) {
+			return *this << str;
+		}
+
+		ostream& print(ostream& os) const
+		{
+			char str[REQUEST_HISTORY_SIZE + 1];
+			int len = min(written_, W32(REQUEST_HISTORY_SIZE));
+			int start = written_ - len;
+
+			foreach(i, len) {
+				str[i] = buf_[(start + i) % REQUEST_HISTORY_SIZE];
+			}
+			str[len] = '\0';
+
+			if(start > 0)
+				os << "...";
+			os << str;
+			return os;
+		}
+
+	private:
+		char *buf_;
+		W32 written_;
+};
+
+static inline ostream& operator <<(ostream& os, const RequestHistory& history)
+{
+	return history.print(os);
+}
+#endif
+
 class MemoryRequest: public selfqueuelink
 {
 	public:
@@ -65,8 +134,10 @@ class MemoryRequest: public selfqueuelink
 			refCounter_ = 0; // or maybe 1
 			opType_ = MEMORY_OP_READ;
 			isData_ = 0;
-			history = new stringbuf();
             coreSignal_ = NULL;
+#ifdef ENABLE_MEM_REQUEST_HISTORY
+			history_.clear();
+#endif
 		}
 
 		void incRefCounter(){
@@ -128,7 +199,9 @@ class MemoryRequest: public selfqueuelink
 
 		W64 get_init_cycles() { return cycles_; }
 
-		stringbuf& get_history() { return *history; }
+#ifdef ENABLE_MEM_REQUEST_HISTORY
+		RequestHistory& get_history() { return history_; }
+#endif
 
         bool is_kernel() {
             // based on owner RIP value
@@ -160,7 +233,9 @@ class MemoryRequest: public selfqueuelink
 			os << "isData[", isData_, "] ";
 			os << "ownerUUID[", ownerUUID_, "] ";
 			os << "ownerRIP[", (void*)ownerRIP_, "] ";
-			os << "History[ " << *history << "] ";
+#ifdef ENABLE_MEM_REQUEST_HISTORY
+			os << "History[ " << history_ << "] ";
+#endif
             if(coreSignal_) {
                 os << "Signal[ " << coreSignal_->get_name() << "] ";
             }
@@ -178,8 +253,10 @@ class MemoryRequest: public selfqueuelink
 		W64 ownerUUID_;
 		int refCounter_;
 		OP_TYPE opType_;
-		stringbuf *history;
         Signal *coreSignal_;
+#ifdef ENABLE_MEM_REQUEST_HISTORY
+		RequestHistory history_;
+#endif
 
 };
 
@@ -192,6 +269,7 @@ class RequestPool: public array<MemoryRequest,REQUEST_POOL_SIZE>
 {
 	public:
 		RequestPool();
+		~RequestPool();
 		MemoryRequest* get_free_request();
 		void garbage_collection();
 
@@ -227,6 +305,9 @@ class RequestPool: public array<MemoryRequest,REQUEST_POOL_SIZE>
 		int size_;
 		StateList freeRequestList_;
 		StateList usedRequestsList_;
+#ifdef ENABLE_MEM_REQUEST_HISTORY
+		char *historyArena_;
+#endif
 
 		void freeRequest(MemoryRequest* request);
 
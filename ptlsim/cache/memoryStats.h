@@ -254,6 +254,90 @@ struct RAMStats : public Statable {
     {}
 };
 
+/**
+ * @brief Statistics of the global directory
+ *
+ * Every EVICT message the directory sends is counted either as a write
+ * or as a replacement invalidation. Messages sent from an inexact entry,
+ * which may reach caches that do not hold the line, are counted again in
+ * 'inexact_invalidations'.
+ */
+struct DirectoryStats : public Statable {
+    StatObj<W64> port_conflicts;
+    StatObj<W64> replacements;
+    StatObj<W64> write_invalidations;
+    StatObj<W64> replacement_invalidations;
+    StatObj<W64> inexact_invalidations;
+    StatObj<W64> overflows;
+
+    DirectoryStats(const char* name, Statable *parent)
+        : Statable(name, parent)
+          , port_conflicts("port_conflicts", this)
+          , replacements("replacements", this)
+          , write_invalidations("write_invalidations", this)
+          , replacement_invalidations("replacement_invalidations", this)
+          , inexact_invalidations("inexact_invalidations", this)
+          , overflows("overflows", this)
+    {}
+};
+
+/**
+ * @brief Statistics of a mesh or ring interconnect
+ *
+ * 'link_wait' counts the cycles packets waited for a link used by other
+ * packets, 'latency' the cycles from injection to delivery.
+ */
+struct MeshStats : public Statable {
+    StatObj<W64> packets;
+    StatObj<W64> flits;
+    StatObj<W64> hops;
+    StatObj<W64> link_wait;
+    StatObj<W64> latency;
+    StatObj<W64> delivery_retries;
+    StatEquation<W64, double, StatObjFormulaDiv> avg_latency;
+    StatEquation<W64, double, StatObjFormulaDiv> avg_hops;
+
+    MeshStats(const char* name, Statable *parent)
+        : Statable(name, parent)
+          , packets("packets", this)
+          , flits("flits", this)
+          , hops("hops", this)
+          , link_wait("link_wait", this)
+          , latency("latency", this)
+          , delivery_retries("delivery_retries", this)
+          , avg_latency("avg_latency", this)
+          , avg_hops("avg_hops", this)
+    {
+        avg_latency.add_elem(&latency);
+        avg_latency.add_elem(&packets);
+        avg_hops.add_elem(&hops);
+        avg_hops.add_elem(&packets);
+    }
+};
+
+struct EventQueueStats : public Statable {
+
+    StatObj<W64> scheduled;
+    StatObj<W64> executed;
+    StatObj<W64> overflowed;
+    StatObj<W64> occupancy;
+    StatObj<W64> cycles;
+    StatEquation<W64, double, StatObjFormulaDiv> avg_occupancy;
+
+    EventQueueStats(const char* name, Statable *parent)
+        : Statable(name, parent)
+          , scheduled("scheduled", this)
+          , executed("executed", this)
+          , overflowed("overflowed", this)
+          , occupancy("occupancy", this)
+          , cycles("cycles", this)
+          , avg_occupancy("avg_occupancy", this)
+    {
+        avg_occupancy.add_elem(&occupancy);
+        avg_occupancy.add_elem(&cycles);
+    }
+};
+
 };
 
 #endif // MEMORY_STATS_H
@@ -0,0 +1,310 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ * Binary trace of the requests cores send to the memory hierarchy, and
+ * replay of such a trace through the caches of a configured machine
+ * without running the cores.
+ */
+
+#ifdef MEM_TEST
+#include <test.h>
+#else
+#include <ptlsim.h>
+#endif
+
+#include <memoryTrace.h>
+#include <memoryHierarchy.h>
+#include <memoryRequest.h>
+
+using namespace Memory;
+
+static inline W64 zigzag_encode(W64 delta)
+{
+    return (delta << 1) ^ W64(W64s(delta) >> 63);
+}
+
+static inline W64 zigzag_decode(W64 value)
+{
+    return (value >> 1) ^ -(value & 1);
+}
+
+MemoryTraceWriter::MemoryTraceWriter()
+    : bufferUsed_(0)
+    , lastCycle_(0)
+    , count_(0)
+{
+    memset(lastAddress_, 0, sizeof(lastAddress_));
+}
+
+MemoryTraceWriter::~MemoryTraceWriter()
+{
+    close();
+}
+
+/**
+ * @brief Create trace file 'filename'
+ *
+ * @return false if the file can not be created
+ */
+bool MemoryTraceWriter::open(const char* filename)
+{
+    close();
+
+    os_.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!os_)
+        return false;
+
+    W32 header[2];
+    header[0] = MEM_TRACE_VERSION;
+    header[1] = 0;
+
+    os_.write(MEM_TRACE_MAGIC, 8);
+    os_.write((char*)header, sizeof(header));
+
+    bufferUsed_ = 0;
+    lastCycle_ = 0;
+    count_ = 0;
+    memset(lastAddress_, 0, sizeof(lastAddress_));
+
+    return true;
+}
+
+void MemoryTraceWriter::close()
+{
+    if (!os_.is_open())
+        return;
+
+    flush_buffer();
+    os_.close();
+}
+
+/**
+ * @brief Write out the buffered records and keep the trace open
+ */
+void MemoryTraceWriter::flush()
+{
+    if (!os_.is_open())
+        return;
+
+    flush_buffer();
+    os_.flush();
+}
+
+void MemoryTraceWriter::flush_buffer()
+{
+    os_.write((char*)buffer_, bufferUsed_);
+    bufferUsed_ = 0;
+}
+
+/**
+ * @brief Append one request, records must be in cycle order
+ */
+void MemoryTraceWriter::record(const MemoryTraceRecord& record)
+{
+    if unlikely (bufferUsed_ > MEM_TRACE_BUFFER_SIZE - MEM_TRACE_MAX_RECORD)
+        flush_buffer();
+
+    buffer_[bufferUsed_++] = byte(record.isWrite) |
+        (byte(record.isInstruction) << 1) | (record.threadId << 2);
+    buffer_[bufferUsed_++] = record.coreId;
+
+    put_varint(record.cycle - lastCycle_);
+    put_varint(zigzag_encode(record.physicalAddress -
+                lastAddress_[record.coreId]));
+
+    lastCycle_ = record.cycle;
+    lastAddress_[record.coreId] = record.physicalAddress;
+    count_++;
+}
+
+MemoryTraceReader::MemoryTraceReader()
+    : bufferUsed_(0)
+    , bufferPos_(0)
+    , lastCycle_(0)
+    , count_(0)
+{
+    memset(lastAddress_, 0, sizeof(lastAddress_));
+}
+
+MemoryTraceReader::~MemoryTraceReader()
+{
+    close();
+}
+
+/**
+ * @brief Open trace file 'filename' and check its header
+ *
+ * @return false if the file can not be read or is not a memory trace
+ */
+bool MemoryTraceReader::open(const char* filename)
+{
+    close();
+
+    is_.open(filename, std::ios::in | std::ios::binary);
+    if (!is_)
+        return false;
+
+    char magic[8];
+    W32 header[2];
+
+    is_.read(magic, 8);
+    is_.read((char*)header, sizeof(header));
+
+    if (!is_ || memcmp(magic, MEM_TRACE_MAGIC, 8) != 0 ||
+            header[0] != MEM_TRACE_VERSION) {
+        is_.close();
+        return false;
+    }
+
+    bufferUsed_ = 0;
+    bufferPos_ = 0;
+    lastCycle_ = 0;
+    count_ = 0;
+    memset(lastAddress_, 0, sizeof(lastAddress_));
+
+    return true;
+}
+
+void MemoryTraceReader::close()
+{
+    if (is_.is_open())
+        is_.close();
+}
+
+/**
+ * @brief Move the unread bytes to the front of the buffer and read more
+ *
+ * The last MEM_TRACE_MAX_RECORD bytes of the buffer are kept zero, so a
+ * record cut by the end of the file never reads past the buffer.
+ */
+void MemoryTraceReader::fill_buffer()
+{
+    int left = bufferUsed_ - bufferPos_;
+    memmove(buffer_, buffer_ + bufferPos_, left);
+    bufferPos_ = 0;
+    bufferUsed_ = left;
+
+    if (is_) {
+        is_.read((char*)buffer_ + left,
+                MEM_TRACE_BUFFER_SIZE - MEM_TRACE_MAX_RECORD - left);
+        bufferUsed_ += is_.gcount();
+    }
+
+    memset(buffer_ + bufferUsed_, 0, MEM_TRACE_BUFFER_SIZE - bufferUsed_);
+}
+
+/**
+ * @brief Read the next request of the trace
+ *
+ * @return false at the end of the trace
+ */
+bool MemoryTraceReader::next(MemoryTraceRecord& record)
+{
+    if unlikely (bufferUsed_ - bufferPos_ < MEM_TRACE_MAX_RECORD)
+        fill_buffer();
+
+    if unlikely (bufferPos_ >= bufferUsed_)
+        return false;
+
+    byte flags = buffer_[bufferPos_++];
+    record.isWrite = flags & 1;
+    record.isInstruction = (flags >> 1) & 1;
+    record.threadId = flags >> 2;
+    record.coreId = buffer_[bufferPos_++];
+
+    lastCycle_ += get_varint();
+    lastAddress_[record.coreId] += zigzag_decode(get_varint());
+
+    /* Record cut by the end of the file */
+    if unlikely (bufferPos_ > bufferUsed_)
+        return false;
+
+    record.cycle = lastCycle_;
+    record.physicalAddress = lastAddress_[record.coreId];
+    count_++;
+
+    return true;
+}
+
+/*
+ * Clock the memory hierarchy until sim_cycle reaches 'cycle', skipping
+ * the cycles in which it has nothing to do.
+ */
+static void clock_until(MemoryHierarchy& memoryHierarchy, W64 cycle)
+{
+    while (sim_cycle < cycle) {
+        W64 next = memoryHierarchy.next_clock();
+
+        if (next > sim_cycle) {
+            W64 skip = min(next, cycle) - sim_cycle;
+            memoryHierarchy.skip_cycles(skip, true);
+            sim_cycle += skip;
+            continue;
+        }
+
+        memoryHierarchy.clock();
+        sim_cycle++;
+    }
+}
+
+/**
+ * @brief Send all requests of 'trace' to the caches of 'memoryHierarchy'
+ *
+ * Requests are issued at their recorded cycle, relative to the first one.
+ * When the L1 of a core can not take a request, the replay waits and all
+ * later requests are shifted by the same number of cycles. Returns once
+ * the hierarchy has no more pending work.
+ *
+ * @return Number of requests replayed
+ */
+W64 Memory::replay_memory_trace(MemoryHierarchy& memoryHierarchy,
+        MemoryTraceReader& trace)
+{
+    MemoryTraceRecord record;
+    W64 replayed = 0;
+    W64 start = sim_cycle;
+    W64 first = 0;
+
+    while (trace.next(record)) {
+        if unlikely (record.coreId >= NUM_SIM_CORES)
+            continue;
+
+        if unlikely (!replayed)
+            first = record.cycle;
+
+        clock_until(memoryHierarchy, record.cycle - first + start);
+
+        while (!memoryHierarchy.is_cache_available(record.coreId,
+                    record.threadId, record.isInstruction)) {
+            memoryHierarchy.clock();
+            sim_cycle++;
+            start++;
+        }
+
+        MemoryRequest *request = memoryHierarchy.get_free_request(
+                record.coreId);
+        assert(request != NULL);
+
+        request->init(record.coreId, record.threadId,
+                record.physicalAddress, 0, sim_cycle, record.isInstruction,
+                0, 0, record.isWrite ? MEMORY_OP_WRITE : MEMORY_OP_READ);
+
+        memoryHierarchy.access_cache(request);
+        replayed++;
+    }
+
+    /* Let the last misses complete */
+    for (;;) {
+        W64 next = memoryHierarchy.next_clock();
+        if (next == W64(-1))
+            break;
+
+        clock_until(memoryHierarchy, next);
+        memoryHierarchy.clock();
+        sim_cycle++;
+    }
+
+    return replayed;
+}
@@ -0,0 +1,120 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ * Binary trace of the requests cores send to the memory hierarchy, and
+ * replay of such a trace through the caches of a configured machine
+ * without running the cores.
+ */
+
+#ifndef MEMORY_TRACE_H
+#define MEMORY_TRACE_H
+
+#include <globals.h>
+#include <superstl.h>
+
+#include <fstream>
+
+/*
+ * Trace file format:
+ *
+ *   header : "MARSSMTR", W32 version, W32 0
+ *   record : byte flags (bit 0 write, bit 1 instruction, bits 2-7 thread),
+ *            byte core,
+ *            varint cycles since the previous record,
+ *            zigzag varint address minus the previous address of the core
+ *
+ * Varints are 7 bits per byte, lowest first, bit 7 set on all bytes but
+ * the last. Most records take 4 to 6 bytes.
+ */
+#define MEM_TRACE_MAGIC        "MARSSMTR"
+#define MEM_TRACE_VERSION      1
+#define MEM_TRACE_BUFFER_SIZE  (1 << 16)
+#define MEM_TRACE_MAX_RECORD   22
+
+namespace Memory {
+
+    class MemoryHierarchy;
+
+    struct MemoryTraceRecord {
+        W64 cycle;
+        W64 physicalAddress;
+        W8 coreId;
+        W8 threadId;
+        bool isInstruction;
+        bool isWrite;
+    };
+
+    class MemoryTraceWriter {
+    public:
+        MemoryTraceWriter();
+        ~MemoryTraceWriter();
+
+        bool open(const char* filename);
+        void close();
+        void flush();
+        void record(const MemoryTraceRecord& record);
+
+        W64 get_count() const { return count_; }
+
+    private:
+        std::ofstream os_;
+        byte buffer_[MEM_TRACE_BUFFER_SIZE];
+        int bufferUsed_;
+        W64 lastCycle_;
+        W64 lastAddress_[256];
+        W64 count_;
+
+        void put_varint(W64 value) {
+            while (value >= 0x80) {
+                buffer_[bufferUsed_++] = byte(value | 0x80);
+                value >>= 7;
+            }
+            buffer_[bufferUsed_++] = byte(value);
+        }
+
+        void flush_buffer();
+    };
+
+    class MemoryTraceReader {
+    public:
+        MemoryTraceReader();
+        ~MemoryTraceReader();
+
+        bool open(const char* filename);
+        void close();
+        bool next(MemoryTraceRecord& record);
+
+        W64 get_count() const { return count_; }
+
+    private:
+        std::ifstream is_;
+        byte buffer_[MEM_TRACE_BUFFER_SIZE];
+        int bufferUsed_;
+        int bufferPos_;
+        W64 lastCycle_;
+        W64 lastAddress_[256];
+        W64 count_;
+
+        W64 get_varint() {
+            W64 value = 0;
+            int shift = 0;
+            byte b;
+            do {
+                b = buffer_[bufferPos_++];
+                value |= W64(b & 0x7f) << shift;
+                shift += 7;
+            } while (b & 0x80);
+            return value;
+        }
+
+        void fill_buffer();
+    };
+
+    W64 replay_memory_trace(MemoryHierarchy& memoryHierarchy,
+            MemoryTraceReader& trace);
+
+};
+
+#endif // MEMORY_TRACE_H
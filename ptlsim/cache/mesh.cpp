@@ -0,0 +1,368 @@
+
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#include <mesh.h>
+
+using namespace Memory;
+using namespace Memory::MeshInterconnect;
+
+
+Mesh::Mesh(const char *name, MemoryHierarchy *memoryHierarchy,
+        int topology)
+    : Interconnect(name, memoryHierarchy)
+    , topology_(topology)
+    , columns_(0)
+    , rows_(0)
+{
+    BaseMachine &machine = memoryHierarchy_->get_machine();
+    int line_size;
+
+    memoryHierarchy_->add_interconnect(this);
+    new_stats = new MeshStats(name, &machine);
+
+    SET_SIGNAL_CB(name, "_hop", hop_, &Mesh::hop_cb);
+    SET_SIGNAL_CB(name, "_deliver", deliver_, &Mesh::deliver_cb);
+
+    new_stats->set_default_stats(user_stats);
+
+    if (!machine.get_option(name, "latency", routerLatency_))
+        routerLatency_ = MESH_ROUTER_DELAY;
+    if (!machine.get_option(name, "link_latency", linkLatency_))
+        linkLatency_ = MESH_LINK_DELAY;
+    if (!machine.get_option(name, "link_width", linkWidth_))
+        linkWidth_ = MESH_LINK_WIDTH;
+    if (!machine.get_option(name, "line_size", line_size))
+        line_size = MESH_LINE_SIZE;
+    if (!machine.get_option(name, "columns", configColumns_))
+        configColumns_ = 0;
+
+    assert(routerLatency_ > 0 && linkLatency_ > 0 && linkWidth_ > 0);
+
+    /* One header flit and the line */
+    dataFlits_ = 1 + (line_size + linkWidth_ - 1) / linkWidth_;
+}
+
+Mesh::~Mesh()
+{
+    foreach (i, nodes_.count())
+        delete nodes_[i];
+
+    delete new_stats;
+}
+
+void Mesh::register_controller(Controller *controller)
+{
+    NodeQueue *nq = new NodeQueue();
+    nq->controller = controller;
+    nq->node = nodes_.count();
+
+    nodes_.push(nq);
+    setup_geometry();
+}
+
+/**
+ * @brief Size the network for the registered controllers
+ *
+ * A mesh whose last row is not full still has routers in the empty
+ * places, so XY routes never leave the grid.
+ */
+void Mesh::setup_geometry()
+{
+    int count = nodes_.count();
+
+    if (topology_ == TOPOLOGY_RING) {
+        columns_ = count;
+        rows_ = 1;
+    } else {
+        columns_ = configColumns_;
+        if (columns_ <= 0) {
+            columns_ = 1;
+            while (columns_ * columns_ < count)
+                columns_++;
+        }
+        rows_ = (count + columns_ - 1) / columns_;
+    }
+
+    linkFree_.resize(columns_ * rows_ * NUM_PORTS);
+    foreach (i, linkFree_.count())
+        linkFree_[i] = 0;
+}
+
+int Mesh::access_fast_path(Controller *controller,
+        MemoryRequest *request)
+{
+    return -1;
+}
+
+void Mesh::annul_request(MemoryRequest *request)
+{
+    /* Packets may have a hop or delivery event pending, so they are only
+     * marked here and freed by that event. */
+    foreach (i, nodes_.count()) {
+        Packet *packet;
+        foreach_list_mutable (nodes_[i]->queue.list(),
+                packet, entry, nextentry) {
+            if (packet->request->is_same(request))
+                packet->annuled = true;
+        }
+    }
+}
+
+bool Mesh::controller_request_cb(void *arg)
+{
+    Message *msg = (Message*)arg;
+
+    NodeQueue *nq = get_queue((Controller*)msg->sender);
+    Packet *packet = nq->queue.alloc();
+
+    if (!packet) {
+        return false;
+    }
+
+    *packet << *msg;
+    ADD_HISTORY_ADD(packet->request);
+
+    packet->queue        = nq;
+    packet->node         = nq->node;
+    packet->dest_node    = get_queue(packet->dest)->node;
+    packet->flits        = packet->has_data ? dataFlits_ : 1;
+    packet->inject_cycle = sim_cycle;
+
+    bool kernel = packet->request->is_kernel();
+    N_STAT_UPDATE(new_stats->packets, ++, kernel);
+    N_STAT_UPDATE(new_stats->flits, += packet->flits, kernel);
+
+    marss_add_event(&hop_, 1, packet);
+
+    return true;
+}
+
+/**
+ * @brief Output port of the router 'node' towards 'dest_node'
+ */
+int Mesh::route(int node, int dest_node) const
+{
+    if (topology_ == TOPOLOGY_RING) {
+        int east = dest_node - node;
+        if (east < 0)
+            east += columns_;
+        return (east <= columns_ - east) ? PORT_EAST : PORT_WEST;
+    }
+
+    int x = node % columns_;
+    int dest_x = dest_node % columns_;
+
+    if (x != dest_x)
+        return (dest_x > x) ? PORT_EAST : PORT_WEST;
+
+    return (dest_node > node) ? PORT_SOUTH : PORT_NORTH;
+}
+
+int Mesh::next_node(int node, int port) const
+{
+    if (topology_ == TOPOLOGY_RING) {
+        if (port == PORT_EAST)
+            return (node + 1) % columns_;
+        return (node + columns_ - 1) % columns_;
+    }
+
+    switch (port) {
+        case PORT_EAST:  return node + 1;
+        case PORT_WEST:  return node - 1;
+        case PORT_NORTH: return node - columns_;
+        case PORT_SOUTH: return node + columns_;
+    }
+
+    assert(0);
+    return -1;
+}
+
+/**
+ * @brief Number of hops between two routers
+ */
+int Mesh::distance(int node, int dest_node) const
+{
+    if (topology_ == TOPOLOGY_RING) {
+        int east = dest_node - node;
+        if (east < 0)
+            east += columns_;
+        return min(east, columns_ - east);
+    }
+
+    return abs(node % columns_ - dest_node % columns_) +
+        abs(node / columns_ - dest_node / columns_);
+}
+
+/**
+ * @brief Move a packet that reached a router to the next one
+ *
+ * The packet leaves the router after its pipeline latency, or later if the
+ * output link is still carrying earlier packets.
+ */
+bool Mesh::hop_cb(void *arg)
+{
+    Packet *packet = (Packet*)arg;
+
+    if (packet->annuled) {
+        release(packet);
+        return true;
+    }
+
+    bool kernel = packet->request->is_kernel();
+
+    if (packet->node == packet->dest_node) {
+        /* The tail flit follows the header */
+        marss_add_event(&deliver_, routerLatency_ + packet->flits - 1,
+                packet);
+        return true;
+    }
+
+    int port = route(packet->node, packet->dest_node);
+    W64 &link_free = linkFree_[packet->node * NUM_PORTS + port];
+    W64 ready = sim_cycle + routerLatency_;
+    W64 start = max(ready, link_free);
+
+    if (start > ready) {
+        N_STAT_UPDATE(new_stats->link_wait, += start - ready, kernel);
+    }
+
+    link_free = start + packet->flits;
+    packet->node = next_node(packet->node, port);
+    packet->hops++;
+
+    N_STAT_UPDATE(new_stats->hops, ++, kernel);
+
+    marss_add_event(&hop_, start + linkLatency_ - sim_cycle, packet);
+
+    return true;
+}
+
+bool Mesh::deliver_cb(void *arg)
+{
+    Packet *packet = (Packet*)arg;
+
+    if (packet->annuled) {
+        release(packet);
+        return true;
+    }
+
+    bool kernel = packet->request->is_kernel();
+
+    /* Keep messages between two controllers in order */
+    if (older_pending(packet)) {
+        N_STAT_UPDATE(new_stats->delivery_retries, ++, kernel);
+        marss_add_event(&deliver_, 1, packet);
+        return true;
+    }
+
+    NodeQueue *dest_nq = nodes_[packet->dest_node];
+
+    Message *msg = memoryHierarchy_->get_message();
+    msg->sender  = this;
+    *msg << *packet;
+
+    bool success = dest_nq->controller->get_interconnect_signal()->
+        emit(msg);
+
+    memoryHierarchy_->free_message(msg);
+
+    memdebug("Mesh sending message success: " << success << endl);
+
+    /* If the destination is not accepting requests now, the packet waits
+     * at the last router and tries again in next cycle. */
+    if (!success) {
+        N_STAT_UPDATE(new_stats->delivery_retries, ++, kernel);
+        marss_add_event(&deliver_, 1, packet);
+        return true;
+    }
+
+    N_STAT_UPDATE(new_stats->latency, += sim_cycle - packet->inject_cycle,
+            kernel);
+    release(packet);
+
+    return true;
+}
+
+/**
+ * @brief Check if an earlier packet from the same source to the same
+ * destination is not delivered yet
+ */
+bool Mesh::older_pending(Packet *packet)
+{
+    Packet *older;
+    foreach_list_mutable (packet->queue->queue.list(),
+            older, entry, nextentry) {
+        if (older == packet)
+            break;
+
+        if (!older->annuled && older->dest == packet->dest)
+            return true;
+    }
+
+    return false;
+}
+
+void Mesh::release(Packet *packet)
+{
+    packet->request->decRefCounter();
+    ADD_HISTORY_REM(packet->request);
+    packet->queue->queue.free(packet);
+}
+
+NodeQueue* Mesh::get_queue(Controller *cont)
+{
+    foreach (i, nodes_.count()) {
+        if (nodes_[i]->controller == cont)
+            return nodes_[i];
+    }
+
+    assert(0);
+    return NULL;
+}
+
+/**
+ * @brief Dump Mesh Interconnect Configuration in YAML Format
+ *
+ * @param out YAML Object
+ */
+void Mesh::dump_configuration(YAML::Emitter &out) const
+{
+    out << YAML::Key << get_name() << YAML::Value << YAML::BeginMap;
+
+    YAML_KEY_VAL(out, "type", "interconnect");
+    YAML_KEY_VAL(out, "topology",
+            (topology_ == TOPOLOGY_RING) ? "ring" : "mesh");
+    YAML_KEY_VAL(out, "columns", columns_);
+    YAML_KEY_VAL(out, "rows", rows_);
+    YAML_KEY_VAL(out, "router_latency", routerLatency_);
+    YAML_KEY_VAL(out, "link_latency", linkLatency_);
+    YAML_KEY_VAL(out, "link_width", linkWidth_);
+    YAML_KEY_VAL(out, "data_flits", dataFlits_);
+    YAML_KEY_VAL(out, "per_node_queue_size", MESH_QUEUE_SIZE);
+
+    out << YAML::EndMap;
+}
+
+struct MeshBuilder : public InterconnectBuilder
+{
+    int topology;
+
+    MeshBuilder(const char *name, int topology_) :
+        InterconnectBuilder(name)
+        , topology(topology_)
+    { }
+
+    Interconnect* get_new_interconnect(MemoryHierarchy &mem,
+            const char *name)
+    {
+        return new Mesh(name, &mem, topology);
+    }
+};
+
+MeshBuilder meshBuilder("mesh", TOPOLOGY_MESH);
+MeshBuilder ringBuilder("ring", TOPOLOGY_RING);
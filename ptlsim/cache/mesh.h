@@ -0,0 +1,255 @@
+
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ */
+
+#ifndef MESH_H
+#define MESH_H
+
+#ifdef MEM_TEST
+#include <test.h>
+#else
+#include <ptlsim.h>
+#endif
+
+#include <cpuController.h>
+#include <memoryHierarchy.h>
+#include <memoryStats.h>
+
+#include <machine.h>
+
+#define MESH_ROUTER_DELAY 2
+#define MESH_LINK_DELAY   1
+#define MESH_LINK_WIDTH   16
+#define MESH_LINE_SIZE    64
+#define MESH_QUEUE_SIZE   16
+
+namespace Memory {
+
+namespace MeshInterconnect {
+
+    enum {
+        TOPOLOGY_MESH = 0,
+        TOPOLOGY_RING,
+    };
+
+    /* Output ports of a router, a ring only uses east and west */
+    enum {
+        PORT_EAST = 0,
+        PORT_WEST,
+        PORT_NORTH,
+        PORT_SOUTH,
+        NUM_PORTS,
+    };
+
+    struct NodeQueue;
+
+    /**
+     * @brief A message travelling through the network
+     *
+     * The packet stays in the queue of its source node until it is
+     * delivered, so a full queue stops the source from injecting more.
+     */
+    struct Packet : public FixStateListObject
+    {
+        MemoryRequest *request;
+        Controller    *source;
+        Controller    *dest;
+        void          *m_arg;
+        bool           annuled;
+        bool           has_data;
+        bool           shared;
+
+        NodeQueue     *queue;
+        int            node;
+        int            dest_node;
+        int            flits;
+        int            hops;
+        W64            inject_cycle;
+
+        void init() {
+            request      = NULL;
+            source       = NULL;
+            dest         = NULL;
+            m_arg        = NULL;
+            annuled      = 0;
+            has_data     = 0;
+            shared       = 0;
+            queue        = NULL;
+            node         = 0;
+            dest_node    = 0;
+            flits        = 0;
+            hops         = 0;
+            inject_cycle = 0;
+        }
+
+        void setup(const Message &msg) {
+            source   = (Controller*)msg.sender;
+            dest     = (Controller*)msg.dest;
+            request  = msg.request;
+            m_arg    = msg.arg;
+            has_data = msg.hasData;
+            shared   = msg.isShared;
+            request->incRefCounter();
+        }
+
+        void fill(Message &msg) const {
+            msg.origin   = source;
+            msg.dest     = dest;
+            msg.request  = request;
+            msg.arg      = m_arg;
+            msg.hasData  = has_data;
+            msg.isShared = shared;
+        }
+
+        ostream& print(ostream& os) const {
+            if (!request) {
+                os << "Free entry";
+                return os;
+            }
+
+            os << "request[", *request, "] ";
+            os << "source[", source->get_name(), "] ";
+            os << "dest[", dest->get_name(), "] ";
+            os << "node[", node, "->", dest_node, "] ";
+            os << "flits[", flits, "] ";
+            os << "annuled[", annuled, "]";
+            return os;
+        }
+    };
+
+    static inline ostream& operator <<(ostream& os, const Packet &packet)
+    {
+        return packet.print(os);
+    }
+
+    static inline Packet& operator <<(Packet& packet, const Message &msg)
+    {
+        packet.setup(msg);
+        return packet;
+    }
+
+    static inline Message& operator <<(Message& msg, const Packet& packet)
+    {
+        packet.fill(msg);
+        return msg;
+    }
+
+    /**
+     * @brief Router node of one controller and its injection queue
+     */
+    struct NodeQueue {
+        Controller *controller;
+        int         node;
+        FixStateList<Packet, MESH_QUEUE_SIZE> queue;
+
+        NodeQueue() {
+            controller = NULL;
+            node       = 0;
+            queue.reset();
+        }
+    };
+
+    /**
+     * @brief 2D mesh or ring network-on-chip between controllers
+     *
+     * Each controller gets its own router, numbered in the order the
+     * controllers are registered. A mesh places them row by row, 'columns'
+     * routers per row, and routes packets X first then Y. A ring is
+     * bidirectional and packets take the shorter direction.
+     *
+     * Every hop takes the router pipeline latency plus the link latency. A
+     * link carries 'link_width' bytes per cycle, so a packet holds each link
+     * on its path for as many cycles as it has flits and packets behind it
+     * wait. Packets are moved by one event per hop, so the simulation cost
+     * grows with the packets in flight and not with the network size.
+     *
+     * Options:
+     *   latency        router pipeline cycles (default 2)
+     *   link_latency   link traversal cycles (default 1)
+     *   link_width     link bytes per cycle (default 16)
+     *   line_size      bytes of data in a packet carrying a line (default 64)
+     *   columns        routers per mesh row (default: square mesh)
+     */
+    class Mesh : public Interconnect
+    {
+        private:
+            dynarray<NodeQueue*> nodes_;
+
+            // First cycle in which each output link is free
+            dynarray<W64> linkFree_;
+
+            Signal hop_;
+            Signal deliver_;
+
+            int topology_;
+            int columns_;
+            int rows_;
+            int configColumns_;
+            int routerLatency_;
+            int linkLatency_;
+            int linkWidth_;
+            int dataFlits_;
+
+            MeshStats *new_stats;
+
+            void setup_geometry();
+            bool older_pending(Packet *packet);
+            void release(Packet *packet);
+
+        public:
+            Mesh(const char *name, MemoryHierarchy *memoryHierarchy,
+                    int topology);
+            ~Mesh();
+
+            bool controller_request_cb(void *arg);
+            void register_controller(Controller *controller);
+            int  access_fast_path(Controller *controller,
+                    MemoryRequest *request);
+            void annul_request(MemoryRequest *request);
+            int  get_delay() { return routerLatency_ + linkLatency_; }
+            void dump_configuration(YAML::Emitter &out) const;
+
+            NodeQueue* get_queue(Controller *cont);
+            int route(int node, int dest_node) const;
+            int next_node(int node, int port) const;
+            int distance(int node, int dest_node) const;
+
+            bool hop_cb(void *arg);
+            bool deliver_cb(void *arg);
+
+            void print(ostream& os) const {
+                os << "--Mesh-Interconnect: ", get_name(), endl;
+                foreach (i, nodes_.count()) {
+                    NodeQueue *nq = nodes_[i];
+                    os << "Node ", i, " ", nq->controller->get_name(),
+                       " Queue:", endl;
+                    os << nq->queue;
+                }
+                os << "--End-Mesh-Interconnect\n";
+            }
+
+            void print_map(ostream& os) {
+                os << "Mesh Interconnect: ", get_name(), endl;
+                os << "\tconnected to: ", endl;
+
+                foreach (i, nodes_.count()) {
+                    os << "\t\tnode[", i, "]: ";
+                    os << nodes_[i]->controller->get_name(), endl;
+                }
+            }
+    };
+
+    static inline ostream& operator <<(ostream& os, const Mesh &mesh)
+    {
+        mesh.print(os);
+        return os;
+    }
+};
+
+};
+
+#endif // MESH_H
@@ -444,6 +444,37 @@ bool MESILogic::is_line_valid(CacheLine *line)
     return true;
 }
 
+/**
+ * @brief Set the state of a line accessed while fast-forwarding
+ *
+ * @param line Line of this cache, invalid if it was just inserted
+ * @param is_write True if the access is a store
+ * @param shared True if other private caches hold the line
+ */
+void MESILogic::warm_line(CacheLine *line, bool is_write, bool shared)
+{
+    if(!controller->is_private()) {
+        /* Shared caches get their lines from main memory */
+        if(line->state == MESI_INVALID)
+            line->state = MESI_EXCLUSIVE;
+        return;
+    }
+
+    if(is_write) {
+        line->state = MESI_MODIFIED;
+    } else if(line->state == MESI_INVALID) {
+        line->state = shared ? MESI_SHARED : MESI_EXCLUSIVE;
+    }
+}
+
+/**
+ * @brief Another core accessed a line this private cache holds
+ */
+void MESILogic::warm_snoop(CacheLine *line, bool is_write)
+{
+    line->state = is_write ? MESI_INVALID : MESI_SHARED;
+}
+
 void MESILogic::handle_response(CacheQueueEntry *entry, Message &msg)
 {
 }
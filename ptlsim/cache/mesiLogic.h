@@ -85,6 +85,8 @@ namespace CoherentCache {
                     Message &message);
             bool is_line_valid(CacheLine *line);
             void invalidate_line(CacheLine *line);
+            void warm_line(CacheLine *line, bool is_write, bool shared);
+            void warm_snoop(CacheLine *line, bool is_write);
 			void dump_configuration(YAML::Emitter &out) const;
 
             MESICacheLineState get_new_state(CacheQueueEntry *queueEntry, bool isShared);
@@ -394,6 +394,44 @@ bool MOESILogic::is_line_valid(CacheLine *line)
     return true;
 }
 
+/**
+ * @brief Set the state of a line accessed while fast-forwarding
+ *
+ * @param line Line of this cache, invalid if it was just inserted
+ * @param is_write True if the access is a store
+ * @param shared True if other private caches hold the line
+ */
+void MOESILogic::warm_line(CacheLine *line, bool is_write, bool shared)
+{
+    if (!controller->is_private()) {
+        if (line->state == MOESI_INVALID)
+            line->state = MOESI_EXCLUSIVE;
+        return;
+    }
+
+    if (is_write) {
+        line->state = MOESI_MODIFIED;
+    } else if (line->state == MOESI_INVALID) {
+        line->state = shared ? MOESI_SHARED : MOESI_EXCLUSIVE;
+    }
+}
+
+/**
+ * @brief Another core accessed a line this private cache holds
+ *
+ * A dirty line stays dirty here as the owner when the other core reads it.
+ */
+void MOESILogic::warm_snoop(CacheLine *line, bool is_write)
+{
+    if (is_write) {
+        line->state = MOESI_INVALID;
+    } else if (line->state == MOESI_MODIFIED) {
+        line->state = MOESI_OWNER;
+    } else if (line->state == MOESI_EXCLUSIVE) {
+        line->state = MOESI_SHARED;
+    }
+}
+
 void MOESILogic::handle_response(CacheQueueEntry *queueEntry,
         Message &message)
 {
@@ -440,7 +478,7 @@ void MOESILogic::send_to_cont(CacheQueueEntry *queueEntry,
         Interconnect *sendTo, Controller *dest)
 {
     queueEntry->dest = dest;
-    queueEntry->request->get_history() << "{MOESI} ";
+    ADD_HISTORY(queueEntry->request, "{MOESI} ");
 
     send_response(queueEntry, sendTo);
 }
@@ -0,0 +1,208 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ * Synthetic agents that send requests to the CPU controllers of a machine
+ * in place of its cores, to benchmark the speed of the caches, coherence
+ * logic and interconnects without booting a guest.
+ */
+
+#ifdef MEM_TEST
+#include <test.h>
+#else
+#include <ptlsim.h>
+#endif
+
+#include <trafficGenerator.h>
+#include <memoryHierarchy.h>
+#include <memoryRequest.h>
+
+using namespace Memory;
+
+const char* Memory::traffic_pattern_names[NUM_TRAFFIC_PATTERNS] = {
+    "stream", "random", "chase", "prodcons", "falseshare"
+};
+
+/**
+ * @brief Index of the pattern called 'name', -1 if there is none
+ */
+int Memory::find_traffic_pattern(const char* name)
+{
+    foreach (i, NUM_TRAFFIC_PATTERNS) {
+        if (strcmp(name, traffic_pattern_names[i]) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+TrafficGenerator::TrafficGenerator(MemoryHierarchy& memoryHierarchy,
+        const TrafficConfig& config)
+    : memoryHierarchy_(memoryHierarchy)
+    , config_(config)
+    , completed_(0)
+    , latencySum_(0)
+    , latencyMax_(0)
+{
+    /* Each load of a pointer chase needs the previous one */
+    if (config_.pattern == TRAFFIC_CHASE || config_.outstanding < 1)
+        config_.outstanding = 1;
+
+    agents_ = new TrafficAgent[config_.agents];
+    state_ = new AgentState[config_.agents];
+
+    foreach (i, config_.agents) {
+        agents_[i].init(i, config_);
+        state_[i].issued = 0;
+        state_[i].completed = 0;
+        state_[i].outstanding = 0;
+    }
+
+    memset(latency_, 0, sizeof(latency_));
+
+    signal_.set_name("Traffic-Generator-wakeup");
+    signal_.connect(SIGNAL_MEM_FN(*this,
+                &TrafficGenerator::request_done_cb));
+}
+
+TrafficGenerator::~TrafficGenerator()
+{
+    delete [] agents_;
+    delete [] state_;
+}
+
+void TrafficGenerator::complete(int agent, W64 latency)
+{
+    int bucket = 0;
+    for (W64 l = latency; l && bucket < TRAFFIC_LATENCY_BUCKETS - 1; l >>= 1)
+        bucket++;
+
+    latency_[bucket]++;
+    latencySum_ += latency;
+    latencyMax_ = max(latencyMax_, latency);
+
+    state_[agent].completed++;
+    state_[agent].outstanding--;
+    completed_++;
+}
+
+bool TrafficGenerator::request_done_cb(void *arg)
+{
+    MemoryRequest *request = (MemoryRequest*)arg;
+
+    complete(request->get_coreid(),
+            sim_cycle - request->get_init_cycles());
+
+    return true;
+}
+
+/*
+ * Send the next request of 'agent' to its CPU controller, returns false
+ * if the L1 can not take it this cycle.
+ */
+bool TrafficGenerator::issue(int agent)
+{
+    if (!memoryHierarchy_.is_cache_available(agent, 0, false))
+        return false;
+
+    W64 address;
+    bool isWrite;
+    agents_[agent].next(address, isWrite);
+
+    MemoryRequest *request = memoryHierarchy_.get_free_request(agent);
+    assert(request != NULL);
+
+    request->init(agent, 0, address, 0, sim_cycle, false, 0,
+            state_[agent].issued, isWrite ? MEMORY_OP_WRITE : MEMORY_OP_READ);
+    request->set_coreSignal(&signal_);
+
+    state_[agent].issued++;
+    state_[agent].outstanding++;
+
+    memoryHierarchy_.access_cache(request);
+
+    /* Completed without being queued in the CPU controller, no wakeup
+     * will follow */
+    if (request->get_ref_counter() == 0)
+        complete(agent, 0);
+
+    return true;
+}
+
+/**
+ * @brief Run all agents until each one has completed its requests
+ *
+ * Every cycle each agent sends at most one request, as long as it has
+ * less than 'outstanding' requests in flight. Cycles in which no agent
+ * can send and the hierarchy has nothing to do are skipped.
+ *
+ * @return Number of completed requests
+ */
+W64 TrafficGenerator::run()
+{
+    W64 total = config_.requests * config_.agents;
+
+    while (completed_ < total) {
+        bool waiting = true;
+
+        foreach (i, config_.agents) {
+            AgentState& state = state_[i];
+
+            if (state.issued == config_.requests ||
+                    state.outstanding >= config_.outstanding)
+                continue;
+
+            waiting = false;
+            issue(i);
+        }
+
+        if (waiting) {
+            W64 next = memoryHierarchy_.next_clock();
+
+            /* Requests in flight but nothing left to wake them up */
+            if unlikely (next == W64(-1)) {
+                ptl_logfile << "Traffic generator: ",
+                            total - completed_, " requests never completed",
+                            endl;
+                break;
+            }
+
+            if (next > sim_cycle) {
+                memoryHierarchy_.skip_cycles(next - sim_cycle, true);
+                sim_cycle = next;
+            }
+        }
+
+        memoryHierarchy_.clock();
+        sim_cycle++;
+    }
+
+    return completed_;
+}
+
+/**
+ * @brief Print the distribution of the request latencies in cycles
+ */
+void TrafficGenerator::print_latency(ostream& os) const
+{
+    os << "Latency (cycles): mean ",
+       (completed_ ? double(latencySum_) / completed_ : 0.0),
+       ", max ", latencyMax_, endl;
+
+    foreach (i, TRAFFIC_LATENCY_BUCKETS) {
+        if (!latency_[i])
+            continue;
+
+        W64 low = i ? (1ULL << (i - 1)) : 0;
+        W64 high = (1ULL << i) - 1;
+
+        os << "  ", intstring(low, 6), " - ";
+        if (i == TRAFFIC_LATENCY_BUCKETS - 1)
+            os << "   inf";
+        else
+            os << intstring(high, 6);
+        os << " : ", intstring(latency_[i], 12), "  ",
+           floatstring(100.0 * latency_[i] / completed_, 6, 2), "%", endl;
+    }
+}
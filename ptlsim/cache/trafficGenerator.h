@@ -0,0 +1,170 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ * Synthetic agents that send requests to the CPU controllers of a machine
+ * in place of its cores, to benchmark the speed of the caches, coherence
+ * logic and interconnects without booting a guest.
+ */
+
+#ifndef TRAFFIC_GENERATOR_H
+#define TRAFFIC_GENERATOR_H
+
+#include <globals.h>
+#include <superstl.h>
+
+#define TRAFFIC_LINE_SIZE          64
+#define TRAFFIC_FALSE_SHARE_LINES  8
+#define TRAFFIC_LATENCY_BUCKETS    16
+
+namespace Memory {
+
+    class MemoryHierarchy;
+    class MemoryRequest;
+
+    enum TrafficPattern {
+        TRAFFIC_STREAM = 0,   // Sequential lines of a private region
+        TRAFFIC_RANDOM,       // Random lines of a private region
+        TRAFFIC_CHASE,        // Random lines, each waits for the previous one
+        TRAFFIC_PRODCONS,     // Pairs of agents, one writes what the other reads
+        TRAFFIC_FALSESHARE,   // All agents write their own word of shared lines
+        NUM_TRAFFIC_PATTERNS
+    };
+
+    extern const char* traffic_pattern_names[NUM_TRAFFIC_PATTERNS];
+
+    int find_traffic_pattern(const char* name);
+
+    struct TrafficConfig {
+        int pattern;
+        int agents;
+        W64 requests;      // Per agent
+        W64 footprint;     // Bytes per agent or per producer/consumer pair
+        int writePercent;  // Ignored by prodcons
+        int outstanding;   // Per agent, chase always uses 1
+        W64 seed;
+    };
+
+    /*
+     * Address stream of one agent. Kept apart from the generator so the
+     * patterns do not depend on a memory hierarchy.
+     */
+    class TrafficAgent {
+    public:
+        TrafficAgent() {}
+
+        void init(int id, const TrafficConfig& config) {
+            id_ = id;
+            pattern_ = config.pattern;
+            writePercent_ = config.writePercent;
+            index_ = 0;
+            rand_ = (config.seed + id + 1) * 0x9e3779b97f4a7c15ULL;
+
+            /* Power of two number of lines, so chase can use a full
+             * period LCG over the line index */
+            lines_ = 1;
+            while (lines_ * 2 * TRAFFIC_LINE_SIZE <= config.footprint)
+                lines_ *= 2;
+
+            int region = (pattern_ == TRAFFIC_PRODCONS) ? id / 2 : id;
+            base_ = W64(region) * lines_ * TRAFFIC_LINE_SIZE;
+
+            chaseInc_ = (rand_ >> 32) | 1;
+            chase_ = 0;
+        }
+
+        void next(W64& address, bool& isWrite) {
+            W64 line;
+
+            switch (pattern_) {
+                case TRAFFIC_STREAM:
+                    line = index_ & (lines_ - 1);
+                    isWrite = random_percent() < writePercent_;
+                    break;
+                case TRAFFIC_RANDOM:
+                    line = (random() >> 11) & (lines_ - 1);
+                    isWrite = random_percent() < writePercent_;
+                    break;
+                case TRAFFIC_CHASE:
+                    chase_ = (chase_ * 6364136223846793005ULL + chaseInc_) &
+                        (lines_ - 1);
+                    line = chase_;
+                    isWrite = random_percent() < writePercent_;
+                    break;
+                case TRAFFIC_PRODCONS:
+                    line = index_ & (lines_ - 1);
+                    isWrite = !(id_ & 1);
+                    break;
+                default:
+                    address = (index_ % TRAFFIC_FALSE_SHARE_LINES) *
+                        TRAFFIC_LINE_SIZE + (id_ % 8) * 8;
+                    isWrite = random_percent() < writePercent_;
+                    index_++;
+                    return;
+            }
+
+            address = base_ + line * TRAFFIC_LINE_SIZE;
+            index_++;
+        }
+
+    private:
+        int id_;
+        int pattern_;
+        int writePercent_;
+        W64 index_;
+        W64 lines_;
+        W64 base_;
+        W64 rand_;
+        W64 chase_;
+        W64 chaseInc_;
+
+        W64 random() {
+            rand_ ^= rand_ >> 12;
+            rand_ ^= rand_ << 25;
+            rand_ ^= rand_ >> 27;
+            return rand_ * 2685821657736338717ULL;
+        }
+
+        int random_percent() {
+            return (random() >> 32) % 100;
+        }
+    };
+
+    class TrafficGenerator {
+    public:
+        TrafficGenerator(MemoryHierarchy& memoryHierarchy,
+                const TrafficConfig& config);
+        ~TrafficGenerator();
+
+        W64 run();
+
+        W64 get_completed() const { return completed_; }
+        void print_latency(ostream& os) const;
+
+    private:
+        MemoryHierarchy& memoryHierarchy_;
+        TrafficConfig config_;
+        TrafficAgent* agents_;
+        Signal signal_;
+
+        struct AgentState {
+            W64 issued;
+            W64 completed;
+            int outstanding;
+        };
+        AgentState* state_;
+
+        W64 completed_;
+        W64 latencySum_;
+        W64 latencyMax_;
+        W64 latency_[TRAFFIC_LATENCY_BUCKETS];
+
+        bool issue(int agent);
+        void complete(int agent, W64 latency);
+        bool request_done_cb(void *arg);
+    };
+
+};
+
+#endif // TRAFFIC_GENERATOR_H
@@ -14,6 +14,7 @@
 #include <branchpred.h>
 #include <decode.h>
 #include <memoryHierarchy.h>
+#include <warm-state.h>
 
 //#define DISABLE_LDST_FWD
 
@@ -1562,7 +1563,7 @@ void AtomOp::writeback_eom()
 #ifdef TRACE_RIP
     ptl_rip_trace << "commit_rip: ",
                   hexstring(rip, 64), " \t",
-                  "simcycle: ", sim_cycle, "\tkernel: ",
+                  "simcycle: ", core_cycle(), "\tkernel: ",
                   thread->ctx.kernel_mode, endl;
 #endif
 
@@ -1728,13 +1729,13 @@ AtomThread::AtomThread(AtomCore& core, W8 threadid, Context& ctx)
     stringbuf sig_name;
     sig_name << "Core" << core.get_coreid() << "-Th" << threadid << "-dcache-wakeup";
     dcache_signal.set_name(sig_name.buf);
-    dcache_signal.connect(signal_mem_ptr(*this,
+    dcache_signal.connect(SIGNAL_MEM_FN(*this,
             &AtomThread::dcache_wakeup));
 
     sig_name.reset();
     sig_name << "Core" << core.get_coreid() << "-Th" << threadid << "-icache-wakeup";
     icache_signal.set_name(sig_name.buf);
-    icache_signal.connect(signal_mem_ptr(*this,
+    icache_signal.connect(SIGNAL_MEM_FN(*this,
             &AtomThread::icache_wakeup));
 
     op_lists.reset();
@@ -1750,7 +1751,11 @@ AtomThread::AtomThread(AtomCore& core, W8 threadid, Context& ctx)
 
     handle_interrupt_at_next_eom = 0;
     current_bb = NULL;
+    total_insns_committed = 0;
 
+    /* Predictor tables live as long as the thread, reset() only flushes
+     * its speculative state */
+    branchpred.init(core.get_coreid(), threadid);
     reset();
 
     // Set Stat Equations
@@ -1821,7 +1826,7 @@ void AtomThread::reset()
     op_waiting_to_writeback_list.reset();
     op_ready_to_writeback_list.reset();
 
-    branchpred.init(core.get_coreid(), threadid);
+    branchpred.flush();
     branches_in_flight = 0;
 
     foreach(i, NUM_ATOM_OPS_PER_THREAD) {
@@ -1957,7 +1962,7 @@ bool AtomThread::fetch_from_icache()
             get_free_request(core.get_coreid());
         assert(request != NULL);
 
-        request->init(core.get_coreid(), threadid, physaddr, 0, sim_cycle,
+        request->init(core.get_coreid(), threadid, physaddr, 0, core_cycle(),
                 true, fetchrip.rip, 0, Memory::MEMORY_OP_READ);
         request->set_coreSignal(&icache_signal);
 
@@ -1998,29 +2003,22 @@ bool AtomThread::fetch_check_current_bb()
         current_bb = NULL;
     }
 
-    BasicBlock *bb = bbcache[ENV_GET_CPU(&ctx)->cpu_index](fetchrip);
+    // Lookup also acquires a lock on the basic block so its not flushed out
+    current_bb = bbcache_of(ENV_GET_CPU(&ctx)->cpu_index).get_and_acquire(ctx, fetchrip);
 
-    if likely (bb) {
-        current_bb = bb;
-    } else {
-        current_bb = bbcache[ENV_GET_CPU(&ctx)->cpu_index].translate(ctx, fetchrip);
-
-        if unlikely (!current_bb) {
-            if(fetchrip.rip == ctx.eip) {
-                // Its a page fault in I-Cache
-                itlb_exception = true;
-                itlb_exception_addr = ctx.exec_fault_addr;
-                ATOMTHLOG1("ITLB Execption addr ",
-                        hexstring(itlb_exception_addr,48), " fetchrip ",
-                        hexstring(fetchrip.rip,48));
-            }
+    if unlikely (!current_bb) {
+        if(fetchrip.rip == ctx.eip) {
+            // Its a page fault in I-Cache
+            itlb_exception = true;
+            itlb_exception_addr = ctx.exec_fault_addr;
+            ATOMTHLOG1("ITLB Execption addr ",
+                    hexstring(itlb_exception_addr,48), " fetchrip ",
+                    hexstring(fetchrip.rip,48));
         }
     }
 
     if(current_bb) {
-        // acquire a lock on this basic block so its not flushed out
-        current_bb->acquire();
-        current_bb->use(sim_cycle);
+        current_bb->use(core_cycle());
 
         if(!current_bb->synthops) {
             synth_uops_for_bb(*current_bb);
@@ -2090,7 +2088,7 @@ itlb_walk_finish:
         get_free_request(core.get_coreid());
     assert(request != NULL);
 
-    request->init(core.get_coreid(), threadid, pteaddr, 0, sim_cycle,
+    request->init(core.get_coreid(), threadid, pteaddr, 0, core_cycle(),
             true, fetchrip.rip, 0, Memory::MEMORY_OP_READ);
     request->set_coreSignal(&icache_signal);
 
@@ -2147,7 +2145,7 @@ dtlb_walk_finish:
         get_free_request(core.get_coreid());
     assert(request != NULL);
 
-    request->init(core.get_coreid(), threadid, pteaddr, 0, sim_cycle,
+    request->init(core.get_coreid(), threadid, pteaddr, 0, core_cycle(),
             false, 0, 0, Memory::MEMORY_OP_READ);
     request->set_coreSignal(&dcache_signal);
 
@@ -2377,7 +2375,7 @@ bool AtomThread::access_dcache(Waddr addr, W64 rip, W8 type, W64 uuid)
     assert(request);
 
     request->init(core.get_coreid(), threadid, addr, 0,
-            sim_cycle, false, rip, uuid, (Memory::OP_TYPE)type);
+            core_cycle(), false, rip, uuid, (Memory::OP_TYPE)type);
     request->set_coreSignal(&dcache_signal);
 
     st_dcache.accesses++;
@@ -2556,7 +2554,7 @@ bool AtomThread::writeback()
     AtomOp* op;
     bool ret_value = false;
 
-    if(sim_cycle > (last_commit_cycle + 1024*1024)) {
+    if(core_cycle() > (last_commit_cycle + 1024*1024)) {
         ptl_logfile << "Core has not progressed since cycle ",
                     last_commit_cycle, " dumping all information\n";
         core.machine.dump_state(ptl_logfile);
@@ -2623,7 +2621,7 @@ bool AtomThread::writeback()
                 ret_value = handle_interrupt();
             }
 
-            last_commit_cycle = sim_cycle;
+            last_commit_cycle = core_cycle();
 
             break;
         }
@@ -2678,6 +2676,7 @@ bool AtomThread::commit_queue()
         st_commit.uops += buf.op->num_uops_used;
 
         if(buf.op->eom || commit_result == COMMIT_BARRIER) {
+            count_total_committed(::total_insns_committed);
             total_insns_committed++;
             st_commit.insns++;
             break;
@@ -2804,7 +2803,12 @@ bool AtomThread::handle_barrier()
 
     ATOMTHLOG1("Executing Assist Function ", assist_name(assist));
 
-    bool flush_required = assist(ctx);
+    bool flush_required;
+    {
+        /* Assists call into QEMU helpers, serialize them */
+        ParallelSection section(parallel_qemu_lock);
+        flush_required = assist(ctx);
+    }
 
     assists[assistid]++;
 
@@ -2983,6 +2987,7 @@ ostream& AtomThread::print(ostream& os) const
 AtomCore::AtomCore(BaseMachine& machine, int num_threads, const char* name)
     : BaseCore(machine, name)
       , threadcount(num_threads)
+      , tlbs_restored(false)
 {
     int th_count;
     if(!machine.get_option(name, "threads", th_count)) {
@@ -2997,7 +3002,7 @@ AtomCore::AtomCore(BaseMachine& machine, int num_threads, const char* name)
 	stringbuf sg_name;
 	sg_name << name << "-run-cycle";
 	run_cycle.set_name(sg_name.buf);
-	run_cycle.connect(signal_mem_ptr(*this, &AtomCore::runcycle));
+	run_cycle.connect(SIGNAL_MEM_FN(*this, &AtomCore::runcycle));
 	marss_register_per_cycle_event(&run_cycle);
 
     foreach(i, threadcount) {
@@ -3136,7 +3141,7 @@ bool AtomCore::runcycle(void* none)
 
     assert(running_thread);
 
-    ATOMCORELOG("Cycle: ", sim_cycle);
+    ATOMCORELOG("Cycle: ", core_cycle());
 
     running_thread->handle_interrupt_at_next_eom =
         running_thread->ctx.check_events();
@@ -3241,8 +3246,11 @@ void AtomCore::reset()
         threads[i]->reset();
     }
 
-    dtlb.reset();
-    itlb.reset();
+    if(!tlbs_restored) {
+        dtlb.reset();
+        itlb.reset();
+    }
+    tlbs_restored = false;
     fetchq.reset();
 
     forwardbuf.reset();
@@ -3266,6 +3274,78 @@ void AtomCore::flush_tlb(Context& ctx)
     }
 }
 
+/**
+ * @brief Check if one of the threads of this core runs 'ctx'
+ */
+bool AtomCore::has_context(Context& ctx)
+{
+    foreach(i, threadcount) {
+        if(&threads[i]->ctx == &ctx)
+            return true;
+    }
+
+    return false;
+}
+
+W64 AtomCore::insns_committed()
+{
+    W64 commits = 0;
+
+    foreach(i, threadcount) {
+        commits += threads[i]->total_insns_committed;
+    }
+
+    return commits;
+}
+
+/**
+ * @brief Train the branch predictor of the thread running 'ctx' with a
+ * branch executed while QEMU fast-forwards
+ */
+void AtomCore::warm_branch(Context& ctx, int type, W64 branchaddr,
+        W64 target, W64 actual)
+{
+    foreach(i, threadcount) {
+        if(&threads[i]->ctx == &ctx) {
+            threads[i]->branchpred.warm(type, branchaddr, target, actual);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Save TLBs of the core and branch predictor of each thread
+ */
+void AtomCore::save_warm_state(WarmStateFile& ws)
+{
+    stringbuf name;
+
+    foreach(i, threadcount) {
+        name.reset(); name << get_name(), "_t", i, "_bp";
+        threads[i]->branchpred.save_state(ws, name);
+    }
+
+    name.reset(); name << get_name(), "_dtlb";
+    ws.save(name, &dtlb, sizeof(dtlb));
+    name.reset(); name << get_name(), "_itlb";
+    ws.save(name, &itlb, sizeof(itlb));
+}
+
+void AtomCore::load_warm_state(WarmStateFile& ws)
+{
+    stringbuf name;
+
+    foreach(i, threadcount) {
+        name.reset(); name << get_name(), "_t", i, "_bp";
+        threads[i]->branchpred.load_state(ws, name);
+    }
+
+    name.reset(); name << get_name(), "_dtlb";
+    tlbs_restored = ws.restore(name, &dtlb, sizeof(dtlb));
+    name.reset(); name << get_name(), "_itlb";
+    tlbs_restored |= ws.restore(name, &itlb, sizeof(itlb));
+}
+
 /**
  * @brief Flush a specific entry in TLB
  *
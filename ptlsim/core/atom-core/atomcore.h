@@ -799,6 +799,7 @@ namespace ATOM_CORE_MODEL {
         bool    mmio_pending;
         bool    inst_in_pipe;
         W64     last_commit_cycle;
+        W64     total_insns_committed;
 
         BranchPredictorInterface branchpred;
 
@@ -1047,6 +1048,12 @@ namespace ATOM_CORE_MODEL {
         void dump_state(ostream& os);
         void update_stats();
         void flush_pipeline();
+        bool has_context(Context& ctx);
+        W64 insns_committed();
+        void warm_branch(Context& ctx, int type, W64 branchaddr, W64 target,
+                W64 actual);
+        void save_warm_state(WarmStateFile& ws);
+        void load_warm_state(WarmStateFile& ws);
         //W8   get_coreid();
 		void dump_configuration(YAML::Emitter &out) const;
 
@@ -1106,6 +1113,10 @@ namespace ATOM_CORE_MODEL {
         DTLB dtlb;
         ITLB itlb;
 
+        // Set when the TLBs are restored from a warm state, so the reset
+        // of the first simulation run doesn't drop them
+        bool tlbs_restored;
+
         // fu_available is used across cycles for non-pipeliend instructions
         // fu_used is used within cycle to make sure that we dont issue
         // multiple instructions to same FU in one cycle
@@ -27,15 +27,22 @@ void BaseCore::update_memory_hierarchy_ptr() {
 
 extern "C" void ptl_flush_bbcache(int8_t context_id) {
     if(in_simulation) {
-      foreach(i, NUM_SIM_CORES) {
-        bbcache[i].flush(context_id);
-        // Get the current ptlsim machine and call its flush tlb
-        PTLsimMachine* machine = PTLsimMachine::getcurrent();
-
-        if(machine) {
-            Context& ctx = machine->contextof(context_id);
-            machine->flush_tlb(ctx);
-        }
+      /* Only the cache holding this context's blocks is affected */
+      if(context_id >= 0) {
+          bbcache_of(context_id).flush(context_id);
+      } else {
+          foreach(i, (config.shared_bbcache ? 1 : NUM_SIM_CORES))
+              bbcache[i].flush(context_id);
+      }
+
+      // Get the current ptlsim machine and call its flush tlb
+      PTLsimMachine* machine = PTLsimMachine::getcurrent();
+
+      if(machine) {
+          foreach(i, NUM_SIM_CORES) {
+              if(context_id < 0 || i == context_id)
+                  machine->flush_tlb(machine->contextof(i));
+          }
       }
     }
 }
@@ -17,6 +17,8 @@
 #include <statsBuilder.h>
 #include <memoryHierarchy.h>
 
+class WarmStateFile;
+
 namespace Core {
 
     class BaseCore : public Statable {
@@ -35,6 +37,53 @@ namespace Core {
             virtual void flush_pipeline() = 0;
 		    virtual void dump_configuration(YAML::Emitter &out) const = 0;
 
+            /*
+             * Idle cycle skipping: a core is quiescent when its last cycle
+             * only updated statistics and every following cycle will do the
+             * same, until either the returned cycle or a memory hierarchy
+             * event wakes it up. Returns 0 if the core is busy and -1 if
+             * only a memory event can wake it up. While the machine skips
+             * cycles, skip_cycles() advances any per-cycle state that is
+             * not a statistic.
+             */
+            virtual W64 quiescent_until() { return 0; }
+            virtual void skip_cycles(W64 cycles) { }
+
+            /*
+             * Halted core parking: is_halted() is true while every thread
+             * of the core is stopped by HLT and has no interrupt pending.
+             * The machine then stops clocking the core and calls
+             * account_halted_cycles() with the number of cycles it missed
+             * once the core wakes up.
+             */
+            virtual bool is_halted() { return false; }
+            virtual void account_halted_cycles(W64 cycles) { }
+
+            /*
+             * x86 instructions committed by all threads of the core, which
+             * '-parallel-reference' compares between serial and parallel
+             * runs.
+             */
+            virtual W64 insns_committed() { return 0; }
+
+            /*
+             * has_context() tells if 'ctx' runs on this core, TLB flushes
+             * only go to that core. Functional warming while QEMU
+             * fast-forwards: warm_branch() trains the branch predictor of
+             * the thread of 'ctx' with a branch it executed (see
+             * BranchPredictorInterface::warm()).
+             */
+            virtual bool has_context(Context& ctx) { return false; }
+            virtual void warm_branch(Context& ctx, int type, W64 branchaddr,
+                    W64 target, W64 actual) { }
+
+            /*
+             * Warm state saved next to a checkpoint: branch predictors and
+             * TLBs, as sections named after the core.
+             */
+            virtual void save_warm_state(WarmStateFile& ws) { }
+            virtual void load_warm_state(WarmStateFile& ws) { }
+
             void update_memory_hierarchy_ptr();
 
             BaseMachine& machine;
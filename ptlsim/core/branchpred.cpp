@@ -9,6 +9,7 @@
 //
 
 #include <branchpred.h>
+#include <warm-state.h>
 
 const char* branchpred_outcome_names[2] = {"mispred", "correct"};
 
@@ -466,7 +467,64 @@ void BranchPredictorInterface::annulras(const PredictorUpdate& predinfo) {
   impl->annulras(predinfo);
 };
 
-void BranchPredictorInterface::flush() { }
+//
+// Functional warming: train the predictor with a branch executed while
+// QEMU fast-forwards, as if it was fetched and committed on the correct
+// path. 'target' is the taken target and 'actual' the next rip.
+//
+void BranchPredictorInterface::warm(int type, W64 branchaddr, W64 target, W64 actual) {
+  PredictorUpdate update;
+  update.uuid = 0;
+  update.ctxid = 0;
+  update.ras_push = 0;
+
+  impl->predict(update, type, branchaddr, target);
+  if unlikely (type & (BRANCH_HINT_CALL|BRANCH_HINT_RET))
+    impl->updateras(update, branchaddr);
+  impl->update(update, branchaddr, actual);
+}
+
+//
+// Warm state: the direction tables and the BTB, saved as sections
+// '<name>_<table>'. The RAS only holds speculative calls and starts empty.
+//
+void BranchPredictorInterface::save_state(WarmStateFile& ws, const char* name) {
+  stringbuf sec;
+
+  sec.reset(); sec << name, "_twolevel_l1";
+  ws.save(sec, &impl->twolevel.shiftregs, sizeof(impl->twolevel.shiftregs));
+  sec.reset(); sec << name, "_twolevel_l2";
+  ws.save(sec, &impl->twolevel.L2table, sizeof(impl->twolevel.L2table));
+  sec.reset(); sec << name, "_bimodal";
+  ws.save(sec, &impl->bimodal.table, sizeof(impl->bimodal.table));
+  sec.reset(); sec << name, "_meta";
+  ws.save(sec, &impl->meta.table, sizeof(impl->meta.table));
+  sec.reset(); sec << name, "_btb";
+  ws.save(sec, &impl->btb.sets, sizeof(impl->btb.sets));
+}
+
+void BranchPredictorInterface::load_state(WarmStateFile& ws, const char* name) {
+  stringbuf sec;
+
+  sec.reset(); sec << name, "_twolevel_l1";
+  ws.restore(sec, &impl->twolevel.shiftregs, sizeof(impl->twolevel.shiftregs));
+  sec.reset(); sec << name, "_twolevel_l2";
+  ws.restore(sec, &impl->twolevel.L2table, sizeof(impl->twolevel.L2table));
+  sec.reset(); sec << name, "_bimodal";
+  ws.restore(sec, &impl->bimodal.table, sizeof(impl->bimodal.table));
+  sec.reset(); sec << name, "_meta";
+  ws.restore(sec, &impl->meta.table, sizeof(impl->meta.table));
+  sec.reset(); sec << name, "_btb";
+  ws.restore(sec, &impl->btb.sets, sizeof(impl->btb.sets));
+}
+
+//
+// Pipeline reset: drop the return address stack, which only holds calls
+// of the discarded pipeline, and keep the trained tables and the BTB.
+//
+void BranchPredictorInterface::flush() {
+  impl->ras.reset();
+}
 
 ostream& operator <<(ostream& os, const BranchPredictorInterface& branchpred) {
   os << branchpred.impl->ras;
@@ -58,6 +58,7 @@ extern W64 branchpred_ras_underflows;
 extern W64 branchpred_ras_annuls;
 
 struct BranchPredictorImplementation;
+class WarmStateFile;
 
 struct BranchPredictorInterface {
   // Pointer to private implementation:
@@ -72,6 +73,9 @@ struct BranchPredictorInterface {
   void update(PredictorUpdate& update, W64 branchaddr, W64 target);
   void updateras(PredictorUpdate& predinfo, W64 branchaddr);
   void annulras(const PredictorUpdate& predinfo);
+  void warm(int type, W64 branchaddr, W64 target, W64 actual);
+  void save_state(WarmStateFile& ws, const char* name);
+  void load_state(WarmStateFile& ws, const char* name);
   void flush();
 };
 
@@ -1757,7 +1757,7 @@ int ReorderBufferEntry::issueload(LoadStoreQueueEntry& state, Waddr& origaddr, W
     Memory::MemoryRequest *request = core.memoryHierarchy->get_free_request(core.get_coreid());
     assert(request != NULL);
 
-    request->init(core.get_coreid(), threadid, state.physaddr << 3, idx, sim_cycle,
+    request->init(core.get_coreid(), threadid, state.physaddr << 3, idx, core_cycle(),
             false, uop.rip.rip, uop.uuid, Memory::MEMORY_OP_READ);
     request->set_coreSignal(&core.dcache_signal);
 
@@ -1904,7 +1904,7 @@ bool ReorderBufferEntry::probetlb(LoadStoreQueueEntry& state, Waddr& origaddr, W
         /* Set this ROB entry to do TLB page walk */
         cycles_left = 0;
         changestate(thread.rob_tlb_miss_list);
-        tlb_miss_init_cycle = sim_cycle;
+        tlb_miss_init_cycle = core_cycle();
         tlb_walk_level = thread.ctx.page_table_level_count();
         thread.thread_stats.dcache.dtlb.misses++;
 
@@ -1988,7 +1988,7 @@ void ReorderBufferEntry::tlbwalk() {
     W64 virtaddr = virtpage;
 
     if(logable(6)) {
-        ptl_logfile << "cycle ", sim_cycle, " rob entry ", *this, " tlb_walk_level: ",
+        ptl_logfile << "cycle ", core_cycle(), " rob entry ", *this, " tlb_walk_level: ",
                     tlb_walk_level, " virtaddr: ", (void*)virtaddr, endl;
     }
 
@@ -1996,7 +1996,7 @@ void ReorderBufferEntry::tlbwalk() {
 
 rob_cont:
 
-        int delay = min(sim_cycle - tlb_miss_init_cycle, (W64)1000);
+        int delay = min(core_cycle() - tlb_miss_init_cycle, (W64)1000);
         thread.thread_stats.dcache.dtlb_latency[delay]++;
 
         if(logable(6)) {
@@ -2064,7 +2064,7 @@ rob_cont:
     Memory::MemoryRequest *request = core.memoryHierarchy->get_free_request(core.get_coreid());
     assert(request != NULL);
 
-    request->init(core.get_coreid(), threadid, pteaddr, idx, sim_cycle,
+    request->init(core.get_coreid(), threadid, pteaddr, idx, core_cycle(),
             false, uop.rip.rip, uop.uuid, Memory::MEMORY_OP_READ);
     request->set_coreSignal(&core.dcache_signal);
 
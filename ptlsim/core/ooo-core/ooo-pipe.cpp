@@ -87,7 +87,7 @@ bool ThreadContext::probeitlb(Waddr icache_addr) {
         }
 
         itlb_walk_level = ctx.page_table_level_count();
-        itlb_miss_init_cycle = sim_cycle;
+        itlb_miss_init_cycle = core_cycle();
         thread_stats.dcache.itlb.misses++;
 
         return false;
@@ -103,7 +103,7 @@ bool ThreadContext::probeitlb(Waddr icache_addr) {
  */
 void ThreadContext::itlbwalk() {
     if(logable(6)) {
-        ptl_logfile << "itlbwalk cycle ", sim_cycle, " tlb_walk_level: ",
+        ptl_logfile << "itlbwalk cycle ", core_cycle(), " tlb_walk_level: ",
                     itlb_walk_level, " virtaddr: ", (void*)(W64(fetchrip)), endl;
     }
 
@@ -114,7 +114,7 @@ itlb_walk_finish:
         }
         itlb_walk_level = 0;
         itlb.insert(fetchrip, threadid);
-        int delay = min(sim_cycle - itlb_miss_init_cycle, (W64)1000);
+        int delay = min(core_cycle() - itlb_miss_init_cycle, (W64)1000);
         thread_stats.dcache.itlb_latency[delay]++;
         waiting_for_icache_fill = 0;
         return;
@@ -136,7 +136,7 @@ itlb_walk_finish:
     Memory::MemoryRequest *request = core.memoryHierarchy->get_free_request(core.get_coreid());
     assert(request != NULL);
 
-    request->init(core.get_coreid(), threadid, pteaddr, 0, sim_cycle,
+    request->init(core.get_coreid(), threadid, pteaddr, 0, core_cycle(),
             true, 0, 0, Memory::MEMORY_OP_READ);
     request->set_coreSignal(&core.icache_signal);
 
@@ -285,7 +285,7 @@ void ThreadContext::flush_pipeline() {
     foreach_issueq(reset(core.get_coreid(), threadid, &core));
 
     dispatch_deadlock_countdown = DISPATCH_DEADLOCK_COUNTDOWN_CYCLES;
-    last_commit_at_cycle = sim_cycle;
+    last_commit_at_cycle = core_cycle();
     external_to_core_state();
 
     if(pause_counter)
@@ -327,8 +327,8 @@ void ThreadContext::reset_fetch_unit(W64 realrip) {
 void ThreadContext::invalidate_smc() {
     if unlikely (smc_invalidate_pending) {
         if (logable(5)) ptl_logfile << "SMC invalidate pending on ", smc_invalidate_rvp, endl;
-        bbcache[ENV_GET_CPU(&ctx)->cpu_index].invalidate_page(smc_invalidate_rvp.mfnlo, INVALIDATE_REASON_SMC);
-        if unlikely (smc_invalidate_rvp.mfnlo != smc_invalidate_rvp.mfnhi) bbcache[ENV_GET_CPU(&ctx)->cpu_index].invalidate_page(smc_invalidate_rvp.mfnhi, INVALIDATE_REASON_SMC);
+        bbcache_of(ENV_GET_CPU(&ctx)->cpu_index).invalidate_page(smc_invalidate_rvp.mfnlo, INVALIDATE_REASON_SMC);
+        if unlikely (smc_invalidate_rvp.mfnlo != smc_invalidate_rvp.mfnhi) bbcache_of(ENV_GET_CPU(&ctx)->cpu_index).invalidate_page(smc_invalidate_rvp.mfnhi, INVALIDATE_REASON_SMC);
         smc_invalidate_pending = 0;
     }
 }
@@ -514,8 +514,8 @@ bool ThreadContext::fetch() {
         return true;
     }
 
-    while ((fetchcount < FETCH_WIDTH) && (taken_branch_count == 0)) {
-        if unlikely (!fetchq.remaining()) {
+    while ((fetchcount < core.sizes.fetch_width) && (taken_branch_count == 0)) {
+        if unlikely (!fetchq_remaining()) {
             thread_stats.fetch.stop.fetchq_full++;
             break;
         }
@@ -599,7 +599,7 @@ bool ThreadContext::fetch() {
             Memory::MemoryRequest *request = core.memoryHierarchy->get_free_request(core.get_coreid());
             assert(request != NULL);
 
-            request->init(core.get_coreid(), threadid, physaddr, 0, sim_cycle,
+            request->init(core.get_coreid(), threadid, physaddr, 0, core_cycle(),
                     true, 0, 0, Memory::MEMORY_OP_READ);
             request->set_coreSignal(&core.icache_signal);
 
@@ -746,7 +746,7 @@ bool ThreadContext::fetch() {
         fetchcount++;
     }
 
-    if (fetchcount == FETCH_WIDTH) thread_stats.fetch.stop.full_width++;
+    if (fetchcount == core.sizes.fetch_width) thread_stats.fetch.stop.full_width++;
     thread_stats.fetch.width[fetchcount]++;
     return true;
 }
@@ -766,24 +766,17 @@ BasicBlock* ThreadContext::fetch_or_translate_basic_block(const RIPVirtPhys& rvp
         current_basic_block = NULL;
     }
 
-    BasicBlock* bb = bbcache[ENV_GET_CPU(&ctx)->cpu_index](rvp);
-
-    if likely (bb) {
-        current_basic_block = bb;
-    } else {
-        current_basic_block = bbcache[ENV_GET_CPU(&ctx)->cpu_index].translate(ctx, rvp);
-        if (current_basic_block == NULL) return NULL;
-        assert(current_basic_block);
-    }
-
      /*
       * Acquire a reference to the new basic block being fetched.
-      * This must be done right away so future allocations do not
-      * reclaim the BB while we still have a reference to it.
+      * This is done together with the lookup so future allocations (or
+      * other cores sharing the cache) do not reclaim the BB while we
+      * still have a reference to it.
       */
 
-    current_basic_block->acquire();
-    current_basic_block->use(sim_cycle);
+    current_basic_block = bbcache_of(ENV_GET_CPU(&ctx)->cpu_index).get_and_acquire(ctx, rvp);
+    if (current_basic_block == NULL) return NULL;
+
+    current_basic_block->use(core_cycle());
 
     if unlikely (!current_basic_block->synthops) synth_uops_for_bb(*current_basic_block);
     assert(current_basic_block->synthops);
@@ -801,13 +794,13 @@ void ThreadContext::rename() {
 
     int prepcount = 0;
 
-    while (prepcount < FRONTEND_WIDTH) {
+    while (prepcount < core.sizes.frontend_width) {
         if unlikely (fetchq.empty()) {
             thread_stats.frontend.status.fetchq_empty++;
             break;
         }
 
-        if unlikely (!ROB.remaining()) {
+        if unlikely (!rob_remaining()) {
             thread_stats.frontend.status.rob_full++;
             break;
         }
@@ -834,12 +827,12 @@ void ThreadContext::rename() {
         bool st = isstore(fetchbuf.opcode);
         bool br = isbranch(fetchbuf.opcode);
 
-        if unlikely (ld && (loads_in_flight >= LDQ_SIZE)) {
+        if unlikely (ld && (loads_in_flight >= core.sizes.load_q_size)) {
             thread_stats.frontend.status.ldq_full++;
             break;
         }
 
-        if unlikely (st && (stores_in_flight >= STQ_SIZE)) {
+        if unlikely (st && (stores_in_flight >= core.sizes.store_q_size)) {
             thread_stats.frontend.status.stq_full++;
             break;
         }
@@ -860,7 +853,7 @@ void ThreadContext::rename() {
         rob.reset();
         rob.uop = transop;
         rob.entry_valid = 1;
-        rob.cycles_left = FRONTEND_STAGES;
+        rob.cycles_left = core.sizes.frontend_stages;
         rob.lsq = NULL;
         if unlikely (ld|st) {
             rob.lsq = &lsq;
@@ -1241,10 +1234,10 @@ bool ReorderBufferEntry::find_sources() {
     ThreadContext& thread = getthread();
 
 #ifndef MULTI_IQ
-    assert(thread.issueq_count >= 0 && thread.issueq_count <= ISSUE_QUEUE_SIZE);
+    assert(thread.issueq_count >= 0 && thread.issueq_count <= getcore().sizes.issue_q_size);
     thread.issueq_count++;
 #else
-    assert(thread.issueq_count[cluster] >= 0 && thread.issueq_count[cluster] <= ISSUE_QUEUE_SIZE*4);
+    assert(thread.issueq_count[cluster] >= 0 && thread.issueq_count[cluster] <= getcore().sizes.issue_q_size*4);
     thread.issueq_count[cluster]++;
 #endif
 
@@ -1315,7 +1308,7 @@ int ThreadContext::dispatch() {
 
     ReorderBufferEntry* rob;
     foreach_list_mutable(rob_ready_to_dispatch_list, rob, entry, nextentry) {
-        if unlikely (core.dispatchcount >= DISPATCH_WIDTH) break;
+        if unlikely (core.dispatchcount >= core.sizes.dispatch_width) break;
 
         /* All operands start out as valid, then get put on wait queues if they are not actually ready. */
 
@@ -1481,7 +1474,7 @@ int ThreadContext::writeback(int cluster) {
     int wakeupcount = 0;
     ReorderBufferEntry* rob;
     foreach_list_mutable(rob_ready_to_writeback_list[cluster], rob, entry, nextentry) {
-        if unlikely (core.writecount >= WRITEBACK_WIDTH) break;
+        if unlikely (core.writecount >= core.sizes.writeback_width) break;
 
         /*
          * Gather statistics
@@ -1610,11 +1603,11 @@ int ThreadContext::commit() {
     foreach_forward(ROB, i) {
         ReorderBufferEntry& rob = ROB[i];
 
-        if unlikely (core.commitcount >= COMMIT_WIDTH) break;
+        if unlikely (core.commitcount >= core.sizes.commit_width) break;
         rc = rob.commit();
         if likely (rc == COMMIT_RESULT_OK) {
             core.commitcount++;
-            last_commit_at_cycle = sim_cycle;
+            last_commit_at_cycle = core_cycle();
 			thread_stats.rob_reads++;
         } else {
             break;
@@ -2002,7 +1995,7 @@ int ReorderBufferEntry::commit() {
         else thread.consecutive_commits_inside_spinlock = 0;
 
         if (thread.consecutive_commits_inside_spinlock >= 512) {
-            ptl_logfile << "WARNING: at cycle ", sim_cycle, ": vcpu ", thread.ctx.vcpuid, " potentially deadlocked inside spinlock (commit rip ", (void*)ctx.commitarf[REG_rip],
+            ptl_logfile << "WARNING: at cycle ", core_cycle(), ": vcpu ", thread.ctx.vcpuid, " potentially deadlocked inside spinlock (commit rip ", (void*)ctx.commitarf[REG_rip],
                         ", count ", thread.consecutive_commits_inside_spinlock, ", int mask ", sshinfo.vcpu_info[thread.ctx.vcpuid].evtchn_upcall_mask, endl, flush;
             ptl_logfile << "Thread 0 rip ", (void*)core.thread[0]->ctx.commitarf[REG_rip], endl;
             ptl_logfile << "Thread 1 rip ", (void*)core.thread[1]->ctx.commitarf[REG_rip], endl;
@@ -2178,7 +2171,7 @@ int ReorderBufferEntry::commit() {
             assert(request != NULL);
 
             request->init(core.get_coreid(), threadid, lsq->physaddr << 3, 0,
-                    sim_cycle, false, uop.rip.rip, uop.uuid,
+                    core_cycle(), false, uop.rip.rip, uop.uuid,
                     Memory::MEMORY_OP_WRITE);
             request->set_coreSignal(&core.dcache_signal);
 
@@ -2267,14 +2260,14 @@ int ReorderBufferEntry::commit() {
     }
 
     if likely (uop.eom) {
-        total_insns_committed++;
+        count_total_committed(total_insns_committed);
         thread.thread_stats.commit.insns++;
         thread.total_insns_committed++;
 
 #ifdef TRACE_RIP
             ptl_rip_trace << "commit_rip: ",
                           hexstring(uop.rip.rip, 64), " \t",
-                          "simcycle: ", sim_cycle, "\tkernel: ",
+                          "simcycle: ", core_cycle(), "\tkernel: ",
                           uop.rip.kernel, endl;
 #endif
         // if(uop.rip.rip > 0x7f0000000000)
@@ -2285,7 +2278,7 @@ int ReorderBufferEntry::commit() {
         ptl_logfile << "ROB Commit Done...\n", flush;
     }
 
-    total_uops_committed++;
+    count_total_committed(total_uops_committed);
     thread.thread_stats.commit.uops++;
     thread.total_uops_committed++;
 
@@ -2301,7 +2294,7 @@ int ReorderBufferEntry::commit() {
     }
 
     if unlikely (uop_is_eom & thread.stop_at_next_eom) {
-        ptl_logfile << "[vcpu ", ENV_GET_CPU(&(thread.ctx))->cpu_index, "] Stopping at cycle ", sim_cycle, " (", total_insns_committed, " commits)", endl;
+        ptl_logfile << "[vcpu ", ENV_GET_CPU(&(thread.ctx))->cpu_index, "] Stopping at cycle ", core_cycle(), " (", total_insns_committed, " commits)", endl;
         return COMMIT_RESULT_STOP;
     }
 
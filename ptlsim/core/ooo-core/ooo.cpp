@@ -23,6 +23,8 @@
 #include <ooo.h>
 
 #include <memoryHierarchy.h>
+#include <warm-state.h>
+#include <host-profile.h>
 
 #define MYDEBUG if(logable(99)) ptl_logfile
 
@@ -78,6 +80,102 @@ namespace OOO_CORE_MODEL {
 
 };
 
+#ifdef OOO_RUNTIME_SIZES
+
+OooCoreSizes::OooCoreSizes()
+    : rob_size(ROB_SIZE)
+    , issue_q_size(ISSUE_QUEUE_SIZE)
+    , load_q_size(LDQ_SIZE)
+    , store_q_size(STQ_SIZE)
+    , fetch_q_size(FETCH_QUEUE_SIZE)
+    , phys_reg_file_size(PHYS_REG_FILE_SIZE)
+    , branch_in_flight(MAX_BRANCHES_IN_FLIGHT)
+    , fetch_width(FETCH_WIDTH)
+    , frontend_width(FRONTEND_WIDTH)
+    , frontend_stages(FRONTEND_STAGES)
+    , dispatch_width(DISPATCH_WIDTH)
+    , writeback_width(WRITEBACK_WIDTH)
+    , commit_width(COMMIT_WIDTH)
+{
+}
+
+/*
+ * @brief Read one size from the core options, the compile-time value is both
+ * the default and the largest size the storage can hold
+ */
+static void get_size_option(BaseMachine& machine, const char* name,
+        const char* opt_name, int& value, int max_value)
+{
+    if(!machine.get_option(name, opt_name, value))
+        return;
+
+    if(value < 1 || value > max_value) {
+        stringbuf err;
+        err << "::ERROR::Core ", name, " option ", opt_name, " is ", value,
+            ", it must be between 1 and ", max_value,
+            " in this core model build", endl;
+        ptl_logfile << err;
+        cerr << err;
+        assert(0);
+        value = (value < 1) ? 1 : max_value;
+    }
+}
+
+/**
+ * @brief Setup sizes from core options of the machine configuration
+ *
+ * @param machine Machine that has options of this core
+ * @param name Name of the core in machine configuration
+ * @param threadcount Number of SMT threads in the core
+ */
+void OooCoreSizes::setup(BaseMachine& machine, const char* name,
+        int threadcount)
+{
+    get_size_option(machine, name, "rob_size", rob_size, ROB_SIZE);
+    get_size_option(machine, name, "issue_q_size", issue_q_size,
+            ISSUE_QUEUE_SIZE);
+    get_size_option(machine, name, "load_q_size", load_q_size, LDQ_SIZE);
+    get_size_option(machine, name, "store_q_size", store_q_size, STQ_SIZE);
+    get_size_option(machine, name, "fetch_q_size", fetch_q_size,
+            FETCH_QUEUE_SIZE);
+    get_size_option(machine, name, "phys_reg_file_size", phys_reg_file_size,
+            MAX_PHYS_REG_FILE_SIZE);
+    get_size_option(machine, name, "branch_in_flight", branch_in_flight,
+            MAX_PHYS_REG_FILE_SIZE / threadcount);
+    get_size_option(machine, name, "fetch_width", fetch_width, FETCH_WIDTH);
+    get_size_option(machine, name, "frontend_width", frontend_width,
+            FRONTEND_WIDTH);
+    get_size_option(machine, name, "frontend_stages", frontend_stages,
+            FRONTEND_STAGES);
+    get_size_option(machine, name, "dispatch_width", dispatch_width,
+            DISPATCH_WIDTH);
+    get_size_option(machine, name, "writeback_width", writeback_width,
+            WRITEBACK_WIDTH);
+    get_size_option(machine, name, "commit_width", commit_width,
+            COMMIT_WIDTH);
+
+    /* Store physical registers are allocated per store queue entry */
+    assert(store_q_size * threadcount <= MAX_PHYS_REG_FILE_SIZE);
+}
+
+#else
+
+const int OooCoreSizes::rob_size;
+const int OooCoreSizes::issue_q_size;
+const int OooCoreSizes::load_q_size;
+const int OooCoreSizes::store_q_size;
+const int OooCoreSizes::fetch_q_size;
+const int OooCoreSizes::phys_reg_file_size;
+const int OooCoreSizes::branch_in_flight;
+const int OooCoreSizes::fetch_width;
+const int OooCoreSizes::frontend_width;
+const int OooCoreSizes::frontend_stages;
+const int OooCoreSizes::dispatch_width;
+const int OooCoreSizes::writeback_width;
+const int OooCoreSizes::commit_width;
+
+#endif
+
 /*
  * @brief Initialize lookup tables used by the simulation
  */
@@ -133,6 +231,10 @@ ThreadContext::ThreadContext(OooCore& core_, W8 threadid_, Context& ctx_)
     /* thread_stats.commit.ipc.enable_periodic_dump(); */
 
     thread_stats.set_default_stats(user_stats);
+
+    /* Predictor tables live as long as the thread, so training done
+     * before simulation starts is kept by reset() */
+    branchpred.init(core_.get_coreid(), threadid_);
     reset();
 }
 
@@ -178,7 +280,7 @@ void ThreadContext::reset() {
     issueq_count = 0;
 #endif
     queued_mem_lock_release_count = 0;
-    branchpred.init(coreid, threadid);
+    branchpred.flush();
 
     in_tlb_walk = 0;
 }
@@ -237,6 +339,8 @@ OooCore::OooCore(BaseMachine& machine_, W8 num_threads,
         threadcount = 1;
     }
 
+    sizes.setup(machine_, name, threadcount);
+
     setzero(threads);
 
     assert(num_threads > 0 && "Core has atleast 1 thread");
@@ -256,20 +360,20 @@ OooCore::OooCore(BaseMachine& machine_, W8 num_threads,
     sig_name << core_name << "-dcache-wakeup";
 
     dcache_signal.set_name(sig_name.buf);
-    dcache_signal.connect(signal_mem_ptr(*this,
+    dcache_signal.connect(SIGNAL_MEM_FN(*this,
                 &OooCore::dcache_wakeup));
 
     sig_name.reset();
 
     sig_name << core_name << "-icache-wakeup";
     icache_signal.set_name(sig_name.buf);
-    icache_signal.connect(signal_mem_ptr(*this,
+    icache_signal.connect(SIGNAL_MEM_FN(*this,
                 &OooCore::icache_wakeup));
 
 	sig_name.reset();
 	sig_name << core_name << "-run-cycle";
 	run_cycle.set_name(sig_name.buf);
-	run_cycle.connect(signal_mem_ptr(*this, &OooCore::runcycle));
+	run_cycle.connect(SIGNAL_MEM_FN(*this, &OooCore::runcycle));
 	marss_register_per_cycle_event(&run_cycle);
 
     threads = (ThreadContext**)malloc(sizeof(ThreadContext*) * threadcount);
@@ -297,25 +401,26 @@ void OooCore::reset() {
     setzero(robs_on_fu);
 
     foreach_issueq(reset(get_coreid(), this));
+    foreach_issueq(set_capacity(sizes.issue_q_size));
 
 #ifndef MULTI_IQ
     int reserved_iq_entries_per_thread = (int)sqrt(
-            ISSUE_QUEUE_SIZE / threadcount);
+            sizes.issue_q_size / threadcount);
     reserved_iq_entries = reserved_iq_entries_per_thread * \
                           threadcount;
     assert(reserved_iq_entries && reserved_iq_entries < \
-            ISSUE_QUEUE_SIZE);
+            sizes.issue_q_size);
 
     foreach_issueq(set_reserved_entries(reserved_iq_entries));
 #else
     int reserved_iq_entries_per_thread = (int)sqrt(
-            ISSUE_QUEUE_SIZE / threadcount);
+            sizes.issue_q_size / threadcount);
 
     for_each_cluster(cluster){
         reserved_iq_entries[cluster] = reserved_iq_entries_per_thread * \
                                        threadcount;
         assert(reserved_iq_entries[cluster] && reserved_iq_entries[cluster] < \
-                ISSUE_QUEUE_SIZE);
+                sizes.issue_q_size);
     }
 
     foreach_issueq(set_reserved_entries(
@@ -515,6 +620,49 @@ int ThreadContext::get_priority() const {
     return priority;
 }
 
+/**
+ * @brief Check if the thread can only make progress after a memory event
+ *
+ * The thread must have nothing that advances by itself from one cycle to
+ * the next: no uops in the frontend pipeline, ready to issue, executing or
+ * completing, no page walk or pause in progress, and fetch has to wait for
+ * the icache or for free fetch queue entries. Uops waiting for operands or
+ * for a cache miss are fine, they are woken up by the memory hierarchy.
+ *
+ * @return true if the next cycle of this thread only updates statistics
+ */
+bool ThreadContext::is_quiescent() {
+    if (handle_interrupt_at_next_eom || pause_counter > 0 ||
+            smc_invalidate_pending) {
+        return false;
+    }
+
+    if (!ctx.running)
+        return true;
+
+    if (!rob_frontend_list.empty() || !rob_ready_to_dispatch_list.empty() ||
+            !rob_tlb_miss_list.empty() || !rob_memory_fence_list.empty() ||
+            !rob_ready_to_commit_queue.empty()) {
+        return false;
+    }
+
+    for_each_cluster (cluster) {
+        if (!rob_ready_to_issue_list[cluster].empty() ||
+                !rob_ready_to_store_list[cluster].empty() ||
+                !rob_ready_to_load_list[cluster].empty() ||
+                !rob_issued_list[cluster].empty() ||
+                !rob_completed_list[cluster].empty() ||
+                !rob_ready_to_writeback_list[cluster].empty()) {
+            return false;
+        }
+    }
+
+    if (itlb_walk_level > 0 && !waiting_for_icache_fill)
+        return false;
+
+    return stall_frontend || waiting_for_icache_fill || !fetchq_remaining();
+}
+
 /**
  * @brief Execute one cycle of the entire core state machine
  *
@@ -572,12 +720,12 @@ bool OooCore::runcycle(void* none) {
         }
     }
 
-    MYDEBUG << " ISSUE_QUEUE_SIZE ", ISSUE_QUEUE_SIZE, " issueq_all.count ", issueq_all.count, " issueq_all.shared_free_entries ",
+    MYDEBUG << " ISSUE_QUEUE_SIZE ", sizes.issue_q_size, " issueq_all.count ", issueq_all.count, " issueq_all.shared_free_entries ",
             issueq_all.shared_free_entries, " total_issueq_reserved_free ", total_issueq_reserved_free,
             " reserved_iq_entries ", reserved_iq_entries, " total_issueq_count ", total_issueq_count, endl;
 
     assert (total_issueq_count == issueq_all.count);
-    assert((ISSUE_QUEUE_SIZE - issueq_all.count) == (issueq_all.shared_free_entries + total_issueq_reserved_free));
+    assert((sizes.issue_q_size - issueq_all.count) == (issueq_all.shared_free_entries + total_issueq_reserved_free));
 #else
     foreach(cluster, 4){
         int total_issueq_count = 0;
@@ -600,11 +748,11 @@ bool OooCore::runcycle(void* none) {
         issueq_operation_on_cluster_with_result((*this), cluster, issueq_count, count);
         int issueq_shared_free_entries = 0;
         issueq_operation_on_cluster_with_result((*this), cluster, issueq_shared_free_entries, shared_free_entries);
-        MYDEBUG << " cluster[", cluster, "] ISSUE_QUEUE_SIZE ", ISSUE_QUEUE_SIZE, " issueq[" , cluster, "].count ", issueq_count, " issueq[" , cluster, "].shared_free_entries ",
+        MYDEBUG << " cluster[", cluster, "] ISSUE_QUEUE_SIZE ", sizes.issue_q_size, " issueq[" , cluster, "].count ", issueq_count, " issueq[" , cluster, "].shared_free_entries ",
                 issueq_shared_free_entries, " total_issueq_reserved_free ", total_issueq_reserved_free,
                 " reserved_iq_entries ", reserved_iq_entries[cluster], " total_issueq_count ", total_issueq_count, endl;
         assert (total_issueq_count == issueq_count);
-        assert((ISSUE_QUEUE_SIZE - issueq_count) == (issueq_shared_free_entries + total_issueq_reserved_free));
+        assert((sizes.issue_q_size - issueq_count) == (issueq_shared_free_entries + total_issueq_reserved_free));
 
     }
 
@@ -626,29 +774,33 @@ bool OooCore::runcycle(void* none) {
         ptl_logfile << "OooCore::run():thread-commit\n";
     }
 
-    foreach (permute, threadcount) {
-        int tid = add_index_modulo(round_robin_tid, +permute, threadcount);
-        ThreadContext* thread = threads[tid];
-        if unlikely (!thread->ctx.running) continue;
+    {
+        host_profile_scope(HPROF_CORE_COMMIT);
+
+        foreach (permute, threadcount) {
+            int tid = add_index_modulo(round_robin_tid, +permute, threadcount);
+            ThreadContext* thread = threads[tid];
+            if unlikely (!thread->ctx.running) continue;
 
-        if (thread->pause_counter > 0) {
-            thread->pause_counter--;
-            if(thread->handle_interrupt_at_next_eom) {
-                commitrc[tid] = COMMIT_RESULT_INTERRUPT;
-                if(thread->ctx.is_int_pending()) {
-                    thread->thread_stats.cycles_in_pause -=
-                        thread->pause_counter;
-                    thread->pause_counter = 0;
+            if (thread->pause_counter > 0) {
+                thread->pause_counter--;
+                if(thread->handle_interrupt_at_next_eom) {
+                    commitrc[tid] = COMMIT_RESULT_INTERRUPT;
+                    if(thread->ctx.is_int_pending()) {
+                        thread->thread_stats.cycles_in_pause -=
+                            thread->pause_counter;
+                        thread->pause_counter = 0;
+                    }
+                } else {
+                    commitrc[tid] = COMMIT_RESULT_OK;
                 }
-            } else {
-                commitrc[tid] = COMMIT_RESULT_OK;
+                continue;
             }
-            continue;
-        }
 
-        commitrc[tid] = thread->commit();
-        for_each_cluster(j) thread->writeback(j);
-        for_each_cluster(j) thread->transfer(j);
+            commitrc[tid] = thread->commit();
+            for_each_cluster(j) thread->writeback(j);
+            for_each_cluster(j) thread->transfer(j);
+        }
     }
 
     if (logable(100)) {
@@ -679,7 +831,10 @@ bool OooCore::runcycle(void* none) {
         ptl_logfile << "OooCore::run():issue\n";
     }
 
-    for_each_cluster(i) { issue(i); }
+    {
+        host_profile_scope(HPROF_CORE_ISSUE);
+        for_each_cluster(i) { issue(i); }
+    }
 
     /*
      * Most of the frontend (except fetch!) also works with round robin priority
@@ -691,18 +846,22 @@ bool OooCore::runcycle(void* none) {
 
     int dispatchrc[threadcount];
     dispatchcount = 0;
-    foreach (permute, threadcount) {
-        int tid = add_index_modulo(round_robin_tid, +permute, threadcount);
-        ThreadContext* thread = threads[tid];
-        if unlikely (!thread->ctx.running) continue;
+    {
+        host_profile_scope(HPROF_CORE_DISPATCH);
+
+        foreach (permute, threadcount) {
+            int tid = add_index_modulo(round_robin_tid, +permute, threadcount);
+            ThreadContext* thread = threads[tid];
+            if unlikely (!thread->ctx.running) continue;
 
-        for_each_cluster(j) { thread->complete(j); }
+            for_each_cluster(j) { thread->complete(j); }
 
-        dispatchrc[tid] = thread->dispatch();
+            dispatchrc[tid] = thread->dispatch();
 
-        if likely (dispatchrc[tid] >= 0) {
-            thread->frontend();
-            thread->rename();
+            if likely (dispatchrc[tid] >= 0) {
+                thread->frontend();
+                thread->rename();
+            }
         }
     }
 
@@ -744,17 +903,21 @@ bool OooCore::runcycle(void* none) {
      */
 
     bool fetch_exception[threadcount];
-    foreach (j, threadcount) {
-        int i = priority_index[j];
-        ThreadContext* thread = threads[i];
-        assert(thread);
-        fetch_exception[i] = true;
-        if unlikely (!thread->ctx.running) {
-            continue;
-        }
+    {
+        host_profile_scope(HPROF_CORE_FETCH);
+
+        foreach (j, threadcount) {
+            int i = priority_index[j];
+            ThreadContext* thread = threads[i];
+            assert(thread);
+            fetch_exception[i] = true;
+            if unlikely (!thread->ctx.running) {
+                continue;
+            }
 
-        if likely (dispatchrc[i] >= 0) {
-            fetch_exception[i] = thread->fetch();
+            if likely (dispatchrc[i] >= 0) {
+                fetch_exception[i] = thread->fetch();
+            }
         }
     }
 
@@ -799,7 +962,7 @@ bool OooCore::runcycle(void* none) {
         switch (rc) {
             case COMMIT_RESULT_SMC:
                 {
-                    if (logable(3)) ptl_logfile << "Potentially cross-modifying SMC detected: global flush required (cycle ", sim_cycle, ", ", total_insns_committed, " commits)", endl, flush;
+                    if (logable(3)) ptl_logfile << "Potentially cross-modifying SMC detected: global flush required (cycle ", core_cycle(), ", ", total_insns_committed, " commits)", endl, flush;
 
                     /*
                      *  DO NOT GLOBALLY FLUSH! It will cut off the other thread(s) in the
@@ -906,8 +1069,8 @@ bool OooCore::runcycle(void* none) {
         if (logable(9)) {
             stringbuf sb;
             sb << "[vcpu ", ENV_GET_CPU(&(thread->ctx))->cpu_index, "] thread ", thread->threadid, ": WARNING: At cycle ",
-               sim_cycle, ", ", total_insns_committed,  " user commits: ",
-               (sim_cycle - thread->last_commit_at_cycle), " cycles;", endl;
+               core_cycle(), ", ", total_insns_committed,  " user commits: ",
+               (core_cycle() - thread->last_commit_at_cycle), " cycles;", endl;
             ptl_logfile << sb, flush;
         }
     }
@@ -916,11 +1079,11 @@ bool OooCore::runcycle(void* none) {
         ThreadContext* thread = threads[i];
         if unlikely (!thread->ctx.running) break;
 
-        if unlikely ((sim_cycle - thread->last_commit_at_cycle) > (W64)1024*1024*threadcount) {
+        if unlikely ((core_cycle() - thread->last_commit_at_cycle) > (W64)1024*1024*threadcount) {
             stringbuf sb;
             sb << "[vcpu ", ENV_GET_CPU((&thread->ctx))->cpu_index, "] thread ", thread->threadid, ": WARNING: At cycle ",
-               sim_cycle, ", ", total_insns_committed,  " user commits: no instructions have committed for ",
-               (sim_cycle - thread->last_commit_at_cycle), " cycles; the pipeline could be deadlocked", endl;
+               core_cycle(), ", ", total_insns_committed,  " user commits: no instructions have committed for ",
+               (core_cycle() - thread->last_commit_at_cycle), " cycles; the pipeline could be deadlocked", endl;
             ptl_logfile << sb, flush;
             cerr << sb, flush;
             machine.dump_state(ptl_logfile);
@@ -936,6 +1099,134 @@ bool OooCore::runcycle(void* none) {
     return exiting;
 }
 
+/**
+ * @brief Check if the core is waiting for the memory hierarchy
+ *
+ * @return -1 if all threads wait for memory events, 0 otherwise
+ */
+W64 OooCore::quiescent_until() {
+    if (commitcount || writecount || dispatchcount)
+        return 0;
+
+    foreach (i, threadcount) {
+        if (!threads[i]->is_quiescent())
+            return 0;
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Advance the per-cycle state of skipped idle cycles
+ *
+ * @param cycles Number of cycles skipped
+ */
+void OooCore::skip_cycles(W64 cycles) {
+    round_robin_tid = (round_robin_tid + cycles) % threadcount;
+}
+
+/**
+ * @brief Check if all threads of the core are halted
+ *
+ * @return true if no thread is running or has an interrupt pending
+ */
+bool OooCore::is_halted() {
+    foreach (i, threadcount) {
+        Context& ctx = threads[i]->ctx;
+        if (ctx.running || ctx.check_events())
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Update statistics for cycles in which the halted core was not
+ * clocked
+ *
+ * With no thread running a cycle only counts itself and an empty issue in
+ * each cluster.
+ *
+ * @param cycles Number of cycles the core was halted
+ */
+void OooCore::account_halted_cycles(W64 cycles) {
+    for_each_cluster(cluster) {
+        per_cluster_stats_update(issue.width, cluster, [0] += cycles);
+    }
+
+    core_stats.cycles += cycles;
+    skip_cycles(cycles);
+}
+
+W64 OooCore::insns_committed() {
+    W64 commits = 0;
+
+    foreach (i, threadcount) {
+        commits += threads[i]->total_insns_committed;
+    }
+
+    return commits;
+}
+
+/**
+ * @brief Check if one of the threads of this core runs 'ctx'
+ */
+bool OooCore::has_context(Context& ctx) {
+    foreach (i, threadcount) {
+        if (&threads[i]->ctx == &ctx)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Train the branch predictor of the thread running 'ctx' with a
+ * branch executed while QEMU fast-forwards
+ */
+void OooCore::warm_branch(Context& ctx, int type, W64 branchaddr,
+        W64 target, W64 actual) {
+    foreach (i, threadcount) {
+        if (&threads[i]->ctx == &ctx) {
+            threads[i]->branchpred.warm(type, branchaddr, target, actual);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Save branch predictor and TLBs of each thread
+ */
+void OooCore::save_warm_state(WarmStateFile& ws) {
+    stringbuf name;
+
+    foreach (i, threadcount) {
+        ThreadContext* thread = threads[i];
+
+        name.reset(); name << get_name(), "_t", i, "_bp";
+        thread->branchpred.save_state(ws, name);
+        name.reset(); name << get_name(), "_t", i, "_dtlb";
+        ws.save(name, &thread->dtlb, sizeof(thread->dtlb));
+        name.reset(); name << get_name(), "_t", i, "_itlb";
+        ws.save(name, &thread->itlb, sizeof(thread->itlb));
+    }
+}
+
+void OooCore::load_warm_state(WarmStateFile& ws) {
+    stringbuf name;
+
+    foreach (i, threadcount) {
+        ThreadContext* thread = threads[i];
+
+        name.reset(); name << get_name(), "_t", i, "_bp";
+        thread->branchpred.load_state(ws, name);
+        name.reset(); name << get_name(), "_t", i, "_dtlb";
+        ws.restore(name, &thread->dtlb, sizeof(thread->dtlb));
+        name.reset(); name << get_name(), "_t", i, "_itlb";
+        ws.restore(name, &thread->itlb, sizeof(thread->itlb));
+    }
+}
+
 /*
  * ReorderBufferEntry
  */
@@ -1347,7 +1638,7 @@ bool ThreadContext::handle_barrier() {
     if (logable(1)) {
         ptl_logfile << "[vcpu ", ENV_GET_CPU(&ctx)->cpu_index, "] Barrier (#", assistid, " -> ", (void*)assist, " ", assist_name(assist), " called from ",
                     (RIPVirtPhys(ctx.reg_selfrip).update(ctx)), "; return to ", (void*)(Waddr)ctx.reg_nextrip,
-                    ") at ", sim_cycle, " cycles, ", total_insns_committed, " commits", endl, flush;
+                    ") at ", core_cycle(), " cycles, ", total_insns_committed, " commits", endl, flush;
     }
 
     if (logable(6)) ptl_logfile << "Calling assist function at ", (void*)assist, "...", endl, flush;
@@ -1358,7 +1649,12 @@ bool ThreadContext::handle_barrier() {
         ptl_logfile << "Before assist:", endl, ctx, endl;
     }
 
-    bool flush_required = assist(ctx);
+    bool flush_required;
+    {
+        /* Assists call into QEMU helpers, serialize them */
+        ParallelSection section(parallel_qemu_lock);
+        flush_required = assist(ctx);
+    }
 
     if (logable(6)) {
         ptl_logfile << "Done with assist", endl;
@@ -1394,7 +1690,7 @@ bool ThreadContext::handle_exception() {
 
     if (logable(4)) {
         ptl_logfile << "[vcpu ", ENV_GET_CPU(&ctx)->cpu_index, "] Exception ", exception_name(ctx.exception), " called from rip ", (void*)(Waddr)ctx.eip,
-                    " at ", sim_cycle, " cycles, ", total_insns_committed, " commits", endl, flush;
+                    " at ", core_cycle(), " cycles, ", total_insns_committed, " commits", endl, flush;
     }
 
     /*
@@ -1517,7 +1813,7 @@ bool ThreadContext::handle_interrupt() {
     if (logable(3)) ptl_logfile << " handle_interrupt, flush_pipeline.",endl;
 
     if (logable(6)) {
-        ptl_logfile << "[vcpu ", threadid, "] interrupts pending at ", sim_cycle, " cycles, ", total_insns_committed, " commits", endl, flush;
+        ptl_logfile << "[vcpu ", threadid, "] interrupts pending at ", core_cycle(), " cycles, ", total_insns_committed, " commits", endl, flush;
         ptl_logfile << "Context at interrupt:", endl;
         ptl_logfile << ctx;
         ptl_logfile.flush();
@@ -1569,10 +1865,18 @@ ostream& OOO_CORE_MODEL::operator <<(ostream& os, const PhysicalRegisterOperandI
     return os;
 }
 
+/**
+ * @brief Flush the TLBs of the thread running 'ctx'
+ *
+ * Each thread has its own TLBs, so the other threads keep their entries.
+ */
 void OooCore::flush_tlb(Context& ctx) {
     foreach(i, threadcount) {
-        threads[i]->dtlb.flush_all();
-        threads[i]->itlb.flush_all();
+        if (&threads[i]->ctx == &ctx) {
+            threads[i]->dtlb.flush_all();
+            threads[i]->itlb.flush_all();
+            break;
+        }
     }
 }
 
@@ -1620,19 +1924,19 @@ void OooCore::dump_configuration(YAML::Emitter &out) const
 
 	YAML_KEY_VAL(out, "type", "core");
 	YAML_KEY_VAL(out, "threads", threadcount);
-	YAML_KEY_VAL(out, "iq_size", ISSUE_QUEUE_SIZE);
+	YAML_KEY_VAL(out, "iq_size", sizes.issue_q_size);
 	YAML_KEY_VAL(out, "phys_reg_files", PHYS_REG_FILE_COUNT);
 #ifdef UNIFIED_INT_FP_PHYS_REG_FILE
-	YAML_KEY_VAL(out, "phys_reg_file_int_fp_size", PHYS_REG_FILE_SIZE);
+	YAML_KEY_VAL(out, "phys_reg_file_int_fp_size", sizes.phys_reg_file_size);
 #else
-	YAML_KEY_VAL(out, "phys_reg_file_int_size", PHYS_REG_FILE_SIZE);
-	YAML_KEY_VAL(out, "phys_reg_file_fp_size", PHYS_REG_FILE_SIZE);
+	YAML_KEY_VAL(out, "phys_reg_file_int_size", sizes.phys_reg_file_size);
+	YAML_KEY_VAL(out, "phys_reg_file_fp_size", sizes.phys_reg_file_size);
 #endif
-	YAML_KEY_VAL(out, "phys_reg_file_st_size", STQ_SIZE * threadcount);
-	YAML_KEY_VAL(out, "phys_reg_file_br_size", MAX_BRANCHES_IN_FLIGHT *
+	YAML_KEY_VAL(out, "phys_reg_file_st_size", sizes.store_q_size * threadcount);
+	YAML_KEY_VAL(out, "phys_reg_file_br_size", sizes.branch_in_flight *
 			threadcount);
-	YAML_KEY_VAL(out, "fetch_q_size", FETCH_QUEUE_SIZE);
-	YAML_KEY_VAL(out, "frontend_stages", FRONTEND_STAGES);
+	YAML_KEY_VAL(out, "fetch_q_size", sizes.fetch_q_size);
+	YAML_KEY_VAL(out, "frontend_stages", sizes.frontend_stages);
 	YAML_KEY_VAL(out, "itlb_size", ITLB_SIZE);
 	YAML_KEY_VAL(out, "dtlb_size", DTLB_SIZE);
 
@@ -1642,17 +1946,17 @@ void OooCore::dump_configuration(YAML::Emitter &out) const
 	YAML_KEY_VAL(out, "fp_FUs", FPU_FU_COUNT);
 	YAML_KEY_VAL(out, "ld_FUs", LOAD_FU_COUNT);
 	YAML_KEY_VAL(out, "st_FUs", STORE_FU_COUNT);
-	YAML_KEY_VAL(out, "frontend_width", FRONTEND_WIDTH);
-	YAML_KEY_VAL(out, "dispatch_width", DISPATCH_WIDTH);
+	YAML_KEY_VAL(out, "frontend_width", sizes.frontend_width);
+	YAML_KEY_VAL(out, "dispatch_width", sizes.dispatch_width);
 	YAML_KEY_VAL(out, "issue_width", MAX_ISSUE_WIDTH);
-	YAML_KEY_VAL(out, "writeback_width", WRITEBACK_WIDTH);
-	YAML_KEY_VAL(out, "commit_width", COMMIT_WIDTH);
-	YAML_KEY_VAL(out, "max_branch_in_flight", MAX_BRANCHES_IN_FLIGHT);
+	YAML_KEY_VAL(out, "writeback_width", sizes.writeback_width);
+	YAML_KEY_VAL(out, "commit_width", sizes.commit_width);
+	YAML_KEY_VAL(out, "max_branch_in_flight", sizes.branch_in_flight);
 
 	out << YAML::Key << "per_thread" << YAML::Value << YAML::BeginMap;
 
-	YAML_KEY_VAL(out, "rob_size", ROB_SIZE);
-	YAML_KEY_VAL(out, "lsq_size", LSQ_SIZE);
+	YAML_KEY_VAL(out, "rob_size", sizes.rob_size);
+	YAML_KEY_VAL(out, "lsq_size", sizes.load_q_size + sizes.store_q_size);
 
 	out << YAML::EndMap;
 
@@ -1674,19 +1978,3 @@ BaseCore* OooCoreBuilder::get_new_core(BaseMachine& machine,
 namespace OOO_CORE_MODEL {
     OooCoreBuilder defaultCoreBuilder(OOO_CORE_NAME);
 };
-
-namespace OOO_CORE_MODEL {
-    CycleTimer cttotal;
-    CycleTimer ctfetch;
-    CycleTimer ctdecode;
-    CycleTimer ctrename;
-    CycleTimer ctfrontend;
-    CycleTimer ctdispatch;
-    CycleTimer ctissue;
-    CycleTimer ctissueload;
-    CycleTimer ctissuestore;
-    CycleTimer ctcomplete;
-    CycleTimer cttransfer;
-    CycleTimer ctwriteback;
-    CycleTimer ctcommit;
-};
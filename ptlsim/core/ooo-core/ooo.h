@@ -40,17 +40,6 @@
  *
  */
 
-/* #define ENABLE_SIM_TIMING */
-#ifdef ENABLE_SIM_TIMING
-#define time_this_scope(ct) CycleTimerScope ctscope(ct)
-#define start_timer(ct) ct.start()
-#define stop_timer(ct) ct.stop()
-#else
-#define time_this_scope(ct) (0)
-#define start_timer(ct) (0)
-#define stop_timer(ct) (0)
-#endif
-
 #define CORE_STATS(var) \
     getcore().core_stats.var(getthread().thread_stats.get_default_stats())
 
@@ -373,12 +362,29 @@ namespace OOO_CORE_MODEL {
             int issueq_id;
             static int issueq_id_seq;
 
+#ifdef OOO_RUNTIME_SIZES
+            /* Entries in use out of the 'size' entries of storage */
+            int capacity;
+
+            IssueQueue(){
+                issueq_id = issueq_id_seq++;
+                capacity = size;
+            }
+            void set_capacity(int num) {
+                assert(num > 0 && num <= size);
+                capacity = num;
+            }
+#else
+            static const int capacity = size;
+
             IssueQueue(){
                 issueq_id = issueq_id_seq++;
             }
+            void set_capacity(int num) { }
+#endif
             void set_reserved_entries(int num) { reserved_entries = num; }
             bool reset_shared_entries() {
-                shared_free_entries = size - reserved_entries;
+                shared_free_entries = capacity - reserved_entries;
                 return true;
             }
             bool alloc_shared_entry() {
@@ -387,8 +393,8 @@ namespace OOO_CORE_MODEL {
                 return true;
             }
             bool free_shared_entry() {
-                if(logable(99)) ptl_logfile << "shared_free_entries: ", shared_free_entries, " size: ",  size, " reserved_entries: ",  reserved_entries, endl;
-                assert(shared_free_entries < size - reserved_entries);
+                if(logable(99)) ptl_logfile << "shared_free_entries: ", shared_free_entries, " size: ",  capacity, " reserved_entries: ",  reserved_entries, endl;
+                assert(shared_free_entries < capacity - reserved_entries);
                 shared_free_entries++;
                 return true;
             }
@@ -396,7 +402,7 @@ namespace OOO_CORE_MODEL {
                 return (shared_free_entries == 0);
             }
 
-            bool remaining() const { return (size - count); }
+            bool remaining() const { return (capacity - count); }
             bool empty() const { return (!count); }
             bool full() const { return (!remaining()); }
 
@@ -456,6 +462,11 @@ namespace OOO_CORE_MODEL {
             OooCore& getcore() { return *core; }
         };
 
+#ifndef OOO_RUNTIME_SIZES
+    template <int size, int operandcount>
+        const int IssueQueue<size, operandcount>::capacity;
+#endif
+
     template <int size, int operandcount>
         static inline ostream& operator <<(ostream& os, const IssueQueue<size, operandcount>& issueq) {
             return issueq.print(os);
@@ -948,6 +959,51 @@ namespace OOO_CORE_MODEL {
     typedef TranslationLookasideBuffer<0, DTLB_SIZE> DTLB;
     typedef TranslationLookasideBuffer<1, ITLB_SIZE> ITLB;
 
+    /**
+     * @brief Sizes and widths of the OOO pipeline structures
+     *
+     * A core model built with RUNTIME_SIZES keeps the compile-time sizes as
+     * the capacity of its fixed storage and takes the sizes it uses from the
+     * machine options of each core, so one build covers many core variants.
+     * Otherwise every size is the compile-time constant as before.
+     */
+    struct OooCoreSizes {
+#ifdef OOO_RUNTIME_SIZES
+        int rob_size;
+        int issue_q_size;
+        int load_q_size;
+        int store_q_size;
+        int fetch_q_size;
+        int phys_reg_file_size;
+        int branch_in_flight;
+        int fetch_width;
+        int frontend_width;
+        int frontend_stages;
+        int dispatch_width;
+        int writeback_width;
+        int commit_width;
+
+        OooCoreSizes();
+        void setup(BaseMachine& machine, const char* name, int threadcount);
+#else
+        static const int rob_size = ROB_SIZE;
+        static const int issue_q_size = ISSUE_QUEUE_SIZE;
+        static const int load_q_size = LDQ_SIZE;
+        static const int store_q_size = STQ_SIZE;
+        static const int fetch_q_size = FETCH_QUEUE_SIZE;
+        static const int phys_reg_file_size = PHYS_REG_FILE_SIZE;
+        static const int branch_in_flight = MAX_BRANCHES_IN_FLIGHT;
+        static const int fetch_width = FETCH_WIDTH;
+        static const int frontend_width = FRONTEND_WIDTH;
+        static const int frontend_stages = FRONTEND_STAGES;
+        static const int dispatch_width = DISPATCH_WIDTH;
+        static const int writeback_width = WRITEBACK_WIDTH;
+        static const int commit_width = COMMIT_WIDTH;
+
+        void setup(BaseMachine& machine, const char* name, int threadcount) { }
+#endif
+    };
+
     /**
      * @brief represent a OOO  thread in SMT core.
      */
@@ -1056,6 +1112,13 @@ namespace OOO_CORE_MODEL {
 
         ThreadContext(OooCore& core_, W8 threadid_, Context& ctx_);
 
+        /*
+         * Free ROB and fetch queue entries within the configured sizes, the
+         * queues themselves are sized for the largest configuration.
+         */
+        int rob_remaining() const;
+        int fetchq_remaining() const;
+
         int commit();
         int writeback(int cluster);
         int transfer(int cluster);
@@ -1079,6 +1142,7 @@ namespace OOO_CORE_MODEL {
         void redispatch_deadlock_recovery();
         void flush_mem_lock_release_list(int start = 0);
         int get_priority() const;
+        bool is_quiescent();
 
         void dump_smt_state(ostream& os);
         void print_smt_state(ostream& os);
@@ -1113,6 +1177,8 @@ namespace OOO_CORE_MODEL {
         int threadcount;
         ThreadContext** threads;
 
+        OooCoreSizes sizes;
+
         ListOfStateLists rob_states;
         ListOfStateLists lsq_states;
 
@@ -1219,10 +1285,10 @@ namespace OOO_CORE_MODEL {
 			/*
 			 * Physical register files
 			 */
-            physregfiles[0]("int", get_coreid(), 0, PHYS_REG_FILE_SIZE, this);
-            physregfiles[1]("fp", get_coreid(), 1, PHYS_REG_FILE_SIZE, this);
-            physregfiles[2]("st", get_coreid(), 2, STQ_SIZE * threadcount, this);
-            physregfiles[3]("br", get_coreid(), 3, MAX_BRANCHES_IN_FLIGHT * threadcount, this);
+            physregfiles[0]("int", get_coreid(), 0, sizes.phys_reg_file_size, this);
+            physregfiles[1]("fp", get_coreid(), 1, sizes.phys_reg_file_size, this);
+            physregfiles[2]("st", get_coreid(), 2, sizes.store_q_size * threadcount, this);
+            physregfiles[3]("br", get_coreid(), 3, sizes.branch_in_flight * threadcount, this);
         }
 
 		/*
@@ -1256,6 +1322,16 @@ namespace OOO_CORE_MODEL {
 
 		/* Pipeline Stages */
         bool runcycle(void*);
+        W64 quiescent_until();
+        void skip_cycles(W64 cycles);
+        bool is_halted();
+        void account_halted_cycles(W64 cycles);
+        W64 insns_committed();
+        bool has_context(Context& ctx);
+        void warm_branch(Context& ctx, int type, W64 branchaddr, W64 target,
+                W64 actual);
+        void save_warm_state(WarmStateFile& ws);
+        void load_warm_state(WarmStateFile& ws);
         void flush_pipeline();
         bool fetch();
         void rename();
@@ -1294,6 +1370,15 @@ namespace OOO_CORE_MODEL {
 		void dump_configuration(YAML::Emitter &out) const;
     };
 
+    inline int ThreadContext::rob_remaining() const {
+        return max(ROB.remaining() - (ROB_SIZE - core.sizes.rob_size), 0);
+    }
+
+    inline int ThreadContext::fetchq_remaining() const {
+        return max(fetchq.remaining() -
+                (FETCH_QUEUE_SIZE - core.sizes.fetch_q_size), 0);
+    }
+
     /**
      * @brief Checker - saved stores to compare after executing emulated
      * instruction
@@ -1312,20 +1397,6 @@ namespace OOO_CORE_MODEL {
 
     void add_checker_store(LoadStoreQueueEntry* lsq, W8 sizeshift);
 
-    extern CycleTimer cttotal;
-    extern CycleTimer ctfetch;
-    extern CycleTimer ctdecode;
-    extern CycleTimer ctrename;
-    extern CycleTimer ctfrontend;
-    extern CycleTimer ctdispatch;
-    extern CycleTimer ctissue;
-    extern CycleTimer ctissueload;
-    extern CycleTimer ctissuestore;
-    extern CycleTimer ctcomplete;
-    extern CycleTimer cttransfer;
-    extern CycleTimer ctwriteback;
-    extern CycleTimer ctcommit;
-
 #ifdef DECLARE_STRUCTURES
 	/*
 	 * The following configuration has two integer/store clusters with a single cycle
@@ -1408,32 +1408,4 @@ const W64 expand_8bit_to_64bit_lut[256] alignto(8) = {
   0xffffffffffff0000ULL,   0xffffffffffff00ffULL,   0xffffffffffffff00ULL,   0xffffffffffffffffULL,
 };
 
-// Signal
-
-Signal::Signal()
-{
-	// name_ = NULL;
-	func = NULL;
-}
-
-Signal::Signal(const char* name)
-{
-	name_ << name;
-	func = NULL;
-}
-
-void Signal::connect(TFunctor* _func) {
-	func = _func;
-}
-
-bool Signal::emit(void *arg) {
-    assert(name_.size() != 0);
-	bool ret_val = (*func)(arg);
-	return ret_val;
-}
-
-TFunctor* superstl::signal_fun_ptr(bool (*_fpt)(void *arg)) {
-	TFunctor2 *t = new TFunctor2(_fpt);
-	return (TFunctor*)t;
-}
 
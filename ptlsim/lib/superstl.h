@@ -3929,67 +3929,154 @@ namespace superstl {
     ~ScopedLock() { lock.release(); }
   };
 
-  class TFunctor {
-	  public:
-		  virtual bool operator()(void* arg) = 0;
-  };
+  //
+  // Callback to a member function of an object or to a plain function.
+  //
+  // The object, the function pointer and a thunk that knows their types
+  // are stored inline, so creating a delegate never allocates and calling
+  // it is a single indirect call to the thunk. Delegates made with
+  // SIGNAL_MEM_FN have the member function compiled into the thunk, which
+  // saves the member function pointer call.
+  //
+  class Delegate {
+	  private:
+		  typedef bool (*Thunk)(const Delegate& d, void *arg);
 
-  template<class T>
-	  class TFunctor1 : public TFunctor {
-		  private:
-			  bool (T::*fpt)(void *arg);
-			  T& obj;
-
-		  public:
-			  TFunctor1(T& _obj, bool (T::*_fpt)(void *arg)) :
-				  obj(_obj) {
-					  fpt = _fpt;
-				  };
-
-			  virtual bool operator()(void *arg) {
-				  return (obj.*fpt)(arg);
-			  };
-	  };
+		  void* obj;
+		  void* fpt[2];
+		  Thunk thunk;
 
-  class TFunctor2 : public TFunctor {
-	  private:
-		  bool (*fpt)(void *arg);
+		  template<class T>
+			  static bool member_thunk(const Delegate& d, void *arg) {
+				  typedef bool (T::*MemFn)(void *arg);
+				  MemFn f = *reinterpret_cast<const MemFn*>(d.fpt);
+				  return (((T*)d.obj)->*f)(arg);
+			  }
+
+		  template<class T, bool (T::*F)(void *arg)>
+			  static bool bound_thunk(const Delegate& d, void *arg) {
+				  return (((T*)d.obj)->*F)(arg);
+			  }
+
+		  static bool function_thunk(const Delegate& d, void *arg) {
+			  typedef bool (*Fn)(void *arg);
+			  Fn f = *reinterpret_cast<const Fn*>(d.fpt);
+			  return (*f)(arg);
+		  }
 
 	  public:
-		  TFunctor2(bool (*_fpt)(void *arg)) :
-			  fpt(_fpt) {}
-		  virtual bool operator()(void *arg) {
-			  return (*fpt)(arg);
+		  Delegate() : obj(NULL), thunk(NULL) {
+			  fpt[0] = fpt[1] = NULL;
+		  }
+
+		  template<class T>
+			  Delegate(T& _obj, bool (T::*_fpt)(void *arg)) {
+				  typedef bool (T::*MemFn)(void *arg);
+				  // Member function pointers are two words in the
+				  // Itanium C++ ABI
+				  typedef char fpt_fits[(sizeof(MemFn) <= sizeof(fpt)) ?
+					  1 : -1] __attribute__((unused));
+
+				  obj = (void*)&_obj;
+				  fpt[0] = fpt[1] = NULL;
+				  *reinterpret_cast<MemFn*>(fpt) = _fpt;
+				  thunk = &member_thunk<T>;
+			  }
+
+		  Delegate(bool (*_fpt)(void *arg)) {
+			  typedef bool (*Fn)(void *arg);
+
+			  obj = NULL;
+			  fpt[0] = fpt[1] = NULL;
+			  *reinterpret_cast<Fn*>(fpt) = _fpt;
+			  thunk = &function_thunk;
+		  }
+
+		  template<class T, bool (T::*F)(void *arg)>
+			  static Delegate bind(T& _obj) {
+				  Delegate d;
+				  d.obj = (void*)&_obj;
+				  d.thunk = &bound_thunk<T, F>;
+				  return d;
+			  }
+
+		  bool operator()(void *arg) const {
+			  return thunk(*this, arg);
+		  }
+
+		  bool bound() const {
+			  return thunk != NULL;
 		  }
   };
 
   template<class T>
-	  TFunctor* signal_mem_ptr(T& _obj, bool (T::*_fpt)(void *arg)) {
-		  TFunctor1<T> *t = new TFunctor1<T>(_obj, _fpt);
-		  return (TFunctor*)t;
+	  Delegate signal_mem_ptr(T& _obj, bool (T::*_fpt)(void *arg)) {
+		  return Delegate(_obj, _fpt);
 	  }
 
-  TFunctor* signal_fun_ptr(bool (*_fpt)(void *arg));
+  static inline Delegate signal_fun_ptr(bool (*_fpt)(void *arg)) {
+	  return Delegate(_fpt);
+  }
+
+  template<class F> struct DelegateClass;
+
+  template<class T>
+	  struct DelegateClass<bool (T::*)(void *arg)> {
+		  typedef T type;
+	  };
+
+  //
+  // Delegate to member function 'cb' (like &Class::function) of 'obj'
+  //
+#define SIGNAL_MEM_FN(obj, cb) \
+  superstl::Delegate::bind<superstl::DelegateClass<decltype(cb)>::type, \
+	  cb>(obj)
 
+  //
+  // Signal names are only used in debug output, so release builds
+  // (DISABLE_LOGGING) do not keep them.
+  //
   class Signal {
 	  private:
+#ifndef DISABLE_LOGGING
 		  stringbuf name_;
-		  TFunctor* func;
+#endif
+		  Delegate func;
 
 	  public:
-		  Signal();
-		  Signal(const char* name);
+		  Signal() {}
+		  Signal(const char* name) {
+			  set_name(name);
+		  }
 
           ~Signal() {}
 
-		  bool emit(void *arg) ;
-		  void connect(TFunctor* _func);
-		  const char* get_name() {
+		  bool emit(void *arg) const {
+			  assert(func.bound());
+			  return func(arg);
+		  }
+
+		  void connect(const Delegate& _func) {
+			  func = _func;
+		  }
+
+		  const Delegate& get_delegate() const {
+			  return func;
+		  }
+
+#ifndef DISABLE_LOGGING
+		  const char* get_name() const {
 			  return name_.buf;
 		  }
 		  void set_name(const char *name) {
 			  name_ << name;
 		  }
+#else
+		  const char* get_name() const {
+			  return "";
+		  }
+		  void set_name(const char *name) { }
+#endif
   };
 
 
@@ -0,0 +1,135 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ * Basic block vector (BBV) profiling of the instructions emulated by QEMU,
+ * the input of SimPoint.
+ */
+
+#include <globals.h>
+#include <superstl.h>
+#include <bbv.h>
+
+BBVProfiler::BBVProfiler()
+    : interval(0)
+    , interval_insns(0)
+    , intervals(0)
+    , next_id(0)
+{ }
+
+BBVProfiler::~BBVProfiler()
+{
+    close();
+}
+
+/**
+ * @brief Start writing the vectors of 'threads' threads to 'filename'
+ *
+ * @param filename BBV file to create
+ * @param threads Number of threads (vCPUs) profiled
+ * @param interval Instructions, of all threads, in each interval
+ *
+ * @return false if the file can not be created
+ */
+bool BBVProfiler::open(const char* filename, int threads, W64 interval)
+{
+    close();
+
+    os.open(filename, std::ios::out | std::ios::binary);
+    if (!os)
+        return false;
+
+    this->interval = max(interval, W64(1));
+    interval_insns = 0;
+    intervals = 0;
+    next_id = 0;
+
+    foreach (i, threads) {
+        vectors.push(new ThreadVector());
+    }
+
+    W32 header[4];
+    header[0] = BBV_VERSION;
+    header[1] = threads;
+    *(W64*)&header[2] = this->interval;
+
+    os.write(BBV_MAGIC, 8);
+    os.write((char*)header, sizeof(header));
+    os.flush();
+
+    return true;
+}
+
+/**
+ * @brief Stop profiling, the instructions of the last partial interval
+ * are not written
+ */
+void BBVProfiler::close()
+{
+    if (os.is_open())
+        os.close();
+
+    ids.clear_and_free();
+
+    foreach (i, vectors.count())
+        delete vectors[i];
+    vectors.clear_and_free();
+}
+
+W32 BBVProfiler::new_block(W64 rip)
+{
+    W32 id = next_id++;
+    ids.add(rip, id);
+
+    /* Vectors grow by doubling, every block has a count in each thread */
+    foreach (i, vectors.count()) {
+        dynarray<W64>& insns = vectors[i]->insns;
+        if (insns.count() == insns.capacity())
+            insns.reserve(max(insns.capacity() * 2, 1024));
+        insns.push(0);
+    }
+
+    W32 record[4];
+    record[0] = BBV_RECORD_BLOCK;
+    record[1] = id;
+    *(W64*)&record[2] = rip;
+
+    os.write((char*)record, sizeof(record));
+
+    return id;
+}
+
+/**
+ * @brief Write the vector of each thread and clear them for next interval
+ */
+void BBVProfiler::end_interval()
+{
+    foreach (i, vectors.count()) {
+        ThreadVector& vec = *vectors[i];
+        int entries = vec.touched.count();
+
+        W32 record[4];
+        record[0] = BBV_RECORD_VECTOR;
+        record[1] = i;
+        record[2] = entries;
+        record[3] = 0;
+
+        os.write((char*)record, sizeof(record));
+        os.write((char*)vec.touched.data, sizeof(W32) * entries);
+
+        foreach (j, entries) {
+            W32 id = vec.touched[j];
+            os.write((char*)&vec.insns[id], sizeof(W64));
+            vec.insns[id] = 0;
+        }
+
+        vec.touched.clear();
+    }
+
+    /* Keep the file usable if QEMU is killed */
+    os.flush();
+
+    intervals++;
+    interval_insns = 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ * Basic block vector (BBV) profiling of the instructions emulated by QEMU,
+ * the input of SimPoint.
+ */
+
+#ifndef BBV_H
+#define BBV_H
+
+#include <globals.h>
+#include <superstl.h>
+
+/*
+ * BBV file format, all fields little endian:
+ *
+ *   header  : "MARSSBBV", W32 version, W32 threads, W64 interval
+ *   block   : W32 BBV_RECORD_BLOCK, W32 id, W64 rip
+ *   vector  : W32 BBV_RECORD_VECTOR, W32 thread, W32 entries, W32 0,
+ *             W32 id[entries], W64 insns[entries]
+ *
+ * A block record gives the rip of a block id before its first use. At the
+ * end of every interval one vector record is written per thread, in thread
+ * order, holding the instructions executed in each block by that thread.
+ * util/bbv2simpoint.py converts the file to SimPoint's text format.
+ */
+#define BBV_MAGIC           "MARSSBBV"
+#define BBV_VERSION         1
+
+enum {
+    BBV_RECORD_BLOCK = 1,
+    BBV_RECORD_VECTOR,
+};
+
+class BBVProfiler {
+public:
+    BBVProfiler();
+    ~BBVProfiler();
+
+    bool open(const char* filename, int threads, W64 interval);
+    void close();
+
+    bool is_open() const { return os.is_open(); }
+
+    /**
+     * @brief Count 'insns' instructions of the block at 'rip' on 'thread'
+     */
+    void add(int thread, W64 rip, int insns) {
+        ThreadVector& vec = *vectors[thread];
+        W32 id = block_id(rip);
+
+        if (vec.insns[id] == 0)
+            vec.touched.push(id);
+
+        vec.insns[id] += insns;
+        interval_insns += insns;
+
+        if unlikely (interval_insns >= interval)
+            end_interval();
+    }
+
+    void end_interval();
+
+    W64 get_intervals() const { return intervals; }
+    W32 get_blocks() const { return next_id; }
+
+private:
+    struct ThreadVector {
+        dynarray<W64> insns;
+        dynarray<W32> touched;
+    };
+
+    ofstream os;
+    W64 interval;
+    W64 interval_insns;
+    W64 intervals;
+    W32 next_id;
+
+    Hashtable<W64, W32, 65536> ids;
+    dynarray<ThreadVector*> vectors;
+
+    W32 block_id(W64 rip) {
+        W32* id = ids.get(rip);
+
+        if likely (id)
+            return *id;
+
+        return new_block(rip);
+    }
+
+    W32 new_block(W64 rip);
+};
+
+#endif /* BBV_H */
@@ -0,0 +1,146 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ * Host time profiler: scoped timers that count the host cycles spent in
+ * each part of the simulator, per simulated core.
+ */
+
+#include <globals.h>
+#include <superstl.h>
+#include <host-profile.h>
+
+static const struct {
+    const char *name;
+    int parent;
+    bool core;
+} zone_info[NUM_HPROF_ZONES] = {
+    { "none",             -1,                false },
+    { "simulation",       -1,                true  },
+    { "core",             HPROF_SIMULATION,  true  },
+    { "fetch",            HPROF_CORE,        true  },
+    { "dispatch",         HPROF_CORE,        true  },
+    { "issue",            HPROF_CORE,        true  },
+    { "commit",           HPROF_CORE,        true  },
+    { "translate",        HPROF_CORE,        true  },
+    { "memory",           HPROF_SIMULATION,  true  },
+    { "controllers",      HPROF_MEMORY,      true  },
+    { "interconnects",    HPROF_MEMORY,      true  },
+    { "qemu_io",          HPROF_SIMULATION,  false },
+    { "qemu_switch",      -1,                true  },
+    { "stats_dump",       -1,                false },
+};
+
+__thread HostProfileThread host_profile_thread = { 0, HPROF_NONE,
+    HPROF_NO_CORE, HPROF_NO_CORE };
+
+HostProfile host_profile;
+
+HostProfile::HostProfile()
+{
+    reset();
+}
+
+void HostProfile::reset()
+{
+    memset(counters_, 0, sizeof(counters_));
+}
+
+/* The no-core counters are the sum of the rows of all host threads */
+W64 HostProfile::get_cycles(int zone, int core) const
+{
+    if (core != HPROF_NO_CORE)
+        return counters_[core].cycles[zone];
+
+    W64 sum = 0;
+    foreach (t, HPROF_HOST_THREADS) {
+        sum += counters_[HPROF_NO_CORE + t].cycles[zone];
+    }
+    return sum;
+}
+
+W64 HostProfile::get_calls(int zone, int core) const
+{
+    if (core != HPROF_NO_CORE)
+        return counters_[core].calls[zone];
+
+    W64 sum = 0;
+    foreach (t, HPROF_HOST_THREADS) {
+        sum += counters_[HPROF_NO_CORE + t].calls[zone];
+    }
+    return sum;
+}
+
+HostProfileStats::HostProfileStats(Statable *parent)
+    : Statable("host_profile", parent)
+      , cycles("cycles", this)
+{
+    zones[HPROF_NONE] = NULL;
+
+    for (int i = HPROF_NONE + 1; i < NUM_HPROF_ZONES; i++) {
+        int parent_zone = zone_info[i].parent;
+        Statable *node = (parent_zone < 0) ? (Statable*)this :
+            (Statable*)zones[parent_zone];
+
+        zones[i] = new HostProfileZoneStats(zone_info[i].name, node,
+                zone_info[i].core, host_profile_counts_calls(i));
+    }
+}
+
+HostProfileStats::~HostProfileStats()
+{
+    /* Children first, they remove themselves from their parent */
+    for (int i = NUM_HPROF_ZONES - 1; i > HPROF_NONE; i--) {
+        delete zones[i];
+    }
+}
+
+/**
+ * @brief Copy the counters of 'profile' into the default Stats
+ *
+ * Children are added to their parents from the last zone to the first,
+ * so each zone's 'cycles' covers its whole subtree.
+ */
+void HostProfileStats::update(const HostProfile& profile)
+{
+    W64 total[NUM_HPROF_ZONES][NUM_SIM_CORES + 1];
+    W64 all = 0;
+
+    foreach (i, NUM_HPROF_ZONES) {
+        foreach (c, NUM_SIM_CORES + 1) {
+            total[i][c] = (i == HPROF_NONE) ? 0 : profile.get_cycles(i, c);
+        }
+    }
+
+    for (int i = NUM_HPROF_ZONES - 1; i > HPROF_NONE; i--) {
+        W64 self = 0;
+        W64 calls = 0;
+        W64 sum = 0;
+
+        foreach (c, NUM_SIM_CORES + 1) {
+            self += profile.get_cycles(i, c);
+            calls += profile.get_calls(i, c);
+            sum += total[i][c];
+
+            if (zone_info[i].parent >= 0)
+                total[zone_info[i].parent][c] += total[i][c];
+        }
+
+        HostProfileZoneStats *zone = zones[i];
+        zone->cycles = sum;
+        zone->self_cycles = self;
+        if (zone->calls)
+            *zone->calls = calls;
+
+        if (zone->per_core) {
+            foreach (c, NUM_SIM_CORES) {
+                (*zone->per_core)[c] = total[i][c];
+            }
+        }
+
+        all += self;
+    }
+
+    cycles = all;
+}
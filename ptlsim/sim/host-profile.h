@@ -0,0 +1,199 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ * Host time profiler: scoped timers that count the host cycles spent in
+ * each part of the simulator, per simulated core.
+ */
+
+#ifndef HOST_PROFILE_H
+#define HOST_PROFILE_H
+
+#include <globals.h>
+#include <superstl.h>
+#include <statsBuilder.h>
+
+/*
+ * Profiled zones. Each zone has a parent in the stats tree, parents come
+ * before their children. A scope only counts the cycles spent in its zone
+ * until the next scope is entered, so nested zones are not counted twice
+ * and 'self_cycles' of all zones add up to the profiled host time.
+ */
+enum HostProfileZone {
+    HPROF_NONE = 0,          // Outside any scope, not exported
+    HPROF_SIMULATION,        // Machine run loop
+    HPROF_CORE,              // Per-cycle signal of a core
+    HPROF_CORE_FETCH,
+    HPROF_CORE_DISPATCH,     // Complete, dispatch, frontend and rename
+    HPROF_CORE_ISSUE,
+    HPROF_CORE_COMMIT,       // Commit, writeback and transfer
+    HPROF_TRANSLATE,         // x86 decoder
+    HPROF_MEMORY,            // Memory hierarchy clock and its events, core
+                             // accesses count in the core's stage
+    HPROF_CONTROLLER,        // Messages handled by caches and memory
+    HPROF_INTERCONNECT,      // Requests handled by interconnects
+    HPROF_QEMU_IO,           // QEMU timers and IO events
+    HPROF_QEMU_SWITCH,       // Switching between QEMU and PTLsim
+    HPROF_STATS,             // Stats dumps
+    NUM_HPROF_ZONES
+};
+
+/*
+ * Zones entered every simulated cycle. They do not count calls, which
+ * would only give the number of cycles, so entering them only reads the
+ * TSC and writes the cycle counter.
+ */
+#define HPROF_HOT_ZONES ((1 << HPROF_CORE) | (1 << HPROF_CORE_FETCH) | \
+        (1 << HPROF_CORE_DISPATCH) | (1 << HPROF_CORE_ISSUE) | \
+        (1 << HPROF_CORE_COMMIT) | (1 << HPROF_MEMORY))
+
+static inline bool host_profile_counts_calls(int zone)
+{
+    return !((HPROF_HOT_ZONES >> zone) & 1);
+}
+
+/* Counter slot of time spent outside any core */
+#define HPROF_NO_CORE  NUM_SIM_CORES
+
+/* Host threads with their own no-core row: the main thread and one parallel
+ * worker per core */
+#define HPROF_HOST_THREADS  (NUM_SIM_CORES + 1)
+
+struct HostProfileThread {
+    W64 last;
+    int zone;
+    int core;
+    int no_core;    // Row of this host thread for HPROF_NO_CORE
+};
+
+extern __thread HostProfileThread host_profile_thread;
+
+class HostProfile {
+public:
+    HostProfile();
+
+    /* Charge the cycles since the last switch to the current zone */
+    inline void switch_to(int zone, int core) {
+        HostProfileThread& thread = host_profile_thread;
+        W64 now = rdtsc();
+
+        counters_[row(thread.core)].cycles[thread.zone] += now - thread.last;
+        thread.last = now;
+        thread.zone = zone;
+        thread.core = core;
+    }
+
+    inline void count(int zone, int core) {
+        counters_[row(core)].calls[zone]++;
+    }
+
+    W64 get_cycles(int zone, int core) const;
+    W64 get_calls(int zone, int core) const;
+
+    void reset();
+
+    /* Give the calling host thread its own row for time outside any core */
+    static void set_host_thread(int id) {
+        assert(id < HPROF_HOST_THREADS);
+        host_profile_thread.no_core = HPROF_NO_CORE + id;
+    }
+
+private:
+    /* One row per core, written only by the thread simulating it, then one
+     * no-core row per host thread */
+    struct Counters {
+        W64 cycles[NUM_HPROF_ZONES];
+        W64 calls[NUM_HPROF_ZONES];
+    } __attribute__((aligned(64)));
+
+    Counters counters_[NUM_SIM_CORES + HPROF_HOST_THREADS];
+
+    static inline int row(int core) {
+        return (core == HPROF_NO_CORE) ? host_profile_thread.no_core : core;
+    }
+};
+
+extern HostProfile host_profile;
+
+class HostProfileScope {
+public:
+    HostProfileScope(int zone) {
+        enter(zone, host_profile_thread.core);
+    }
+
+    HostProfileScope(int zone, int core) {
+        enter(zone, core);
+    }
+
+    ~HostProfileScope() {
+        host_profile.switch_to(prevZone_, prevCore_);
+    }
+
+private:
+    int prevZone_;
+    int prevCore_;
+
+    void enter(int zone, int core) {
+        prevZone_ = host_profile_thread.zone;
+        prevCore_ = host_profile_thread.core;
+        if (host_profile_counts_calls(zone))
+            host_profile.count(zone, core);
+        host_profile.switch_to(zone, core);
+    }
+};
+
+/* Build with 'scons profile=1' to compile the scopes in */
+#ifdef ENABLE_HOST_PROFILE
+#define host_profile_scope(zone) HostProfileScope hprof_scope(zone)
+#define host_profile_core_scope(zone, core) \
+    HostProfileScope hprof_scope(zone, core)
+#else
+#define host_profile_scope(zone) (0)
+#define host_profile_core_scope(zone, core) (0)
+#endif
+
+/**
+ * @brief Host profile of one zone in the stats
+ *
+ * 'cycles' includes the zones below this one, 'per_core' splits 'cycles'
+ * by simulated core for the zones that run on behalf of a core. 'calls'
+ * is only kept for zones outside HPROF_HOT_ZONES.
+ */
+struct HostProfileZoneStats : public Statable {
+    StatObj<W64> cycles;
+    StatObj<W64> self_cycles;
+    StatObj<W64> *calls;
+    StatArray<W64, NUM_SIM_CORES> *per_core;
+
+    HostProfileZoneStats(const char *name, Statable *parent, bool core,
+            bool count_calls)
+        : Statable(name, parent)
+          , cycles("cycles", this)
+          , self_cycles("self_cycles", this)
+          , calls(NULL)
+          , per_core(NULL)
+    {
+        if (count_calls)
+            calls = new StatObj<W64>("calls", this);
+        if (core)
+            per_core = new StatArray<W64, NUM_SIM_CORES>("per_core", this);
+    }
+
+    ~HostProfileZoneStats() {
+        delete calls;
+        delete per_core;
+    }
+};
+
+struct HostProfileStats : public Statable {
+    StatObj<W64> cycles;
+    HostProfileZoneStats *zones[NUM_HPROF_ZONES];
+
+    HostProfileStats(Statable *parent);
+    ~HostProfileStats();
+
+    void update(const HostProfile& profile);
+};
+
+#endif // HOST_PROFILE_H
@@ -15,6 +15,9 @@
 #include <basecore.h>
 #include <statsBuilder.h>
 #include <memoryHierarchy.h>
+#include <sampling.h>
+#include <warm-state.h>
+#include <host-profile.h>
 
 #include <cstdarg>
 
@@ -37,6 +40,17 @@ BaseMachine::BaseMachine(const char *name)
 
     context_used = 0;
     coreid_counter = 0;
+
+    quantum_base = 0;
+    quantum_cycles = 0;
+    workers_shutdown = false;
+    parallel_stats = new ParallelStats(this);
+    reference_ready = false;
+    reference_out = NULL;
+    reference_row = 0;
+    idle_skip_stats = new IdleSkipStats(this);
+    halted_stats = new HaltedCoreStats(this);
+    parked_cores = 0;
 }
 
 BaseMachine::~BaseMachine()
@@ -46,9 +60,12 @@ BaseMachine::~BaseMachine()
 
 void BaseMachine::reset()
 {
+    destroy_workers();
+
     context_used = 0;
     context_counter = 0;
     coreid_counter = 0;
+    parked_cores = 0;
 
     foreach(i, cores.count()) {
         BaseCore* core = cores[i];
@@ -65,6 +82,14 @@ void BaseMachine::reset()
 
 void BaseMachine::shutdown()
 {
+	destroy_workers();
+
+	if (reference_out) {
+		reference_out->close();
+		delete reference_out;
+		reference_out = NULL;
+	}
+
 	foreach (i, cores.count()) {
 		BaseCore* core = cores[i];
 		delete core;
@@ -138,6 +163,10 @@ bool BaseMachine::init(PTLsimConfig& config)
 
     init_qemu_io_events();
 
+    parallel_stats->set_default_stats(user_stats);
+    idle_skip_stats->set_default_stats(user_stats);
+    halted_stats->set_default_stats(user_stats);
+
     return 1;
 }
 
@@ -166,36 +195,80 @@ void BaseMachine::dump_configuration(ostream& os) const
 	os << "#\n# Simulated Machine Configuration\n#\n";
 
 	config_yaml = new YAML::Emitter();
+	emit_configuration(*config_yaml);
+
+	os << config_yaml->c_str() << "\n";
+	os << "\n# End Machine Configuration\n";
+
+	ptl_logfile << "Dumped all machine configuration\n";
+}
 
-	*config_yaml << YAML::BeginMap;
-	*config_yaml << YAML::Key << "machine";
-	*config_yaml << YAML::Value << YAML::BeginMap;
+/**
+ * @brief Emit configuration of the machine, its cores, controllers and
+ * interconnects as YAML
+ */
+void BaseMachine::emit_configuration(YAML::Emitter& out) const
+{
+	out << YAML::BeginMap;
+	out << YAML::Key << "machine";
+	out << YAML::Value << YAML::BeginMap;
 
 	/* Some machine specific parameters */
-	*config_yaml << YAML::Key << "name" << YAML::Value << config.machine_config;
-	*config_yaml << YAML::Key << "cpu_contexts" << YAML::Value << NUM_SIM_CORES;
-	*config_yaml << YAML::Key << "freq" << YAML::Value << config.core_freq_hz;
+	out << YAML::Key << "name" << YAML::Value << config.machine_config;
+	out << YAML::Key << "cpu_contexts" << YAML::Value << NUM_SIM_CORES;
+	out << YAML::Key << "freq" << YAML::Value << config.core_freq_hz;
 
 	/* Now go through all cores */
 	foreach (i, cores.count())
-		cores[i]->dump_configuration(*config_yaml);
+		cores[i]->dump_configuration(out);
 
 	/* Next is all controllers/caches */
 	foreach (i, controllers.count())
-		controllers[i]->dump_configuration(*config_yaml);
+		controllers[i]->dump_configuration(out);
 
 	/* Now dump all interconnections */
 	foreach (i, interconnects.count())
-		interconnects[i]->dump_configuration(*config_yaml);
+		interconnects[i]->dump_configuration(out);
 
 	/* Finalize YAML */
-	*config_yaml << YAML::EndMap;
-	*config_yaml << YAML::EndMap;
+	out << YAML::EndMap;
+	out << YAML::EndMap;
+}
 
-	os << config_yaml->c_str() << "\n";
-	os << "\n# End Machine Configuration\n";
+/**
+ * @brief CRC of the machine configuration, warm state is only restored
+ * into a machine with the same signature
+ */
+W64 BaseMachine::config_signature() const
+{
+	YAML::Emitter out;
+	emit_configuration(out);
 
-	ptl_logfile << "Dumped all machine configuration\n";
+	CRC32 crc;
+	crc.update((byte*)out.c_str(), out.size());
+
+	return W64(crc) | (W64(out.size()) << 32);
+}
+
+/**
+ * @brief Save the warm state of all cores and controllers
+ */
+void BaseMachine::save_warm_state(WarmStateFile& ws)
+{
+	foreach (i, cores.count())
+		cores[i]->save_warm_state(ws);
+
+	foreach (i, controllers.count())
+		controllers[i]->save_warm_state(ws);
+}
+
+void BaseMachine::load_warm_state(WarmStateFile& ws)
+{
+	foreach (i, cores.count())
+		cores[i]->load_warm_state(ws);
+
+	foreach (i, controllers.count())
+		controllers[i]->load_warm_state(ws);
 }
 
 int BaseMachine::run(PTLsimConfig& config)
@@ -227,7 +300,192 @@ int BaseMachine::run(PTLsimConfig& config)
     first_run = 0;
 
     // Run each core
+    bool exiting;
+    bool parallel = (config.parallel_quantum > 1 &&
+            per_cycle_signals.count() > 1);
+
+    if unlikely (!reference_ready)
+        setup_parallel_reference(config, parallel);
+
+    if (parallel) {
+        exiting = run_parallel(config);
+    } else {
+        exiting = run_serial(config);
+    }
+
+    if(logable(1))
+        ptl_logfile << "Exiting out-of-order core at ", total_insns_committed, " commits, ", total_uops_committed, " uops and ", iterations, " iterations (cycles)", endl;
+
+    config.dump_state_now = 0;
+
+    return exiting;
+}
+
+/*
+ * Idle cycle skipping
+ *
+ * When every core only waits for the memory hierarchy, cycles until the
+ * next memory or IO event do nothing but update statistics, and they update
+ * them the same way each cycle. Such a stretch is found by checking the
+ * cores at the start of a cycle. The first idle cycle records which stats
+ * blocks are written, the second one measures how much each counter in
+ * those blocks changes. If the second cycle wrote no other block and the
+ * cores are still idle, the measured change is added once for every
+ * remaining cycle and the clock jumps to the wake up cycle.
+ */
+
+enum {
+    IDLE_SKIP_NONE,
+    IDLE_SKIP_FIRST,
+    IDLE_SKIP_MARKED,
+    IDLE_SKIP_MEASURE,
+};
+
+/**
+ * @brief Find until which cycle all cores are idle
+ *
+ * The wake up cycle is also bounded by every cycle at which the simulation
+ * loop does something besides clocking, so skipping never moves past one.
+ *
+ * @return First cycle that must be simulated, or 0 if a core is busy now
+ */
+W64 BaseMachine::idle_wake_cycle(PTLsimConfig& config)
+{
+    W64 wake = -1;
+
+    foreach (i, cores.count()) {
+        W64 until = cores[i]->quiescent_until();
+        if (!until)
+            return 0;
+        wake = min(wake, until);
+    }
+
+    wake = min(wake, memoryHierarchyPtr->next_clock());
+    wake = min(wake, next_qemu_io_event_cycle());
+    wake = min(wake, config.stop_at_cycle);
+    wake = min(wake, ((sim_cycle / 1000) + 1) * 1000);
+
+    if (time_stats_file || reference_out) {
+        wake = min(wake, ((sim_cycle / config.time_stats_period) + 1) *
+                config.time_stats_period);
+    }
+
+    if (!logenable && config.start_log_at_iteration > iterations)
+        wake = min(wake, sim_cycle + (config.start_log_at_iteration - iterations));
+
+    return wake;
+}
+
+/**
+ * @brief Jump over idle cycles, replaying their measured statistics
+ *
+ * @param cycles Number of cycles to skip
+ */
+void BaseMachine::skip_idle_cycles(W64 cycles)
+{
+    foreach (i, 3) {
+        idle_delta[i].apply(cycles);
+    }
+
+    foreach (i, cores.count()) {
+        /* Parked cores account all their cycles when they wake up */
+        if (parked_cores[i]) continue;
+        cores[i]->skip_cycles(cycles);
+    }
+
+    memoryHierarchyPtr->skip_cycles(cycles, false);
+
+    sim_cycle += cycles;
+    iterations += cycles;
+
+    idle_skip_stats->skips++;
+    idle_skip_stats->skipped_cycles += cycles;
+
+    if (logable(4))
+        ptl_logfile << "Skipped ", cycles, " idle cycles to ", sim_cycle, endl;
+}
+
+/*
+ * Halted core parking
+ *
+ * A core whose threads all executed HLT and have nothing left in flight is
+ * taken out of the per-cycle loop. Every cycle the machine only checks if
+ * the core is still halted, which is the case until QEMU marks one of its
+ * contexts running again or raises an interrupt for it, for example from
+ * an IPI or an IO event. The cycles the core was parked are then accounted
+ * in one step before it is clocked again.
+ */
+
+/**
+ * @brief Check if halted cores can be parked in this machine
+ *
+ * Parking relies on each core having registered exactly one per-cycle
+ * signal, so the signal at index i clocks core i.
+ */
+bool BaseMachine::can_park_cores(PTLsimConfig& config)
+{
+    return config.park_halted_cores &&
+        cores.count() == per_cycle_signals.count() &&
+        cores.count() <= NUM_SIM_CORES;
+}
+
+/**
+ * @brief Stop clocking a halted core from the next cycle on
+ *
+ * @param core Index of the core
+ */
+void BaseMachine::park_core(int core)
+{
+    parked_cores[core] = 1;
+    parked_at[core] = sim_cycle + 1;
+    halted_stats->parks++;
+
+    if (logable(4))
+        ptl_logfile << "Parking halted core ", core, " at cycle ",
+                    sim_cycle, endl;
+}
+
+/**
+ * @brief Account the cycles a core was parked and clock it again
+ *
+ * @param core Index of the core
+ */
+void BaseMachine::unpark_core(int core)
+{
+    W64 cycles = sim_cycle - parked_at[core];
+
+    parked_cores[core] = 0;
+    cores[core]->account_halted_cycles(cycles);
+    halted_stats->parked_cycles += cycles;
+
+    if (logable(4))
+        ptl_logfile << "Waking up core ", core, " at cycle ", sim_cycle,
+                    " after ", cycles, " halted cycles", endl;
+}
+
+/**
+ * @brief Wake up every parked core, so all statistics are up to date
+ */
+void BaseMachine::unpark_all_cores()
+{
+    foreach (i, cores.count()) {
+        if (parked_cores[i])
+            unpark_core(i);
+    }
+}
+
+/**
+ * @brief Clock the memory hierarchy and all cores one cycle at a time
+ *
+ * @param config Simulation configuration
+ *
+ * @return true if simulation must switch back to emulation
+ */
+bool BaseMachine::run_serial(PTLsimConfig& config)
+{
     bool exiting = false;
+    int idle_state = IDLE_SKIP_NONE;
+    bool park = can_park_cores(config);
 
     for (;;) {
         if unlikely ((!logenable) &&
@@ -246,36 +504,88 @@ int BaseMachine::run(PTLsimConfig& config)
 
         if unlikely (time_stats_file && sim_cycle > 0 &&
                 sim_cycle % config.time_stats_period == 0) {
+            host_profile_scope(HPROF_STATS);
             StatsBuilder::get().dump_periodic(*time_stats_file, sim_cycle);
         }
 
+        if unlikely (reference_out && sim_cycle > 0 &&
+                sim_cycle % config.time_stats_period == 0)
+            write_parallel_reference();
 
         // limit the ptl_logfile size
         if unlikely (ptl_logfile.is_open() &&
                 ((W64)ptl_logfile.tellp() > config.log_file_size))
             backup_and_reopen_logfile();
 
+        if (idle_state == IDLE_SKIP_MARKED) {
+            foreach (i, 3) idle_delta[i].snapshot();
+            idle_state = IDLE_SKIP_MEASURE;
+        } else if unlikely (config.skip_idle_cycles &&
+                idle_wake_cycle(config) > sim_cycle + 2) {
+            idle_delta[0].start(*user_stats);
+            idle_delta[1].start(*kernel_stats);
+            idle_delta[2].start(*global_stats);
+            idle_state = IDLE_SKIP_FIRST;
+        }
+
         memoryHierarchyPtr->clock();
         clock_qemu_io_events();
 
 		foreach (i, coremodel.per_cycle_signals.size()) {
       current_cpu = ENV_GET_CPU(&contextof(i));
       smp_mb();
+            if unlikely (park && parked_cores[i]) {
+                if (cores[i]->is_halted())
+                    continue;
+                unpark_core(i);
+            }
 			if (logable(4))
 				ptl_logfile << "Per-Cycle-Signal : " <<
 					coremodel.per_cycle_signals[i]->get_name() << endl;
-			exiting |= coremodel.per_cycle_signals[i]->emit(NULL);
+			{
+				host_profile_core_scope(HPROF_CORE, i);
+				exiting |= coremodel.per_cycle_signals[i]->emit(NULL);
+			}
+            if unlikely (park && cores[i]->is_halted() &&
+                    cores[i]->quiescent_until() != 0) {
+                park_core(i);
+            }
 		}
 
         sim_cycle++;
         iterations++;
 
+        if unlikely (idle_state == IDLE_SKIP_FIRST) {
+            if (!exiting && idle_wake_cycle(config) > sim_cycle + 1) {
+                foreach (i, 3) idle_delta[i].mark();
+                idle_state = IDLE_SKIP_MARKED;
+            } else {
+                foreach (i, 3) idle_delta[i].cancel();
+                idle_state = IDLE_SKIP_NONE;
+            }
+        } else if unlikely (idle_state == IDLE_SKIP_MEASURE) {
+            bool same = true;
+            foreach (i, 3) same &= idle_delta[i].measure();
+
+            W64 wake = idle_wake_cycle(config);
+            if (!exiting && same && wake != W64(-1) && wake > sim_cycle) {
+                skip_idle_cycles(wake - sim_cycle);
+            } else {
+                idle_skip_stats->samples_aborted++;
+            }
+            idle_state = IDLE_SKIP_NONE;
+        }
+
         if unlikely (config.stop_at_insns <= total_insns_committed ||
                 config.stop_at_cycle <= sim_cycle) {
             ptl_logfile << "Stopping simulation loop at specified limits (", sim_cycle, " cycles, ", total_insns_committed, " commits)", endl;
             exiting = 1;
             break;
         }
+        if unlikely (sampling.stop_at_insns <= total_insns_committed) {
+            exiting = 1;
+            break;
+        }
         if unlikely (exiting) {
             if unlikely(ret_qemu_env == NULL)
                 ret_qemu_env = &contextof(0);
@@ -283,19 +593,389 @@ int BaseMachine::run(PTLsimConfig& config)
         }
     }
 
-    if(logable(1))
-        ptl_logfile << "Exiting out-of-order core at ", total_insns_committed, " commits, ", total_uops_committed, " uops and ", iterations, " iterations (cycles)", endl;
+    unpark_all_cores();
 
-    config.dump_state_now = 0;
+    return exiting;
+}
+
+/*
+ * Parallel core simulation
+ *
+ * Each per-cycle signal (one per core) is emitted from its own worker thread
+ * for a quantum of 'parallel-quantum' cycles. Each worker counts the cycles
+ * of its own core from the start of the quantum in worker_cycle, read with
+ * core_cycle(); sim_cycle stays at the start of the quantum, as QEMU on the
+ * main thread expects.
+ *
+ * A worker also clocks the CPU controller of its core, which with the L1
+ * caches behind it is private to the core: instruction buffer and L1 hits
+ * complete on the worker with their normal latency. Requests that go past
+ * the L1 are queued together with the cycle in which they were made. At
+ * the quantum boundary the workers are parked and the main thread replays
+ * the quantum one cycle at a time, clocking the rest of the hierarchy and
+ * the QEMU IO events and then issuing the requests the cores made in that
+ * cycle, in core order, like run_serial does. Misses therefore reach the
+ * hierarchy at the same cycle as in serial mode, but their completions and
+ * IO interrupts reach the cores only at the end of the quantum; the
+ * 'late_wakeups' and 'wakeup_skew' stats count this.
+ *
+ * A core that asks to switch back to emulation stops where it is, the other
+ * cores finish the quantum. Stop conditions are checked at quantum
+ * boundaries, and quanta end at every time-stats sample so the samples see
+ * the cores and the hierarchy at the same cycle.
+ *
+ * The other state shared between cores is guarded by the locks listed with
+ * ParallelSection. A worker only flushes the TLBs of its own core, guest
+ * TLB flushes for other cores wait for the end of the quantum.
+ * '-parallel-reference' measures how far the result is from
+ * a serial run (see ParallelStats).
+ */
+
+bool parallel_sim_active = false;
+__thread int parallel_worker_id = -1;
+__thread W64 worker_cycle = 0;
+ParallelLock parallel_qemu_lock;
+
+static void* parallel_worker_main(void *arg)
+{
+    ParallelWorker *worker = (ParallelWorker*)arg;
+    BaseMachine &machine = *worker->machine;
+
+    parallel_worker_id = worker->id;
+
+    /* Time between quanta is not charged to the main thread's no-core row */
+    HostProfile::set_host_thread(worker->id + 1);
+
+    for (;;) {
+        pthread_barrier_wait(&machine.quantum_start);
+
+        if unlikely (machine.workers_shutdown)
+            break;
+
+        current_cpu = ENV_GET_CPU(&machine.contextof(worker->id));
+        worker_cycle = machine.quantum_base;
+        worker->exiting = false;
+
+        {
+            host_profile_core_scope(HPROF_CORE, worker->id);
+
+            foreach (cycle, machine.quantum_cycles) {
+                machine.memoryHierarchyPtr->clock_cpu_controller(worker->id);
+                bool exiting = worker->signal->emit(NULL);
+                worker_cycle++;
+
+                if unlikely (exiting) {
+                    worker->exiting = true;
+                    break;
+                }
+            }
+        }
+
+        pthread_barrier_wait(&machine.quantum_end);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Create one worker thread for each per-cycle signal
+ */
+void BaseMachine::setup_workers()
+{
+    if (workers.count() == per_cycle_signals.count())
+        return;
+
+    destroy_workers();
+
+    int count = per_cycle_signals.count();
+
+    /* Each worker has its own request queue in the memory hierarchy */
+    assert(count <= NUM_SIM_CORES);
+
+    pthread_barrier_init(&quantum_start, NULL, count + 1);
+    pthread_barrier_init(&quantum_end, NULL, count + 1);
+    workers_shutdown = false;
+
+    foreach (i, count) {
+        ParallelWorker *worker = new ParallelWorker();
+        worker->machine = this;
+        worker->signal = per_cycle_signals[i];
+        worker->id = i;
+        worker->exiting = false;
+
+        int rc = pthread_create(&worker->thread, NULL,
+                parallel_worker_main, worker);
+        assert(rc == 0);
+
+        workers.push(worker);
+    }
+
+    ptl_logfile << "Created ", count, " parallel simulation workers", endl;
+}
+
+/**
+ * @brief Stop and join all worker threads
+ */
+void BaseMachine::destroy_workers()
+{
+    if (workers.count() == 0)
+        return;
+
+    workers_shutdown = true;
+    pthread_barrier_wait(&quantum_start);
+
+    foreach (i, workers.count()) {
+        pthread_join(workers[i]->thread, NULL);
+        delete workers[i];
+    }
+
+    workers.clear();
+
+    pthread_barrier_destroy(&quantum_start);
+    pthread_barrier_destroy(&quantum_end);
+}
+
+/**
+ * @brief Run all cores in parallel, one host thread per core
+ *
+ * @param config Simulation configuration
+ *
+ * @return true if simulation must switch back to emulation
+ */
+bool BaseMachine::run_parallel(PTLsimConfig& config)
+{
+    bool exiting = false;
+
+    setup_workers();
+
+    if unlikely(sim_cycle == 0 && time_stats_file)
+        StatsBuilder::get().dump_header(*time_stats_file);
+
+    while (!exiting) {
+        if unlikely ((!logenable) &&
+                iterations >= config.start_log_at_iteration &&
+                !config.log_user_only) {
+            ptl_logfile << "Start logging at level ", config.loglevel,
+                        " in cycle ", iterations, endl, flush;
+            logenable = 1;
+        }
+
+        if unlikely (sim_cycle > 0 &&
+                sim_cycle % config.time_stats_period == 0) {
+            if (time_stats_file) {
+                host_profile_scope(HPROF_STATS);
+                StatsBuilder::get().dump_periodic(*time_stats_file,
+                        sim_cycle);
+            }
+
+            if (reference.count())
+                compare_parallel_reference();
+        }
+
+        // limit the ptl_logfile size
+        if unlikely (ptl_logfile.is_open() &&
+                ((W64)ptl_logfile.tellp() > config.log_file_size))
+            backup_and_reopen_logfile();
+
+        quantum_base = sim_cycle;
+        quantum_cycles = min(config.parallel_quantum,
+                config.stop_at_cycle - sim_cycle);
+
+        if (time_stats_file || reference.count()) {
+            quantum_cycles = min(quantum_cycles, config.time_stats_period -
+                    (sim_cycle % config.time_stats_period));
+        }
+
+        if unlikely (quantum_cycles == 0)
+            quantum_cycles = 1;
+
+        /* Let the cores run the quantum */
+        parallel_sim_active = true;
+        pthread_barrier_wait(&quantum_start);
+        pthread_barrier_wait(&quantum_end);
+        parallel_sim_active = false;
+
+        flush_deferred_tlbs();
+
+        parallel_stats->quanta++;
+
+        /* Then the rest of the memory hierarchy and IO catch up with them */
+        memoryHierarchyPtr->end_quantum(sim_cycle + quantum_cycles);
+
+        foreach (cycle, quantum_cycles) {
+            if(sim_cycle % 1000 == 0)
+                update_progress();
+
+            memoryHierarchyPtr->clock_shared();
+            clock_qemu_io_events();
+            parallel_stats->deferred_requests +=
+                memoryHierarchyPtr->issue_deferred();
+
+            sim_cycle++;
+            iterations++;
+        }
+
+        parallel_stats->cycles += quantum_cycles;
+
+        foreach (i, workers.count()) {
+            exiting |= workers[i]->exiting;
+        }
+
+        if unlikely (exiting) {
+            parallel_stats->early_exits++;
+            if unlikely(ret_qemu_env == NULL)
+                ret_qemu_env = &contextof(0);
+        }
+
+        if unlikely (config.stop_at_insns <= total_insns_committed ||
+                config.stop_at_cycle <= sim_cycle) {
+            ptl_logfile << "Stopping simulation loop at specified limits (", sim_cycle, " cycles, ", total_insns_committed, " commits)", endl;
+            exiting = 1;
+        }
+        if unlikely (sampling.stop_at_insns <= total_insns_committed) {
+            exiting = 1;
+        }
+    }
 
     return exiting;
 }
 
+/**
+ * @brief Open the serial reference of '-parallel-reference'
+ *
+ * A serial run writes the file, a parallel run reads it. The file holds the
+ * number of cores, then one row per time-stats period of the cycle followed
+ * by the commits of each core, all as W64.
+ *
+ * @param config Simulation configuration
+ * @param parallel True if this run simulates the cores in parallel
+ */
+void BaseMachine::setup_parallel_reference(PTLsimConfig& config,
+        bool parallel)
+{
+    reference_ready = true;
+
+    if (!config.parallel_reference.set())
+        return;
+
+    foreach (i, NUM_SIM_CORES) {
+        reference_last[i] = 0;
+        parallel_last[i] = 0;
+    }
+
+    if (!parallel) {
+        W64 count = cores.count();
+
+        reference_out = new ofstream(config.parallel_reference.buf,
+                std::ios::out | std::ios::binary);
+        reference_out->write((char*)&count, sizeof(count));
+        return;
+    }
+
+    ifstream is(config.parallel_reference.buf,
+            std::ios::in | std::ios::binary);
+    W64 count = 0;
+    W64 value;
+
+    if (!is || !(is >> count) || count != W64(cores.count())) {
+        ptl_logfile << "Parallel reference ", config.parallel_reference,
+                    " is missing or has a different number of cores", endl;
+        return;
+    }
+
+    while (is >> value) {
+        reference.push(value);
+    }
+
+    /* Drop a row cut short by a serial run that did not end cleanly */
+    reference.resize(reference.count() - (reference.count() % (count + 1)));
+    reference_row = 0;
+
+    ptl_logfile << "Comparing against ", reference.count() / (count + 1),
+                " samples of a serial run from ", config.parallel_reference,
+                endl;
+}
+
+/**
+ * @brief Add the commits of each core at this cycle to the serial reference
+ */
+void BaseMachine::write_parallel_reference()
+{
+    W64 row[NUM_SIM_CORES + 1];
+
+    row[0] = sim_cycle;
+    foreach (i, cores.count()) {
+        row[i + 1] = cores[i]->insns_committed();
+    }
+
+    reference_out->write((char*)row, sizeof(W64) * (cores.count() + 1));
+    reference_out->flush();
+}
+
+/**
+ * @brief Compare the commits of each core with the serial reference
+ *
+ * Commits of the period since the last compared sample are taken from both
+ * runs. Both are sampled at the same cycle, so the difference of commits is
+ * also the difference of IPC times the length of the period.
+ */
+void BaseMachine::compare_parallel_reference()
+{
+    int width = cores.count() + 1;
+    int rows = reference.count() / width;
+
+    while (reference_row < rows &&
+            reference[reference_row * width] < sim_cycle) {
+        reference_row++;
+    }
+
+    if (reference_row == rows || reference[reference_row * width] != sim_cycle)
+        return;
+
+    W64 *row = &reference[reference_row * width + 1];
+
+    foreach (i, cores.count()) {
+        W64 commits = cores[i]->insns_committed();
+        W64 period = commits - parallel_last[i];
+        W64 serial = row[i] - reference_last[i];
+        W64 error = (period > serial) ? (period - serial) : (serial - period);
+
+        parallel_stats->commit_error += error;
+        parallel_stats->reference_commits += serial;
+        parallel_stats->core_commit_error[i] += error;
+        parallel_stats->core_reference_commits[i] += serial;
+
+        parallel_last[i] = commits;
+        reference_last[i] = row[i];
+    }
+
+    parallel_stats->reference_samples++;
+    reference_row++;
+}
+
+/**
+ * @brief Flush the TLB entries of 'ctx' in the core that runs it
+ *
+ * A parallel worker only flushes the TLBs of its own core. Flushes of cores
+ * clocked by other workers wait for the end of the quantum, see
+ * flush_deferred_tlbs().
+ */
 void BaseMachine::flush_tlb(Context& ctx)
 {
     foreach(i, cores.count()) {
         BaseCore* core = cores[i];
-        core->flush_tlb(ctx);
+        if (!core->has_context(ctx))
+            continue;
+
+        if unlikely (parallel_sim_active && i != parallel_worker_id) {
+            ParallelTLBFlush& flush = tlb_flushes[parallel_worker_id].push();
+            flush.ctx = &ctx;
+            flush.virtaddr = 0;
+            flush.all = true;
+        } else {
+            core->flush_tlb(ctx);
+        }
+        break;
     }
 }
 
@@ -303,7 +983,72 @@ void BaseMachine::flush_tlb_virt(Context& ctx, Waddr virtaddr)
 {
     foreach(i, cores.count()) {
         BaseCore* core = cores[i];
-        core->flush_tlb_virt(ctx, virtaddr);
+        if (!core->has_context(ctx))
+            continue;
+
+        if unlikely (parallel_sim_active && i != parallel_worker_id) {
+            ParallelTLBFlush& flush = tlb_flushes[parallel_worker_id].push();
+            flush.ctx = &ctx;
+            flush.virtaddr = virtaddr;
+            flush.all = false;
+        } else {
+            core->flush_tlb_virt(ctx, virtaddr);
+        }
+        break;
+    }
+}
+
+/**
+ * @brief Do the TLB flushes the workers made for each other's cores
+ *
+ * Called on the main thread once the workers are parked at the end of a
+ * quantum, in worker order.
+ */
+void BaseMachine::flush_deferred_tlbs()
+{
+    foreach(i, workers.count()) {
+        dynarray<ParallelTLBFlush>& flushes = tlb_flushes[i];
+
+        foreach(j, flushes.count()) {
+            ParallelTLBFlush& flush = flushes[j];
+            if (flush.all)
+                flush_tlb(*flush.ctx);
+            else
+                flush_tlb_virt(*flush.ctx, flush.virtaddr);
+        }
+
+        parallel_stats->deferred_tlb_flushes += flushes.count();
+        flushes.clear();
+    }
+}
+
+/**
+ * @brief Functional warming of the caches on the path of 'ctx'
+ *
+ * @param ctx Context that made the access while QEMU fast-forwards
+ * @param physaddr Physical address of the access
+ * @param is_icache True for instruction fetches
+ * @param is_write True for stores
+ */
+void BaseMachine::warm_memory(Context& ctx, W64 physaddr, bool is_icache,
+        bool is_write)
+{
+    foreach(i, cores.count()) {
+        BaseCore* core = cores[i];
+        if (core->has_context(ctx)) {
+            memoryHierarchyPtr->warm_access(core->get_coreid(), physaddr,
+                    is_icache, is_write);
+            return;
+        }
+    }
+}
+
+void BaseMachine::warm_branch(Context& ctx, int type, W64 branchaddr,
+        W64 target, W64 actual)
+{
+    foreach(i, cores.count()) {
+        BaseCore* core = cores[i];
+        core->warm_branch(ctx, type, branchaddr, target, actual);
     }
 }
 
@@ -13,6 +13,8 @@
 
 #include <ptlsim.h>
 
+#include <pthread.h>
+
 #define YAML_KEY_VAL(out, key, val) \
 	out << YAML::Key << key << YAML::Value << val;
 
@@ -43,6 +45,114 @@ struct ConnectionDef {
     dynarray<SingleConnection*> connections;
 };
 
+struct BaseMachine;
+
+/**
+ * @brief Host thread that clocks one per-cycle Signal in parallel mode
+ */
+struct ParallelWorker {
+    BaseMachine *machine;
+    Signal *signal;
+    W8 id;
+    pthread_t thread;
+    bool exiting;
+};
+
+/**
+ * @brief TLB flush a worker made for a core clocked by another worker
+ */
+struct ParallelTLBFlush {
+    Context *ctx;
+    Waddr virtaddr;
+    bool all;
+};
+
+/**
+ * @brief Statistics of parallel core simulation
+ *
+ * 'early_exits' counts quanta in which a core asked to switch back to
+ * emulation. 'deferred_requests' counts the core requests that waited for
+ * the end of their quantum, 'deferred_tlb_flushes' the TLB flushes of
+ * other cores. 'late_wakeups' counts the requests that completed while the
+ * main thread replayed a quantum, so their core only saw them at its end,
+ * and 'wakeup_skew' the cycles they were late by.
+ *
+ * With '-parallel-reference' the commits of each core in every time-stats
+ * period are compared with a serial run sampled at the same cycles.
+ * 'commit_error' adds up the absolute differences and 'reference_commits'
+ * the commits of the serial run, so 'ipc_error' is the relative error of
+ * the per-period IPC. The 'core_' arrays split both by core.
+ */
+struct ParallelStats : public Statable {
+    StatObj<W64> quanta;
+    StatObj<W64> early_exits;
+    StatObj<W64> cycles;
+    StatObj<W64> deferred_requests;
+    StatObj<W64> deferred_tlb_flushes;
+    StatObj<W64> late_wakeups;
+    StatObj<W64> wakeup_skew;
+    StatObj<W64> reference_samples;
+    StatObj<W64> commit_error;
+    StatObj<W64> reference_commits;
+    StatEquation<W64, double, StatObjFormulaDiv> ipc_error;
+    StatArray<W64, NUM_SIM_CORES> core_commit_error;
+    StatArray<W64, NUM_SIM_CORES> core_reference_commits;
+
+    ParallelStats(Statable *parent)
+        : Statable("parallel", parent)
+          , quanta("quanta", this)
+          , early_exits("early_exits", this)
+          , cycles("cycles", this)
+          , deferred_requests("deferred_requests", this)
+          , deferred_tlb_flushes("deferred_tlb_flushes", this)
+          , late_wakeups("late_wakeups", this)
+          , wakeup_skew("wakeup_skew", this)
+          , reference_samples("reference_samples", this)
+          , commit_error("commit_error", this)
+          , reference_commits("reference_commits", this)
+          , ipc_error("ipc_error", this)
+          , core_commit_error("core_commit_error", this)
+          , core_reference_commits("core_reference_commits", this)
+    {
+        ipc_error.add_elem(&commit_error);
+        ipc_error.add_elem(&reference_commits);
+    }
+};
+
+/**
+ * @brief Statistics of idle cycle skipping
+ *
+ * 'samples_aborted' counts idle stretches that were sampled but not
+ * skipped, because the second sample cycle did different work than the
+ * first one or a core woke up.
+ */
+struct IdleSkipStats : public Statable {
+    StatObj<W64> skips;
+    StatObj<W64> skipped_cycles;
+    StatObj<W64> samples_aborted;
+
+    IdleSkipStats(Statable *parent)
+        : Statable("idle_skip", parent)
+          , skips("skips", this)
+          , skipped_cycles("skipped_cycles", this)
+          , samples_aborted("samples_aborted", this)
+    {}
+};
+
+/**
+ * @brief Statistics of halted core parking
+ */
+struct HaltedCoreStats : public Statable {
+    StatObj<W64> parks;
+    StatObj<W64> parked_cycles;
+
+    HaltedCoreStats(Statable *parent)
+        : Statable("halted_cores", parent)
+          , parks("parks", this)
+          , parked_cycles("parked_cycles", this)
+    {}
+};
+
 struct BaseMachine: public PTLsimMachine {
     dynarray<Core::BaseCore*> cores;
     dynarray<Memory::Controller*> controllers;
@@ -57,17 +167,67 @@ struct BaseMachine: public PTLsimMachine {
 
     Memory::MemoryHierarchy* memoryHierarchyPtr;
 
+    // Parallel core simulation
+    dynarray<ParallelWorker*> workers;
+    pthread_barrier_t quantum_start;
+    pthread_barrier_t quantum_end;
+    W64 quantum_base;
+    W64 quantum_cycles;
+    bool workers_shutdown;
+    ParallelStats *parallel_stats;
+    dynarray<ParallelTLBFlush> tlb_flushes[NUM_SIM_CORES];
+
+    // Serial reference of parallel simulation: rows of the cycle followed
+    // by the commits of each core
+    bool reference_ready;
+    ofstream *reference_out;
+    dynarray<W64> reference;
+    int reference_row;
+    W64 reference_last[NUM_SIM_CORES];
+    W64 parallel_last[NUM_SIM_CORES];
+
+    // Idle cycle skipping
+    StatsDelta idle_delta[3];
+    IdleSkipStats *idle_skip_stats;
+
+    // Halted core parking
+    bitvec<NUM_SIM_CORES> parked_cores;
+    W64 parked_at[NUM_SIM_CORES];
+    HaltedCoreStats *halted_stats;
+
     BaseMachine(const char* name);
     virtual bool init(PTLsimConfig& config);
     virtual int run(PTLsimConfig& config);
+    bool run_serial(PTLsimConfig& config);
+    bool run_parallel(PTLsimConfig& config);
+    void setup_parallel_reference(PTLsimConfig& config, bool parallel);
+    void write_parallel_reference();
+    void compare_parallel_reference();
+    W64 idle_wake_cycle(PTLsimConfig& config);
+    void skip_idle_cycles(W64 cycles);
+    bool can_park_cores(PTLsimConfig& config);
+    void park_core(int core);
+    void unpark_core(int core);
+    void unpark_all_cores();
+    void setup_workers();
+    void destroy_workers();
+    void flush_deferred_tlbs();
     virtual W8 get_num_cores();
     virtual void dump_state(ostream& os);
     virtual void update_stats();
     virtual void flush_tlb(Context& ctx);
     virtual void flush_tlb_virt(Context& ctx, Waddr virtaddr);
+    virtual void warm_memory(Context& ctx, W64 physaddr, bool is_icache,
+            bool is_write);
+    virtual void warm_branch(Context& ctx, int type, W64 branchaddr,
+            W64 target, W64 actual);
+    virtual W64 config_signature() const;
+    virtual void save_warm_state(WarmStateFile& ws);
+    virtual void load_warm_state(WarmStateFile& ws);
     void flush_all_pipelines();
     virtual void reset();
 	virtual void dump_configuration(ostream& os) const;
+	void emit_configuration(YAML::Emitter& out) const;
 	virtual void shutdown();
     virtual ~BaseMachine();
 
@@ -44,6 +44,9 @@ extern "C" {
 
 #include <ptl-qemu.h>
 #include <ptlsim.h>
+#include <sampling.h>
+#include <bbv.h>
+#include <warm-state.h>
 
 #include <cacheConstants.h>
 
@@ -412,6 +415,35 @@ int ptl_cpuid(uint32_t index, uint32_t count, uint32_t *eax, uint32_t *ebx,
     return 0;
 }
 
+/**
+ * @brief Save the warm state of the simulated machine next to checkpoint
+ * 'chk_name'
+ *
+ * Only done once simulation has started, before that the machine has no
+ * state to save.
+ */
+static void save_warm_state(const char* chk_name)
+{
+    PTLsimMachine* machine = PTLsimMachine::getcurrent();
+
+    if (!machine || !machine->initialized)
+        return;
+
+    stringbuf filename;
+    filename << config.warm_state_dir, "/", chk_name, ".warm";
+
+    WarmStateFile ws;
+    if (!ws.create(filename, machine->config_signature())) {
+        ptl_logfile << "Unable to create warm state file ", filename, endl;
+        return;
+    }
+
+    machine->save_warm_state(ws);
+    ws.close();
+
+    ptl_logfile << "Warm state saved to ", filename, endl;
+}
+
 void create_checkpoint(const char* chk_name)
 {
     if (!config.quiet)
@@ -423,6 +455,10 @@ void create_checkpoint(const char* chk_name)
                 qstring_from_str(chk_name)));
     do_savevm(cur_mon, checkpoint_dict);
 
+    if (config.warm_state_dir.set()) {
+        save_warm_state(chk_name);
+    }
+
     if (!config.quiet)
         cout << "MARSSx86::Checkpoint ", chk_name,
              " created\n";
@@ -943,7 +979,7 @@ int copy_from_user_phys_prechecked(void* target, Waddr source, int bytes, Waddr&
 void Context::propagate_x86_exception(byte exception, W32 errorcode , Waddr virtaddr ) {
     if(logable(2))
         ptl_logfile << "Propagating exception from simulation at eip: ",
-                    this->eip, " cycle: ", sim_cycle, endl;
+                    this->eip, " cycle: ", core_cycle(), endl;
     setup_qemu_switch_all_ctx(*this);
     ptl_stable_state = 1;
     handle_interrupt = 1;
@@ -1297,7 +1333,7 @@ bool Context::try_handle_fault(Waddr virtaddr, int store) {
 
 extern "C" void ptl_add_phys_memory_mapping(int8_t cpu_index, uint64_t host_vaddr, uint64_t guest_paddr)
 {
-  hvirt_gphys_maps[cpu_index][(Waddr)host_vaddr] = (Waddr)guest_paddr;
+  hvirt_gphys_map.add((Waddr)host_vaddr, (Waddr)guest_paddr);
 }
 
 void ptl_quit()
@@ -1414,25 +1450,87 @@ void read_simpoint_file()
     sort(simpoints.data, simpoints.size(), PointerSortComparator<Simpoint>());
 }
 
+/* Basic block vector profiling */
+
+uint8_t ptl_bbv_enabled = 0;
+static BBVProfiler bbv_profiler;
+
+static void init_bbv_profile()
+{
+    if (!bbv_profiler.open(config.bbv_file.buf, NUM_SIM_CORES,
+                config.simpoint_interval)) {
+        cerr << "Error: Unable to create bbv file: " <<
+            config.bbv_file << endl;
+        ptl_quit();
+        return;
+    }
+
+    ptl_logfile << "Writing basic block vectors of " <<
+        config.simpoint_interval << " instructions to " <<
+        config.bbv_file << endl;
+
+    ptl_bbv_enabled = 1;
+}
+
+void ptl_bbv_count(int cpu_index, uint64_t rip, int insns)
+{
+    bbv_profiler.add(cpu_index, rip, insns);
+}
+
+/**
+ * @brief Create the checkpoint of current simpoint and move to the next
+ *
+ * @param ctx CPU that reached the simpoint last
+ */
+static void simpoint_checkpoint(Context& ctx)
+{
+    stringbuf* chk_name = get_simpoint_chk_name();
+    create_checkpoint(chk_name->buf);
+
+    set_next_simpoint(&ctx);
+
+    delete chk_name;
+}
+
+/**
+ * @brief Set all CPUs to emulate up to the next simpoint
+ *
+ * @param ctx CPU that reached the last simpoint
+ *
+ * Simpoint intervals count the instructions of all CPUs, so the
+ * instructions to the next simpoint are split evenly between the CPUs
+ * and rebalanced, as in fast-forward, when a CPU halts. 'ctx' gets the
+ * remainder of the split.
+ */
 void set_next_simpoint(CPUX86State* ctx)
 {
     W64 point;
+    W64 insns;
 
     simpoint_ctr++;
 
     if (simpoint_ctr >= simpoints.size()) {
         simpoint_enabled = 0;
-        ctx->simpoint_decr = 0;
+        foreach (i, NUM_SIM_CORES) {
+            contextof(i).simpoint_decr = 0;
+        }
         return;
     }
 
     point = get_simpoint(simpoint_ctr) * config.simpoint_interval;
-    ctx->simpoint_decr = (point - total_simpoint_inst_complted);
+    insns = point - total_simpoint_inst_complted;
     total_simpoint_inst_complted = point;
-    tb_flush(ctx);
 
-    if (ctx->simpoint_decr == 0 && get_simpoint(simpoint_ctr) == 0) {
-        ptl_simpoint_reached(ENV_GET_CPU(ctx)->cpu_index);
+    foreach (i, NUM_SIM_CORES) {
+        Context& t_ctx = contextof(i);
+        t_ctx.simpoint_decr = insns / NUM_SIM_CORES;
+        tb_flush(&t_ctx);
+    }
+    ctx->simpoint_decr += insns % NUM_SIM_CORES;
+
+    /* First simpoint at the start, all CPUs are there already */
+    if (insns == 0 && get_simpoint(simpoint_ctr) == 0) {
+        simpoint_checkpoint(*ctx);
     }
 }
 
@@ -1448,12 +1546,9 @@ stringbuf* get_simpoint_chk_name()
 
 void init_simpoints()
 {
-    /* First check if we are simulating only one core or not */
-    if (NUM_SIM_CORES != 1) {
-        cerr << "ERROR: Marss doesnt support simpoints with more than " <<
-            "one CPU Context.  Please simulate with only one CPU.\n";
-        ptl_quit();
-    }
+    /* Called as each CPU Context is created */
+    if (simpoint_enabled)
+        return;
 
     read_simpoint_file();
     simpoint_enabled = 1;
@@ -1469,26 +1564,43 @@ uint8_t ptl_fast_fwd_enabled = 0;
 
 uint8_t sim_update_clock_offset = 1;
 
+/**
+ * @brief Flag to indicate if fast-fwd instructions warm the simulated
+ * caches and branch predictors
+ */
+uint8_t ptl_fast_fwd_warming = 0;
+
+/* Machine that is warmed, created on the first warming access */
+static PTLsimMachine* warm_machine = NULL;
+static W64 warm_mem_accesses = 0;
+static W64 warm_branches = 0;
+
 /**
  * @brief Set CPU's simpoint_decr count to fast-forward simulation mode
  */
 void set_cpu_fast_fwd()
 {
-    W64 fwd_insns;
-
-    if (config.fast_fwd_insns == 0 && config.fast_fwd_user_insns == 0)
-        return;
-
     if (config.fast_fwd_insns > 0) {
-        ptl_fast_fwd_enabled = 1;
-        fwd_insns = config.fast_fwd_insns;
+        set_cpu_fast_fwd_insns(config.fast_fwd_insns, 1);
     } else if (config.fast_fwd_user_insns > 0) {
-        ptl_fast_fwd_enabled = 2;
-        fwd_insns = config.fast_fwd_user_insns;
+        set_cpu_fast_fwd_insns(config.fast_fwd_user_insns, 2);
     }
+}
+
+/**
+ * @brief Fast-forward 'insns' instructions split evenly between all CPUs
+ *
+ * @param insns Number of instructions to emulate
+ * @param mode 1 to count all instructions, 2 for only user level
+ */
+void set_cpu_fast_fwd_insns(W64 insns, int mode)
+{
+    ptl_fast_fwd_enabled = mode;
+    ptl_fast_fwd_warming = config.fast_fwd_warm;
+    warm_mem_accesses = 0;
+    warm_branches = 0;
 
-    /* Set each CPU's counter specified from config.fast_fwd_insns */
-    W64 per_cpu_fast_fwd = fwd_insns / NUM_SIM_CORES;
+    W64 per_cpu_fast_fwd = insns / NUM_SIM_CORES;
 
     ptl_logfile << "All CPU context will be fast-forwared to " <<
         per_cpu_fast_fwd << " instructions.\n";
@@ -1500,6 +1612,52 @@ void set_cpu_fast_fwd()
     }
 }
 
+static PTLsimMachine* get_warm_machine()
+{
+    if unlikely (!warm_machine) {
+        warm_machine = setup_sim_machine();
+
+        /* No machine to warm, don't call us again */
+        if (!warm_machine)
+            ptl_fast_fwd_warming = 0;
+    }
+
+    return warm_machine;
+}
+
+/**
+ * @brief Functional warming of the memory hierarchy with a fast-forwarded
+ * access
+ */
+void ptl_warm_mem_access(int cpu_index, uint64_t paddr, int is_icache,
+        int is_write)
+{
+    PTLsimMachine* machine = get_warm_machine();
+
+    if unlikely (!machine)
+        return;
+
+    machine->warm_memory(contextof(cpu_index), paddr, is_icache, is_write);
+    warm_mem_accesses++;
+}
+
+/**
+ * @brief Functional warming of the branch predictor with a fast-forwarded
+ * branch
+ */
+void ptl_warm_branch(int cpu_index, int type, uint64_t ripafter,
+        uint64_t target, uint64_t actual)
+{
+    PTLsimMachine* machine = get_warm_machine();
+
+    if unlikely (!machine)
+        return;
+
+    machine->warm_branch(contextof(cpu_index), type, ripafter, target,
+            actual);
+    warm_branches++;
+}
+
 /**
  * @brief Allocate part of remaining instructions to specified CPU
  *
@@ -1544,12 +1702,14 @@ static void adjust_fwd_insts(Context& ctx)
 }
 
 /**
- * @brief CPU has emulated fast-fwd instructions, check if simulation point has
- * reached or not
+ * @brief CPU has emulated its share of instructions, check if all CPUs are
+ * done
  *
  * @param ctx CPU Context that finished emulating its allocated instructions
+ *
+ * @return true when all CPUs are stopped or halted, they are left stopped
  */
-static void cpu_fast_fwded(Context& ctx)
+static bool all_cpus_fast_fwded(Context& ctx)
 {
     bool all_halted_or_stopped = true;
     bool others_halted = false;
@@ -1585,38 +1745,64 @@ static void cpu_fast_fwded(Context& ctx)
                     ctx.simpoint_decr << " instructions\n";
             }
             ENV_GET_CPU(&ctx)->stopped = 0;
-            return;
+            return false;
         }
     }
 
-    /* If all CPU's are stopped then issue -run to start simulation */
-    if (all_halted_or_stopped) {
-
-        /* If we still have any instrucitons remaining then print message
-         * to logfile indicating that we are switching to simulation
-         * earlier than expected. */
-        if (insns_remaining > 1000) {
-			/* Restore this counter for debugging only */
-			ctx.simpoint_decr = insns_remaining;
-
-            ptl_logfile << "WARNING: Early switching to simulation mode. ";
-            ptl_logfile << "Instrucitons remaining in each CPU context to fast-forward are:\n";
-
-            foreach (i, NUM_SIM_CORES) {
-                ptl_logfile << "\tCPU " << (int)i << ": " <<
-                    (int)(contextof(i).simpoint_decr) << "\n";
-                contextof(i).simpoint_decr = 0;
-            }
+    if (!all_halted_or_stopped)
+        return false;
+
+    /* If we still have any instrucitons remaining then print message
+     * to logfile indicating that we are stopping earlier than expected. */
+    if (insns_remaining > 1000) {
+        /* Restore this counter for debugging only */
+        ctx.simpoint_decr = insns_remaining;
+
+        ptl_logfile << "WARNING: Early end of fast-forward. ";
+        ptl_logfile << "Instrucitons remaining in each CPU context to fast-forward are:\n";
+
+        foreach (i, NUM_SIM_CORES) {
+            ptl_logfile << "\tCPU " << (int)i << ": " <<
+                (int)(contextof(i).simpoint_decr) << "\n";
+            contextof(i).simpoint_decr = 0;
         }
+    }
+
+    return true;
+}
+
+static void resume_fast_fwded_cpus()
+{
+    foreach (i, NUM_SIM_CORES) {
+        ENV_GET_CPU(&contextof(i))->stopped = 0;
+        tb_flush(&contextof(i));
+    }
+}
+
+/**
+ * @brief CPU has emulated fast-fwd instructions, check if simulation point has
+ * reached or not
+ *
+ * @param ctx CPU Context that finished emulating its allocated instructions
+ */
+static void cpu_fast_fwded(Context& ctx)
+{
+    /* If all CPU's are stopped then issue -run to start simulation */
+    if (all_cpus_fast_fwded(ctx)) {
 
         ptl_fast_fwd_enabled = 0;
 
-        foreach (i, NUM_SIM_CORES) {
-            ENV_GET_CPU(&contextof(i))->stopped = 0;
-            tb_flush(&contextof(i));
+        if (ptl_fast_fwd_warming) {
+            ptl_fast_fwd_warming = 0;
+            ptl_logfile << "Fast-forward warmed caches with " <<
+                warm_mem_accesses << " accesses and branch predictors with "
+                << warm_branches << " branches\n";
         }
 
-        if (config.fast_fwd_checkpoint.size() > 0) {
+        resume_fast_fwded_cpus();
+
+        if (config.fast_fwd_checkpoint.size() > 0 &&
+                !sampling.fast_forwarding()) {
             create_checkpoint(config.fast_fwd_checkpoint.buf);
             ptl_quit();
         } else {
@@ -1640,15 +1826,17 @@ void ptl_simpoint_reached(int cpuid)
 
     if (simpoint_enabled) {
 
-        stringbuf* chk_name = get_simpoint_chk_name();
-        create_checkpoint(chk_name->buf);
-
-        set_next_simpoint(&ctx);
+        /* With more than one CPU, wait for all of them to emulate their
+         * share of the interval */
+        if (!all_cpus_fast_fwded(ctx))
+            return;
 
-        delete chk_name;
+        resume_fast_fwded_cpus();
+        simpoint_checkpoint(ctx);
     }
 
-    if (config.fast_fwd_insns > 0 || config.fast_fwd_user_insns > 0) {
+    if (config.fast_fwd_insns > 0 || config.fast_fwd_user_insns > 0 ||
+            sampling.fast_forwarding()) {
         cpu_fast_fwded(ctx);
     }
 }
@@ -1670,6 +1858,10 @@ void ptl_qemu_initialized(void)
         set_next_simpoint(&contextof(0));
     }
 
+    if (config.bbv_file.set()) {
+        init_bbv_profile();
+    }
+
     set_cpu_fast_fwd();
 
     if (config.run) {
@@ -174,7 +174,8 @@ int ptl_cpuid(uint32_t index, uint32_t count, uint32_t *eax, uint32_t *ebx,
  * ptl_flush_bbcache
  * context_id	: ID of the context of which the BasicBlockCache will be
  *				  flushed
- * working		: Flush all the decoded cache on tlb flush
+ * working		: On tlb flush, mark the decoded blocks of this context to be
+ *				  revalidated before their next use
  */
 void ptl_flush_bbcache(int8_t context_id);
 
@@ -240,6 +241,23 @@ void init_simpoints(void);
  */
 void set_next_simpoint(CPUX86State* ctx);
 
+/**
+ * @brief Indicate if emulated basic blocks are profiled ('-bbv')
+ *
+ * When set, QEMU calls ptl_bbv_count() after each translation block it
+ * executes.
+ */
+extern uint8_t ptl_bbv_enabled;
+
+/**
+ * @brief Count an executed basic block in the basic block vectors
+ *
+ * @param cpu_index CPU that executed the block
+ * @param rip Start address of the block
+ * @param insns Number of instructions in the block
+ */
+void ptl_bbv_count(int cpu_index, uint64_t rip, int insns);
+
 /**
  * @brief Indicate if Emualtion mode is running in fast-fwd mode or not
  *
@@ -254,6 +272,44 @@ extern uint8_t ptl_fast_fwd_enabled;
  */
 void set_cpu_fast_fwd(void);
 
+/**
+ * @brief Fast-forward given number of instructions, split between all CPU
+ * Contexts, before switching back to simulation mode
+ */
+void set_cpu_fast_fwd_insns(W64 insns, int mode);
+
+/**
+ * @brief Indicate if fast-forwarded instructions warm the simulated caches
+ * and branch predictors ('-fast-fwd-warm')
+ *
+ * When set, the softmmu load/store/fetch helpers call ptl_warm_mem_access()
+ * and the branch helpers call ptl_warm_branch().
+ */
+extern uint8_t ptl_fast_fwd_warming;
+
+/**
+ * @brief Access of a fast-forwarded instruction to physical address 'paddr'
+ *
+ * @param cpu_index CPU that made the access
+ * @param paddr Guest physical address
+ * @param is_icache 1 for instruction fetch
+ * @param is_write 1 for store
+ */
+void ptl_warm_mem_access(int cpu_index, uint64_t paddr, int is_icache,
+        int is_write);
+
+/**
+ * @brief Branch executed by a fast-forwarded instruction
+ *
+ * @param cpu_index CPU that executed the branch
+ * @param type BRANCH_HINT_* bits of the branch
+ * @param ripafter Address of the instruction after the branch
+ * @param target Target when taken
+ * @param actual Address of the next executed instruction
+ */
+void ptl_warm_branch(int cpu_index, int type, uint64_t ripafter,
+        uint64_t target, uint64_t actual);
+
 /**
  * @brief Initialize simulator structures after QEMU's initialization
  *
@@ -17,8 +17,7 @@
 #include <netinet/in.h>
 #include <errno.h>
 #include <sys/types.h>
-#include <sys/ipc.h>
-#include <sys/sem.h>
+#include <sys/wait.h>
 
 #include <bson/bson.h>
 #include <bson/mongo.h>
@@ -29,6 +28,12 @@
 #include <fstream>
 #include <syscalls.h>
 #include <ptl-qemu.h>
+#include <sync-barrier.h>
+#include <sampling.h>
+#include <warm-state.h>
+#include <host-profile.h>
+#include <memoryTrace.h>
+#include <trafficGenerator.h>
 
 #include <test.h>
 /*
@@ -79,6 +84,7 @@ ofstream *time_stats_file;
 #endif
 
 static void sync_remove();
+static SyncBarrier sync_barrier;
 static void kill_simulation();
 static void write_mongo_stats();
 static void setup_sim_stats();
@@ -134,14 +140,58 @@ struct SimStats : public Statable
         { }
     } performance;
 
+    struct sync : public Statable
+    {
+        StatObj<W64> barriers;
+        StatObj<W64> wait_usecs;
+        StatObj<W64> max_wait_usecs;
+        StatObj<W64> departed;
+
+        sync(Statable *parent)
+            : Statable("sync", parent)
+              , barriers("barriers", this)
+              , wait_usecs("wait_usecs", this)
+              , max_wait_usecs("max_wait_usecs", this)
+              , departed("departed", this)
+        { }
+    } sync;
+
+    struct sampling : public Statable
+    {
+        StatObj<W64> windows;
+        StatObj<W64> measured_insns;
+        StatObj<W64> measured_cycles;
+        StatObj<W64> warmup_insns;
+        StatObj<W64> fast_forward_insns;
+        StatEquation<W64, double, StatObjFormulaDiv> cpi;
+
+        sampling(Statable *parent)
+            : Statable("sampling", parent)
+              , windows("windows", this)
+              , measured_insns("measured_insns", this)
+              , measured_cycles("measured_cycles", this)
+              , warmup_insns("warmup_insns", this)
+              , fast_forward_insns("fast_forward_insns", this)
+              , cpi("cpi", this)
+        {
+            cpi.add_elem(&measured_cycles);
+            cpi.add_elem(&measured_insns);
+        }
+    } sampling;
+
     StatString tags;
 
+    HostProfileStats host_profile;
+
     SimStats()
         : Statable("simulator")
           , version(this)
           , run(this)
           , performance(this)
+          , sync(this)
+          , sampling(this)
           , tags("tags", this)
+          , host_profile(this)
     {
         tags.set_split(",");
     }
@@ -180,11 +230,15 @@ void ConfigurationParser<PTLsimConfig>::reset() {
   snapshot_now.reset();
   time_stats_logfile = "";
   time_stats_period = 10000;
+  time_stats_format = "text";
 
   start_at_rip = INVALIDRIP;
   fast_fwd_insns = 0;
   fast_fwd_user_insns = 0;
   fast_fwd_checkpoint = "";
+  fast_fwd_warm = 0;
+  warm_state_dir = "";
+  warm_state_file = "";
 
   // memory model
   use_memory_model = 0;
@@ -210,12 +264,29 @@ void ConfigurationParser<PTLsimConfig>::reset() {
   dumpcode_filename = "test.dat";
   dump_at_end = 0;
   bbcache_dump_filename.reset();
+  shared_bbcache = 0;
+  bbcache_store_filename.reset();
+  bbcache_store_size = 256;
 
   machine_config = "";
+  parallel_quantum = 0;
+  parallel_reference = "";
+  skip_idle_cycles = 0;
+  park_halted_cores = 0;
 
   ///
   /// memory hierarchy implementation
   ///
+  mem_request_history = 0;
+  cache_config.reset();
+  mem_trace_file = "";
+  mem_trace_replay = "";
+  traffic_pattern = "";
+  traffic_requests = 1000000;
+  traffic_footprint = 4*1024*1024;
+  traffic_write_percent = 30;
+  traffic_outstanding = 8;
+  traffic_seed = 1;
 
   checker_enabled = 0;
   checker_start_rip = INVALIDRIP;
@@ -235,11 +306,23 @@ void ConfigurationParser<PTLsimConfig>::reset() {
 
   // Sync Options
   sync_interval = 0;
+  sync_group = "";
 
   // Simpoint options
   simpoint_file = "";
   simpoint_interval = 10e6;
   simpoint_chk_name = "simpoint";
+  bbv_file = "";
+
+  sweep_file = "";
+  sweep_jobs = 0;
+
+  sampling_period = 0;
+  sampling_warmup = 100000;
+  sampling_window = 10000;
+  sampling_min_windows = 30;
+  sampling_error = 0.03;
+  sampling_confidence = 0.997;
 }
 
 template <>
@@ -276,11 +359,15 @@ void ConfigurationParser<PTLsimConfig>::setup() {
   add(snapshot_now,                 "snapshot-now",         "Take statistical snapshot immediately, using specified name");
   add(time_stats_logfile,           "time-stats-logfile",   "File to write time-series statistics (new)");
   add(time_stats_period,            "time-stats-period",    "Frequency of capturing time-stats (in cycles)");
+  add(time_stats_format,            "time-stats-format",    "Time-stats file format: text (CSV) or binary (read with util/mstats.py)");
   section("Trace Start/Stop Point");
   add(start_at_rip,                 "startrip",             "Start at rip <startrip>");
   add(fast_fwd_insns,               "fast-fwd-insns",       "Fast Fwd each CPU by <N> instructions");
   add(fast_fwd_user_insns,          "fast-fwd-user-insns",  "Fast Fwd each CPU by <N> user level instructions");
   add(fast_fwd_checkpoint,          "fast-fwd-checkpoint",  "Create a checkpoint <chk-name> after fast-forwarding");
+  add(fast_fwd_warm,                "fast-fwd-warm",        "Warm caches and branch predictors while fast-forwarding");
+  add(warm_state_dir,               "warm-state-dir",       "Save caches, directory, branch predictors and TLBs to <dir>/<chk-name>.warm with each checkpoint created after simulation started");
+  add(warm_state_file,              "load-warm-state",      "Restore caches, directory, branch predictors and TLBs from <file> when simulation starts");
   add(stop_at_insns,                "stopinsns",            "Stop after executing <stopinsns> user instructions");
   add(stop_at_cycle,                "stopcycle",            "Stop after <stop> cycles");
   add(stop_at_iteration,            "stopiter",             "Stop after <stop> iterations (does not apply to cycle-accurate cores)");
@@ -310,11 +397,18 @@ void ConfigurationParser<PTLsimConfig>::setup() {
   add(dumpcode_filename,            "dumpcode",             "Save page of user code at final rip to file <dumpcode>");
   add(dump_at_end,                  "dump-at-end",          "Set breakpoint and dump core before first instruction executed on return to native mode");
   add(bbcache_dump_filename,        "bbdump",               "Basic block cache dump filename");
+  add(shared_bbcache,               "shared-bbcache",       "Share one decoded basic block cache between all cores");
+  add(bbcache_store_filename,       "bbcache-store",        "Keep translated basic blocks in this file across runs");
+  add(bbcache_store_size,           "bbcache-store-size",   "Size in MB of a new basic block store file");
 
  add(verify_cache,               "verify-cache",                   "run simulation with storing actual data in cache");
 
   section("Core Configuration");
   add(machine_config, "machine", "Name of machine configuration to simulate");
+  add(parallel_quantum, "parallel-quantum", "Simulate each core and its L1 caches on its own host thread for <N> cycles, then service L1 misses and IO (0 for serial)");
+  add(parallel_reference, "parallel-reference", "Per-core commits every time-stats-period cycles: written by a serial run, compared against by a parallel run");
+  add(skip_idle_cycles, "skip-idle", "Skip cycles in which all cores only wait for the memory hierarchy");
+  add(park_halted_cores, "park-halted", "Stop clocking cores whose threads are all halted until an interrupt arrives");
 
  ///
  /// following are for the new memory hierarchy implementation:
@@ -322,6 +416,16 @@ void ConfigurationParser<PTLsimConfig>::setup() {
 
   section("Memory Hierarchy Configuration");
   //  add(memory_log,               "memory-log",               "log memory debugging info");
+  add(mem_request_history,      "mem-request-history",      "Record path of each memory request (needs ENABLE_MEM_REQUEST_HISTORY)");
+  add(cache_config,             "cache-config",             "Override cache geometry: <name prefix>:size=<S>:assoc=<N>:line_size=<N>:latency=<N>[,...]");
+  add(mem_trace_file,           "mem-trace",                "Write a binary trace of all core requests to the memory hierarchy to <file>");
+  add(mem_trace_replay,         "mem-trace-replay",         "Replay the memory trace <file> through the caches of the machine, without running the cores, then quit");
+  add(traffic_pattern,          "traffic",                  "Drive the caches of the machine with synthetic agents instead of the cores, then quit: stream, random, chase, prodcons or falseshare");
+  add(traffic_requests,         "traffic-requests",         "Requests sent by each traffic agent");
+  add(traffic_footprint,        "traffic-footprint",        "Bytes touched by each traffic agent (per pair for prodcons)");
+  add(traffic_write_percent,    "traffic-write-percent",    "Percent of traffic requests that are writes (prodcons: producers write, consumers read)");
+  add(traffic_outstanding,      "traffic-outstanding",      "Requests each traffic agent keeps in flight (chase: always 1)");
+  add(traffic_seed,             "traffic-seed",             "Seed of the random traffic patterns");
 
   // MongoDB
   section("bus configuration");
@@ -341,11 +445,25 @@ void ConfigurationParser<PTLsimConfig>::setup() {
 
   section("Synchronization Options");
   add(sync_interval, "sync", "Number of simulation cycles between synchronization");
+  add(sync_group, "sync-group", "Name of the group of simulation instances to synchronize with");
 
   section("Simpoint Options");
   add(simpoint_file, "simpoint", "Create simpoint based checkpoints from given 'simpoint' file");
   add(simpoint_interval, "simpoint-interval", "Number of instructions in each interval");
   add(simpoint_chk_name, "simpoint-chk-name", "Checkpoint name prefix");
+  add(bbv_file, "bbv", "Write basic block vectors of each 'simpoint-interval' emulated instructions to <file>");
+
+  section("Sweep Options");
+  add(sweep_file, "sweep", "Fork one child per line of <file> at the start of simulation, each line holds simconfig options of one configuration");
+  add(sweep_jobs, "sweep-jobs", "Maximum number of sweep children running at once (0 for all)");
+
+  section("Statistical Sampling");
+  add(sampling_period, "sampling-period", "Simulate one sample every <n> instructions and fast-forward the rest (0 to disable)");
+  add(sampling_warmup, "sampling-warmup", "Detailed instructions simulated before each sample to warm up the machine state");
+  add(sampling_window, "sampling-window", "Instructions measured in each sample");
+  add(sampling_min_windows, "sampling-min-windows", "Minimum number of samples before stopping");
+  add(sampling_error, "sampling-error", "Stop when the CPI confidence interval is within this fraction of the mean");
+  add(sampling_confidence, "sampling-confidence", "Confidence level of the CPI interval");
 };
 
 #ifndef CONFIG_ONLY
@@ -490,6 +608,8 @@ void dump_text_stats()
 
 static void flush_stats()
 {
+    host_profile_scope(HPROF_STATS);
+
     if(config.screenshot_file.set()) {
         qemu_take_screenshot((char*)config.screenshot_file);
     }
@@ -498,6 +618,10 @@ static void flush_stats()
     assert(machine);
     machine->update_stats();
 
+    BaseMachine* base_machine = (BaseMachine*)machine;
+    if(base_machine->memoryHierarchyPtr)
+        base_machine->memoryHierarchyPtr->flush_trace();
+
     // Call this function to setup tags and other info
     setup_sim_stats();
 
@@ -674,78 +798,33 @@ if ((config.loglevel > 0) & (config.start_log_at_rip == INVALIDRIP) & (config.st
   return true;
 }
 
-/* Synchronization Support using SystemV Semaphores */
-const int SEM_ID = 3764;
-static int sem_id = -1;
-
-static void sync_op(W16 op)
-{
-    int rc;
-    sembuf sem_op;
-
-    sem_op.sem_num = 0;
-    sem_op.sem_op = op;
-    sem_op.sem_flg = 0;
-
-    while ((rc = semop(sem_id, &sem_op, 1)) == -1) {
-        if (errno != EINTR && errno != EIDRM) {
-            ptl_logfile << "Error in op " << op << " is: ";
-            switch (errno) {
-                case EACCES: ptl_logfile << "Access\n"; break;
-                case EEXIST: ptl_logfile << "Exists\n"; break;
-                case EINVAL: ptl_logfile << "Invalid\n"; break;
-                case ENOENT: ptl_logfile << "NoEnt\n"; break;
-                case ENOMEM: ptl_logfile << "NoMem\n"; break;
-                case ENOSPC: ptl_logfile << "NoSPC\n"; break;
-            }
-            ptl_logfile << flush;
-        }
-        if (errno == EIDRM) {
-            /* Semaphore is removed, so kill simulation */
-            flush_stats();
-            kill_simulation();
-        }
-    }
-}
-
-static void sync_set_sem()
-{
-    sync_op(1);
-}
+/* Synchronization Support using a shared memory barrier */
 
 static void sync_setup()
 {
-    /* First we will try to create a new semaphore if it fails
-     * then some other simulation process has already setup the
-     * semaphore and it will act as Master */
-
-    int env_sem_id = -1;
-    char *env_sem_id_p;
-
-    env_sem_id_p = getenv("MARSS_SEM_ID");
+    /*
+     * All instances with the same sync group run in lockstep. The group
+     * name comes from -sync-group, or MARSS_SYNC_GROUP when not given.
+     */
+    stringbuf group;
+
+    if (config.sync_group.set()) {
+        group << config.sync_group;
+    } else if (getenv("MARSS_SYNC_GROUP")) {
+        group << getenv("MARSS_SYNC_GROUP");
+    } else {
+        group << "default";
+    }
 
-    if (env_sem_id_p)
-        env_sem_id = atoi(env_sem_id_p);
-    else
-        env_sem_id = SEM_ID;
-
-    sem_id = semget(env_sem_id, 1, IPC_CREAT | 0666);
-
-    if (sem_id == -1) {
-        ptl_logfile << "Sempahore setup error: ";
-        switch (errno) {
-            case EACCES: ptl_logfile << "Access\n"; break;
-            case EEXIST: ptl_logfile << "Exists\n"; break;
-            case EINVAL: ptl_logfile << "Invalid\n"; break;
-            case ENOENT: ptl_logfile << "NoEnt\n"; break;
-            case ENOMEM: ptl_logfile << "NoMem\n"; break;
-            case ENOSPC: ptl_logfile << "NoSPC\n"; break;
-        }
-        ptl_logfile << flush;
+    if (!sync_barrier.join(group)) {
+        ptl_logfile << "Unable to join sync group ", group, ": ",
+                    strerror(errno), endl, flush;
         kill_simulation();
+        return;
     }
 
-    sync_set_sem();
+    ptl_logfile << "Joined sync group ", group, " with ",
+                sync_barrier.participants(), " participants", endl;
 }
 
 static void sync_wait()
@@ -757,21 +836,23 @@ static void sync_wait()
 
     last_sync_cycle = sim_cycle;
 
-    /* Decrement semaphore */
-    sync_op(-1);
-
-    /* Now wait for all prcoesses to reach to semaphore */
-    sync_op(0);
-
-    sync_set_sem();
+    if (!sync_barrier.wait()) {
+        /* Group is removed by sync_helper, so kill simulation */
+        ptl_logfile << "Sync group removed, stopping simulation", endl;
+        flush_stats();
+        kill_simulation();
+    }
 }
 
 static void sync_remove()
 {
-    /* We allow any simulation instance to remove the semaphore
-     * so that other instances will kill themselves */
-    if (sem_id != -1)
-        semctl(sem_id, 0, IPC_RMID);
+    /* Other instances keep running without this one */
+    sync_barrier.leave();
+}
+
+static void sync_detach()
+{
+    sync_barrier.detach();
 }
 
 Hashtable<const char*, PTLsimMachine*, 1>* machinetable = NULL;
@@ -782,6 +863,11 @@ void PTLsimMachine::update_stats() { return; }
 void PTLsimMachine::dump_state(ostream& os) { return; }
 void PTLsimMachine::flush_tlb(Context& ctx) { return; }
 void PTLsimMachine::flush_tlb_virt(Context& ctx, Waddr virtaddr) { return; }
+void PTLsimMachine::warm_memory(Context& ctx, W64 physaddr, bool is_icache, bool is_write) { return; }
+void PTLsimMachine::warm_branch(Context& ctx, int type, W64 branchaddr, W64 target, W64 actual) { return; }
+W64 PTLsimMachine::config_signature() const { return 0; }
+void PTLsimMachine::save_warm_state(WarmStateFile& ws) { return; }
+void PTLsimMachine::load_warm_state(WarmStateFile& ws) { return; }
 void PTLsimMachine::dump_configuration(ostream& os) const { return; }
 
 void PTLsimMachine::addmachine(const char* name, PTLsimMachine* machine) {
@@ -831,7 +917,7 @@ void ptl_reconfigure(const char* config_str) {
 
 	ptl_logfile << "Configuration changed: " << config << endl;
 
-    if (config.sync_interval && sem_id == -1) {
+    if (config.sync_interval && !sync_barrier.joined()) {
         sync_setup();
     }
 
@@ -889,8 +975,15 @@ extern "C" void ptl_machine_configure(const char* config_str_) {
         // time based stats
         if (config.time_stats_logfile.length > 0)
         {
-            time_stats_file = new ofstream(config.time_stats_logfile.buf);
-            builder.init_timer_stats();
+            bool binary = (config.time_stats_format == "binary");
+
+            if (!binary && config.time_stats_format != "text")
+                ptl_logfile << "Unknown time-stats format: " <<
+                    config.time_stats_format << " using text format." << endl;
+
+            time_stats_file = new ofstream(config.time_stats_logfile.buf,
+                    binary ? std::ios::out | std::ios::binary : std::ios::out);
+            builder.init_timer_stats(binary);
         } else {
             time_stats_file = NULL;
         }
@@ -1065,6 +1158,8 @@ void compare_checker(W8 context_id, W64 flagmask) {
 }
 
 void setup_qemu_switch_all_ctx(Context& last_ctx) {
+    host_profile_scope(HPROF_QEMU_SWITCH);
+
 	foreach(c, contextcount) {
 		Context& ctx = contextof(c);
 		if(&ctx != &last_ctx)
@@ -1076,6 +1171,8 @@ void setup_qemu_switch_all_ctx(Context& last_ctx) {
 }
 
 void setup_qemu_switch_except_ctx(const Context& const_ctx) {
+    host_profile_scope(HPROF_QEMU_SWITCH);
+
 	foreach(c, contextcount) {
 		Context& ctx = contextof(c);
 		if(&ctx != &const_ctx)
@@ -1084,6 +1181,8 @@ void setup_qemu_switch_except_ctx(const Context& const_ctx) {
 }
 
 void setup_ptlsim_switch_all_ctx(Context& last_ctx) {
+    host_profile_scope(HPROF_QEMU_SWITCH);
+
 	foreach(c, contextcount) {
 		Context& ctx = contextof(c);
 		if(&ctx != &last_ctx)
@@ -1177,7 +1276,17 @@ static void set_run_stats()
     simstats.set_default_stats(stat); \
     simstats.run.seconds = seconds; \
     simstats.performance.cycles_per_sec = cycles_per_sec; \
-    simstats.performance.commits_per_sec = commits_per_sec;
+    simstats.performance.commits_per_sec = commits_per_sec; \
+    simstats.sync.barriers = sync_barrier.barriers; \
+    simstats.sync.wait_usecs = sync_barrier.wait_ns / 1000; \
+    simstats.sync.max_wait_usecs = sync_barrier.max_wait_ns / 1000; \
+    simstats.sync.departed = sync_barrier.departed; \
+    simstats.sampling.windows = sampling.windows; \
+    simstats.sampling.measured_insns = sampling.measured_insns; \
+    simstats.sampling.measured_cycles = sampling.measured_cycles; \
+    simstats.sampling.warmup_insns = sampling.warmup_insns; \
+    simstats.sampling.fast_forward_insns = sampling.fast_forward_insns; \
+    simstats.host_profile.update(host_profile);
 
     RUN_STAT(user_stats);
     RUN_STAT(kernel_stats);
@@ -1260,7 +1369,229 @@ static void dump_machine_configuration(PTLsimMachine *machine)
 	}
 }
 
-extern "C" uint8_t ptl_simulate() {
+/* Sweep Support: simulate many configurations from one checkpoint */
+
+/**
+ * @brief Read sweep configurations, one line of simconfig options each
+ *
+ * Empty lines and lines starting with '#' are skipped.
+ */
+static void read_sweep_file(dynarray<stringbuf*>& sweep)
+{
+    stringbuf line;
+    ifstream is(config.sweep_file);
+
+    if (!is) {
+        cerr << "Error: Unable to read sweep file: " <<
+            config.sweep_file << endl;
+        return;
+    }
+
+    while (1) {
+        line.reset(4096);
+        is.getline(line.buf, line.length);
+        if (!is) break;
+
+        char* options = line.buf;
+        while (*options == ' ' || *options == '\t') options++;
+
+        if (*options == '\0' || *options == '#')
+            continue;
+
+        stringbuf* entry = new stringbuf();
+        *entry << options;
+        sweep.push(entry);
+    }
+
+    is.close();
+}
+
+/**
+ * @brief Reconfigure a sweep child with its own options and output files
+ *
+ * @param id Index of the configuration in the sweep file
+ * @param options simconfig options of this configuration
+ *
+ * Log, stats and time-stats files get a '.<id>' suffix so children never
+ * share an output file. Options of the sweep line are applied last and can
+ * override them.
+ */
+static void setup_sweep_child(int id, const stringbuf& options)
+{
+    stringbuf child_config;
+
+    config.sweep_file.reset();
+    config.kill_after_run = 1;
+
+    /* Children must not use the barrier slot of the parent */
+    sync_detach();
+    config.sync_interval = 0;
+
+    if (config.log_filename.set())
+        child_config << "-logfile " << config.log_filename << "." << id << " ";
+
+    if (config.stats_filename.set())
+        child_config << "-stats " << config.stats_filename << "." << id << " ";
+    else if (config.yaml_stats_filename.set())
+        child_config << "-yamlstats " << config.yaml_stats_filename << "." <<
+            id << " ";
+
+    if (time_stats_file) {
+        stringbuf time_stats_name;
+        time_stats_name << config.time_stats_logfile << "." << id;
+
+        bool binary = (config.time_stats_format == "binary");
+        time_stats_file->close();
+        delete time_stats_file;
+        time_stats_file = new ofstream(time_stats_name.buf,
+                binary ? std::ios::out | std::ios::binary : std::ios::out);
+    }
+
+    child_config << options;
+
+    ptl_reconfigure(child_config);
+
+    ptl_logfile << "Sweep configuration ", id, ": ", options, endl, flush;
+}
+
+/**
+ * @brief Wait for one sweep child to finish
+ *
+ * @return true if the child exited normally with status 0
+ */
+static bool wait_sweep_child()
+{
+    int status;
+    pid_t pid;
+
+    while ((pid = waitpid(-1, &status, 0)) == -1 && errno == EINTR) ;
+
+    if (pid == -1)
+        return false;
+
+    bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+    ptl_logfile << "Sweep child ", pid, (ok ? " finished" : " failed"),
+                " (status ", status, ")", endl, flush;
+
+    return ok;
+}
+
+/**
+ * @brief Fork one child per sweep configuration
+ *
+ * Called at the start of the first simulation run, after the checkpoint is
+ * restored and before any machine is built. Each child shares the guest
+ * memory image with the parent copy-on-write, reconfigures itself with its
+ * sweep line and simulates. The parent only waits for the children and then
+ * quits.
+ *
+ * Note that children share the open disk image of the parent, so the
+ * simulated region must not write to the guest disk.
+ *
+ * @return true in a child that should simulate, false in the parent
+ */
+static bool run_sweep()
+{
+    dynarray<stringbuf*> sweep;
+    int running = 0;
+    int failed = 0;
+    bool child = false;
+
+    read_sweep_file(sweep);
+
+    int jobs = config.sweep_jobs ? (int)config.sweep_jobs : sweep.count();
+
+    ptl_logfile << "Sweeping ", sweep.count(), " configurations from ",
+                config.sweep_file, " with up to ", jobs, " children", endl;
+
+    foreach (i, sweep.count()) {
+        if (running == jobs) {
+            failed += !wait_sweep_child();
+            running--;
+        }
+
+        /* Flush buffered output so children don't write it again */
+        ptl_logfile << flush;
+        cerr << flush;
+
+        pid_t pid = fork();
+
+        if (pid == 0) {
+            setup_sweep_child(i, *sweep[i]);
+            child = true;
+            break;
+        }
+
+        if (pid < 0) {
+            ptl_logfile << "Unable to fork sweep configuration ", i, ": ",
+                        strerror(errno), endl;
+            failed++;
+            continue;
+        }
+
+        running++;
+    }
+
+    if (!child) {
+        while (running > 0) {
+            failed += !wait_sweep_child();
+            running--;
+        }
+
+        stringbuf sb;
+        sb << "Sweep completed: " << sweep.count() << " configurations, " <<
+            failed << " failed" << endl;
+        ptl_logfile << sb << flush;
+        cerr << sb << flush;
+    }
+
+    foreach (i, sweep.count()) {
+        delete sweep[i];
+    }
+
+    if (!child) {
+        config.sweep_file.reset();
+        ptl_quit();
+    }
+
+    return child;
+}
+
+/**
+ * @brief Restore the warm state saved with the checkpoint we start from
+ */
+static void load_warm_state(PTLsimMachine* machine)
+{
+	WarmStateFile ws;
+
+	if (!ws.open(config.warm_state_file, machine->config_signature())) {
+		ptl_logfile << "Warm state ", config.warm_state_file,
+					" not loaded: missing or saved from a different ",
+					"machine configuration", endl;
+		cerr << "Warm state ", config.warm_state_file,
+			 " not loaded: missing or saved from a different ",
+			 "machine configuration", endl;
+		return;
+	}
+
+	machine->load_warm_state(ws);
+
+	ptl_logfile << "Warm state ", config.warm_state_file, ": ",
+				ws.get_restored(), " structures restored, ",
+				ws.get_skipped(), " skipped", endl;
+}
+
+/**
+ * @brief Find the configured machine and initialize it on first use
+ *
+ * Called when simulation starts, and by functional warming which needs
+ * the caches and branch predictors while QEMU fast-forwards.
+ *
+ * @return The machine, NULL if it can not be used
+ */
+PTLsimMachine* setup_sim_machine()
+{
 	PTLsimMachine* machine = NULL;
 	char* machinename = config.core_name;
 	if likely (curr_ptl_machine != NULL) {
@@ -1272,20 +1603,15 @@ extern "C" uint8_t ptl_simulate() {
 	if (!machine) {
 		ptl_logfile << "Cannot find core named '" << machinename << "'" << endl;
 		cerr << "Cannot find core named '" << machinename << "'" << endl;
-		return 0;
+		return NULL;
 	}
 
-    // If config.run_tests is enabled, then run testcases
-    if(config.run_tests) {
-        run_tests();
-    }
-
 	if (!machine->initialized) {
 		ptl_logfile << "Initializing core '" << machinename << "'" << endl;
 		if (!machine->init(config)) {
 			ptl_logfile << "Cannot initialize simulation machine; check the configuration!" << endl;
             config.run = 0;
-			return 0;
+			return NULL;
 		}
 		machine->initialized = 1;
 		machine->first_run = 1;
@@ -1300,6 +1626,10 @@ extern "C" uint8_t ptl_simulate() {
 		/* Dump Machine configuration */
 		dump_machine_configuration(machine);
 
+		if (config.warm_state_file.set()) {
+			load_warm_state(machine);
+		}
+
 		/* Update stats every half second: */
 		ticks_per_update = seconds_to_native_ticks(0.2);
 		last_printed_status_at_ticks = 0;
@@ -1336,6 +1666,133 @@ extern "C" uint8_t ptl_simulate() {
         }
 	}
 
+	return machine;
+}
+
+/**
+ * @brief Stream the requests of a memory trace through the caches of the
+ * machine instead of simulating the guest, dump the stats and quit
+ */
+static void replay_mem_trace(PTLsimMachine* machine)
+{
+    BaseMachine* base_machine = (BaseMachine*)machine;
+    Memory::MemoryTraceReader trace;
+
+    if (!trace.open(config.mem_trace_replay)) {
+        cerr << "Unable to read memory trace ", config.mem_trace_replay, endl;
+        ptl_logfile << "Unable to read memory trace ", config.mem_trace_replay, endl;
+        config.kill = true;
+        kill_simulation();
+        return;
+    }
+
+    W64 tsc_at_replay = rdtsc();
+    W64 requests;
+    {
+        host_profile_scope(HPROF_SIMULATION);
+        requests = Memory::replay_memory_trace(
+                *base_machine->memoryHierarchyPtr, trace);
+    }
+    double seconds = ticks_to_native_seconds(rdtsc() - tsc_at_replay);
+
+    stringbuf sb;
+    sb << endl, "Replayed ", requests, " memory requests in ", sim_cycle,
+       " cycles and ", seconds, " seconds (", W64(requests / max(seconds, 1e-9)),
+       " requests/sec)", endl;
+
+    ptl_logfile << sb << flush;
+    cerr << sb << flush;
+
+    flush_stats();
+
+    config.kill = true;
+    kill_simulation();
+}
+
+/**
+ * @brief Send synthetic traffic from one agent per core to the caches of
+ * the machine instead of simulating the guest, dump the stats and quit
+ */
+static void run_traffic(PTLsimMachine* machine)
+{
+    BaseMachine* base_machine = (BaseMachine*)machine;
+    Memory::TrafficConfig traffic;
+
+    traffic.pattern = Memory::find_traffic_pattern(config.traffic_pattern);
+    if (traffic.pattern < 0) {
+        cerr << "Unknown traffic pattern ", config.traffic_pattern, endl;
+        ptl_logfile << "Unknown traffic pattern ", config.traffic_pattern, endl;
+        config.kill = true;
+        kill_simulation();
+        return;
+    }
+
+    traffic.agents = base_machine->get_num_cores();
+    traffic.requests = config.traffic_requests;
+    traffic.footprint = config.traffic_footprint;
+    traffic.writePercent = config.traffic_write_percent;
+    traffic.outstanding = config.traffic_outstanding;
+    traffic.seed = config.traffic_seed;
+
+    Memory::TrafficGenerator generator(*base_machine->memoryHierarchyPtr,
+            traffic);
+
+    W64 tsc_at_traffic = rdtsc();
+    W64 requests;
+    {
+        host_profile_scope(HPROF_SIMULATION);
+        requests = generator.run();
+    }
+    double seconds = ticks_to_native_seconds(rdtsc() - tsc_at_traffic);
+
+    stringbuf sb;
+    sb << endl, "Traffic ", config.traffic_pattern, " on ",
+       config.machine_config, ": ", requests, " memory requests from ",
+       traffic.agents, " agents in ", sim_cycle, " cycles and ", seconds,
+       " seconds (", W64(requests / max(seconds, 1e-9)), " requests/sec)",
+       endl;
+
+    ptl_logfile << sb;
+    cerr << sb;
+    generator.print_latency(ptl_logfile);
+    generator.print_latency(cerr);
+    ptl_logfile << flush;
+    cerr << flush;
+
+    flush_stats();
+
+    config.kill = true;
+    kill_simulation();
+}
+
+extern "C" uint8_t ptl_simulate() {
+    host_profile_scope(HPROF_QEMU_SWITCH);
+
+    /* Sweep parent never simulates, children continue with their config */
+    if unlikely (config.sweep_file.set()) {
+        if (!run_sweep())
+            return 0;
+    }
+
+    // If config.run_tests is enabled, then run testcases
+    if(config.run_tests) {
+        run_tests();
+    }
+
+	PTLsimMachine* machine = setup_sim_machine();
+	if (!machine)
+		return 0;
+
+    if unlikely (config.mem_trace_replay.set()) {
+        replay_mem_trace(machine);
+        return 0;
+    }
+
+    if unlikely (config.traffic_pattern.set()) {
+        run_traffic(machine);
+        return 0;
+    }
+
 	foreach(ctx_no, contextcount) {
 		Context& ctx = contextof(ctx_no);
 		ctx.setup_ptlsim_switch();
@@ -1368,10 +1825,32 @@ extern "C" uint8_t ptl_simulate() {
 		ptl_logfile << endl;
     }
 
-	machine->run(config);
+    if unlikely (sampling.fast_forwarding()) {
+        sampling.resume(config);
+    } else if unlikely (config.sampling_period && !sampling.enabled()) {
+        sampling.start(config);
+    }
+
+    /* Warm-up and measured window of a sample run back to back */
+    for (;;) {
+        {
+            host_profile_scope(HPROF_SIMULATION);
+            machine->run(config);
+        }
+
+        if likely (!sampling.detailed() || machine->ret_qemu_env ||
+                sampling.stop_at_insns > total_insns_committed)
+            break;
+
+        sampling.window_end(config);
+
+        if (!sampling.detailed())
+            break;
+    }
 
 	if (config.stop_at_insns <= total_insns_committed || config.kill == true
-			|| config.stop == true || config.stop_at_cycle < sim_cycle) {
+			|| config.stop == true || config.stop_at_cycle < sim_cycle ||
+            sampling.done()) {
 		machine->stopped = 1;
 	}
 
@@ -1380,6 +1859,26 @@ extern "C" uint8_t ptl_simulate() {
     if(machine->ret_qemu_env)
         setup_qemu_switch_all_ctx(*machine->ret_qemu_env);
 
+    if (sampling.fast_forwarding() && !machine->stopped) {
+        if(logable(1)) {
+            ptl_logfile << "Sampling: fast-forwarding at sim_cycle: " <<
+                sim_cycle << endl << flush;
+        }
+
+        /* Same as a stop, without the stats dump */
+        machine->first_run = 1;
+        sim_update_clock_offset = 1;
+
+        foreach(ctx_no, contextcount) {
+            Context& ctx = contextof(ctx_no);
+            tb_flush((CPUX86State*)(&ctx));
+            ctx.old_eip = 0;
+        }
+
+        sampling.fast_forward(config);
+        return 0;
+    }
+
 	if (!machine->stopped) {
         if(logable(1)) {
 			ptl_logfile << "Switching back to qemu rip: " << (void *)contextof(0).get_cs_eip() << " exception: " << contextof(0).exception_index <<
@@ -1419,6 +1918,7 @@ extern "C" uint8_t ptl_simulate() {
 	last_printed_status_at_ticks = 0;
 	cerr << endl;
 
+    sampling.finish(config);
     flush_stats();
 
 	if(config.kill || config.kill_after_run) {
@@ -1540,6 +2040,7 @@ void clock_qemu_io_events()
     QemuIOSignal *signal;
     foreach_list_mutable(qemuIOEvents->list(), signal, entry, prev) {
         if (signal->cycle <= sim_cycle) {
+            host_profile_scope(HPROF_QEMU_IO);
             ptl_logfile << "Executing QEMU IO Event at " << sim_cycle << endl;
             signal->fn(signal->arg);
             qemuIOEvents->free(signal);
@@ -1547,6 +2048,22 @@ void clock_qemu_io_events()
     }
 }
 
+/**
+ * @brief Cycle of the earliest pending QEMU IO event
+ *
+ * @return -1 if no event is pending
+ */
+W64 next_qemu_io_event_cycle()
+{
+    W64 next = -1;
+    QemuIOSignal *signal;
+    foreach_list_mutable(qemuIOEvents->list(), signal, entry, prev) {
+        next = min(next, signal->cycle);
+    }
+
+    return next;
+}
+
 extern "C" void add_qemu_io_event(QemuIOCB fn, void *arg, int delay)
 {
     QemuIOSignal* signal = qemuIOEvents->alloc();
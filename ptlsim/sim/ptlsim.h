@@ -17,6 +17,8 @@
 
 #include <statsBuilder.h>
 
+#include <pthread.h>
+
 #define INVALID_MFN 0xffffffffffffffffULL
 #define INVALID_PHYSADDR 0xffffffffffffffffULL
 
@@ -45,6 +47,8 @@ struct PTLsimCore{
 
 extern Context* ptl_contexts[MAX_CONTEXTS];
 
+class WarmStateFile;
+
 struct PTLsimMachine : public Statable {
   bool initialized;
   bool stopped;
@@ -61,6 +65,13 @@ struct PTLsimMachine : public Statable {
   virtual void dump_state(ostream& os);
   virtual void flush_tlb(Context& ctx);
   virtual void flush_tlb_virt(Context& ctx, Waddr virtaddr);
+  virtual void warm_memory(Context& ctx, W64 physaddr, bool is_icache,
+          bool is_write);
+  virtual void warm_branch(Context& ctx, int type, W64 branchaddr,
+          W64 target, W64 actual);
+  virtual W64 config_signature() const;
+  virtual void save_warm_state(WarmStateFile& ws);
+  virtual void load_warm_state(WarmStateFile& ws);
   virtual void dump_configuration(ostream& os) const;
   virtual void reset(){};
   virtual void shutdown(){};
@@ -82,6 +93,8 @@ struct PTLsimMachine : public Statable {
   }
 };
 
+PTLsimMachine* setup_sim_machine();
+
 void setup_qemu_switch_all_ctx(Context& last_ctx);
 void setup_qemu_switch_except_ctx(const Context& const_ctx);
 void setup_ptlsim_switch_all_ctx(Context& const_ctx);
@@ -172,6 +185,15 @@ extern W64 total_uops_committed;
 extern W64 total_insns_committed;
 extern W64 total_basic_blocks_committed;
 
+/* Count a commit in one of the global totals above, which all cores share
+ * in parallel mode; the locked add is only paid for there */
+static inline void count_total_committed(W64& total) {
+  if unlikely (parallel_sim_active)
+    xadd(total, W64(1));
+  else
+    total++;
+}
+
 // #define TRACE_RIP
 #ifdef TRACE_RIP
 extern ofstream ptl_rip_trace;
@@ -196,6 +218,9 @@ struct PTLsimConfig {
   W64 fast_fwd_insns;
   W64 fast_fwd_user_insns;
   stringbuf fast_fwd_checkpoint;
+  bool fast_fwd_warm;
+  stringbuf warm_state_dir;
+  stringbuf warm_state_file;
 
   // Logging
   bool quiet;
@@ -222,6 +247,7 @@ struct PTLsimConfig {
   stringbuf snapshot_now;
   stringbuf time_stats_logfile;
   W64 time_stats_period;
+  stringbuf time_stats_format;
   stringbuf stats_format;
 
   // memory model:
@@ -254,14 +280,31 @@ struct PTLsimConfig {
   stringbuf dumpcode_filename;
   bool dump_at_end;
   stringbuf bbcache_dump_filename;
+  bool shared_bbcache;
+  stringbuf bbcache_store_filename;
+  W64 bbcache_store_size;
 
   // Machine configurations
   stringbuf machine_config;
+  W64 parallel_quantum;
+  stringbuf parallel_reference;
+  bool skip_idle_cycles;
+  bool park_halted_cores;
 
   ///
   /// for memory hierarchy implementaion
   ///
   //  bool memory_log;
+  bool mem_request_history;
+  stringbuf cache_config;
+  stringbuf mem_trace_file;
+  stringbuf mem_trace_replay;
+  stringbuf traffic_pattern;
+  W64 traffic_requests;
+  W64 traffic_footprint;
+  W64 traffic_write_percent;
+  W64 traffic_outstanding;
+  W64 traffic_seed;
 
   bool checker_enabled;
   W64 checker_start_rip;
@@ -281,11 +324,25 @@ struct PTLsimConfig {
 
   // Sync Options
   W64  sync_interval;
+  stringbuf sync_group;
 
   // Simpoint options
   stringbuf simpoint_file;
   W64 simpoint_interval;
   stringbuf simpoint_chk_name;
+  stringbuf bbv_file;
+
+  // Sweep options
+  stringbuf sweep_file;
+  W64 sweep_jobs;
+
+  // Statistical sampling options
+  W64 sampling_period;
+  W64 sampling_warmup;
+  W64 sampling_window;
+  W64 sampling_min_windows;
+  double sampling_error;
+  double sampling_confidence;
 
   void reset();
 
@@ -311,8 +368,56 @@ extern bool logenable;
 
 void force_logging_enabled();
 
+/*
+ * Parallel core simulation support
+ *
+ * When '-parallel-quantum' is set each core is clocked on its own host
+ * thread for a quantum of cycles. parallel_sim_active is only true while
+ * the workers run; the memory hierarchy then queues the requests of each
+ * core and services them on the main thread at the quantum boundary, so it
+ * needs no lock. The remaining state shared between cores has one lock per
+ * kind, taken with a ParallelSection:
+ *
+ *   parallel_qemu_lock       QEMU helpers and the decoder, which reads
+ *                            guest code through QEMU
+ *   parallel_interlock_lock  memory interlocks of locked instructions
+ *
+ * A thread holding parallel_interlock_lock must not take the QEMU lock.
+ * parallel_worker_id is the index of the worker running on this thread,
+ * parallel_sim_active and the cycle of its core are in ptlhwdef.h.
+ */
+extern __thread int parallel_worker_id;
+
+struct ParallelLock {
+  pthread_mutex_t mutex;
+
+  ParallelLock() {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+  }
+};
+
+extern ParallelLock parallel_qemu_lock;
+extern ParallelLock parallel_interlock_lock;
+
+struct ParallelSection {
+  ParallelLock* lock;
+
+  ParallelSection(ParallelLock& l) : lock(parallel_sim_active ? &l : NULL) {
+    if unlikely (lock) pthread_mutex_lock(&lock->mutex);
+  }
+
+  ~ParallelSection() {
+    if unlikely (lock) pthread_mutex_unlock(&lock->mutex);
+  }
+};
+
 void init_qemu_io_events();
 void clock_qemu_io_events();
+W64 next_qemu_io_event_cycle();
 
 /**
  * @brief Convert nano-seconds to Simulation Cycles
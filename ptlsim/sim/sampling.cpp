@@ -0,0 +1,200 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ * Statistical sampling of a run (SMARTS): short detailed windows taken at
+ * a fixed period, with QEMU fast-forwarding the instructions in between.
+ */
+
+#include <globals.h>
+#include <ptlsim.h>
+#include <ptl-qemu.h>
+#include <statsBuilder.h>
+#include <sampling.h>
+
+SamplingController sampling;
+
+SamplingController::SamplingController()
+    : stop_at_insns(infinity)
+    , windows(0)
+    , measured_insns(0)
+    , measured_cycles(0)
+    , warmup_insns(0)
+    , fast_forward_insns(0)
+    , phase(SAMPLING_OFF)
+    , phase_start_insns(0)
+    , phase_start_cycle(0)
+    , user_start(NULL)
+    , kernel_start(NULL)
+    , user_sampled(NULL)
+    , kernel_sampled(NULL)
+{ }
+
+/**
+ * @brief Start a sampled run from the current point of simulation
+ */
+void SamplingController::start(PTLsimConfig& config)
+{
+    StatsBuilder& builder = StatsBuilder::get();
+
+    if (!user_start) {
+        user_start = builder.get_new_stats();
+        kernel_start = builder.get_new_stats();
+        user_sampled = builder.get_new_stats();
+        kernel_sampled = builder.get_new_stats();
+    }
+
+    user_sampled->reset();
+    kernel_sampled->reset();
+    cpi.reset();
+
+    windows = 0;
+    measured_insns = 0;
+    measured_cycles = 0;
+    warmup_insns = 0;
+    fast_forward_insns = 0;
+
+    ptl_logfile << "Sampling: one window of ", config.sampling_window,
+                " instructions every ", config.sampling_period,
+                " instructions, ", config.sampling_warmup,
+                " instructions of warm-up", endl;
+
+    resume(config);
+}
+
+/**
+ * @brief Back in simulation after a fast-forward, begin the next period
+ */
+void SamplingController::resume(PTLsimConfig& config)
+{
+    if (config.sampling_warmup == 0) {
+        measure(config);
+        return;
+    }
+
+    phase = SAMPLING_WARMUP;
+    phase_start_insns = total_insns_committed;
+    stop_at_insns = total_insns_committed + config.sampling_warmup;
+}
+
+void SamplingController::measure(PTLsimConfig& config)
+{
+    phase = SAMPLING_MEASURE;
+    phase_start_insns = total_insns_committed;
+    phase_start_cycle = sim_cycle;
+    stop_at_insns = total_insns_committed + config.sampling_window;
+
+    *user_start = *user_stats;
+    *kernel_start = *kernel_stats;
+}
+
+/**
+ * @brief Machine reached 'stop_at_insns' in a detailed phase
+ *
+ * Moves on to the next phase: the measured window after the warm-up, and
+ * after the window either a fast-forward or SAMPLING_DONE when the
+ * estimate is accurate enough.
+ */
+void SamplingController::window_end(PTLsimConfig& config)
+{
+    if (phase == SAMPLING_WARMUP) {
+        warmup_insns += total_insns_committed - phase_start_insns;
+        measure(config);
+        return;
+    }
+
+    assert(phase == SAMPLING_MEASURE);
+
+    W64 insns = total_insns_committed - phase_start_insns;
+    W64 cycles = sim_cycle - phase_start_cycle;
+    StatsBuilder& builder = StatsBuilder::get();
+
+    /* Add the stats of this window only: end - start */
+    builder.add_stats(*user_sampled, *user_stats);
+    builder.sub_stats(*user_sampled, *user_start);
+    builder.add_stats(*kernel_sampled, *kernel_stats);
+    builder.sub_stats(*kernel_sampled, *kernel_start);
+
+    windows++;
+    measured_insns += insns;
+    measured_cycles += cycles;
+
+    if (insns > 0)
+        cpi.add(double(cycles) / double(insns));
+
+    double z = SampleEstimator::z_score(config.sampling_confidence);
+
+    if (logable(1)) {
+        ptl_logfile << "Sampling: window ", windows, " ", cycles,
+                    " cycles, ", insns, " instructions, CPI ",
+                    cpi.mean(), " +- ", cpi.half_width(z), endl;
+    }
+
+    stop_at_insns = infinity;
+
+    if (cpi.count() >= config.sampling_min_windows &&
+            cpi.relative_error(z) <= config.sampling_error) {
+        phase = SAMPLING_DONE;
+        return;
+    }
+
+    W64 detailed = config.sampling_warmup + config.sampling_window;
+
+    if (config.sampling_period <= detailed) {
+        /* Nothing to skip, next period starts right away */
+        resume(config);
+        return;
+    }
+
+    phase = SAMPLING_FAST_FORWARD;
+}
+
+/**
+ * @brief Let QEMU emulate the rest of the period
+ *
+ * Called once the machine has switched all contexts back to QEMU.
+ */
+void SamplingController::fast_forward(PTLsimConfig& config)
+{
+    W64 insns = config.sampling_period - config.sampling_warmup -
+        config.sampling_window;
+
+    /* Each vCPU gets an equal share, at least one instruction */
+    insns = max(insns, W64(NUM_SIM_CORES));
+    fast_forward_insns += insns;
+
+    set_cpu_fast_fwd_insns(insns, 1);
+}
+
+/**
+ * @brief End the sampled run and report the measured windows
+ *
+ * Replaces the user and kernel stats with the sum of the measured
+ * windows, so the stats dump describes only the sampled instructions.
+ */
+void SamplingController::finish(PTLsimConfig& config)
+{
+    if (phase == SAMPLING_OFF)
+        return;
+
+    phase = SAMPLING_OFF;
+    stop_at_insns = infinity;
+
+    double z = SampleEstimator::z_score(config.sampling_confidence);
+    stringbuf sb;
+
+    sb << "Sampling: ", windows, " windows, ", measured_insns,
+       " measured instructions, CPI ", cpi.mean(), " +- ",
+       cpi.half_width(z), " (", cpi.relative_error(z) * 100,
+       "% at ", config.sampling_confidence * 100, "% confidence)", endl;
+
+    ptl_logfile << sb << flush;
+    cerr << sb << flush;
+
+    if (windows == 0)
+        return;
+
+    *user_stats = *user_sampled;
+    *kernel_stats = *kernel_sampled;
+}
@@ -0,0 +1,148 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ * Statistical sampling of a run (SMARTS): short detailed windows taken at
+ * a fixed period, with QEMU fast-forwarding the instructions in between.
+ */
+
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <globals.h>
+#include <math.h>
+
+class Stats;
+struct PTLsimConfig;
+
+/*
+ * Running mean and variance of the per-window samples (Welford), and the
+ * confidence interval of the mean assuming it is normally distributed.
+ */
+class SampleEstimator {
+public:
+    SampleEstimator() { reset(); }
+
+    void reset() {
+        n = 0;
+        m = 0;
+        m2 = 0;
+    }
+
+    void add(double x) {
+        n++;
+        double delta = x - m;
+        m += delta / n;
+        m2 += delta * (x - m);
+    }
+
+    W64 count() const { return n; }
+    double mean() const { return m; }
+
+    /* Sample variance */
+    double variance() const {
+        return (n > 1) ? m2 / (n - 1) : 0;
+    }
+
+    /* Half width of the confidence interval with the given z score */
+    double half_width(double z) const {
+        if (n < 2) return INFINITY;
+        return z * sqrt(variance() / n);
+    }
+
+    /* Half width relative to the mean */
+    double relative_error(double z) const {
+        if (m == 0) return INFINITY;
+        return half_width(z) / fabs(m);
+    }
+
+    /* Two sided z score of a confidence level, 0.95 gives 1.96 */
+    static double z_score(double confidence) {
+        double lo = 0, hi = 10;
+
+        if (confidence <= 0) return 0;
+        if (confidence >= 1) return hi;
+
+        foreach (i, 64) {
+            double z = (lo + hi) / 2;
+            if (erf(z / M_SQRT2) < confidence)
+                lo = z;
+            else
+                hi = z;
+        }
+
+        return (lo + hi) / 2;
+    }
+
+private:
+    W64 n;
+    double m;
+    double m2;
+};
+
+enum {
+    SAMPLING_OFF = 0,
+    SAMPLING_WARMUP,        /* detailed, not measured */
+    SAMPLING_MEASURE,       /* detailed, measured */
+    SAMPLING_FAST_FORWARD,  /* emulated by QEMU */
+    SAMPLING_DONE,
+};
+
+/*
+ * Drives the '-sampling-period' mode.
+ *
+ * Every period starts with 'sampling-warmup' detailed instructions that
+ * bring caches and predictors back to a warm state, followed by a window
+ * of 'sampling-window' measured instructions; the rest of the period is
+ * fast-forwarded by QEMU, split evenly between the vCPUs. The Stats delta
+ * of every measured window is accumulated and the run stops once the
+ * confidence interval of the window CPI is within 'sampling-error' of its
+ * mean. The reported stats are then the sum of the measured windows.
+ */
+class SamplingController {
+public:
+    SamplingController();
+
+    void start(PTLsimConfig& config);
+    void resume(PTLsimConfig& config);
+    void window_end(PTLsimConfig& config);
+    void fast_forward(PTLsimConfig& config);
+    void finish(PTLsimConfig& config);
+
+    int  get_phase() const { return phase; }
+    bool enabled() const { return phase != SAMPLING_OFF; }
+    bool detailed() const {
+        return phase == SAMPLING_WARMUP || phase == SAMPLING_MEASURE;
+    }
+    bool fast_forwarding() const { return phase == SAMPLING_FAST_FORWARD; }
+    bool done() const { return phase == SAMPLING_DONE; }
+
+    /* Machine leaves its run loop when this many instructions committed */
+    W64 stop_at_insns;
+
+    SampleEstimator cpi;
+
+    /* Stats of this run */
+    W64 windows;
+    W64 measured_insns;
+    W64 measured_cycles;
+    W64 warmup_insns;
+    W64 fast_forward_insns;
+
+private:
+    int phase;
+    W64 phase_start_insns;
+    W64 phase_start_cycle;
+
+    Stats *user_start;
+    Stats *kernel_start;
+    Stats *user_sampled;
+    Stats *kernel_sampled;
+
+    void measure(PTLsimConfig& config);
+};
+
+extern SamplingController sampling;
+
+#endif /* SAMPLING_H */
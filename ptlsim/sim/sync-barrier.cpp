@@ -0,0 +1,421 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ * Shared memory barrier used by the '-sync' option to run multiple
+ * simulation instances in lockstep.
+ */
+
+#include <sync-barrier.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/* Spin on the sense this many times before sleeping on the futex */
+#define SYNC_SPIN_COUNT 2000
+
+/* Look for participants that died without leaving after this long */
+#define SYNC_REAP_TIMEOUT_NS 100000000ULL
+
+static void group_shm_name(const char* group_name, char* buf, int size)
+{
+    snprintf(buf, size, "/marss-sync-%s", group_name);
+}
+
+static uint64_t now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+static int futex_wait(volatile uint32_t* addr, uint32_t val,
+        const timespec* timeout)
+{
+    return syscall(SYS_futex, (uint32_t*)addr, FUTEX_WAIT, val, timeout,
+            NULL, 0);
+}
+
+static void futex_wake_all(volatile uint32_t* addr)
+{
+    syscall(SYS_futex, (uint32_t*)addr, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static bool init_lock(SyncBarrierGroup* group)
+{
+    pthread_mutexattr_t attr;
+    bool ok;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    ok = (pthread_mutex_init(&group->lock, &attr) == 0);
+    pthread_mutexattr_destroy(&attr);
+
+    return ok;
+}
+
+/*
+ * Count participants and arrivals again from the slots, after the owner
+ * of the lock died in the middle of an update.
+ */
+static void repair_locked(SyncBarrierGroup* group)
+{
+    group->participants = 0;
+    group->arrived = 0;
+
+    for (int i = 0; i < SYNC_BARRIER_MAX_PARTICIPANTS; i++) {
+        if (group->slots[i].pid == 0) {
+            group->slots[i].arrived = 0;
+            continue;
+        }
+
+        group->participants++;
+        if (group->slots[i].arrived)
+            group->arrived++;
+    }
+}
+
+static void group_lock(SyncBarrierGroup* group)
+{
+    if (pthread_mutex_lock(&group->lock) == EOWNERDEAD) {
+        repair_locked(group);
+        pthread_mutex_consistent(&group->lock);
+    }
+}
+
+static void group_unlock(SyncBarrierGroup* group)
+{
+    pthread_mutex_unlock(&group->lock);
+}
+
+/*
+ * Start the next phase: clear all arrivals and flip the sense so every
+ * waiter of the current phase returns. Called with the lock held.
+ */
+static void release_locked(SyncBarrierGroup* group)
+{
+    for (int i = 0; i < SYNC_BARRIER_MAX_PARTICIPANTS; i++)
+        group->slots[i].arrived = 0;
+
+    group->arrived = 0;
+    group->phase++;
+    __sync_synchronize();
+    group->sense ^= 1;
+    futex_wake_all(&group->sense);
+}
+
+/*
+ * Remove a participant, the others are released if the removed one was
+ * the last they were waiting for. Called with the lock held.
+ */
+static void remove_slot_locked(SyncBarrierGroup* group, int idx)
+{
+    if (group->slots[idx].arrived)
+        group->arrived--;
+
+    group->slots[idx].pid = 0;
+    group->slots[idx].arrived = 0;
+    group->participants--;
+
+    if (group->arrived > 0 && group->arrived >= group->participants)
+        release_locked(group);
+}
+
+SyncBarrier::SyncBarrier()
+    : barriers(0)
+    , wait_ns(0)
+    , max_wait_ns(0)
+    , departed(0)
+    , group(NULL)
+    , slot(-1)
+{
+    name[0] = '\0';
+}
+
+SyncBarrier::~SyncBarrier()
+{
+    leave();
+}
+
+SyncBarrierGroup* SyncBarrier::map_group(const char* group_name)
+{
+    char shm_name[NAME_MAX];
+    group_shm_name(group_name, shm_name, sizeof(shm_name));
+
+    int fd = shm_open(shm_name, O_RDWR | O_CREAT, 0666);
+    if (fd < 0)
+        return NULL;
+
+    if (ftruncate(fd, sizeof(SyncBarrierGroup)) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void* mem = mmap(NULL, sizeof(SyncBarrierGroup), PROT_READ | PROT_WRITE,
+            MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (mem == MAP_FAILED)
+        return NULL;
+
+    SyncBarrierGroup* group = (SyncBarrierGroup*)mem;
+
+    if (__sync_bool_compare_and_swap(&group->magic, 0, SYNC_BARRIER_INIT)) {
+        if (!init_lock(group)) {
+            group->magic = 0;
+            unmap_group(group);
+            return NULL;
+        }
+        __sync_synchronize();
+        group->magic = SYNC_BARRIER_MAGIC;
+    }
+
+    /* Another process is setting up the lock */
+    while (group->magic == SYNC_BARRIER_INIT)
+        sched_yield();
+
+    if (group->magic != SYNC_BARRIER_MAGIC) {
+        unmap_group(group);
+        return NULL;
+    }
+
+    return group;
+}
+
+void SyncBarrier::unmap_group(SyncBarrierGroup* group)
+{
+    munmap(group, sizeof(SyncBarrierGroup));
+}
+
+/**
+ * @brief Close a group for all its participants
+ *
+ * Waiting and later calls to wait() of the participants return false.
+ */
+bool SyncBarrier::remove_group(const char* group_name)
+{
+    char shm_name[NAME_MAX];
+    SyncBarrierGroup* group = map_group(group_name);
+
+    if (!group)
+        return false;
+
+    group_lock(group);
+    group->closed = 1;
+    group->sense ^= 1;
+    futex_wake_all(&group->sense);
+    group_unlock(group);
+
+    unmap_group(group);
+
+    group_shm_name(group_name, shm_name, sizeof(shm_name));
+    shm_unlink(shm_name);
+
+    return true;
+}
+
+/**
+ * @brief Join a named group, creating it if this is the first participant
+ *
+ * A participant that joins while others are waiting becomes part of the
+ * current phase.
+ *
+ * @return false if the group can not be mapped or is full
+ */
+bool SyncBarrier::join(const char* group_name)
+{
+    if (group)
+        return true;
+
+    while (true) {
+        group = map_group(group_name);
+        if (!group)
+            return false;
+
+        group_lock(group);
+
+        /* Last participant left and unlinked it, open a new one */
+        if (group->closed) {
+            group_unlock(group);
+            unmap_group(group);
+            group = NULL;
+            sched_yield();
+            continue;
+        }
+
+        break;
+    }
+
+    slot = -1;
+    for (int i = 0; i < SYNC_BARRIER_MAX_PARTICIPANTS; i++) {
+        if (group->slots[i].pid == 0) {
+            slot = i;
+            break;
+        }
+    }
+
+    if (slot >= 0) {
+        group->slots[slot].pid = getpid();
+        group->slots[slot].arrived = 0;
+        group->participants++;
+    }
+
+    group_unlock(group);
+
+    if (slot < 0) {
+        unmap_group(group);
+        group = NULL;
+        return false;
+    }
+
+    strncpy(name, group_name, sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+
+    return true;
+}
+
+/**
+ * @brief Leave the group, the last participant removes it
+ */
+void SyncBarrier::leave()
+{
+    if (!group)
+        return;
+
+    bool last = false;
+
+    group_lock(group);
+
+    if (!group->closed) {
+        remove_slot_locked(group, slot);
+
+        if (group->participants == 0) {
+            group->closed = 1;
+            last = true;
+        }
+    }
+
+    group_unlock(group);
+
+    unmap_group(group);
+    group = NULL;
+    slot = -1;
+
+    if (last) {
+        char shm_name[NAME_MAX];
+        group_shm_name(name, shm_name, sizeof(shm_name));
+        shm_unlink(shm_name);
+    }
+}
+
+/**
+ * @brief Drop the mapping without leaving the group
+ *
+ * Used by a forked child that inherited the parent's membership.
+ */
+void SyncBarrier::detach()
+{
+    if (!group)
+        return;
+
+    unmap_group(group);
+    group = NULL;
+    slot = -1;
+}
+
+int SyncBarrier::participants() const
+{
+    return group ? group->participants : 0;
+}
+
+/*
+ * Remove participants whose process is gone, so a crashed instance does
+ * not stop the others forever.
+ */
+void SyncBarrier::reap_dead()
+{
+    group_lock(group);
+
+    for (int i = 0; i < SYNC_BARRIER_MAX_PARTICIPANTS; i++) {
+        pid_t pid = group->slots[i].pid;
+
+        if (pid == 0 || i == slot)
+            continue;
+
+        if (kill(pid, 0) == -1 && errno == ESRCH) {
+            remove_slot_locked(group, i);
+            departed++;
+        }
+    }
+
+    group_unlock(group);
+}
+
+/**
+ * @brief Wait until all participants of the group have arrived
+ *
+ * @return false if the group was closed by sync_helper
+ */
+bool SyncBarrier::wait()
+{
+    if (!group)
+        return false;
+
+    uint64_t start = now_ns();
+
+    group_lock(group);
+
+    if (group->closed) {
+        group_unlock(group);
+        return false;
+    }
+
+    uint32_t sense = group->sense;
+
+    group->slots[slot].arrived = 1;
+    group->arrived++;
+
+    if (group->arrived >= group->participants) {
+        release_locked(group);
+        group_unlock(group);
+        barriers++;
+        return true;
+    }
+
+    group_unlock(group);
+
+    for (int i = 0; i < SYNC_SPIN_COUNT && group->sense == sense; i++)
+        asm volatile("pause" ::: "memory");
+
+    while (group->sense == sense) {
+        timespec timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_nsec = SYNC_REAP_TIMEOUT_NS;
+
+        if (futex_wait(&group->sense, sense, &timeout) == -1 &&
+                errno == ETIMEDOUT) {
+            reap_dead();
+        }
+    }
+
+    uint64_t waited = now_ns() - start;
+    wait_ns += waited;
+    if (waited > max_wait_ns)
+        max_wait_ns = waited;
+    barriers++;
+
+    return !group->closed;
+}
@@ -0,0 +1,90 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ * Shared memory barrier used by the '-sync' option to run multiple
+ * simulation instances in lockstep.
+ */
+
+#ifndef SYNC_BARRIER_H
+#define SYNC_BARRIER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#define SYNC_BARRIER_MAGIC 0x324e5953 /* 'SYN2' */
+#define SYNC_BARRIER_INIT  0x54494e49 /* 'INIT', lock being set up */
+#define SYNC_BARRIER_MAX_PARTICIPANTS 256
+
+/*
+ * Barrier state shared by all members of a group, mapped from
+ * /dev/shm/marss-sync-<group>. A new segment is all zero which is a valid
+ * empty group; the first process to map it sets up 'lock' and then stores
+ * the magic.
+ *
+ * 'sense' is the futex word and flips every time all participants have
+ * arrived. Everything else is protected by 'lock', a process-shared robust
+ * mutex, so a participant that dies while holding it does not block the
+ * others.
+ */
+struct SyncBarrierGroup {
+    volatile uint32_t magic;
+    pthread_mutex_t lock;
+    volatile uint32_t sense;
+    volatile uint32_t closed;
+    int participants;
+    int arrived;
+    uint64_t phase;
+
+    struct {
+        pid_t pid;
+        int arrived;
+    } slots[SYNC_BARRIER_MAX_PARTICIPANTS];
+};
+
+/*
+ * Sense-reversing barrier over a named group of processes.
+ *
+ * Each process joins a group once and then calls wait() every sync
+ * interval. The last process to arrive flips the sense and wakes the
+ * others with a single futex call, other processes spin briefly and then
+ * sleep on the futex. A process that leaves is removed from the group and
+ * releases the others if they were only waiting for it; processes that die
+ * without leaving are found and removed when a wait times out.
+ */
+class SyncBarrier {
+public:
+    SyncBarrier();
+    ~SyncBarrier();
+
+    bool join(const char* group_name);
+    void leave();
+    void detach();
+    bool wait();
+
+    bool joined() const { return group != NULL; }
+    int participants() const;
+
+    /* Access a group without joining it, used by tools/sync_helper */
+    static SyncBarrierGroup* map_group(const char* group_name);
+    static void unmap_group(SyncBarrierGroup* group);
+    static bool remove_group(const char* group_name);
+
+    /* Stats of this instance */
+    uint64_t barriers;
+    uint64_t wait_ns;
+    uint64_t max_wait_ns;
+    uint64_t departed;
+
+private:
+    SyncBarrierGroup* group;
+    int slot;
+    char name[128];
+
+    void reap_dead();
+};
+
+#endif /* SYNC_BARRIER_H */
@@ -0,0 +1,196 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ * Microarchitectural warm state (cache lines, directory, branch predictors
+ * and TLBs) saved next to a checkpoint.
+ */
+
+#include <globals.h>
+#include <superstl.h>
+#include <warm-state.h>
+
+WarmStateFile::WarmStateFile()
+    : writing(false)
+    , restored(0)
+    , skipped(0)
+{ }
+
+WarmStateFile::~WarmStateFile()
+{
+    close();
+}
+
+/**
+ * @brief Create 'filename' to save the state of a machine
+ *
+ * @param filename Warm state file
+ * @param signature Signature of the machine configuration
+ *
+ * @return false if the file can not be created
+ */
+bool WarmStateFile::create(const char* filename, W64 signature)
+{
+    close();
+
+    os.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!os)
+        return false;
+
+    W32 header[4];
+    header[0] = WARM_STATE_VERSION;
+    header[1] = 0;
+    *(W64*)&header[2] = signature;
+
+    os.write(WARM_STATE_MAGIC, 8);
+    os.write((char*)header, sizeof(header));
+
+    writing = true;
+    return true;
+}
+
+/**
+ * @brief Read all sections of 'filename' to restore a machine
+ *
+ * @param filename Warm state file
+ * @param signature Signature of the machine configuration
+ *
+ * @return false if the file can not be read, is not a warm state file or
+ * was saved from a different configuration
+ */
+bool WarmStateFile::open(const char* filename, W64 signature)
+{
+    close();
+
+    ifstream is(filename, std::ios::in | std::ios::binary);
+    if (!is)
+        return false;
+
+    char magic[8];
+    W32 header[4];
+
+    is.read(magic, 8);
+    is.read((char*)header, sizeof(header));
+
+    if (!is || memcmp(magic, WARM_STATE_MAGIC, 8) != 0 ||
+            header[0] != WARM_STATE_VERSION ||
+            *(W64*)&header[2] != signature) {
+        return false;
+    }
+
+    while (1) {
+        W32 sec[4];
+        is.read((char*)sec, sizeof(sec));
+        if (!is) break;
+
+        W32 len = sec[0];
+        char* name = new char[len + 1];
+        is.read(name, len);
+        name[len] = 0;
+
+        Section* s = new Section();
+        s->name << name;
+        s->size = *(W64*)&sec[2];
+        s->data = new byte[s->size];
+        s->restored = false;
+        delete[] name;
+
+        is.read((char*)s->data, s->size);
+
+        if (!is) {
+            /* Truncated file, drop the partial section */
+            delete[] s->data;
+            delete s;
+            break;
+        }
+
+        sections.push(s);
+    }
+
+    return true;
+}
+
+void WarmStateFile::close()
+{
+    if (os.is_open())
+        os.close();
+
+    foreach (i, sections.count()) {
+        delete[] sections[i]->data;
+        delete sections[i];
+    }
+    sections.clear();
+
+    writing = false;
+    restored = 0;
+    skipped = 0;
+}
+
+WarmStateFile::Section* WarmStateFile::find(const char* name) const
+{
+    foreach (i, sections.count()) {
+        if (strcmp(sections[i]->name.buf, name) == 0)
+            return sections[i];
+    }
+
+    return NULL;
+}
+
+bool WarmStateFile::has(const char* name) const
+{
+    return find(name) != NULL;
+}
+
+bool WarmStateFile::is_restored(const char* name) const
+{
+    Section* s = find(name);
+    return s && s->restored;
+}
+
+/**
+ * @brief Append the section 'name' holding 'size' bytes of 'data'
+ */
+void WarmStateFile::save(const char* name, const void* data, W64 size)
+{
+    assert(writing);
+
+    W32 sec[4];
+    sec[0] = strlen(name);
+    sec[1] = 0;
+    *(W64*)&sec[2] = size;
+
+    os.write((char*)sec, sizeof(sec));
+    os.write(name, sec[0]);
+    os.write((const char*)data, size);
+
+    /* Names only, to answer has() */
+    Section* s = new Section();
+    s->name << name;
+    s->data = NULL;
+    s->size = size;
+    s->restored = false;
+    sections.push(s);
+}
+
+/**
+ * @brief Copy section 'name' to 'data' if it exists with the same size
+ *
+ * @return false if the structure keeps its current state
+ */
+bool WarmStateFile::restore(const char* name, void* data, W64 size)
+{
+    assert(!writing);
+
+    Section* s = find(name);
+
+    if (!s || s->size != size) {
+        skipped++;
+        return false;
+    }
+
+    memcpy(data, s->data, size);
+    s->restored = true;
+    restored++;
+    return true;
+}
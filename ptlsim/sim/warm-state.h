@@ -0,0 +1,65 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ * Microarchitectural warm state (cache lines, directory, branch predictors
+ * and TLBs) saved next to a checkpoint.
+ */
+
+#ifndef WARM_STATE_H
+#define WARM_STATE_H
+
+#include <globals.h>
+#include <superstl.h>
+
+/*
+ * Warm state file format:
+ *
+ *   header  : "MARSSWRM", W32 version, W32 0, W64 signature
+ *   section : W32 name length, W32 0, W64 size, name, 'size' bytes
+ *
+ * Each structure is saved as one section named after its owner. The
+ * signature identifies the machine configuration; a file made with another
+ * configuration is not loaded.
+ */
+#define WARM_STATE_MAGIC    "MARSSWRM"
+#define WARM_STATE_VERSION  1
+
+class WarmStateFile {
+public:
+    WarmStateFile();
+    ~WarmStateFile();
+
+    bool create(const char* filename, W64 signature);
+    bool open(const char* filename, W64 signature);
+    void close();
+
+    void save(const char* name, const void* data, W64 size);
+    bool restore(const char* name, void* data, W64 size);
+    bool has(const char* name) const;
+    bool is_restored(const char* name) const;
+
+    bool is_writing() const { return writing; }
+
+    int get_restored() const { return restored; }
+    int get_skipped() const { return skipped; }
+
+private:
+    struct Section {
+        stringbuf name;
+        byte* data;
+        W64 size;
+        bool restored;
+    };
+
+    ofstream os;
+    bool writing;
+    dynarray<Section*> sections;
+    int restored;
+    int skipped;
+
+    Section* find(const char* name) const;
+};
+
+#endif /* WARM_STATE_H */
@@ -16,6 +16,20 @@ static Stats *periodic_stats = NULL;
 static Stats *temp_stats  = NULL;
 static Stats *temp2_stats  = NULL;
 
+/*
+ * Binary time-stats file:
+ *
+ *   header: magic[8], W32 version, W32 columns, W32 fields, W32 reserved,
+ *           followed by 'fields' field records (see PeriodicColumns)
+ *   row:    W64 cycle, W64 bitmap[(columns + 63) / 64], and one W64 for
+ *           each set bit in column order
+ *
+ * Like the text format each row holds the change of every counter since the
+ * previous row, counters that did not change are left out of the row.
+ */
+#define TIME_STATS_MAGIC   "MARSSTSB"
+#define TIME_STATS_VERSION 1
+
 Statable::Statable(const char *name)
 {
     this->name = name;
@@ -274,6 +288,20 @@ void Statable::sub_periodic_stats(Stats& dest_stats, Stats& src_stats)
         sub_stats(dest_stats, src_stats);
 }
 
+void Statable::get_periodic_columns(PeriodicColumns &cols) const
+{
+    if(dump_disabled || !periodic_enabled) return;
+
+    // Same order as dump_header
+    foreach(i, leafs.count()) {
+        leafs[i]->get_periodic_columns(cols);
+    }
+
+    foreach(i, childNodes.count()) {
+        childNodes[i]->get_periodic_columns(cols);
+    }
+}
+
 stringbuf *Statable::get_full_stat_string() const
 {
     if (parent)
@@ -339,6 +367,61 @@ StatObjBase* Statable::get_stat_obj(dynarray<stringbuf*> &names, int idx)
 	return NULL;
 }
 
+int PeriodicColumns::column(W64 offset)
+{
+    foreach(i, offsets.count()) {
+        if(offsets[i] == offset)
+            return i;
+    }
+
+    offsets.push(offset);
+    return offsets.count() - 1;
+}
+
+void PeriodicColumns::put(W64 value, int bytes)
+{
+    foreach(i, bytes) {
+        fields.push(W8(value >> (i * 8)));
+    }
+}
+
+void PeriodicColumns::put_name(const char *name)
+{
+    int len = strlen(name);
+
+    put(len, sizeof(W16));
+    foreach(i, len) {
+        fields.push(name[i]);
+    }
+}
+
+/*
+ * Field record: W8 type, W8 op, W16 name length, name, then for a counter
+ * the W32 column and for an equation a W16 count and W32 column of each
+ * element.
+ */
+void PeriodicColumns::add_counter(const char *name, W64 offset)
+{
+    put(FIELD_COUNTER, sizeof(W8));
+    put(0, sizeof(W8));
+    put_name(name);
+    put(column(offset), sizeof(W32));
+    field_count++;
+}
+
+void PeriodicColumns::add_equation(const char *name, int op,
+        dynarray<W64> &elems)
+{
+    put(FIELD_EQUATION, sizeof(W8));
+    put(op, sizeof(W8));
+    put_name(name);
+    put(elems.count(), sizeof(W16));
+    foreach(i, elems.count()) {
+        put(column(elems[i]), sizeof(W32));
+    }
+    field_count++;
+}
+
 StatsBuilder *StatsBuilder::_builder = NULL;
 
 Stats* StatsBuilder::get_new_stats()
@@ -351,11 +434,141 @@ Stats* StatsBuilder::get_new_stats()
 void StatsBuilder::destroy_stats(Stats *stats)
 {
     delete stats->mem;
+    delete[] stats->dirty;
     delete stats;
 }
 
-ostream& StatsBuilder::dump_header(ostream &os) const
+StatsDelta::StatsDelta()
+    : stats(NULL)
+      , tracking(false)
+{
+    saved_dirty = new W8[STATS_DIRTY_BLOCKS];
+    blocks = new W8[STATS_DIRTY_BLOCKS];
+    delta = new W8[STATS_SIZE];
+    memset(blocks, 0, sizeof(W8) * STATS_DIRTY_BLOCKS);
+}
+
+StatsDelta::~StatsDelta()
+{
+    delete[] saved_dirty;
+    delete[] blocks;
+    delete[] delta;
+}
+
+void StatsDelta::begin_tracking()
+{
+    memcpy(saved_dirty, stats->dirty, sizeof(W8) * STATS_DIRTY_BLOCKS);
+    memset(stats->dirty, 0, sizeof(W8) * STATS_DIRTY_BLOCKS);
+    tracking = true;
+}
+
+void StatsDelta::end_tracking()
+{
+    foreach (i, STATS_DIRTY_BLOCKS) {
+        stats->dirty[i] |= saved_dirty[i];
+    }
+    tracking = false;
+}
+
+/**
+ * @brief Start the first interval, which finds the written blocks
+ */
+void StatsDelta::start(Stats &stats)
+{
+    this->stats = &stats;
+    begin_tracking();
+}
+
+/**
+ * @brief End the first interval
+ */
+void StatsDelta::mark()
+{
+    memcpy(blocks, stats->dirty, sizeof(W8) * STATS_DIRTY_BLOCKS);
+    end_tracking();
+}
+
+/**
+ * @brief Start the second interval, which is measured
+ */
+void StatsDelta::snapshot()
 {
+    foreach (i, STATS_DIRTY_BLOCKS) {
+        if (blocks[i]) {
+            W64 start = W64(i) << STATS_DIRTY_SHIFT;
+            memcpy(delta + start, stats->mem + start, Stats::block_size(i));
+        }
+    }
+
+    begin_tracking();
+}
+
+/**
+ * @brief End the second interval and compute the change of each counter
+ *
+ * @return false if the second interval wrote blocks the first one did not,
+ * so the two intervals did different work and the delta can not be used
+ */
+bool StatsDelta::measure()
+{
+    bool same = true;
+
+    foreach (i, STATS_DIRTY_BLOCKS) {
+        if (stats->dirty[i] && !blocks[i])
+            same = false;
+    }
+
+    if (same) {
+        foreach (i, STATS_DIRTY_BLOCKS) {
+            if (!blocks[i]) continue;
+
+            W64 start = W64(i) << STATS_DIRTY_SHIFT;
+            W64 *cur = (W64*)(stats->mem + start);
+            W64 *diff = (W64*)(delta + start);
+
+            foreach (w, Stats::block_size(i) / sizeof(W64)) {
+                diff[w] = cur[w] - diff[w];
+            }
+        }
+    }
+
+    end_tracking();
+
+    return same;
+}
+
+/**
+ * @brief Add the measured change 'times' times
+ */
+void StatsDelta::apply(W64 times)
+{
+    foreach (i, STATS_DIRTY_BLOCKS) {
+        if (!blocks[i]) continue;
+
+        W64 start = W64(i) << STATS_DIRTY_SHIFT;
+        W64 *cur = (W64*)(stats->mem + start);
+        W64 *diff = (W64*)(delta + start);
+
+        foreach (w, Stats::block_size(i) / sizeof(W64)) {
+            cur[w] += diff[w] * times;
+        }
+    }
+}
+
+/**
+ * @brief Stop an interval that can not be measured
+ */
+void StatsDelta::cancel()
+{
+    if (tracking)
+        end_tracking();
+}
+
+ostream& StatsBuilder::dump_header(ostream &os)
+{
+    if (binary_periodic)
+        return dump_header_binary(os);
+
     if (rootNode->is_dump_periodic())
     {
         os << "sim_cycle";
@@ -365,8 +578,14 @@ ostream& StatsBuilder::dump_header(ostream &os) const
     return os;
 }
 
-void StatsBuilder::init_timer_stats()
+void StatsBuilder::init_timer_stats(bool binary)
 {
+    binary_periodic = binary;
+
+    /* Binary dumps only keep the last value of each column */
+    if (binary)
+        return;
+
     if(!periodic_stats) {
         periodic_stats = get_new_stats();
     }
@@ -380,8 +599,11 @@ void StatsBuilder::init_timer_stats()
     }
 }
 
-ostream& StatsBuilder::dump_periodic(ostream& os, W64 cycle) const
+ostream& StatsBuilder::dump_periodic(ostream& os, W64 cycle)
 {
+    if (binary_periodic)
+        return dump_periodic_binary(os, cycle);
+
     /* Here we perform diff of last saved stats and updated user/kernel stats.
      * Addition/Subtraction is done on the operand1 so we keep two temporary
      * stats as copying is faster than addition/subtraction. */
@@ -402,6 +624,71 @@ ostream& StatsBuilder::dump_periodic(ostream& os, W64 cycle) const
     return os;
 }
 
+ostream& StatsBuilder::dump_header_binary(ostream &os)
+{
+    PeriodicColumns cols;
+    rootNode->get_periodic_columns(cols);
+
+    periodic_offsets.clear();
+    foreach(i, cols.offsets.count()) {
+        periodic_offsets.push(cols.offsets[i]);
+    }
+
+    int words = (periodic_offsets.count() + 63) / 64;
+    periodic_last.resize(periodic_offsets.count());
+    periodic_last.fill(0);
+    periodic_row.resize(1 + words + periodic_offsets.count());
+
+    W32 header[4];
+    header[0] = TIME_STATS_VERSION;
+    header[1] = periodic_offsets.count();
+    header[2] = cols.field_count;
+    header[3] = 0;
+
+    os.write(TIME_STATS_MAGIC, 8);
+    os.write((char*)header, sizeof(header));
+    os.write((char*)cols.fields.data, cols.fields.count());
+
+    return os;
+}
+
+/*
+ * Reads each column straight from the user and kernel Stats memory, no
+ * tree walk or string formatting.
+ */
+ostream& StatsBuilder::dump_periodic_binary(ostream& os, W64 cycle)
+{
+    int columns = periodic_offsets.count();
+    int words = (columns + 63) / 64;
+    W8 *user_mem = (W8*)user_stats->base();
+    W8 *kernel_mem = (W8*)kernel_stats->base();
+    W64 *row = periodic_row.data;
+    W64 *bitmap = row + 1;
+    W64 *values = bitmap + words;
+    int count = 0;
+
+    row[0] = cycle;
+    foreach(i, words) {
+        bitmap[i] = 0;
+    }
+
+    foreach(i, columns) {
+        W64 offset = periodic_offsets[i];
+        W64 value = *(W64*)(user_mem + offset) + *(W64*)(kernel_mem + offset);
+        W64 delta = value - periodic_last[i];
+
+        if(delta) {
+            periodic_last[i] = value;
+            bitmap[i / 64] |= (1ULL << (i % 64));
+            values[count++] = delta;
+        }
+    }
+
+    os.write((char*)row, sizeof(W64) * (1 + words + count));
+
+    return os;
+}
+
 ostream& StatsBuilder::dump_summary(ostream& os) const
 {
     if (rootNode->is_summarize_enabled()) {
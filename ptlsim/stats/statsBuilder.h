@@ -23,8 +23,16 @@
 #  define STATS_SIZE 1024*1024
 #endif
 
+/*
+ * Stats memory is tracked for writes in blocks of 1 << STATS_DIRTY_SHIFT
+ * bytes, a block that was never written since the last reset is all zero.
+ */
+#define STATS_DIRTY_SHIFT  12
+#define STATS_DIRTY_BLOCKS ((STATS_SIZE >> STATS_DIRTY_SHIFT) + 1)
+
 class StatObjBase;
 class Stats;
+class PeriodicColumns;
 
 inline static YAML::Emitter& operator << (YAML::Emitter& out, const W64 value)
 {
@@ -244,11 +252,45 @@ class Statable {
 
         ostream& dump_header(ostream &os) const;
 
+        void get_periodic_columns(PeriodicColumns &cols) const;
+
         stringbuf *get_full_stat_string() const;
 
 		StatObjBase* get_stat_obj(dynarray<stringbuf*> &names, int idx);
 };
 
+/**
+ * @brief Layout of the binary time-stats file
+ *
+ * Collected once when the header is written. Each column is a W64 counter
+ * at a fixed offset in the Stats memory, so a periodic dump only reads those
+ * offsets instead of walking the Stats tree. Fields are the named entries of
+ * the header: a field either shows one column or is an equation computed by
+ * the reader from other columns.
+ */
+class PeriodicColumns {
+    public:
+        enum { FIELD_COUNTER = 0, FIELD_EQUATION = 1 };
+        enum { EQUATION_ADD = 0, EQUATION_DIV = 1 };
+
+        dynarray<W64> offsets;
+        dynarray<W8> fields;
+        int field_count;
+
+        PeriodicColumns() : field_count(0) { }
+
+        /**
+         * @brief Column index of counter at given offset, added if needed
+         */
+        int column(W64 offset);
+
+        void add_counter(const char *name, W64 offset);
+        void add_equation(const char *name, int op, dynarray<W64> &elems);
+
+        void put(W64 value, int bytes);
+        void put_name(const char *name);
+};
+
 /**
  * @brief Builder interface to for Stats object
  *
@@ -263,10 +305,20 @@ class StatsBuilder {
         Statable *rootNode;
         W64 stat_offset;
 
+        /* Binary time-stats: counter offsets and their last dumped value */
+        bool binary_periodic;
+        dynarray<W64> periodic_offsets;
+        dynarray<W64> periodic_last;
+        dynarray<W64> periodic_row;
+
+        ostream& dump_header_binary(ostream &os);
+        ostream& dump_periodic_binary(ostream &os, W64 cycle);
+
         StatsBuilder()
         {
             rootNode = new Statable("", true);
             stat_offset = 0;
+            binary_periodic = false;
         }
 
         ~StatsBuilder()
@@ -360,7 +412,12 @@ class StatsBuilder {
          */
         bson_buffer* dump(Stats *stats, bson_buffer *bb) const;
 
-        void init_timer_stats();
+        /**
+         * @brief Setup periodic (time-stats) dumps
+         *
+         * @param binary Write the binary columnar format instead of CSV
+         */
+        void init_timer_stats(bool binary = false);
 
         void add_stats(Stats& dest_stats, Stats& src_stats) const
         {
@@ -385,8 +442,8 @@ class StatsBuilder {
         }
 
         bool is_dump_periodic() { return rootNode->is_dump_periodic(); }
-        ostream& dump_header(ostream &os) const;
-        ostream& dump_periodic(ostream &os, W64 cycle) const;
+        ostream& dump_header(ostream &os);
+        ostream& dump_periodic(ostream &os, W64 cycle);
         ostream& dump_summary(ostream &os) const;
 
         void delete_nodes()
@@ -408,28 +465,65 @@ class StatsBuilder {
  * classes to store their variables. Users are not allowed to directly create
  * an object of Stats, they must used StatsBuilder::get_new_stats() function
  * to get one.
+ *
+ * Every write through a StatObjBase marks its block in the dirty map, so
+ * reset, copy and add/sub only visit blocks that were written. Reads go
+ * through get() and leave the map untouched. The map has
+ * one byte per block instead of one bit so that cores simulated on their own
+ * threads can mark blocks without atomic operations.
  */
 class Stats {
     private:
         W8 *mem;
+        W8 *dirty;
 
         Stats()
         {
             mem = new W8[STATS_SIZE];
-            reset();
+            dirty = new W8[STATS_DIRTY_BLOCKS];
+            memset(mem, 0, sizeof(W8) * STATS_SIZE);
+            memset(dirty, 0, sizeof(W8) * STATS_DIRTY_BLOCKS);
         }
 
     public:
         friend class StatsBuilder;
+        friend class StatsDelta;
 
         W64 base()
         {
             return (W64)mem;
         }
 
+        W8* dirty_map()
+        {
+            return dirty;
+        }
+
+        void mark_dirty(W64 offset, W64 size = 1)
+        {
+            W64 last = (offset + size - 1) >> STATS_DIRTY_SHIFT;
+            for (W64 i = offset >> STATS_DIRTY_SHIFT; i <= last; i++)
+                dirty[i] = 1;
+        }
+
+        bool is_dirty(W64 offset, W64 size = 1) const
+        {
+            W64 last = (offset + size - 1) >> STATS_DIRTY_SHIFT;
+            for (W64 i = offset >> STATS_DIRTY_SHIFT; i <= last; i++) {
+                if (dirty[i]) return true;
+            }
+            return false;
+        }
+
         void reset()
         {
-            memset(mem, 0, sizeof(W8) * STATS_SIZE);
+            foreach (i, STATS_DIRTY_BLOCKS) {
+                if (dirty[i]) {
+                    memset(mem + (W64(i) << STATS_DIRTY_SHIFT), 0,
+                            block_size(i));
+                    dirty[i] = 0;
+                }
+            }
         }
 
         Stats& operator+=(Stats& rhs_stats)
@@ -440,9 +534,56 @@ class Stats {
 
         Stats& operator=(Stats& rhs_stats)
         {
-            memcpy(mem, rhs_stats.mem, sizeof(W8) * STATS_SIZE);
+            foreach (i, STATS_DIRTY_BLOCKS) {
+                if (dirty[i] | rhs_stats.dirty[i]) {
+                    W64 start = W64(i) << STATS_DIRTY_SHIFT;
+                    memcpy(mem + start, rhs_stats.mem + start, block_size(i));
+                    dirty[i] = rhs_stats.dirty[i];
+                }
+            }
             return *this;
         }
+
+    private:
+        static W64 block_size(int block)
+        {
+            W64 start = W64(block) << STATS_DIRTY_SHIFT;
+            return min(W64(STATS_SIZE) - start, W64(1) << STATS_DIRTY_SHIFT);
+        }
+};
+
+/**
+ * @brief Change of a Stats over one interval, to repeat it without
+ * simulating
+ *
+ * Measuring takes two intervals that must do the same work: the first one
+ * finds the blocks that are written, the second one records how much each
+ * counter in those blocks changes. apply() then adds that change again as
+ * many times as needed. Between start() and mark() and between snapshot()
+ * and measure() the dirty map of the Stats only holds the writes of the
+ * interval, so nothing else may use the Stats then.
+ */
+class StatsDelta {
+    private:
+        Stats *stats;
+        W8 *saved_dirty;
+        W8 *blocks;
+        W8 *delta;
+        bool tracking;
+
+        void begin_tracking();
+        void end_tracking();
+
+    public:
+        StatsDelta();
+        ~StatsDelta();
+
+        void start(Stats &stats);
+        void mark();
+        void snapshot();
+        bool measure();
+        void apply(W64 times);
+        void cancel();
 };
 
 /**
@@ -542,6 +683,11 @@ class StatObjBase {
 
         virtual ostream& dump_summary(ostream& os, Stats* stats, const char* pfx) const = 0;
 
+        /**
+         * @brief Add periodic counters of this object to binary time-stats
+         */
+        virtual void get_periodic_columns(PeriodicColumns &cols) const { }
+
         virtual void add_stats(Stats& dest_stats, Stats& src_stats) = 0;
         virtual void sub_stats(Stats& dest_stats, Stats& src_stats) = 0;
 
@@ -566,13 +712,17 @@ class StatObj : public StatObjBase {
         W64 offset;
 
         T *default_var;
+        W8 *dirty_flag;
 
         inline void set_default_var_ptr()
         {
             if(default_stats) {
                 default_var = (T*)(default_stats->base() + offset);
+                dirty_flag = default_stats->dirty_map() +
+                    (offset >> STATS_DIRTY_SHIFT);
             } else {
                 default_var = NULL;
+                dirty_flag = NULL;
             }
         }
 
@@ -590,6 +740,10 @@ class StatObj : public StatObjBase {
 
             offset = builder.get_offset(sizeof(T));
 
+            /* dirty_flag covers the whole variable */
+            assert((offset >> STATS_DIRTY_SHIFT) ==
+                    ((offset + sizeof(T) - 1) >> STATS_DIRTY_SHIFT));
+
             set_default_var_ptr();
         }
 
@@ -617,6 +771,7 @@ class StatObj : public StatObjBase {
         inline T operator++(int dummy)
         {
             assert(default_var);
+            *dirty_flag = 1;
             T ret = (*default_var)++;
             return ret;
         }
@@ -629,6 +784,7 @@ class StatObj : public StatObjBase {
         inline T operator++()
         {
             assert(default_var);
+            *dirty_flag = 1;
             (*default_var)++;
             return (*default_var);
         }
@@ -642,6 +798,7 @@ class StatObj : public StatObjBase {
          */
         inline T operator--(int dummy) {
             assert(default_var);
+            *dirty_flag = 1;
             T ret = (*default_var)--;
             return ret;
         }
@@ -653,6 +810,7 @@ class StatObj : public StatObjBase {
          */
         inline T operator--() {
             assert(default_var);
+            *dirty_flag = 1;
             (*default_var)--;
             return (*default_var);
         }
@@ -665,12 +823,14 @@ class StatObj : public StatObjBase {
          * @return T& with updated value
          */
         inline T& operator -= (T& val) {
+            *dirty_flag = 1;
             (*default_var) -= val;
             return (*default_var);
         }
 
         inline T& operator=(T& val) {
             assert(default_var);
+            *dirty_flag = 1;
             (*default_var) = val;
             return (*default_var);
         }
@@ -711,6 +871,7 @@ class StatObj : public StatObjBase {
          */
         inline T operator +=(const T &b) const {
             assert(default_var);
+            *dirty_flag = 1;
             *default_var += b;
             return *default_var;;
         }
@@ -725,6 +886,7 @@ class StatObj : public StatObjBase {
         inline T operator +=(const StatObj<T> &statObj) const {
             assert(default_var);
             assert(statObj.default_var);
+            *dirty_flag = 1;
             *default_var += (*statObj.default_var);
             return  *default_var;
         }
@@ -828,9 +990,23 @@ class StatObj : public StatObjBase {
          */
         inline T& operator()(Stats *stats) const
         {
+            /* Callers may write through the reference */
+            stats->mark_dirty(offset, sizeof(T));
             return *(T*)(stats->base() + offset);
         }
 
+        /**
+         * @brief Read the value in given Stats without marking it dirty
+         *
+         * @param stats Stats* to read from
+         *
+         * @return const reference of type T in given Stats
+         */
+        inline const T& get(Stats *stats) const
+        {
+            return *(const T*)(stats->base() + offset);
+        }
+
         /**
          * @brief Dump a string representation to ostream
          *
@@ -842,15 +1018,7 @@ class StatObj : public StatObjBase {
          */
         ostream& dump(ostream& os, Stats *stats, const char* pfx="") const
         {
-            if(is_dump_disabled()) return os;
-
-            T var = (*this)(stats);
-			stringbuf *full_string = get_full_stat_string();
-
-            os << pfx << *full_string << ":" << var << "\n";
-
-			delete full_string;
-            return os;
+            return dump_value(os, get(stats), pfx);
         }
 
         /**
@@ -863,14 +1031,7 @@ class StatObj : public StatObjBase {
          */
         YAML::Emitter& dump(YAML::Emitter &out, Stats *stats) const
         {
-            if(is_dump_disabled()) return out;
-
-            T var = (*this)(stats);
-
-            out << YAML::Key << (char *)name;
-            out << YAML::Value << var;
-
-            return out;
+            return dump_value(out, get(stats));
         }
 
         /**
@@ -883,24 +1044,24 @@ class StatObj : public StatObjBase {
          */
         bson_buffer* dump(bson_buffer *bb, Stats *stats) const
         {
-            if(is_dump_disabled()) return bb;
-
-            T var = (*this)(stats);
-
-            // FIXME : Currently we dump all values as 'long'
-            return bson_append_long(bb, (char *)name, var);
+            return dump_value(bb, get(stats));
         }
 
         void add_stats(Stats& dest_stats, Stats& src_stats)
         {
+            /* Clean blocks are zero, nothing to add */
+            if (!src_stats.is_dirty(offset)) return;
+
             T& dest_var = (*this)(&dest_stats);
-            dest_var += (*this)(&src_stats);
+            dest_var += *(T*)(src_stats.base() + offset);
         }
 
         void sub_stats(Stats& dest_stats, Stats& src_stats)
         {
+            if (!src_stats.is_dirty(offset)) return;
+
             T& dest_var = (*this)(&dest_stats);
-            dest_var -= (*this)(&src_stats);
+            dest_var -= *(T*)(src_stats.base() + offset);
         }
 
         void add_periodic_stats(Stats& dest_stats, Stats& src_stats)
@@ -921,18 +1082,75 @@ class StatObj : public StatObjBase {
         {
             if (is_dump_periodic())
             {
-                T& val = (*this)(stats);
-                os << "," << val;
+                os << "," << get(stats);
             }
             return os;
         }
 
+        void get_periodic_columns(PeriodicColumns &cols) const
+        {
+            if (is_dump_periodic()) {
+                assert(sizeof(T) == sizeof(W64));
+                stringbuf *full_string = get_full_stat_string();
+                cols.add_counter(full_string->buf, offset);
+                delete full_string;
+            }
+        }
+
+        /**
+         * @brief Offset of this counter in Stats memory
+         */
+        W64 get_offset() const
+        {
+            return offset;
+        }
+
         ostream &dump_summary(ostream &os, Stats *stats, const char* pfx) const
+        {
+            return dump_summary_value(os, get(stats), pfx);
+        }
+
+    protected:
+        /*
+         * Dump helpers that take the value to print, so StatEquation can
+         * print its result without storing it in the Stats.
+         */
+        ostream& dump_value(ostream& os, T var, const char* pfx) const
+        {
+            if(is_dump_disabled()) return os;
+
+			stringbuf *full_string = get_full_stat_string();
+
+            os << pfx << *full_string << ":" << var << "\n";
+
+			delete full_string;
+            return os;
+        }
+
+        YAML::Emitter& dump_value(YAML::Emitter &out, T var) const
+        {
+            if(is_dump_disabled()) return out;
+
+            out << YAML::Key << (char *)name;
+            out << YAML::Value << var;
+
+            return out;
+        }
+
+        bson_buffer* dump_value(bson_buffer *bb, T var) const
+        {
+            if(is_dump_disabled()) return bb;
+
+            // FIXME : Currently we dump all values as 'long'
+            return bson_append_long(bb, (char *)name, var);
+        }
+
+        ostream &dump_summary_value(ostream &os, T var, const char* pfx) const
         {
             if (is_summarize_enabled()) {
-                T& val = (*this)(stats);
                 stringbuf *name = get_full_stat_string();
-                os << pfx << "." << (*name) << " = " << val << endl;
+                os << pfx << "." << (*name) << " = " << var << endl;
+                delete name;
             }
 
             return os;
@@ -1011,6 +1229,8 @@ class StatArray : public StatObjBase {
             assert(index < size);
             assert(default_var);
 
+            default_stats->mark_dirty(offset + sizeof(T) * index);
+
             BaseArr& arr = *(BaseArr*)(default_var);
             return arr[index];
         }
@@ -1025,9 +1245,23 @@ class StatArray : public StatObjBase {
          */
         BaseArr& operator()(Stats *stats) const
         {
+            /* Callers may write through the reference */
+            stats->mark_dirty(offset, sizeof(BaseArr));
             return *(BaseArr*)(stats->base() + offset);
         }
 
+        /**
+         * @brief Read the array in given Stats without marking it dirty
+         *
+         * @param stats Stats* to read from
+         *
+         * @return const reference of array of type T in given Stats
+         */
+        const BaseArr& get(Stats *stats) const
+        {
+            return *(const BaseArr*)(stats->base() + offset);
+        }
+
         /**
          * @brief dump string representation of StatArray
          *
@@ -1044,14 +1278,14 @@ class StatArray : public StatObjBase {
 			stringbuf *full_string = get_full_stat_string();
 
 			if (labels) {
-				BaseArr& arr = (*this)(stats);
+				const BaseArr& arr = get(stats);
 				foreach(i, size) {
 					os << pfx << *full_string << "." << labels[i] <<
 						":" << arr[i] << "\n";
 				}
 			} else {
 				os << pfx << *full_string << ":";
-				BaseArr& arr = (*this)(stats);
+				const BaseArr& arr = get(stats);
 				foreach(i, size) {
 					os << arr[i] << " ";
 				}
@@ -1081,7 +1315,7 @@ class StatArray : public StatObjBase {
             if(labels) {
                 out << YAML::BeginMap;
 
-                BaseArr& arr = (*this)(stats);
+                const BaseArr& arr = get(stats);
                 foreach(i, size) {
                     out << YAML::Key << labels[i];
                     out << YAML::Value << arr[i];
@@ -1092,7 +1326,7 @@ class StatArray : public StatObjBase {
                 out << YAML::Flow;
                 out << YAML::BeginSeq;
 
-                BaseArr& arr = (*this)(stats);
+                const BaseArr& arr = get(stats);
                 foreach(i, size) {
                     out << arr[i];
                 }
@@ -1119,7 +1353,7 @@ class StatArray : public StatObjBase {
             char numstr[16];
             bson_buffer *arr;
 
-            BaseArr& val = (*this)(stats);
+            const BaseArr& val = get(stats);
             if(labels) {
                 arr = bson_append_start_object(bb, (char *)name);
 
@@ -1140,8 +1374,11 @@ class StatArray : public StatObjBase {
 
         void add_stats(Stats& dest_stats, Stats& src_stats)
         {
+            /* Clean blocks are zero, nothing to add */
+            if (!src_stats.is_dirty(offset, sizeof(BaseArr))) return;
+
             BaseArr& dest_arr = (*this)(&dest_stats);
-            BaseArr& src_arr = (*this)(&src_stats);
+            BaseArr& src_arr = *(BaseArr*)(src_stats.base() + offset);
             foreach(i, size) {
                 dest_arr[i] += src_arr[i];
             }
@@ -1149,8 +1386,10 @@ class StatArray : public StatObjBase {
 
         void sub_stats(Stats& dest_stats, Stats& src_stats)
         {
+            if (!src_stats.is_dirty(offset, sizeof(BaseArr))) return;
+
             BaseArr& dest_arr = (*this)(&dest_stats);
-            BaseArr& src_arr = (*this)(&src_stats);
+            BaseArr& src_arr = *(BaseArr*)(src_stats.base() + offset);
             foreach(i, size) {
                 dest_arr[i] -= src_arr[i];
             }
@@ -1212,7 +1451,7 @@ class StatArray : public StatObjBase {
         {
             if (!is_dump_periodic()) return os;
 
-            BaseArr& arr = (*this)(stats);
+            const BaseArr& arr = get(stats);
 
             foreach(i, size) {
                 if(periodic_flag[i]) {
@@ -1223,6 +1462,32 @@ class StatArray : public StatObjBase {
             return os;
         }
 
+        void get_periodic_columns(PeriodicColumns &cols) const
+        {
+            if (!is_dump_periodic()) return;
+
+            assert(sizeof(T) == sizeof(W64));
+            stringbuf *full_string = get_full_stat_string();
+            stringbuf col_name;
+
+            foreach(i, size) {
+                if(periodic_flag[i]) {
+                    col_name.reset();
+                    col_name << *full_string << ".";
+
+                    if(labels) {
+                        col_name << labels[i];
+                    } else {
+                        col_name << i;
+                    }
+
+                    cols.add_counter(col_name.buf, offset + sizeof(T) * i);
+                }
+            }
+
+            delete full_string;
+        }
+
         void enable_summary(int id = -1)
         {
             StatObjBase::enable_summary();
@@ -1238,7 +1503,7 @@ class StatArray : public StatObjBase {
         {
             if (!is_summarize_enabled()) return os;
 
-            BaseArr& arr = (*this)(stats);
+            const BaseArr& arr = get(stats);
             stringbuf* name = get_full_stat_string();
 
             foreach (i, size) {
@@ -1355,6 +1620,7 @@ class StatString : public StatObjBase {
 
             assert(default_var);
 
+            default_stats->mark_dirty(offset, MAX_STAT_STR_SIZE);
             strcpy(default_var, str);
 
             return default_var;
@@ -1410,9 +1676,21 @@ class StatString : public StatObjBase {
          */
         inline char* operator()(Stats *stats) const
         {
+            /* Callers may write through the pointer */
+            stats->mark_dirty(offset, MAX_STAT_STR_SIZE);
             return (char*)(stats->base() + offset);
         }
 
+        /**
+         * @brief Read the string of given Stats without marking it dirty
+         *
+         * @param stats A Stats database pointer
+         */
+        inline const char* get(Stats *stats) const
+        {
+            return (const char*)(stats->base() + offset);
+        }
+
         /**
          * @brief Dump string of given database to given ostream
          *
@@ -1424,7 +1702,7 @@ class StatString : public StatObjBase {
         {
             if(is_dump_disabled()) return os;
 
-            char* var = (*this)(stats);
+            const char* var = get(stats);
 			stringbuf *full_string = get_full_stat_string();
 
             if(split[0] != '\0') {
@@ -1456,7 +1734,7 @@ class StatString : public StatObjBase {
         {
             if(is_dump_disabled()) return out;
 
-            char* var = (*this)(stats);
+            const char* var = get(stats);
 
             if(split[0] != '\0') {
                 dynarray<stringbuf*> tags;
@@ -1495,7 +1773,7 @@ class StatString : public StatObjBase {
         {
             if(is_dump_disabled()) return bb;
 
-            char* var = (*this)(stats);
+            const char* var = get(stats);
 
             if(split[0] != '\0') {
                 dynarray<stringbuf*> tags;
@@ -1549,13 +1827,15 @@ class StatString : public StatObjBase {
 struct StatObjFormulaAdd {
     typedef dynarray<StatObj<W64>* > elems_t;
 
+    enum { periodic_op = PeriodicColumns::EQUATION_ADD };
+
     static W64 compute(Stats* stats, const elems_t& elems)
     {
         W64 ret = 0;
 
         foreach(i, elems.count()) {
             StatObj<W64>& e = *elems[i];
-            ret += e(stats);
+            ret += e.get(stats);
         }
 
         return ret;
@@ -1568,13 +1848,15 @@ struct StatObjFormulaAdd {
 struct StatObjFormulaDiv {
     typedef dynarray<StatObj<W64>* > elems_t;
 
+    enum { periodic_op = PeriodicColumns::EQUATION_DIV };
+
     static double compute(Stats* stats, const elems_t& elems)
     {
         double ret = 0;
 
         assert(elems.count() == 2);
-        double val1 = double((*elems[0])(stats));
-        double val2 = double((*elems[1])(stats));
+        double val1 = double(elems[0]->get(stats));
+        double val2 = double(elems[1]->get(stats));
 
         if(val2 == 0)
             return ret;
@@ -1592,8 +1874,10 @@ struct StatObjFormulaDiv {
  * @tparam K Type of result to store
  * @tparam F Formula to compute result
  *
- * The computation is done when any of the 'dump' function is called. This
- * class only supports computation over StatObj<T> type objects.
+ * The computation is done when any of the 'dump' function is called, the
+ * result is only printed and never stored in the Stats, so dumping leaves
+ * every block clean. This class only supports computation over StatObj<T>
+ * type objects.
  */
 template<typename T, typename K, typename F>
 class StatEquation : public StatObj<K> {
@@ -1604,14 +1888,15 @@ class StatEquation : public StatObj<K> {
         F formula;
 
         /**
-         * @brief Perform computation and store result
+         * @brief Perform computation
          *
          * @param stats Stats Database used for computation
+         *
+         * @return Result of the formula
          */
-        void compute(Stats* stats) const
+        K compute(Stats* stats) const
         {
-            K& val = (*this)(stats);
-            val = formula.compute(stats, elems);
+            return formula.compute(stats, elems);
         }
 
     public:
@@ -1636,6 +1921,16 @@ class StatEquation : public StatObj<K> {
             elems.push(obj);
         }
 
+        /**
+         * @brief Result of the formula over given Stats
+         *
+         * @param stats Stats Database used for computation
+         */
+        K operator()(Stats *stats) const
+        {
+            return compute(stats);
+        }
+
         void enable_periodic_dump()
         {
             base_t::enable_periodic_dump();
@@ -1655,8 +1950,7 @@ class StatEquation : public StatObj<K> {
          */
         ostream& dump(ostream& os, Stats *stats, const char* pfx="") const
         {
-            compute(stats);
-            return base_t::dump(os, stats, pfx);
+            return base_t::dump_value(os, compute(stats), pfx);
         }
 
         /**
@@ -1670,8 +1964,7 @@ class StatEquation : public StatObj<K> {
         YAML::Emitter& dump(YAML::Emitter& out,
                 Stats *stats) const
         {
-            compute(stats);
-            return base_t::dump(out, stats);
+            return base_t::dump_value(out, compute(stats));
         }
 
         /**
@@ -1685,8 +1978,7 @@ class StatEquation : public StatObj<K> {
         bson_buffer* dump(bson_buffer* out,
                 Stats *stats) const
         {
-            compute(stats);
-            return base_t::dump(out, stats);
+            return base_t::dump_value(out, compute(stats));
         }
 
         /**
@@ -1698,10 +1990,38 @@ class StatEquation : public StatObj<K> {
          */
         ostream& dump_periodic(ostream &os, Stats *stats) const
         {
-            compute(stats);
-            base_t::dump_periodic(os, stats);
+            if (this->is_dump_periodic())
+                os << "," << compute(stats);
             return os;
         }
+
+        /**
+         * @brief Print summary value of this Stats Object
+         */
+        ostream &dump_summary(ostream &os, Stats *stats, const char* pfx) const
+        {
+            return base_t::dump_summary_value(os, compute(stats), pfx);
+        }
+
+        /**
+         * @brief Add this equation to binary time-stats
+         *
+         * The result is not stored in the file, the reader computes it from
+         * the columns of the elements.
+         */
+        void get_periodic_columns(PeriodicColumns &cols) const
+        {
+            if (!this->is_dump_periodic()) return;
+
+            dynarray<W64> elem_offsets;
+            foreach(i, elems.count()) {
+                elem_offsets.push(elems[i]->get_offset());
+            }
+
+            stringbuf *full_string = this->get_full_stat_string();
+            cols.add_equation(full_string->buf, F::periodic_op, elem_offsets);
+            delete full_string;
+        }
 };
 
 #endif // STATS_BUILDER_H
@@ -151,7 +151,7 @@ namespace {
 
                 // clean up bbcache
                 foreach(i, NUM_SIM_CORES) {
-                    bbcache[i].flush(i);
+                    bbcache[i].invalidate_all();
                 }
             }
     };
@@ -929,6 +929,64 @@ namespace {
         ASSERT_TRUE(op.all_src_ready());
     }
 
+    TEST_F(AtomCoreTest, ResetKeepsBranchPredictor)
+    {
+        AtomCore& core = *(AtomCore*)base_machine->cores[0];
+        AtomThread& thread = *core.threads[0];
+        PredictorUpdate update;
+        int ret = BRANCH_HINT_INDIRECT | BRANCH_HINT_RET;
+
+        // Train an indirect jump and a call while fast-forwarding
+        core.warm_branch(thread.ctx, BRANCH_HINT_INDIRECT, 0x4010, 0, 0x8000);
+        core.warm_branch(thread.ctx, BRANCH_HINT_CALL, 0x4020, 0x9000, 0x9000);
+
+        ASSERT_EQ(thread.branchpred.predict(update, ret, 0x9010, 0), 0x4020);
+
+        // Switching into simulation resets the core on its first run
+        core.reset();
+
+        // The BTB keeps the jump target, the RAS of the old pipeline is gone
+        ASSERT_EQ(thread.branchpred.predict(update, BRANCH_HINT_INDIRECT,
+                    0x4010, 0), 0x8000);
+        ASSERT_EQ(thread.branchpred.predict(update, ret, 0x9010, 0), 0);
+    }
+
+    TEST_F(AtomCoreTest, ResetKeepsWarmState)
+    {
+        const char* filename = "/tmp/test_atom_warm_state";
+        AtomCore& core = *(AtomCore*)base_machine->cores[0];
+        AtomThread& thread = *core.threads[0];
+        PredictorUpdate update;
+        WarmStateFile ws;
+
+        core.warm_branch(thread.ctx, BRANCH_HINT_INDIRECT, 0x4010, 0, 0x8000);
+        core.dtlb.insert(0x7000, 0);
+
+        ASSERT_TRUE(ws.create(filename, 0x1234));
+        core.save_warm_state(ws);
+        ws.close();
+
+        // Start from an untrained predictor and an empty TLB
+        thread.branchpred.reset();
+        core.dtlb.reset();
+        ASSERT_FALSE(core.dtlb.probe(0x7000, 0));
+
+        ASSERT_TRUE(ws.open(filename, 0x1234));
+        core.load_warm_state(ws);
+
+        // The reset of the first run keeps everything restored
+        core.reset();
+        ASSERT_EQ(thread.branchpred.predict(update, BRANCH_HINT_INDIRECT,
+                    0x4010, 0), 0x8000);
+        ASSERT_TRUE(core.dtlb.probe(0x7000, 0));
+
+        // Resets after a sampling fast-forward only drop the stale TLBs
+        core.reset();
+        ASSERT_EQ(thread.branchpred.predict(update, BRANCH_HINT_INDIRECT,
+                    0x4010, 0), 0x8000);
+        ASSERT_FALSE(core.dtlb.probe(0x7000, 0));
+    }
+
     TEST(AtomCoreModelTest, CheckFUEnums)
     {
         ASSERT_EQ(FU_ALU0, 0x1);
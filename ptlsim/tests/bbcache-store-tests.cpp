@@ -0,0 +1,169 @@
+
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <superstl.h>
+#include <decode.h>
+#include <bbcache-store.h>
+
+#include <unistd.h>
+
+namespace {
+
+    const char* store_file = "/tmp/test_bbcache_store";
+
+    /* Decoder state of a fetched, not yet translated block */
+    void setup_decoder(TraceDecoder& trans, byte* insnbytes)
+    {
+        foreach (i, 16) insnbytes[i] = 0x90 + i;
+
+        trans.insnbytes = insnbytes;
+        trans.valid_byte_count = 16;
+        trans.hflags = 0x40;
+        trans.pe = 1;
+        trans.bb.rip.mfnlo = 0x1234;
+        trans.bb.rip.mfnhi = 0x1235;
+    }
+
+    /* Block as the decoder would produce it from the bytes above */
+    void setup_block(TraceDecoder& trans)
+    {
+        trans.bb.count = 3;
+        trans.bb.bytes = 12;
+        trans.bb.user_insn_count = 2;
+        trans.bb.rip_taken = 0x400100;
+        trans.bb.rip_not_taken = 0x40000c;
+
+        foreach (i, 3) {
+            trans.bb.transops[i].init(OP_add, REG_rax, REG_rax, REG_imm,
+                    REG_zero, 3, i + 1);
+        }
+    }
+
+    TEST(BasicBlockStore, InsertAndLookup)
+    {
+        unlink(store_file);
+
+        BasicBlockStore store;
+        byte insnbytes[16];
+        bool stale;
+
+        ASSERT_TRUE(store.open(store_file, 1));
+        ASSERT_TRUE(store.writable());
+
+        TraceDecoder trans(0x400000, true, false, false);
+        setup_decoder(trans, insnbytes);
+
+        ASSERT_TRUE(store.lookup(trans, insnbytes, stale) == NULL);
+        ASSERT_FALSE(stale);
+
+        setup_block(trans);
+        BasicBlock* bb = trans.bb.clone();
+        ASSERT_TRUE(store.insert(trans, insnbytes, *bb));
+        bb->free();
+
+        /* A new decoder for the same block, as on the next run */
+        TraceDecoder next(0x400000, true, false, false);
+        setup_decoder(next, insnbytes);
+
+        bb = store.lookup(next, insnbytes, stale);
+        ASSERT_TRUE(bb != NULL);
+        ASSERT_EQ(3, bb->count);
+        ASSERT_EQ(12, bb->bytes);
+        ASSERT_EQ(0x400100U, bb->rip_taken);
+        ASSERT_EQ(0, bb->refcount);
+        ASSERT_TRUE(bb->synthops == NULL);
+        ASSERT_EQ(3, bb->transops[2].rbimm);
+        bb->free();
+
+        /* Different decode mode is a different block */
+        TraceDecoder kernel(0x400000, true, true, false);
+        setup_decoder(kernel, insnbytes);
+        ASSERT_TRUE(store.lookup(kernel, insnbytes, stale) == NULL);
+
+        /* Changed code is decoded again */
+        insnbytes[5] = 0xcc;
+        ASSERT_TRUE(store.lookup(next, insnbytes, stale) == NULL);
+        ASSERT_TRUE(stale);
+
+        /* Bytes after the end of the block do not matter */
+        insnbytes[5] = 0x95;
+        insnbytes[14] = 0xcc;
+        bb = store.lookup(next, insnbytes, stale);
+        ASSERT_TRUE(bb != NULL);
+        bb->free();
+
+        store.close();
+        unlink(store_file);
+    }
+
+    TEST(BasicBlockStore, Persistent)
+    {
+        unlink(store_file);
+
+        byte insnbytes[16];
+        bool stale;
+
+        {
+            BasicBlockStore store;
+            ASSERT_TRUE(store.open(store_file, 1));
+
+            TraceDecoder trans(0x400000, true, false, false);
+            setup_decoder(trans, insnbytes);
+            setup_block(trans);
+            ASSERT_TRUE(store.insert(trans, insnbytes, trans.bb));
+            store.close();
+        }
+
+        BasicBlockStore store;
+        ASSERT_TRUE(store.open(store_file, 1));
+
+        /* A second user of the same file only reads it */
+        BasicBlockStore other;
+        ASSERT_TRUE(other.open(store_file, 1));
+        ASSERT_FALSE(other.writable());
+
+        TraceDecoder trans(0x400000, true, false, false);
+        setup_decoder(trans, insnbytes);
+        setup_block(trans);
+
+        BasicBlock* bb = store.lookup(trans, insnbytes, stale);
+        ASSERT_TRUE(bb != NULL);
+        bb->free();
+
+        bb = other.lookup(trans, insnbytes, stale);
+        ASSERT_TRUE(bb != NULL);
+        bb->free();
+
+        ASSERT_FALSE(other.insert(trans, insnbytes, trans.bb));
+
+        other.close();
+        store.close();
+        unlink(store_file);
+    }
+
+    TEST(BasicBlockStore, SkipsFaultingBlocks)
+    {
+        unlink(store_file);
+
+        BasicBlockStore store;
+        byte insnbytes[16];
+
+        ASSERT_TRUE(store.open(store_file, 1));
+
+        TraceDecoder trans(0x400000, true, false, false);
+        setup_decoder(trans, insnbytes);
+        setup_block(trans);
+
+        trans.bb.invalidblock = 1;
+        ASSERT_FALSE(store.insert(trans, insnbytes, trans.bb));
+
+        trans.bb.invalidblock = 0;
+        trans.valid_byte_count = 8;
+        ASSERT_FALSE(store.insert(trans, insnbytes, trans.bb));
+
+        store.close();
+        unlink(store_file);
+    }
+}
@@ -0,0 +1,63 @@
+
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <superstl.h>
+#include <decode.h>
+
+namespace {
+
+    BasicBlock* new_block(Waddr rip)
+    {
+        BasicBlock* bb = (BasicBlock*)malloc(sizeof(BasicBlockBase));
+        bb->reset();
+        bb->rip.rip = rip;
+        bb->unchecked.setall();
+        return bb;
+    }
+
+    /* A TLB flush only visits the blocks the context checked since its
+     * last flush */
+    TEST(BasicBlockCache, FlushCheckedBlocks)
+    {
+        BasicBlockCache& cache = bbcache[0];
+        BasicBlock* a = new_block(0x1000);
+        BasicBlock* b = new_block(0x2000);
+        BasicBlock* c = new_block(0x3000);
+
+        cache.flush(-1);
+        ASSERT_FALSE(cache.checked[0]);
+
+        cache.mark_checked(a, 0);
+        cache.mark_checked(b, 0);
+        cache.mark_checked(b, 0);
+        ASSERT_FALSE(a->unchecked.test(0));
+        ASSERT_FALSE(b->unchecked.test(0));
+        ASSERT_TRUE(c->unchecked.test(0));
+
+        cache.flush(0);
+        ASSERT_TRUE(a->unchecked.test(0));
+        ASSERT_TRUE(b->unchecked.test(0));
+        ASSERT_TRUE(a->checkedlink[0].unlinked());
+        ASSERT_TRUE(b->checkedlink[0].unlinked());
+        ASSERT_FALSE(cache.checked[0]);
+
+        /* An invalidated block leaves the list and the others stay */
+        cache.mark_checked(a, 0);
+        cache.mark_checked(b, 0);
+        cache.mark_checked(c, 0);
+        b->unlink_checked();
+        b->unchecked.reset(0);
+
+        cache.flush(-1);
+        ASSERT_TRUE(a->unchecked.test(0));
+        ASSERT_FALSE(b->unchecked.test(0));
+        ASSERT_TRUE(c->unchecked.test(0));
+        ASSERT_FALSE(cache.checked[0]);
+
+        ::free(a);
+        ::free(b);
+        ::free(c);
+    }
+};
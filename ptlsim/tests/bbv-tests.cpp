@@ -0,0 +1,94 @@
+
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <bbv.h>
+
+#include <fstream>
+
+namespace {
+
+    template <typename T>
+    T read_val(std::ifstream& is)
+    {
+        T val;
+        is.read((char*)&val, sizeof(T));
+        return val;
+    }
+
+    TEST(BBVProfiler, WritesVectors)
+    {
+        const char* filename = "/tmp/test_bbv";
+        BBVProfiler bbv;
+
+        ASSERT_TRUE(bbv.open(filename, 2, 100));
+
+        /* Interval 1: 100 instructions */
+        bbv.add(0, 0x1000, 10);
+        bbv.add(1, 0x2000, 20);
+        bbv.add(0, 0x1000, 10);
+        bbv.add(0, 0x3000, 60);
+
+        /* Interval 2, the block crossing the end counts in it */
+        bbv.add(1, 0x3000, 50);
+        bbv.add(1, 0x1000, 70);
+
+        /* Partial interval, not written */
+        bbv.add(0, 0x4000, 5);
+
+        ASSERT_EQ(2U, bbv.get_intervals());
+        ASSERT_EQ(4U, bbv.get_blocks());
+        bbv.close();
+
+        std::ifstream is(filename, std::ios::in | std::ios::binary);
+        char magic[8];
+        is.read(magic, 8);
+        ASSERT_EQ(0, memcmp(magic, BBV_MAGIC, 8));
+        ASSERT_EQ(BBV_VERSION, read_val<W32>(is));
+        ASSERT_EQ(2U, read_val<W32>(is));
+        ASSERT_EQ(100U, read_val<W64>(is));
+
+        W64 rips[4] = {0, 0, 0, 0};
+        W64 insns[2][2][4];
+        int vectors = 0;
+        memset(insns, 0, sizeof(insns));
+
+        while (is.peek() != EOF) {
+            W32 type = read_val<W32>(is);
+
+            if (type == BBV_RECORD_BLOCK) {
+                W32 id = read_val<W32>(is);
+                ASSERT_LT(id, 4U);
+                rips[id] = read_val<W64>(is);
+                continue;
+            }
+
+            ASSERT_EQ(BBV_RECORD_VECTOR, type);
+            W32 thread = read_val<W32>(is);
+            W32 entries = read_val<W32>(is);
+            read_val<W32>(is);
+
+            ASSERT_EQ(vectors % 2, thread);
+            W32 ids[4];
+            is.read((char*)ids, sizeof(W32) * entries);
+            foreach (i, entries) {
+                insns[vectors / 2][thread][ids[i]] = read_val<W64>(is);
+            }
+            vectors++;
+        }
+
+        ASSERT_EQ(4, vectors);
+        ASSERT_EQ(0x1000U, rips[0]);
+        ASSERT_EQ(0x2000U, rips[1]);
+        ASSERT_EQ(0x3000U, rips[2]);
+        ASSERT_EQ(0x4000U, rips[3]);
+
+        ASSERT_EQ(20U, insns[0][0][0]);
+        ASSERT_EQ(60U, insns[0][0][2]);
+        ASSERT_EQ(20U, insns[0][1][1]);
+        ASSERT_EQ(0U, insns[1][0][0]);
+        ASSERT_EQ(50U, insns[1][1][2]);
+        ASSERT_EQ(70U, insns[1][1][0]);
+    }
+}
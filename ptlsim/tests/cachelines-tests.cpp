@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <superstl.h>
+#include <memoryHierarchy.h>
+#include <cacheLines.h>
+
+#include <iostream>
+
+using namespace Memory;
+
+namespace {
+
+    /*
+     * Run the same access stream on the compiled and the run-time sized
+     * cache lines, both must hit, evict and invalidate identically.
+     */
+    template <int SETS, int WAYS>
+    void compare_cachelines(int accesses)
+    {
+        CacheLines<SETS, WAYS, 64, 2> compiled(2, 2);
+        DynamicCacheLines dynamic(SETS, WAYS, 64, 2, 2, 2);
+        MemoryRequest request;
+        W64 seed = 1;
+
+        compiled.init();
+        dynamic.init();
+
+        ASSERT_EQ(compiled.get_size(), dynamic.get_size());
+        ASSERT_EQ(compiled.get_line_bits(), dynamic.get_line_bits());
+
+        foreach (i, accesses) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            W64 addr = (seed >> 20) % (SETS * WAYS * 64 * 4);
+
+            request.init(0, 0, addr, 0, i, false, 0, i, MEMORY_OP_READ);
+
+            CacheLine *line1 = compiled.probe(&request);
+            CacheLine *line2 = dynamic.probe(&request);
+            ASSERT_EQ(line1 == NULL, line2 == NULL);
+
+            if (line1 == NULL) {
+                W64 oldTag1 = InvalidTag<W64>::INVALID;
+                W64 oldTag2 = InvalidTag<W64>::INVALID;
+                compiled.insert(&request, oldTag1);
+                dynamic.insert(&request, oldTag2);
+                ASSERT_EQ(oldTag1, oldTag2);
+            }
+
+            if (i % 97 == 0) {
+                ASSERT_EQ(compiled.invalidate(&request),
+                        dynamic.invalidate(&request));
+            }
+        }
+    }
+
+    TEST(DynamicCacheLines, MatchesCompiledCacheLines)
+    {
+        compare_cachelines<64, 4>(100000);
+        compare_cachelines<256, 8>(100000);
+        compare_cachelines<128, 16>(100000);
+    }
+
+    TEST(DynamicCacheLines, Geometry)
+    {
+        DynamicCacheLines lines(512, 8, 64, 5, 2, 1);
+        lines.init();
+
+        ASSERT_EQ(512 * 8 * 64, lines.get_size());
+        ASSERT_EQ(6, lines.get_line_bits());
+        ASSERT_EQ(5, lines.get_access_latency());
+        ASSERT_EQ(0x12340, lines.tagOf(0x1237f));
+    }
+
+    /*
+     * Host cycles per access of the template-specialized cache lines and of
+     * DynamicCacheLines with the same geometry, over a working set twice
+     * the size of a 32K 8-way L1.
+     */
+    template <typename T>
+    W64 time_cachelines(T& lines, int accesses, CycleTimer& timer)
+    {
+        MemoryRequest request;
+        W64 seed = 1;
+        W64 hits = 0;
+
+        lines.init();
+
+        timer.start();
+        foreach (i, accesses) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            W64 addr = (seed >> 20) % (64 * 8 * 64 * 2);
+
+            request.init(0, 0, addr, 0, i, false, 0, i, MEMORY_OP_READ);
+
+            if (lines.probe(&request)) {
+                hits++;
+            } else {
+                W64 oldTag = InvalidTag<W64>::INVALID;
+                lines.insert(&request, oldTag);
+            }
+        }
+        timer.stop();
+
+        return hits;
+    }
+
+    TEST(DynamicCacheLinesBench, Probe)
+    {
+        const int accesses = 1 << 22;
+        CycleTimer compiled_timer;
+        CycleTimer dynamic_timer;
+
+        CacheLines<64, 8, 64, 4> *compiled =
+            new CacheLines<64, 8, 64, 4>(2, 1);
+        DynamicCacheLines *dynamic =
+            new DynamicCacheLines(64, 8, 64, 4, 2, 1);
+
+        W64 compiled_hits = time_cachelines(*compiled, accesses,
+                compiled_timer);
+        W64 dynamic_hits = time_cachelines(*dynamic, accesses,
+                dynamic_timer);
+
+        ASSERT_EQ(compiled_hits, dynamic_hits);
+        delete compiled;
+        delete dynamic;
+
+        std::cout << "Cache lines probe/insert: "
+            << (double)compiled_timer.cycles() / accesses
+            << " cycles compiled, "
+            << (double)dynamic_timer.cycles() / accesses
+            << " cycles with DynamicCacheLines" << std::endl;
+    }
+}
@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <superstl.h>
+#include <eventQueue.h>
+#include <memoryStats.h>
+#include <statsBuilder.h>
+
+using namespace Memory;
+
+namespace {
+
+    struct EventRecorder {
+        dynarray<W64> order;
+
+        bool record(void *arg) {
+            order.push((W64)arg);
+            return true;
+        }
+    };
+
+    TEST(EventQueue, SameCycleFIFO)
+    {
+        EventRecorder rec;
+        Signal sig("record");
+        sig.connect(signal_mem_ptr(rec, &EventRecorder::record));
+
+        EventQueue queue;
+
+        foreach (i, 10) {
+            queue.add(&sig, 5, (void*)(W64)i);
+        }
+        queue.add(&sig, 3, (void*)(W64)100);
+
+        ASSERT_EQ(11, queue.count());
+        ASSERT_EQ(3, queue.next_clock());
+
+        ASSERT_EQ(0, queue.dispatch(2));
+        ASSERT_EQ(1, queue.dispatch(3));
+        ASSERT_EQ(10, queue.dispatch(5));
+        ASSERT_TRUE(queue.empty());
+
+        ASSERT_EQ(100, rec.order[0]);
+        foreach (i, 10) {
+            ASSERT_EQ(i, rec.order[i + 1]);
+        }
+    }
+
+    TEST(EventQueue, OverflowMigration)
+    {
+        EventRecorder rec;
+        Signal sig("record");
+        sig.connect(signal_mem_ptr(rec, &EventRecorder::record));
+
+        EventQueue queue;
+        W64 far = EVENT_WHEEL_SIZE * 3 + 7;
+
+        queue.add(&sig, far, (void*)1);
+        queue.add(&sig, far, (void*)2);
+        queue.add(&sig, 10, (void*)0);
+
+        ASSERT_EQ(10, queue.next_clock());
+        ASSERT_EQ(1, queue.dispatch(far - 1));
+        ASSERT_EQ(far, queue.next_clock());
+
+        // Added after the far events migrated into the wheel
+        queue.add(&sig, far, (void*)3);
+
+        ASSERT_EQ(3, queue.dispatch(far));
+        ASSERT_EQ(4, rec.order.count());
+        foreach (i, 4) {
+            ASSERT_EQ(i, rec.order[i]);
+        }
+    }
+
+    TEST(EventQueue, NoFixedCapacity)
+    {
+        EventRecorder rec;
+        Signal sig("record");
+        sig.connect(signal_mem_ptr(rec, &EventRecorder::record));
+
+        EventQueue queue;
+        int total = EVENT_POOL_CHUNK * 20;
+
+        foreach (i, total) {
+            queue.add(&sig, 1 + (i % 4000), (void*)(W64)i);
+        }
+
+        ASSERT_EQ(total, queue.count());
+        ASSERT_EQ(total, queue.dispatch(4000));
+        ASSERT_EQ(W64(-1), queue.next_clock());
+
+        queue.add(&sig, 4100, NULL);
+        queue.reset();
+        ASSERT_TRUE(queue.empty());
+    }
+
+    /*
+     * Run the queue to cycle 'end' with two events pending, one at cycle
+     * 2 and one at 'wake'. With 'skip_idle' the idle cycles in between are
+     * skipped like BaseMachine::run_serial does with -skip-idle: measure
+     * one idle cycle, replay its stats and skip the rest.
+     */
+    void run_idle(EventQueue &queue, Stats *stats, W64 wake, W64 end,
+            bool skip_idle)
+    {
+        EventRecorder rec;
+        Signal sig("record");
+        sig.connect(signal_mem_ptr(rec, &EventRecorder::record));
+
+        queue.add(&sig, 2, NULL);
+        queue.add(&sig, wake, NULL);
+
+        W64 cycle = 0;
+        while (cycle <= 2) queue.dispatch(cycle++);
+
+        if (skip_idle) {
+            StatsDelta delta;
+            delta.start(*stats);
+            queue.dispatch(cycle++);
+            delta.mark();
+
+            delta.snapshot();
+            queue.dispatch(cycle++);
+            ASSERT_TRUE(delta.measure());
+
+            ASSERT_EQ(wake, queue.next_clock());
+            delta.apply(wake - cycle);
+            queue.skip(wake - cycle);
+            cycle = wake;
+        }
+
+        while (cycle <= end) queue.dispatch(cycle++);
+
+        ASSERT_EQ(2, rec.order.count());
+    }
+
+    TEST(EventQueue, SkipIdleStats)
+    {
+        StatsBuilder &builder = StatsBuilder::get();
+        Stats *stats = builder.get_new_stats();
+        Statable root("root");
+        EventQueueStats event_stats("memory_events", &root);
+        root.set_default_stats(stats);
+
+        W64 wake = EVENT_WHEEL_SIZE * 2 + 5;
+        W64 end = wake + 10;
+
+        W64 cycles, occupancy, executed;
+        {
+            EventQueue queue;
+            queue.set_stats(&event_stats);
+            run_idle(queue, stats, wake, end, false);
+            cycles = event_stats.cycles(stats);
+            occupancy = event_stats.occupancy(stats);
+            executed = event_stats.executed(stats);
+        }
+
+        stats->reset();
+        {
+            EventQueue queue;
+            queue.set_stats(&event_stats);
+            run_idle(queue, stats, wake, end, true);
+        }
+
+        ASSERT_EQ(end + 1, cycles);
+        ASSERT_EQ(cycles, event_stats.cycles(stats));
+        ASSERT_EQ(occupancy, event_stats.occupancy(stats));
+        ASSERT_EQ(executed, event_stats.executed(stats));
+
+        /* Callers that do not replay stats count the skipped cycles */
+        stats->reset();
+        {
+            EventQueue queue;
+            queue.set_stats(&event_stats);
+            queue.skip(10, true);
+            queue.dispatch(10);
+        }
+        ASSERT_EQ(11, event_stats.cycles(stats));
+
+        builder.destroy_stats(stats);
+    }
+}
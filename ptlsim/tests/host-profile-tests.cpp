@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <statsBuilder.h>
+#include <host-profile.h>
+
+#include <iostream>
+#include <pthread.h>
+
+namespace {
+
+    const int last_core = NUM_SIM_CORES - 1;
+
+    W64 spin(int count)
+    {
+        volatile W64 sum = 0;
+        foreach (i, count) {
+            sum += i;
+        }
+        return sum;
+    }
+
+    TEST(HostProfile, NestedScopes)
+    {
+        host_profile.reset();
+
+        {
+            HostProfileScope sim(HPROF_SIMULATION);
+            spin(1000);
+            {
+                HostProfileScope core(HPROF_CORE, last_core);
+                spin(1000);
+                {
+                    /* Inherits the core of the enclosing scope */
+                    HostProfileScope mem(HPROF_MEMORY);
+                    spin(100000);
+                }
+            }
+            {
+                HostProfileScope mem(HPROF_MEMORY);
+                spin(1000);
+            }
+        }
+
+        ASSERT_EQ(1U, host_profile.get_calls(HPROF_SIMULATION, HPROF_NO_CORE));
+
+        /* Zones entered every cycle do not count calls */
+        ASSERT_EQ(0U, host_profile.get_calls(HPROF_CORE, last_core));
+        ASSERT_EQ(0U, host_profile.get_calls(HPROF_MEMORY, last_core));
+
+        /* Time of a nested scope is not counted in the outer ones */
+        W64 sim = host_profile.get_cycles(HPROF_SIMULATION, HPROF_NO_CORE);
+        W64 core = host_profile.get_cycles(HPROF_CORE, last_core);
+        W64 mem = host_profile.get_cycles(HPROF_MEMORY, last_core);
+
+        ASSERT_GT(sim, 0U);
+        ASSERT_GT(core, 0U);
+        ASSERT_GT(mem, 10 * sim);
+        ASSERT_GT(mem, 10 * core);
+        ASSERT_EQ(HPROF_NONE, host_profile_thread.zone);
+        ASSERT_EQ(HPROF_NO_CORE, host_profile_thread.core);
+    }
+
+    TEST(HostProfile, Stats)
+    {
+        StatsBuilder &builder = StatsBuilder::get();
+        Stats *stats = builder.get_new_stats();
+        Statable root("root");
+        HostProfileStats profile_stats(&root);
+
+        host_profile.reset();
+
+        {
+            HostProfileScope sim(HPROF_SIMULATION);
+            spin(1000);
+            {
+                HostProfileScope core(HPROF_CORE, last_core);
+                spin(1000);
+                {
+                    HostProfileScope fetch(HPROF_CORE_FETCH);
+                    spin(1000);
+                }
+            }
+            {
+                HostProfileScope mem(HPROF_MEMORY);
+                spin(1000);
+            }
+        }
+
+        root.set_default_stats(stats);
+        profile_stats.update(host_profile);
+
+        W64 sim = host_profile.get_cycles(HPROF_SIMULATION, HPROF_NO_CORE);
+        W64 core = host_profile.get_cycles(HPROF_CORE, last_core);
+        W64 fetch = host_profile.get_cycles(HPROF_CORE_FETCH, last_core);
+        W64 mem = host_profile.get_cycles(HPROF_MEMORY, HPROF_NO_CORE);
+
+        HostProfileZoneStats *z_sim = profile_stats.zones[HPROF_SIMULATION];
+        HostProfileZoneStats *z_core = profile_stats.zones[HPROF_CORE];
+
+        ASSERT_EQ(sim, z_sim->self_cycles(stats));
+        ASSERT_EQ(sim + core + fetch + mem, z_sim->cycles(stats));
+        ASSERT_EQ(core + fetch, z_core->cycles(stats));
+        ASSERT_EQ(core + fetch, (*z_core->per_core)(stats)[last_core]);
+        ASSERT_EQ(core + fetch, (*z_sim->per_core)(stats)[last_core]);
+        ASSERT_EQ(1U, (*z_sim->calls)(stats));
+        ASSERT_TRUE(z_core->calls == NULL);
+        ASSERT_EQ(sim + core + fetch + mem, profile_stats.cycles(stats));
+
+        /* Only zones that run on behalf of a core are split by core */
+        ASSERT_TRUE(profile_stats.zones[HPROF_STATS]->per_core == NULL);
+
+        builder.destroy_stats(stats);
+    }
+
+    void* host_thread_main(void *arg)
+    {
+        HostProfile::set_host_thread(1);
+        {
+            HostProfileScope io(HPROF_QEMU_IO);
+            spin(1000);
+        }
+        return NULL;
+    }
+
+    /* Each host thread counts its time outside any core in its own row */
+    TEST(HostProfile, HostThreadRows)
+    {
+        pthread_t thread;
+
+        host_profile.reset();
+
+        {
+            HostProfileScope io(HPROF_QEMU_IO);
+            ASSERT_EQ(0, pthread_create(&thread, NULL, host_thread_main,
+                        NULL));
+            ASSERT_EQ(0, pthread_join(thread, NULL));
+        }
+
+        ASSERT_EQ(2U, host_profile.get_calls(HPROF_QEMU_IO, HPROF_NO_CORE));
+        ASSERT_EQ(HPROF_NO_CORE, host_profile_thread.no_core);
+    }
+
+    /*
+     * Cost of the scopes entered in each simulated cycle of an ooo core:
+     * the core, its four stages and the memory hierarchy clock.
+     */
+    TEST(HostProfileBench, Cycle)
+    {
+        const int count = 1 << 20;
+        CycleTimer timer;
+
+        host_profile.reset();
+
+        timer.start();
+        {
+            HostProfileScope sim(HPROF_SIMULATION);
+            foreach (i, count) {
+                {
+                    HostProfileScope core(HPROF_CORE, i % NUM_SIM_CORES);
+                    { HostProfileScope stage(HPROF_CORE_COMMIT); }
+                    { HostProfileScope stage(HPROF_CORE_ISSUE); }
+                    { HostProfileScope stage(HPROF_CORE_DISPATCH); }
+                    { HostProfileScope stage(HPROF_CORE_FETCH); }
+                }
+                HostProfileScope mem(HPROF_MEMORY);
+            }
+        }
+        timer.stop();
+
+        ASSERT_GT(host_profile.get_cycles(HPROF_MEMORY, HPROF_NO_CORE), 0U);
+        ASSERT_EQ(0U, host_profile.get_calls(HPROF_MEMORY, HPROF_NO_CORE));
+
+        std::cout << "Host profile: " << (double)timer.cycles() / count
+            << " cycles per simulated cycle, "
+            << (double)timer.cycles() / (6 * count) << " cycles per scope"
+            << std::endl;
+    }
+}
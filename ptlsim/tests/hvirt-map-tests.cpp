@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <superstl.h>
+#include <hvirt-map.h>
+
+#include <iostream>
+#include <map>
+
+namespace {
+
+    TEST(HvirtGphysMap, Lookup)
+    {
+        HvirtGphysMap map;
+        Waddr paddr;
+
+        ASSERT_FALSE(map.lookup(0, 0x7f0000001000ULL, paddr));
+
+        map.add(0x7f0000001000ULL, 0x5000);
+        map.add(0x7f0000002000ULL, 0x0);
+        map.add(0x7f0000002000ULL, 0x0);
+        ASSERT_EQ(2U, map.get_count());
+
+        ASSERT_TRUE(map.lookup(0, 0x7f0000001234ULL, paddr));
+        ASSERT_EQ(0x5234U, paddr);
+
+        /* Guest physical page 0 is a valid mapping */
+        ASSERT_TRUE(map.lookup(1, 0x7f0000002010ULL, paddr));
+        ASSERT_EQ(0x10U, paddr);
+
+        /* Same front cache slot, different page */
+        Waddr alias = 0x7f0000001000ULL + (HVIRT_FRONT_SIZE << HVIRT_PAGE_BITS);
+        ASSERT_FALSE(map.lookup(0, alias, paddr));
+        map.add(alias, 0x9000);
+        ASSERT_TRUE(map.lookup(0, alias + 8, paddr));
+        ASSERT_EQ(0x9008U, paddr);
+
+        /* A remapped page is not served from a stale front cache entry */
+        map.add(0x7f0000001000ULL, 0x6000);
+        ASSERT_TRUE(map.lookup(0, 0x7f0000001000ULL, paddr));
+        ASSERT_EQ(0x6000U, paddr);
+        ASSERT_EQ(3U, map.get_count());
+
+        map.clear();
+        ASSERT_FALSE(map.lookup(0, 0x7f0000001000ULL, paddr));
+        ASSERT_EQ(0U, map.get_count());
+    }
+
+    /*
+     * Cost of translating the host address of a load or store with the
+     * std::map that was used before and with the radix tree and front
+     * cache, over 256MB of guest RAM.
+     */
+    TEST(HvirtGphysMapBench, Lookup)
+    {
+        const int pages = 1 << 16;
+        const int lookups = 1 << 22;
+        const Waddr base = 0x7f3a00000000ULL;
+        CycleTimer map_timer;
+        CycleTimer radix_timer;
+        std::map<Waddr, Waddr> old_map;
+        HvirtGphysMap *radix = new HvirtGphysMap();
+        W64 seed;
+
+        foreach (i, pages) {
+            old_map[base + (W64(i) << 12)] = W64(i) << 12;
+            radix->add(base + (W64(i) << 12), W64(i) << 12);
+        }
+
+        /* Loads and stores mostly stay in a small working set of pages */
+        W64 sum_map = 0;
+        seed = 1;
+        map_timer.start();
+        foreach (i, lookups) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            int page = (seed >> 60) ? (seed >> 33) % 64 : (seed >> 33) % pages;
+            Waddr vaddr = base + (W64(page) << 12) + (i & 0xff8);
+            std::map<Waddr, Waddr>::iterator it = old_map.find(vaddr & ~0xfffULL);
+            sum_map += it->second + (vaddr & 0xfff);
+        }
+        map_timer.stop();
+
+        W64 sum_radix = 0;
+        seed = 1;
+        radix_timer.start();
+        foreach (i, lookups) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            int page = (seed >> 60) ? (seed >> 33) % 64 : (seed >> 33) % pages;
+            Waddr vaddr = base + (W64(page) << 12) + (i & 0xff8);
+            Waddr paddr;
+            radix->lookup(0, vaddr, paddr);
+            sum_radix += paddr;
+        }
+        radix_timer.stop();
+
+        ASSERT_EQ(sum_map, sum_radix);
+        delete radix;
+
+        std::cout << "Host to guest physical: "
+            << (double)map_timer.cycles() / lookups
+            << " cycles with std::map, "
+            << (double)radix_timer.cycles() / lookups
+            << " cycles with radix tree" << std::endl;
+    }
+}
@@ -0,0 +1,116 @@
+
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <memoryTrace.h>
+
+#include <fstream>
+
+using namespace Memory;
+
+namespace {
+
+    MemoryTraceRecord make_record(W64 cycle, W64 addr, int core, int thread,
+            bool icache, bool write)
+    {
+        MemoryTraceRecord record;
+        record.cycle = cycle;
+        record.physicalAddress = addr;
+        record.coreId = core;
+        record.threadId = thread;
+        record.isInstruction = icache;
+        record.isWrite = write;
+        return record;
+    }
+
+    TEST(MemoryTrace, WriteRead)
+    {
+        const char* filename = "/tmp/test_mem_trace";
+        const int count = 100000;
+        MemoryTraceWriter *writer = new MemoryTraceWriter();
+
+        ASSERT_TRUE(writer->open(filename));
+
+        /* Strided streams of each core, with backward and far jumps */
+        foreach (i, count) {
+            int core = i % 4;
+            W64 addr = 0x100000 * (core + 1) + 64 * (i / 4);
+            if (i % 7 == 0) addr = 0x7fffffffc0ULL - 64 * i;
+            writer->record(make_record(10 + i * 3, addr, core, i % 3,
+                        (i % 5) == 0, (i % 2) == 1));
+        }
+
+        ASSERT_EQ(W64(count), writer->get_count());
+        writer->close();
+        delete writer;
+
+        /* Compact: a few bytes per request */
+        std::ifstream is(filename, std::ios::in | std::ios::binary |
+                std::ios::ate);
+        ASSERT_LT(W64(is.tellg()), W64(count) * 8);
+        is.close();
+
+        MemoryTraceReader *reader = new MemoryTraceReader();
+        MemoryTraceRecord record;
+
+        ASSERT_TRUE(reader->open(filename));
+
+        foreach (i, count) {
+            int core = i % 4;
+            W64 addr = 0x100000 * (core + 1) + 64 * (i / 4);
+            if (i % 7 == 0) addr = 0x7fffffffc0ULL - 64 * i;
+
+            ASSERT_TRUE(reader->next(record));
+            ASSERT_EQ(W64(10 + i * 3), record.cycle);
+            ASSERT_EQ(addr, record.physicalAddress);
+            ASSERT_EQ(core, record.coreId);
+            ASSERT_EQ(i % 3, record.threadId);
+            ASSERT_EQ((i % 5) == 0, record.isInstruction);
+            ASSERT_EQ((i % 2) == 1, record.isWrite);
+        }
+
+        ASSERT_FALSE(reader->next(record));
+        ASSERT_EQ(W64(count), reader->get_count());
+        delete reader;
+    }
+
+    /* Flushed records can be read while the writer is still open */
+    TEST(MemoryTrace, Flush)
+    {
+        const char* filename = "/tmp/test_mem_trace_flush";
+        MemoryTraceWriter writer;
+
+        ASSERT_TRUE(writer.open(filename));
+        foreach (i, 10) {
+            writer.record(make_record(i, 64 * i, 0, 0, false, false));
+        }
+        writer.flush();
+
+        MemoryTraceReader reader;
+        MemoryTraceRecord record;
+
+        ASSERT_TRUE(reader.open(filename));
+        foreach (i, 10) {
+            ASSERT_TRUE(reader.next(record));
+            ASSERT_EQ(W64(64 * i), record.physicalAddress);
+        }
+        ASSERT_FALSE(reader.next(record));
+
+        writer.close();
+    }
+
+    TEST(MemoryTrace, BadFile)
+    {
+        const char* filename = "/tmp/test_mem_trace_bad";
+        MemoryTraceReader *reader = new MemoryTraceReader();
+
+        std::ofstream os(filename, std::ios::out | std::ios::binary);
+        os << "not a memory trace";
+        os.close();
+
+        ASSERT_FALSE(reader->open(filename));
+        ASSERT_FALSE(reader->open("/tmp/no_such_mem_trace"));
+        delete reader;
+    }
+}
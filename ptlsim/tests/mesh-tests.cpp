@@ -0,0 +1,237 @@
+
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+
+#include <memoryHierarchy.h>
+#include <mesh.h>
+#include <machine.h>
+
+using namespace Memory;
+using namespace Memory::MeshInterconnect;
+
+namespace {
+
+    /* Controller that records the messages the network delivers to it */
+    class TestMeshCont : public Controller
+    {
+        public:
+            TestMeshCont(const char *name, MemoryHierarchy *mem)
+                : Controller(0, name, mem)
+                , reject(0)
+            { }
+
+            dynarray<MemoryRequest*> received;
+            dynarray<W64> cycles;
+
+            // Number of deliveries to refuse before accepting again
+            int reject;
+
+            bool handle_interconnect_cb(void *arg)
+            {
+                Message *msg = (Message*)arg;
+
+                if (reject > 0) {
+                    reject--;
+                    return false;
+                }
+
+                received.push(msg->request);
+                cycles.push(sim_cycle);
+                return true;
+            }
+
+            void register_interconnect(Interconnect *interconnect, int type)
+            { }
+            void print_map(ostream& os) { }
+            void print(ostream& os) const { }
+            bool is_full(bool fromInterconnect = false) const { return false; }
+            void annul_request(MemoryRequest *request) { }
+            void dump_configuration(YAML::Emitter &out) const { }
+    };
+
+    class MeshTest : public ::testing::Test {
+        public:
+            MemoryHierarchy *mem;
+            Mesh *mesh;
+            dynarray<TestMeshCont*> conts;
+
+            MeshTest()
+            {
+                BaseMachine* machine = (BaseMachine*)(
+                        PTLsimMachine::getmachine("base"));
+
+                mem = new MemoryHierarchy(*machine);
+
+                /* Network events are queued on the machine's hierarchy */
+                machine->memoryHierarchyPtr = mem;
+            }
+
+            /* Every test gets its own network so stats names don't clash */
+            void build(int topology, int count)
+            {
+                static int networks = 0;
+                stringbuf name;
+
+                name << "test_noc_", networks++;
+                mesh = new Mesh(name.buf, mem, topology);
+
+                foreach (i, count) {
+                    stringbuf cont_name;
+                    cont_name << name.buf, "_node_", i;
+                    TestMeshCont *cont = new TestMeshCont(cont_name.buf,
+                            mem);
+                    conts.push(cont);
+                    mesh->register_controller(cont);
+                }
+            }
+
+            MemoryRequest* send(int src, int dest, bool data)
+            {
+                MemoryRequest *request = mem->get_free_request(0);
+                request->init(0, 0, 0x1234540, 0, sim_cycle,
+                        false, 0xffffff0, 0, MEMORY_OP_READ);
+
+                Message *msg = mem->get_message();
+                msg->sender  = conts[src];
+                msg->dest    = conts[dest];
+                msg->request = request;
+                msg->hasData = data;
+
+                bool success = mesh->get_controller_request_signal()->
+                    emit(msg);
+                mem->free_message(msg);
+
+                EXPECT_TRUE(success);
+                return request;
+            }
+
+            void run(int cycles)
+            {
+                foreach (i, cycles) {
+                    mem->clock();
+                    sim_cycle++;
+                }
+            }
+    };
+
+    TEST_F(MeshTest, MeshRoute)
+    {
+        build(TOPOLOGY_MESH, 9);
+
+        /* 3x3 mesh, X first then Y */
+        ASSERT_EQ(PORT_EAST, mesh->route(0, 8));
+        ASSERT_EQ(PORT_SOUTH, mesh->route(2, 8));
+        ASSERT_EQ(PORT_WEST, mesh->route(8, 0));
+        ASSERT_EQ(PORT_NORTH, mesh->route(6, 0));
+
+        ASSERT_EQ(4, mesh->distance(0, 8));
+        ASSERT_EQ(2, mesh->distance(1, 7));
+        ASSERT_EQ(0, mesh->distance(4, 4));
+
+        int path[] = {1, 2, 5, 8};
+        int node = 0;
+        int hops = 0;
+
+        while (node != 8) {
+            node = mesh->next_node(node, mesh->route(node, 8));
+            ASSERT_EQ(path[hops], node);
+            hops++;
+        }
+
+        ASSERT_EQ(mesh->distance(0, 8), hops);
+    }
+
+    /* A mesh that doesn't fill its last row keeps its columns */
+    TEST_F(MeshTest, MeshPartialRow)
+    {
+        build(TOPOLOGY_MESH, 5);
+
+        ASSERT_EQ(PORT_EAST, mesh->route(3, 2));
+        ASSERT_EQ(4, mesh->next_node(3, PORT_EAST));
+        ASSERT_EQ(2, mesh->distance(4, 2));
+        ASSERT_EQ(3, mesh->distance(3, 2));
+    }
+
+    TEST_F(MeshTest, RingRoute)
+    {
+        build(TOPOLOGY_RING, 6);
+
+        /* Packets take the shorter way around */
+        ASSERT_EQ(PORT_EAST, mesh->route(0, 2));
+        ASSERT_EQ(PORT_WEST, mesh->route(0, 4));
+        ASSERT_EQ(PORT_EAST, mesh->route(5, 1));
+        ASSERT_EQ(PORT_EAST, mesh->route(0, 3));
+
+        ASSERT_EQ(0, mesh->next_node(5, PORT_EAST));
+        ASSERT_EQ(5, mesh->next_node(0, PORT_WEST));
+
+        ASSERT_EQ(2, mesh->distance(0, 4));
+        ASSERT_EQ(2, mesh->distance(5, 1));
+        ASSERT_EQ(3, mesh->distance(0, 3));
+    }
+
+    /* Each hop takes the router and link latency and the destination
+     * router holds the packet until its tail flit arrives */
+    TEST_F(MeshTest, Latency)
+    {
+        build(TOPOLOGY_MESH, 4);
+
+        W64 start = sim_cycle;
+        MemoryRequest *ctrl = send(0, 1, false);
+        MemoryRequest *data = send(2, 1, true);
+        run(20);
+
+        ASSERT_EQ(2, conts[1]->received.count());
+        ASSERT_EQ(ctrl, conts[1]->received[0]);
+        ASSERT_EQ(start + 6, conts[1]->cycles[0]);
+
+        /* Two hops through router 3 */
+        ASSERT_EQ(data, conts[1]->received[1]);
+        ASSERT_EQ(start + 13, conts[1]->cycles[1]);
+    }
+
+    /* Two data packets on the same link are serialized by their flits,
+     * packets on different links are not */
+    TEST_F(MeshTest, LinkContention)
+    {
+        build(TOPOLOGY_MESH, 4);
+
+        W64 start = sim_cycle;
+        MemoryRequest *first  = send(0, 1, true);
+        MemoryRequest *second = send(0, 1, true);
+        MemoryRequest *other  = send(0, 2, true);
+        run(30);
+
+        ASSERT_EQ(2, conts[1]->received.count());
+        ASSERT_EQ(first, conts[1]->received[0]);
+        ASSERT_EQ(second, conts[1]->received[1]);
+        ASSERT_EQ(start + 10, conts[1]->cycles[0]);
+        ASSERT_EQ(start + 15, conts[1]->cycles[1]);
+
+        ASSERT_EQ(1, conts[2]->received.count());
+        ASSERT_EQ(other, conts[2]->received[0]);
+        ASSERT_EQ(start + 10, conts[2]->cycles[0]);
+    }
+
+    /* Messages between two controllers arrive in the order they were sent,
+     * even if the first one has to be retried */
+    TEST_F(MeshTest, DeliveryOrder)
+    {
+        build(TOPOLOGY_RING, 4);
+
+        W64 start = sim_cycle;
+        conts[1]->reject = 3;
+
+        MemoryRequest *first  = send(0, 1, false);
+        MemoryRequest *second = send(0, 1, false);
+        run(20);
+
+        ASSERT_EQ(0, conts[1]->reject);
+        ASSERT_EQ(2, conts[1]->received.count());
+        ASSERT_EQ(first, conts[1]->received[0]);
+        ASSERT_EQ(second, conts[1]->received[1]);
+        ASSERT_EQ(start + 9, conts[1]->cycles[0]);
+        ASSERT_LT(conts[1]->cycles[0], conts[1]->cycles[1]);
+    }
+};
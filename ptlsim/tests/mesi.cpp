@@ -405,4 +405,39 @@ namespace {
         ASSERT_EQ(st, exc);
         r();
     }
+
+#define warm(state, write, shared) \
+    st = state; cont->mesi->warm_line(line, write, shared);
+
+#define warm_snoop(state, write) \
+    st = state; cont->mesi->warm_snoop(line, write);
+
+    TEST_F(MesiTest, Warming)
+    {
+        cont->set_private(true);
+
+        warm(in, false, false);
+        ASSERT_EQ(st, exc);
+        warm(in, false, true);
+        ASSERT_EQ(st, sh);
+        warm(sh, false, false);
+        ASSERT_EQ(st, sh);
+        warm(sh, true, true);
+        ASSERT_EQ(st, mod);
+        warm(in, true, false);
+        ASSERT_EQ(st, mod);
+
+        warm_snoop(mod, false);
+        ASSERT_EQ(st, sh);
+        warm_snoop(exc, true);
+        ASSERT_EQ(st, in);
+
+        /* Shared caches only fill the line from memory */
+        cont->set_private(false);
+
+        warm(in, true, true);
+        ASSERT_EQ(st, exc);
+        warm(mod, false, false);
+        ASSERT_EQ(st, mod);
+    }
 };
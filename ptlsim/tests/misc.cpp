@@ -5,6 +5,7 @@
 #include <ptlsim.h>
 #include <ptl-qemu.h>
 #include <superstl.h>
+#include <memoryRequest.h>
 
 void read_simpoint_file();
 int get_simpoint(int id);
@@ -64,17 +65,47 @@ namespace {
         ASSERT_EQ(320, get_simpoint(2));
         ASSERT_EQ(3220, get_simpoint(3));
 
-        set_next_simpoint(&ctx);
-        ASSERT_EQ(10 * config.simpoint_interval, ctx.simpoint_decr);
+        /* Each context gets its share, context 0 also the remainder */
+        W64 intervals[] = {10, 10, 300, 2900};
+        foreach (n, 4) {
+            W64 insns = intervals[n] * config.simpoint_interval;
+
+            set_next_simpoint(&ctx);
+            ASSERT_EQ(insns / NUM_SIM_CORES + insns % NUM_SIM_CORES,
+                    ctx.simpoint_decr);
+            for (int i = 1; i < NUM_SIM_CORES; i++) {
+                ASSERT_EQ(insns / NUM_SIM_CORES, contextof(i).simpoint_decr);
+            }
+        }
+    }
 
-        set_next_simpoint(&ctx);
-        ASSERT_EQ(10 * config.simpoint_interval, ctx.simpoint_decr);
+    TEST(Simpoint, SetNextSimpointRemainder)
+    {
+        /* Interval that does not split evenly between the contexts, the
+         * remainder goes to the context that reached the simpoint */
+        W64 interval = config.simpoint_interval;
+        config.simpoint_interval = 3 * NUM_SIM_CORES + NUM_SIM_CORES - 1;
+        Context& ctx = contextof(NUM_SIM_CORES - 1);
 
-        set_next_simpoint(&ctx);
-        ASSERT_EQ(300 * config.simpoint_interval, ctx.simpoint_decr);
+        clear_simpoints();
+        add_simpoint(1, 0);
+        add_simpoint(2, 1);
+
+        foreach (n, 2) {
+            set_next_simpoint(&ctx);
+
+            W64 total = 0;
+            foreach (i, NUM_SIM_CORES) {
+                Context& t_ctx = contextof(i);
+                W64 share = (&t_ctx == &ctx) ? 3 + NUM_SIM_CORES - 1 : 3;
+                ASSERT_EQ(share, t_ctx.simpoint_decr);
+                total += t_ctx.simpoint_decr;
+            }
+            ASSERT_EQ(config.simpoint_interval, total);
+        }
 
-        set_next_simpoint(&ctx);
-        ASSERT_EQ(2900 * config.simpoint_interval, ctx.simpoint_decr);
+        clear_simpoints();
+        config.simpoint_interval = interval;
     }
 
     TEST(Simpoint, ChkName)
@@ -111,4 +142,41 @@ namespace {
         EXPECT_STREQ("test_sp_0", name->buf);
         delete name;
     }
+
+    static long resident_pages()
+    {
+        long size = 0, resident = 0;
+        FILE *statm = fopen("/proc/self/statm", "r");
+        if (statm) {
+            if (fscanf(statm, "%ld %ld", &size, &resident) != 2)
+                resident = 0;
+            fclose(statm);
+        }
+        return resident;
+    }
+
+    TEST(RequestPool, RecycleKeepsMemoryFlat)
+    {
+        Memory::RequestPool *pool = new Memory::RequestPool();
+
+        // Warm up so the first allocations of the test are not counted
+        foreach (i, 2 * Memory::REQUEST_POOL_SIZE) {
+            Memory::MemoryRequest *req = pool->get_free_request();
+            req->init(0, 0, i << 6, 0, i, false, 0, i,
+                    Memory::MEMORY_OP_READ);
+        }
+
+        long start = resident_pages();
+
+        foreach (i, 1000000) {
+            Memory::MemoryRequest *req = pool->get_free_request();
+            req->init(0, 0, i << 6, 0, i, false, 0, i,
+                    Memory::MEMORY_OP_READ);
+        }
+
+        // Allow some slack for unrelated allocations by the runtime
+        EXPECT_LE(resident_pages() - start, 16);
+
+        delete pool;
+    }
 };
@@ -0,0 +1,237 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+
+#include <memoryHierarchy.h>
+#include <cpuController.h>
+#include <machine.h>
+
+using namespace Memory;
+
+namespace {
+
+    /* Addresses from here on miss in TestL1 */
+    const W64 MISS_ADDR = 0x100000;
+
+    /* L1 stand-in: reads below MISS_ADDR hit on the fast path after 3
+     * cycles, other requests are sent through the interconnect and
+     * recorded */
+    class TestL1 : public Interconnect
+    {
+        public:
+            TestL1(const char *name, MemoryHierarchy *mem)
+                : Interconnect(name, mem)
+            { }
+
+            dynarray<MemoryRequest*> received;
+            dynarray<W64> cycles;
+
+            bool controller_request_cb(void *arg)
+            {
+                Message *msg = (Message*)arg;
+                received.push(msg->request);
+                cycles.push(sim_cycle);
+                return true;
+            }
+
+            int access_fast_path(Controller *controller,
+                    MemoryRequest *request)
+            {
+                if (request->get_type() == MEMORY_OP_WRITE ||
+                        request->get_physical_address() >= MISS_ADDR)
+                    return -1;
+                return 3;
+            }
+
+            void register_controller(Controller *controller) { }
+            void print_map(ostream& os) { }
+            void print(ostream& os) const { }
+            int get_delay() { return 0; }
+            void annul_request(MemoryRequest *request) { }
+            void dump_configuration(YAML::Emitter &out) const { }
+    };
+
+    /* Records the cycles in which the CPU controller wakes up the core */
+    struct WakeupRecorder {
+        dynarray<W64> cycles;
+
+        bool wakeup(void *arg)
+        {
+            cycles.push(core_cycle());
+            return true;
+        }
+    };
+
+    class ParallelTest : public ::testing::Test {
+        public:
+            MemoryHierarchy *mem;
+            TestL1 *l1;
+            WakeupRecorder core;
+            Signal wakeup;
+
+            ParallelTest()
+                : wakeup("test_parallel_wakeup")
+            {
+                BaseMachine* machine = (BaseMachine*)(
+                        PTLsimMachine::getmachine("base"));
+
+                mem = new MemoryHierarchy(*machine);
+                machine->memoryHierarchyPtr = mem;
+
+                /* Every test gets its own controller so stats names
+                 * don't clash */
+                static int hierarchies = 0;
+                stringbuf name;
+                name << "test_parallel_", hierarchies++;
+
+                stringbuf cont_name;
+                cont_name << name.buf, "_cpu";
+                CPUController *cont = new CPUController(0, cont_name.buf,
+                        mem);
+
+                l1 = new TestL1(name.buf, mem);
+                cont->register_interconnect(l1, INTERCONN_TYPE_I);
+                cont->register_interconnect(l1, INTERCONN_TYPE_D);
+                mem->setup_full_flags();
+
+                wakeup.connect(signal_mem_ptr(core, &WakeupRecorder::wakeup));
+            }
+
+            MemoryRequest* request(W64 addr, int robid, OP_TYPE type)
+            {
+                MemoryRequest *request = mem->get_free_request(0);
+                request->init(0, 0, addr, robid, core_cycle(), false, 0, 0,
+                        type);
+                request->set_coreSignal(&wakeup);
+                return request;
+            }
+
+            /* Serial mode */
+            void run(int cycles)
+            {
+                foreach (i, cycles) {
+                    mem->clock();
+                    sim_cycle++;
+                }
+            }
+
+            /* Cycles [from, to) of a quantum of worker 0 that starts at
+             * sim_cycle. The last cycle is left current, so requests made
+             * after this are made in cycle 'to - 1'. */
+            void worker_run(int from, int to)
+            {
+                parallel_sim_active = true;
+                parallel_worker_id = 0;
+
+                for (int i = from; i < to; i++) {
+                    worker_cycle = sim_cycle + i;
+                    mem->clock_cpu_controller(0);
+                }
+            }
+
+            void worker_stop()
+            {
+                parallel_sim_active = false;
+                parallel_worker_id = -1;
+            }
+
+            /* Main thread at the end of a quantum */
+            void replay(int cycles)
+            {
+                mem->end_quantum(sim_cycle + cycles);
+
+                foreach (i, cycles) {
+                    mem->clock_shared();
+                    mem->issue_deferred();
+                    sim_cycle++;
+                }
+            }
+    };
+
+    /* An L1 hit made in a quantum completes on the worker after the same
+     * latency as in serial mode */
+    TEST_F(ParallelTest, L1HitOnWorker)
+    {
+        W64 start = sim_cycle;
+
+        run(2);
+        mem->clock();
+        ASSERT_FALSE(mem->access_cache(request(0x1000, 0, MEMORY_OP_READ)));
+        sim_cycle++;
+        run(8);
+
+        ASSERT_EQ(1, core.cycles.count());
+        W64 serial_read = core.cycles[0] - start;
+        core.cycles.clear();
+
+        start = sim_cycle;
+
+        worker_run(0, 3);
+        EXPECT_FALSE(mem->access_cache(request(0x2000, 1, MEMORY_OP_READ)));
+        worker_run(3, 11);
+        worker_stop();
+
+        /* Completed on the worker, nothing went to the L1 interconnect */
+        ASSERT_EQ(1, core.cycles.count());
+        ASSERT_EQ(serial_read, core.cycles[0] - start);
+        ASSERT_EQ(0, l1->received.count());
+
+        replay(11);
+        ASSERT_EQ(0, l1->received.count());
+    }
+
+    /* A miss and a write made in a quantum reach the L1 in the same cycles
+     * as in serial mode when the main thread replays the quantum */
+    TEST_F(ParallelTest, DeferredTiming)
+    {
+        W64 start = sim_cycle;
+
+        run(2);
+        mem->clock();
+        ASSERT_FALSE(mem->access_cache(request(MISS_ADDR, 0,
+                        MEMORY_OP_READ)));
+        ASSERT_TRUE(mem->access_cache(request(0x2000, 1, MEMORY_OP_WRITE)));
+        sim_cycle++;
+        run(8);
+
+        ASSERT_EQ(2, l1->received.count());
+        W64 serial_miss = l1->cycles[0] - start;
+        W64 serial_write = l1->cycles[1] - start;
+
+        l1->received.clear();
+        l1->cycles.clear();
+
+        start = sim_cycle;
+
+        worker_run(0, 3);
+        EXPECT_FALSE(mem->access_cache(request(MISS_ADDR + 0x1000, 2,
+                        MEMORY_OP_READ)));
+        EXPECT_TRUE(mem->access_cache(request(0x4000, 3, MEMORY_OP_WRITE)));
+        worker_run(3, 11);
+        worker_stop();
+
+        /* Nothing reached the L1 during the quantum */
+        ASSERT_EQ(0, l1->received.count());
+
+        replay(11);
+
+        ASSERT_EQ(2, l1->received.count());
+        ASSERT_EQ(serial_miss, l1->cycles[0] - start);
+        ASSERT_EQ(serial_write, l1->cycles[1] - start);
+    }
+
+    /* A worker stops making requests when the ones it queued would fill
+     * the CPU controller */
+    TEST_F(ParallelTest, DeferredQueueFull)
+    {
+        worker_run(0, 1);
+
+        foreach (i, CPU_CONT_PENDING_REQ_SIZE) {
+            EXPECT_TRUE(mem->is_cache_available(0, 0, false));
+            mem->access_cache(request(0x10000 + i * 64, i, MEMORY_OP_WRITE));
+        }
+        EXPECT_FALSE(mem->is_cache_available(0, 0, false));
+
+        worker_stop();
+    }
+}
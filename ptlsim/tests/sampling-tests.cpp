@@ -0,0 +1,60 @@
+
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <sampling.h>
+
+namespace {
+
+    TEST(SampleEstimator, MeanAndVariance)
+    {
+        SampleEstimator est;
+
+        ASSERT_EQ(0U, est.count());
+        ASSERT_EQ(INFINITY, est.half_width(2));
+
+        double samples[] = {2, 4, 4, 4, 5, 5, 7, 9};
+        foreach (i, 8) {
+            est.add(samples[i]);
+        }
+
+        ASSERT_EQ(8U, est.count());
+        ASSERT_DOUBLE_EQ(5.0, est.mean());
+        ASSERT_DOUBLE_EQ(32.0 / 7, est.variance());
+        ASSERT_DOUBLE_EQ(2 * sqrt(32.0 / 7 / 8), est.half_width(2));
+        ASSERT_DOUBLE_EQ(est.half_width(2) / 5, est.relative_error(2));
+
+        est.reset();
+        ASSERT_EQ(0U, est.count());
+        ASSERT_EQ(0, est.variance());
+    }
+
+    TEST(SampleEstimator, ZScore)
+    {
+        ASSERT_NEAR(1.645, SampleEstimator::z_score(0.90), 0.001);
+        ASSERT_NEAR(1.960, SampleEstimator::z_score(0.95), 0.001);
+        ASSERT_NEAR(2.968, SampleEstimator::z_score(0.997), 0.001);
+        ASSERT_EQ(0, SampleEstimator::z_score(0));
+    }
+
+    /* Interval narrows as windows are added until the target is met */
+    TEST(SampleEstimator, Converges)
+    {
+        SampleEstimator est;
+        double z = SampleEstimator::z_score(0.997);
+        W64 seed = 1;
+        int windows = 0;
+
+        while (est.count() < 30 || est.relative_error(z) > 0.03) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            double noise = double((seed >> 33) % 1000) / 1000 - 0.5;
+            est.add(1.5 + noise);
+            windows++;
+            ASSERT_LT(windows, 100000);
+        }
+
+        ASSERT_NEAR(1.5, est.mean(), 1.5 * 0.03);
+        ASSERT_LE(est.relative_error(z), 0.03);
+    }
+}
@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <superstl.h>
+#include <globalDirectory.h>
+
+namespace {
+
+    TEST(SharerFormat, Full)
+    {
+        SharerFormat format;
+        W64 s[2];
+
+        format.setup(DIR_SHARERS_FULL, 100, 0, 0);
+        ASSERT_EQ(2, format.get_words());
+
+        format.clear(s);
+        ASSERT_TRUE(format.empty(s));
+        ASSERT_EQ(-1, format.first(s));
+
+        format.add(s, 70);
+        format.add(s, 5);
+        format.add(s, 63);
+        format.add(s, 5);
+
+        ASSERT_TRUE(format.exact(s));
+        ASSERT_EQ(3, format.count(s));
+        ASSERT_EQ(5, format.first(s));
+        ASSERT_TRUE(format.test(s, 63));
+        ASSERT_TRUE(format.test(s, 70));
+        ASSERT_FALSE(format.test(s, 64));
+
+        /* Every sharer can be removed on its own */
+        format.remove(s, 5);
+        ASSERT_FALSE(format.test(s, 5));
+        ASSERT_EQ(63, format.first(s));
+
+        format.remove(s, 63);
+        format.remove(s, 70);
+        ASSERT_TRUE(format.empty(s));
+    }
+
+    TEST(SharerFormat, Limited)
+    {
+        SharerFormat format;
+        W64 s, t;
+
+        format.setup(DIR_SHARERS_LIMITED, 16, 3, 0);
+        ASSERT_EQ(1, format.get_words());
+
+        format.clear(&s);
+        format.add(&s, 9);
+        format.add(&s, 3);
+        format.add(&s, 9);
+
+        ASSERT_TRUE(format.exact(&s));
+        ASSERT_EQ(2, format.count(&s));
+        ASSERT_EQ(3, format.first(&s));
+        ASSERT_TRUE(format.test(&s, 9));
+        ASSERT_FALSE(format.test(&s, 4));
+
+        /* Removing a pointer keeps the others */
+        format.add(&s, 12);
+        format.remove(&s, 3);
+        ASSERT_EQ(2, format.count(&s));
+        ASSERT_FALSE(format.test(&s, 3));
+        ASSERT_TRUE(format.test(&s, 9));
+        ASSERT_TRUE(format.test(&s, 12));
+        ASSERT_EQ(9, format.first(&s));
+
+        format.remove(&s, 12);
+        format.remove(&s, 9);
+        ASSERT_TRUE(format.empty(&s));
+
+        format.add(&s, 1);
+        format.copy(&t, &s);
+        ASSERT_TRUE(format.test(&t, 1));
+        ASSERT_EQ(1, format.count(&t));
+    }
+
+    /* One sharer more than the pointers turns the entry into a broadcast */
+    TEST(SharerFormat, LimitedOverflow)
+    {
+        SharerFormat format;
+        W64 s;
+
+        format.setup(DIR_SHARERS_LIMITED, 16, 2, 0);
+
+        format.clear(&s);
+        format.add(&s, 4);
+        format.add(&s, 7);
+        ASSERT_TRUE(format.exact(&s));
+
+        format.add(&s, 11);
+        ASSERT_FALSE(format.exact(&s));
+        ASSERT_EQ(16, format.count(&s));
+        ASSERT_EQ(0, format.first(&s));
+
+        foreach (id, 16) {
+            ASSERT_TRUE(format.test(&s, id));
+        }
+        ASSERT_FALSE(format.test(&s, 16));
+
+        /* A broadcast entry can not forget a single cache */
+        format.remove(&s, 4);
+        ASSERT_TRUE(format.test(&s, 4));
+        format.add(&s, 2);
+        ASSERT_FALSE(format.exact(&s));
+
+        format.clear(&s);
+        ASSERT_TRUE(format.empty(&s));
+        ASSERT_TRUE(format.exact(&s));
+    }
+
+    TEST(SharerFormat, Coarse)
+    {
+        SharerFormat format;
+        W64 s;
+
+        /* Smallest group that fits 256 caches in one word */
+        format.setup(DIR_SHARERS_COARSE, 256, 0, 0);
+        ASSERT_EQ(4, format.get_group());
+        ASSERT_EQ(1, format.get_words());
+
+        format.clear(&s);
+        ASSERT_TRUE(format.exact(&s));
+
+        format.add(&s, 5);
+        ASSERT_FALSE(format.exact(&s));
+        ASSERT_EQ(4, format.count(&s));
+        ASSERT_EQ(4, format.first(&s));
+
+        foreach (id, 4) {
+            ASSERT_TRUE(format.test(&s, 4 + id));
+        }
+        ASSERT_FALSE(format.test(&s, 3));
+        ASSERT_FALSE(format.test(&s, 8));
+
+        /* The group bit may still cover other sharers */
+        format.remove(&s, 5);
+        ASSERT_TRUE(format.test(&s, 5));
+
+        format.add(&s, 255);
+        ASSERT_EQ(8, format.count(&s));
+        ASSERT_TRUE(format.test(&s, 252));
+    }
+
+    /* Groups of one cache are exact like the full format */
+    TEST(SharerFormat, CoarseSingleCacheGroups)
+    {
+        SharerFormat format;
+        W64 s;
+
+        format.setup(DIR_SHARERS_COARSE, 8, 0, 1);
+        ASSERT_EQ(1, format.get_group());
+
+        format.clear(&s);
+        format.add(&s, 2);
+        format.add(&s, 6);
+        ASSERT_TRUE(format.exact(&s));
+        ASSERT_EQ(2, format.count(&s));
+
+        format.remove(&s, 2);
+        ASSERT_FALSE(format.test(&s, 2));
+        ASSERT_EQ(6, format.first(&s));
+    }
+}
@@ -0,0 +1,198 @@
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <superstl.h>
+#include <eventQueue.h>
+
+#include <iostream>
+
+using namespace Memory;
+
+namespace {
+
+    struct Counter {
+        W64 sum;
+
+        Counter() : sum(0) {}
+
+        bool add(void *arg) {
+            sum += (W64)arg;
+            return true;
+        }
+    };
+
+    struct Base {
+        W64 pad;
+        virtual ~Base() {}
+    };
+
+    /* Member of a second base, 'this' must be adjusted on calls */
+    struct Derived : public Base, public Counter {
+        bool twice(void *arg) {
+            sum += 2 * (W64)arg;
+            return (W64)arg != 0;
+        }
+    };
+
+    W64 fun_sum = 0;
+
+    bool fun_add(void *arg)
+    {
+        fun_sum += (W64)arg;
+        return true;
+    }
+
+    TEST(Delegate, Call)
+    {
+        Counter counter;
+        Derived derived;
+        Signal sig("add");
+
+        ASSERT_FALSE(sig.get_delegate().bound());
+
+        sig.connect(signal_mem_ptr(counter, &Counter::add));
+        ASSERT_TRUE(sig.emit((void*)5));
+        ASSERT_TRUE(sig.emit((void*)7));
+        ASSERT_EQ(12U, counter.sum);
+
+        sig.connect(signal_mem_ptr(derived, &Derived::twice));
+        ASSERT_TRUE(sig.emit((void*)3));
+        ASSERT_FALSE(sig.emit((void*)0));
+        ASSERT_EQ(6U, derived.sum);
+
+        /* Member function compiled into the delegate */
+        sig.connect(SIGNAL_MEM_FN(derived, &Derived::twice));
+        ASSERT_TRUE(sig.emit((void*)2));
+        ASSERT_EQ(10U, derived.sum);
+
+        sig.connect(SIGNAL_MEM_FN(derived, &Counter::add));
+        ASSERT_TRUE(sig.emit((void*)1));
+        ASSERT_EQ(11U, derived.sum);
+
+        sig.connect(signal_fun_ptr(fun_add));
+        ASSERT_TRUE(sig.emit((void*)4));
+        ASSERT_EQ(4U, fun_sum);
+
+        /* Delegates are plain values */
+        Delegate copy = signal_mem_ptr(counter, &Counter::add);
+        Delegate other = copy;
+        ASSERT_TRUE(other((void*)1));
+        ASSERT_EQ(13U, counter.sum);
+    }
+
+    /* Callback object as Signal::connect used to allocate it */
+    struct LegacyFunctor {
+        virtual bool operator()(void* arg) = 0;
+    };
+
+    template<class T>
+    struct LegacyFunctor1 : public LegacyFunctor {
+        bool (T::*fpt)(void *arg);
+        T& obj;
+
+        LegacyFunctor1(T& _obj, bool (T::*_fpt)(void *arg))
+            : fpt(_fpt), obj(_obj) {}
+
+        virtual bool operator()(void *arg) {
+            return (obj.*fpt)(arg);
+        }
+    };
+
+    /* Callbacks of simulated controllers are spread over many objects */
+    const int bench_signals = 4096;
+
+    int next_signal(W64& seed)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (seed >> 33) % bench_signals;
+    }
+
+    /*
+     * Cost of emitting signals of many controllers, with the heap allocated
+     * virtual functor that Signal used before and with the inline delegate,
+     * and events per second through the memory hierarchy event queue.
+     */
+    TEST(SignalBench, EventDispatch)
+    {
+        const int events = 1 << 20;
+        const int batch = 64;
+        double hz = CycleTimer::gethz();
+        CycleTimer legacy_timer;
+        CycleTimer delegate_timer;
+        CycleTimer queue_timer;
+        Counter *counters = new Counter[bench_signals];
+        W64 seed;
+
+        LegacyFunctor **legacy = new LegacyFunctor*[bench_signals];
+        dynarray<void*> filler;
+        foreach (i, bench_signals) {
+            legacy[i] = new LegacyFunctor1<Counter>(counters[i],
+                    &Counter::add);
+            /* Other allocations of the simulator between the functors */
+            filler.push(malloc(96));
+        }
+
+        seed = 1;
+        legacy_timer.start();
+        foreach (i, events) {
+            (*legacy[next_signal(seed)])((void*)1);
+        }
+        legacy_timer.stop();
+
+        foreach (i, bench_signals) {
+            delete legacy[i];
+            free(filler[i]);
+        }
+        delete[] legacy;
+
+        Signal *sigs = new Signal[bench_signals];
+        foreach (i, bench_signals) {
+            sigs[i].set_name("add");
+            sigs[i].connect(SIGNAL_MEM_FN(counters[i], &Counter::add));
+        }
+
+        seed = 1;
+        delegate_timer.start();
+        foreach (i, events) {
+            sigs[next_signal(seed)].emit((void*)1);
+        }
+        delegate_timer.stop();
+
+        EventQueue queue;
+        W64 clock = 0;
+
+        seed = 1;
+        queue_timer.start();
+        for (int i = 0; i < events; i += batch) {
+            foreach (j, batch) {
+                queue.add(&sigs[next_signal(seed)], clock + (j & 7),
+                        (void*)1);
+            }
+            queue.dispatch(clock + 7);
+            clock += 8;
+        }
+        queue_timer.stop();
+
+        W64 sum = 0;
+        foreach (i, bench_signals) {
+            sum += counters[i].sum;
+        }
+        ASSERT_EQ(W64(events) * 3, sum);
+
+        delete[] sigs;
+        delete[] counters;
+
+        std::cout << "Signal emit: "
+            << (double)legacy_timer.cycles() / events
+            << " cycles with virtual functor, "
+            << (double)delegate_timer.cycles() / events
+            << " cycles with delegate" << std::endl;
+
+        if (hz > 0) {
+            std::cout << "Event queue: "
+                << (W64)(events / ((double)queue_timer.cycles() / hz))
+                << " events per second" << std::endl;
+        }
+    }
+}
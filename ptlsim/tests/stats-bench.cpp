@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+
+// We disable Assert of Simulator
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <statsBuilder.h>
+#include <memoryStats.h>
+
+#include <iostream>
+
+/*
+ * Core parameters of the 'xeon' core in config/xeon.conf. The namespace is
+ * unique to this file so it never clashes with the generated core models.
+ */
+#define OOO_CORE_MODEL xeon_stats_bench
+#define OOO_ISSUE_WIDTH 5
+#define OOO_COMMIT_WIDTH 4
+#define OOO_ROB_SIZE 128
+#define OOO_ISSUE_Q_SIZE 36
+#define OOO_ALU_FU_COUNT 6
+#define OOO_FPU_FU_COUNT 6
+#define OOO_LOAD_FU_COUNT 1
+#define OOO_STORE_FU_COUNT 1
+#define OOO_LOAD_Q_SIZE 48
+#define OOO_STORE_Q_SIZE 32
+#include <ooo-stats.h>
+
+namespace OOO_CORE_MODEL {
+#ifdef MULTI_IQ
+    const char* cluster_names[MAX_CLUSTERS] = {"int0", "int1", "ld", "fp"};
+#else
+    const char* cluster_names[MAX_CLUSTERS] = {"all"};
+#endif
+    const char* phys_reg_file_names[PHYS_REG_FILE_COUNT] = {"int", "fp", "st", "br"};
+};
+
+using namespace Memory;
+using namespace OOO_CORE_MODEL;
+
+namespace {
+
+    /* Stats tree of the xeon_single_core machine */
+    struct XeonStats : public Statable {
+        Statable core;
+        OooCoreThreadStats thread;
+        OooCoreStats core_stats;
+        CPUControllerStats core_cont;
+        MESIStats L1_I;
+        MESIStats L1_D;
+        MESIStats L2;
+        MESIStats L3;
+        BusStats bus;
+
+        XeonStats() : Statable("xeon_stats_bench")
+                      , core("ooo_0_0", this)
+                      , thread("thread0", &core)
+                      , core_stats("core", &core)
+                      , core_cont("core_0_cont", this)
+                      , L1_I("L1_I_0", this)
+                      , L1_D("L1_D_0", this)
+                      , L2("L2_0", this)
+                      , L3("L3_0", this)
+                      , bus("split_bus_0", this)
+        { }
+
+        /* Counters updated in a typical time-stats period */
+        void simulate_period(int i) {
+            thread.commit.insns += 12000 + i;
+            thread.commit.uops += 17000 + i;
+            core_stats.cycles += 10000;
+            L1_I.cpurequest.count.hit.read.hit += 3000;
+            L1_D.cpurequest.count.hit.read.hit += 2500 + i;
+            L1_D.cpurequest.count.hit.write.hit += 900;
+            L1_D.cpurequest.count.miss.read += 40;
+            L2.cpurequest.count.hit.read.hit += 30;
+            L2.cpurequest.count.miss.read += 10;
+            L3.cpurequest.count.miss.read += 2;
+            bus.addr_bus_cycles += 12;
+        }
+    };
+
+    struct Snapshot {
+        Stats *user, *kernel, *total, *last, *diff;
+
+        Snapshot() {
+            StatsBuilder &builder = StatsBuilder::get();
+            user = builder.get_new_stats();
+            kernel = builder.get_new_stats();
+            total = builder.get_new_stats();
+            last = builder.get_new_stats();
+            diff = builder.get_new_stats();
+        }
+
+        ~Snapshot() {
+            StatsBuilder &builder = StatsBuilder::get();
+            builder.destroy_stats(user);
+            builder.destroy_stats(kernel);
+            builder.destroy_stats(total);
+            builder.destroy_stats(last);
+            builder.destroy_stats(diff);
+        }
+
+        /* Same work as update_stats and a text time-stats dump */
+        void take() {
+            total->reset();
+            *total += *user;
+            *total += *kernel;
+
+            *diff = *total;
+            StatsBuilder::get().sub_stats(*diff, *last);
+            *last = *total;
+        }
+    };
+
+    /*
+     * Time snapshots of the xeon_single_core stats. 'full' marks the whole
+     * Stats memory dirty before each snapshot, which costs the same as
+     * copying and walking all of it like before dirty tracking.
+     */
+    W64 run_snapshots(XeonStats &st, Snapshot &snap, bool full, int periods)
+    {
+        CycleTimer timer;
+
+        st.set_default_stats(snap.user);
+
+        foreach (i, periods) {
+            st.simulate_period(i);
+
+            if (full) {
+                snap.user->mark_dirty(0, STATS_SIZE);
+                snap.kernel->mark_dirty(0, STATS_SIZE);
+                snap.last->mark_dirty(0, STATS_SIZE);
+            }
+
+            timer.start();
+            snap.take();
+            timer.stop();
+        }
+
+        return timer.cycles() / periods;
+    }
+
+    TEST(StatsBench, XeonSnapshot)
+    {
+        const int periods = 50;
+        XeonStats st;
+        Snapshot dirty_snap;
+        Snapshot full_snap;
+
+        W64 dirty_cycles = run_snapshots(st, dirty_snap, false, periods);
+        W64 full_cycles = run_snapshots(st, full_snap, true, periods);
+
+        std::cout << "Stats snapshot, xeon_single_core: "
+            << dirty_cycles << " cycles with dirty tracking, "
+            << full_cycles << " cycles for the full Stats memory" << std::endl;
+
+        ASSERT_EQ(0, memcmp((void*)dirty_snap.total->base(),
+                    (void*)full_snap.total->base(), STATS_SIZE));
+        ASSERT_EQ(0, memcmp((void*)dirty_snap.diff->base(),
+                    (void*)full_snap.diff->base(), STATS_SIZE));
+    }
+}
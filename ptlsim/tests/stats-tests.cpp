@@ -318,4 +318,206 @@ namespace {
 
 		ASSERT_EQ(ct1_val, 10);
 	}
+
+    TEST(Stats, DirtyBlocks) {
+        StatsBuilder &builder = StatsBuilder::get();
+        builder.delete_nodes();
+
+        Stats *src = builder.get_new_stats();
+        Stats *dest = builder.get_new_stats();
+
+        TestStat st;
+        StatArray<W64, 1024> spacer("spacer", &st);
+        StatObj<W64> far("far", &st);
+
+        st.set_default_stats(src);
+        st.ct1 += 5;
+
+        ASSERT_TRUE(src->is_dirty(0));
+        ASSERT_FALSE(src->is_dirty(far.get_offset()));
+        ASSERT_FALSE(dest->is_dirty(0));
+
+        /* Copy and add only touch the written block */
+        *dest = *src;
+        ASSERT_TRUE(dest->is_dirty(0));
+        ASSERT_FALSE(dest->is_dirty(far.get_offset()));
+        ASSERT_EQ(5, st.ct1(dest));
+
+        far++;
+        spacer[1023] += 3;
+        *dest += *src;
+        ASSERT_EQ(10, st.ct1(dest));
+        ASSERT_EQ(1, far(dest));
+        ASSERT_EQ(3, spacer(dest)[1023]);
+
+        builder.sub_stats(*dest, *src);
+        ASSERT_EQ(5, st.ct1(dest));
+        ASSERT_EQ(0, far(dest));
+
+        /* Reset leaves every block clean and zero */
+        src->reset();
+        ASSERT_FALSE(src->is_dirty(0, STATS_SIZE));
+        ASSERT_EQ(0, st.ct1(src));
+
+        *dest = *src;
+        ASSERT_EQ(0, st.ct1(dest));
+        ASSERT_EQ(0, spacer(dest)[1023]);
+
+        builder.destroy_stats(src);
+        builder.destroy_stats(dest);
+    }
+
+    TEST(Stats, Delta) {
+        StatsBuilder &builder = StatsBuilder::get();
+        builder.delete_nodes();
+
+        Stats *stats = builder.get_new_stats();
+
+        TestStat st;
+        StatArray<W64, 1024> spacer("spacer", &st);
+        StatObj<W64> far("far", &st);
+
+        st.set_default_stats(stats);
+        far += 100;
+
+        /* The same work in two cycles is replayed exactly */
+        StatsDelta delta;
+        delta.start(*stats);
+        st.ct1 += 2;
+        st.ct2++;
+        delta.mark();
+
+        delta.snapshot();
+        st.ct1 += 2;
+        st.ct2++;
+        ASSERT_TRUE(delta.measure());
+
+        delta.apply(10);
+        ASSERT_EQ(24, st.ct1(stats));
+        ASSERT_EQ(12, st.ct2(stats));
+        ASSERT_EQ(100, far(stats));
+
+        /* Dirty blocks from before are kept for snapshots */
+        ASSERT_TRUE(stats->is_dirty(far.get_offset()));
+
+        /* Writes to a block the first cycle did not touch fail the sample */
+        delta.start(*stats);
+        st.ct1++;
+        delta.mark();
+
+        delta.snapshot();
+        st.ct1++;
+        far++;
+        ASSERT_FALSE(delta.measure());
+        ASSERT_TRUE(stats->is_dirty(far.get_offset()));
+        ASSERT_EQ(26, st.ct1(stats));
+
+        /* Cancelled sample leaves the dirty map as it was */
+        stats->reset();
+        delta.start(*stats);
+        st.ct1++;
+        delta.cancel();
+        ASSERT_TRUE(stats->is_dirty(0));
+
+        builder.destroy_stats(stats);
+    }
+
+    TEST(Stats, DumpKeepsBlocksClean) {
+        StatsBuilder &builder = StatsBuilder::get();
+        builder.delete_nodes();
+
+        Stats *stats = builder.get_new_stats();
+
+        TestStat st;
+        StatArray<W64, 1024> spacer("spacer", &st);
+        StatObj<W64> far("far", &st);
+
+        st.ct1.enable_summary();
+        st.sum.enable_summary();
+        spacer.enable_summary();
+
+        /* Dumping a clean Stats in every format reads it only */
+        ostringstream os;
+        builder.dump(stats, os);
+
+        YAML::Emitter out;
+        builder.dump(stats, out);
+
+        bson_buffer bb;
+        bson_buffer_init(&bb);
+        builder.dump(stats, &bb);
+        bson_buffer_destroy(&bb);
+
+        st.dump_summary(os, stats, "test");
+        st.div.dump(os, stats);
+
+        ASSERT_FALSE(stats->is_dirty(0, STATS_SIZE));
+
+        /* Only the written block stays dirty after a dump */
+        st.ct1 += 5;
+        builder.dump(stats, os);
+        st.dump_summary(os, stats, "test");
+
+        ASSERT_TRUE(stats->is_dirty(st.ct1.get_offset()));
+        ASSERT_FALSE(stats->is_dirty(far.get_offset()));
+        ASSERT_EQ(5, st.sum(stats));
+
+        builder.destroy_stats(stats);
+    }
+
+    TEST(Stats, BinaryTimeStats) {
+        StatsBuilder &builder = StatsBuilder::get();
+        builder.delete_nodes();
+        user_stats->reset();
+        kernel_stats->reset();
+
+        ostringstream os;
+        TestStat st;
+        builder.init_timer_stats(true);
+
+        st.ct1.set_default_stats(kernel_stats);
+        st.ct2.set_default_stats(user_stats);
+        st.time_arr.set_default_stats(user_stats);
+        st.sum.enable_periodic_dump();
+        st.time_arr.enable_periodic_dump(2);
+
+        builder.dump_header(os);
+        std::string header = os.str();
+        reset_stream(os);
+
+        /* magic, version, 2 columns for sum and 1 for time_arr, 4 fields */
+        const W32 *counts = (const W32*)(header.data() + 8);
+        ASSERT_EQ(0, header.compare(0, 8, "MARSSTSB"));
+        ASSERT_EQ(1, counts[0]);
+        ASSERT_EQ(3, counts[1]);
+        ASSERT_EQ(4, counts[2]);
+
+        st.ct1 += 7;
+        st.ct2 += 2;
+        builder.dump_periodic(os, 100);
+
+        /* cycle, bitmap and only the two changed counters */
+        std::string row1 = os.str();
+        const W64 *row = (const W64*)row1.data();
+        ASSERT_EQ(4 * sizeof(W64), row1.size());
+        ASSERT_EQ(100, row[0]);
+        ASSERT_EQ(3, row[1]);
+        ASSERT_EQ(7, row[2]);
+        ASSERT_EQ(2, row[3]);
+        reset_stream(os);
+
+        st.ct2++;
+        st.time_arr[2] += 5;
+        builder.dump_periodic(os, 200);
+
+        std::string row2 = os.str();
+        row = (const W64*)row2.data();
+        ASSERT_EQ(4 * sizeof(W64), row2.size());
+        ASSERT_EQ(200, row[0]);
+        ASSERT_EQ(6, row[1]);
+        ASSERT_EQ(1, row[2]);
+        ASSERT_EQ(5, row[3]);
+
+        builder.init_timer_stats(false);
+    }
 };
@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+
+#include <sync-barrier.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+namespace {
+
+    /* Each test uses its own group so runs never interfere */
+    void test_group_name(char* buf, int size, const char* test)
+    {
+        snprintf(buf, size, "test-%s-%d", test, getpid());
+    }
+
+    /* Counters shared between the forked participants */
+    volatile int* shared_counters(int count)
+    {
+        void* mem = mmap(NULL, sizeof(int) * count, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        memset(mem, 0, sizeof(int) * count);
+        return (volatile int*)mem;
+    }
+
+    int wait_children(int count)
+    {
+        int failed = 0;
+
+        for (int i = 0; i < count; i++) {
+            int status;
+            wait(&status);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                failed++;
+        }
+
+        return failed;
+    }
+
+    /*
+     * No participant may start round r+1 before every participant has
+     * finished round r.
+     */
+    TEST(SyncBarrier, Lockstep)
+    {
+        const int procs = 4;
+        const int rounds = 200;
+        char group[64];
+        test_group_name(group, sizeof(group), "lockstep");
+
+        volatile int* progress = shared_counters(procs);
+        SyncBarrier* barriers[procs];
+
+        /* Join before forking so every round has all participants */
+        for (int p = 0; p < procs; p++) {
+            barriers[p] = new SyncBarrier();
+            ASSERT_TRUE(barriers[p]->join(group));
+        }
+        ASSERT_EQ(procs, barriers[0]->participants());
+
+        for (int p = 0; p < procs; p++) {
+            if (fork() == 0) {
+                SyncBarrier& barrier = *barriers[p];
+
+                for (int r = 0; r < rounds; r++) {
+                    progress[p] = r;
+                    if (!barrier.wait())
+                        _exit(2);
+
+                    for (int q = 0; q < procs; q++) {
+                        if (progress[q] < r)
+                            _exit(1);
+                    }
+
+                    if (!barrier.wait())
+                        _exit(2);
+                }
+
+                barrier.leave();
+                _exit(0);
+            }
+        }
+
+        for (int p = 0; p < procs; p++) {
+            barriers[p]->detach();
+            delete barriers[p];
+        }
+
+        ASSERT_EQ(0, wait_children(procs));
+    }
+
+    /* A participant that leaves releases the others waiting for it */
+    TEST(SyncBarrier, LeaveReleasesWaiters)
+    {
+        char group[64];
+        test_group_name(group, sizeof(group), "leave");
+
+        SyncBarrier stays, leaves;
+        ASSERT_TRUE(stays.join(group));
+        ASSERT_TRUE(leaves.join(group));
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            leaves.detach();
+            bool released = stays.wait();
+            stays.leave();
+            _exit(released ? 0 : 1);
+        }
+
+        stays.detach();
+        usleep(20000);
+        leaves.leave();
+
+        ASSERT_EQ(0, wait_children(1));
+    }
+
+    /* Participants that died without leaving are removed on timeout */
+    TEST(SyncBarrier, DeadParticipant)
+    {
+        char group[64];
+        test_group_name(group, sizeof(group), "dead");
+
+        SyncBarrier barrier;
+        ASSERT_TRUE(barrier.join(group));
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            barrier.detach();
+            SyncBarrier crashed;
+            crashed.join(group);
+            _exit(0); /* exits without leave() */
+        }
+        ASSERT_EQ(0, wait_children(1));
+        ASSERT_EQ(2, barrier.participants());
+
+        ASSERT_TRUE(barrier.wait());
+        ASSERT_EQ(1U, barrier.departed);
+        ASSERT_EQ(1, barrier.participants());
+
+        barrier.leave();
+    }
+
+    /* A participant that dies while holding the group lock */
+    TEST(SyncBarrier, DeadLockOwner)
+    {
+        char group[64];
+        test_group_name(group, sizeof(group), "deadlock");
+
+        SyncBarrier barrier;
+        ASSERT_TRUE(barrier.join(group));
+
+        pid_t pid = fork();
+        if (pid == 0) {
+            barrier.detach();
+            SyncBarrier crashed;
+            crashed.join(group);
+
+            SyncBarrierGroup* shared = SyncBarrier::map_group(group);
+            pthread_mutex_lock(&shared->lock);
+            _exit(0); /* exits with the lock held */
+        }
+        ASSERT_EQ(0, wait_children(1));
+
+        ASSERT_TRUE(barrier.wait());
+        ASSERT_EQ(1U, barrier.departed);
+        ASSERT_EQ(1, barrier.participants());
+
+        barrier.leave();
+    }
+
+    /* Removing the group stops every participant */
+    TEST(SyncBarrier, RemoveGroup)
+    {
+        char group[64];
+        test_group_name(group, sizeof(group), "remove");
+
+        SyncBarrier a, b;
+        ASSERT_TRUE(a.join(group));
+        ASSERT_TRUE(b.join(group));
+
+        ASSERT_TRUE(SyncBarrier::remove_group(group));
+        ASSERT_FALSE(a.wait());
+
+        a.leave();
+        b.leave();
+    }
+}
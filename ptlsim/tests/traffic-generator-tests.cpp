@@ -0,0 +1,116 @@
+
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <trafficGenerator.h>
+
+#include <set>
+
+using namespace Memory;
+
+namespace {
+
+    TrafficConfig make_config(int pattern, W64 footprint)
+    {
+        TrafficConfig config;
+        config.pattern = pattern;
+        config.agents = 4;
+        config.requests = 1000;
+        config.footprint = footprint;
+        config.writePercent = 30;
+        config.outstanding = 8;
+        config.seed = 1;
+        return config;
+    }
+
+    TEST(TrafficAgent, Stream)
+    {
+        TrafficConfig config = make_config(TRAFFIC_STREAM, 64 * 1024);
+        TrafficAgent agent;
+        W64 address;
+        bool write;
+
+        agent.init(2, config);
+
+        foreach (i, 2048) {
+            agent.next(address, write);
+            ASSERT_EQ(2 * 64 * 1024 + (i % 1024) * 64ULL, address);
+        }
+    }
+
+    TEST(TrafficAgent, ChaseVisitsAllLines)
+    {
+        /* Footprint is rounded down to a power of two lines */
+        TrafficConfig config = make_config(TRAFFIC_CHASE, 100 * 64);
+        TrafficAgent agent;
+        std::set<W64> lines;
+        W64 address;
+        bool write;
+
+        agent.init(1, config);
+
+        foreach (i, 64) {
+            agent.next(address, write);
+            ASSERT_EQ(0U, address % 64);
+            ASSERT_GE(address, 64 * 64ULL);
+            ASSERT_LT(address, 2 * 64 * 64ULL);
+            lines.insert(address);
+        }
+
+        ASSERT_EQ(64U, lines.size());
+    }
+
+    TEST(TrafficAgent, RandomWrites)
+    {
+        TrafficConfig config = make_config(TRAFFIC_RANDOM, 1 << 20);
+        TrafficAgent agent;
+        W64 address;
+        bool write;
+        int writes = 0;
+
+        agent.init(0, config);
+
+        foreach (i, 10000) {
+            agent.next(address, write);
+            ASSERT_LT(address, 1ULL << 20);
+            writes += write;
+        }
+
+        ASSERT_GT(writes, 2500);
+        ASSERT_LT(writes, 3500);
+    }
+
+    TEST(TrafficAgent, Sharing)
+    {
+        TrafficConfig config = make_config(TRAFFIC_PRODCONS, 4096);
+        TrafficAgent producer, consumer, other;
+        W64 paddr, caddr, oaddr;
+        bool pwrite, cwrite, owrite;
+
+        producer.init(2, config);
+        consumer.init(3, config);
+        other.init(0, config);
+
+        foreach (i, 100) {
+            producer.next(paddr, pwrite);
+            consumer.next(caddr, cwrite);
+            other.next(oaddr, owrite);
+            ASSERT_EQ(paddr, caddr);
+            ASSERT_NE(paddr, oaddr);
+            ASSERT_TRUE(pwrite);
+            ASSERT_FALSE(cwrite);
+        }
+
+        config = make_config(TRAFFIC_FALSESHARE, 4096);
+        producer.init(0, config);
+        consumer.init(1, config);
+
+        foreach (i, 100) {
+            producer.next(paddr, pwrite);
+            consumer.next(caddr, cwrite);
+            ASSERT_NE(paddr, caddr);
+            ASSERT_EQ(paddr / 64, caddr / 64);
+        }
+    }
+}
@@ -0,0 +1,62 @@
+
+#include <gtest/gtest.h>
+
+#define DISABLE_ASSERT
+#include <ptlsim.h>
+#include <warm-state.h>
+
+namespace {
+
+    TEST(WarmState, SaveRestore)
+    {
+        const char* filename = "/tmp/test_warm_state";
+        W64 tags[16];
+        W32 counters[8];
+
+        foreach (i, 16) tags[i] = i * 0x40;
+        foreach (i, 8) counters[i] = i % 4;
+
+        WarmStateFile ws;
+        ASSERT_TRUE(ws.create(filename, 0x1234));
+        ws.save("L1_D_0", tags, sizeof(tags));
+        ws.save("core_0_t0_bp", counters, sizeof(counters));
+        ASSERT_TRUE(ws.has("L1_D_0"));
+        ASSERT_FALSE(ws.has("L2_0"));
+        ws.close();
+
+        W64 new_tags[16];
+        W32 new_counters[4];
+        memset(new_tags, 0, sizeof(new_tags));
+
+        ASSERT_TRUE(ws.open(filename, 0x1234));
+        ASSERT_TRUE(ws.restore("L1_D_0", new_tags, sizeof(new_tags)));
+        ASSERT_TRUE(ws.is_restored("L1_D_0"));
+        ASSERT_EQ(0, memcmp(tags, new_tags, sizeof(tags)));
+
+        /* Size changed, the structure keeps its state */
+        ASSERT_FALSE(ws.restore("core_0_t0_bp", new_counters,
+                    sizeof(new_counters)));
+        ASSERT_FALSE(ws.is_restored("core_0_t0_bp"));
+
+        /* Not in the file */
+        ASSERT_FALSE(ws.restore("L2_0", new_tags, sizeof(new_tags)));
+
+        ASSERT_EQ(1, ws.get_restored());
+        ASSERT_EQ(2, ws.get_skipped());
+    }
+
+    TEST(WarmState, SignatureMismatch)
+    {
+        const char* filename = "/tmp/test_warm_state_sig";
+        W64 data = 42;
+
+        WarmStateFile ws;
+        ASSERT_TRUE(ws.create(filename, 1));
+        ws.save("L1_D_0", &data, sizeof(data));
+        ws.close();
+
+        ASSERT_FALSE(ws.open(filename, 2));
+        ASSERT_FALSE(ws.open("/tmp/no_such_warm_state", 1));
+        ASSERT_TRUE(ws.open(filename, 1));
+    }
+}
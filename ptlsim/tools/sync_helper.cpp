@@ -2,119 +2,103 @@
  * sync_helper.cpp : A small helper tool for Marss's -sync option
  *
  * This small tool is aimed to help Marss users in -sync option by
- * providing options to manipulate semaphore used for syncing between
- * simulation instances.  Available options are:
+ * providing options to inspect and remove the shared memory barrier used
+ * for syncing between simulation instances.  Available options are:
  *
- *    delete   :  Delete the semaphore
- *    set N    :  Set semaphore value to N
+ *    info [group]    :  Show the participants of the group (default)
+ *    delete [group]  :  Delete the group, all its instances stop
+ *
+ * The group defaults to MARSS_SYNC_GROUP from the environment, or
+ * 'default' which is the group used when '-sync-group' is not given.
  *
  * To compile:
- *    $ g++ sync_helper.cpp -o sync_helper
+ *    $ g++ sync_helper.cpp ../sim/sync-barrier.cpp -I../sim -o sync_helper -lrt -lpthread
  */
 
 
 #include <iostream>
 
-#include <sys/types.h>
-#include <sys/ipc.h>
-#include <sys/sem.h>
+#include <sync-barrier.h>
+
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-#include <errno.h>
+#include <unistd.h>
 
 using namespace std;
 
-#define SEM_NUM 3764
-
-void info(int sem_id)
+bool group_exists(const char* group_name)
 {
-    int rc;
+    char path[256];
 
-    rc = semctl(sem_id, 0, GETVAL);
-    cout << "Semaphore value: " << rc << endl;
-
-    rc = semctl(sem_id, 0, GETZCNT);
-    cout << "Processes waiting for zero: " << rc << endl;
+    snprintf(path, sizeof(path), "/dev/shm/marss-sync-%s", group_name);
+    return access(path, F_OK) == 0;
 }
 
-void remove(int sem_id)
+void info(const char* group_name)
 {
-    int rc;
-
-    rc = semctl(sem_id, 0, IPC_RMID);
+    SyncBarrierGroup* group = SyncBarrier::map_group(group_name);
 
-    if (rc != 0) {
-        cout << "Unable to delete semaphore: ";
-        perror("sem_id");
+    if (!group) {
+        cout << "Unable to access group " << group_name << endl;
+        perror("map_group");
         return;
     }
 
-    cout << "Semaphore removed." << endl;
-}
+    cout << "Group: " << group_name << endl;
+    cout << "Participants: " << group->participants << endl;
+    cout << "Arrived at barrier: " << group->arrived << endl;
+    cout << "Phase: " << group->phase << endl;
 
-void set(int sem_id, int val)
-{
-    int rc;
+    for (int i = 0; i < SYNC_BARRIER_MAX_PARTICIPANTS; i++) {
+        if (group->slots[i].pid == 0)
+            continue;
 
-    rc = semctl(sem_id, 0, SETVAL, val);
+        cout << "  pid " << group->slots[i].pid <<
+            (group->slots[i].arrived ? " (waiting)" : "") << endl;
+    }
+
+    SyncBarrier::unmap_group(group);
+}
 
-    if (rc != 0) {
-        cout << "Unable to set semaphore value: ";
-        perror("sem_id");
+void delete_group(const char* group_name)
+{
+    if (!SyncBarrier::remove_group(group_name)) {
+        cout << "Unable to delete group: ";
+        perror("remove_group");
         return;
     }
 
-    cout << "Semaphore value set to " << val << endl;
+    cout << "Group removed." << endl;
 }
 
 int main(int argc, char** argv)
 {
-    char *env_sem_id_p;
-    int sem_num;
-    int sem_id;
-    int val;
-    int rc;
-
-    /* First check if semaphore exists or not */
-
-    env_sem_id_p = getenv("MARSS_SEM_ID");
+    const char* group_name = getenv("MARSS_SYNC_GROUP");
+    const char* cmd = "info";
 
-    if (env_sem_id_p)
-        sem_num = atoi(env_sem_id_p);
-    else
-        sem_num = SEM_NUM;
+    if (!group_name || !group_name[0])
+        group_name = "default";
 
-    sem_id = semget(sem_num, 1, IPC_CREAT|IPC_EXCL|0666);
+    if (argc >= 2)
+        cmd = argv[1];
 
-    if (sem_id == -1) {
-        if (errno == EEXIST) {
-            sem_id = semget(sem_num, 1, IPC_CREAT|0666);
-        }
-
-        if (sem_id == -1) {
-            cout << "Unable to access semaphore.\n";
-            perror("sem_id");
-            exit(0);
-        }
-    }
+    if (argc >= 3)
+        group_name = argv[2];
 
-    info(sem_id);
-
-    if (argc < 2)
+    if (!group_exists(group_name)) {
+        cout << "No simulation instances in group " << group_name << endl;
         return 0;
+    }
 
-    if (strcmp("delete", argv[1]) == 0) {
-        remove(sem_id);
-    } else if (strcmp("set", argv[1]) == 0) {
-
-        if (argc < 3) {
-            cout << "Please specify the value to set.\n";
-            return -1;
-        }
-
-        val = atoi(argv[2]);
-        set(sem_id, val);
+    if (strcmp("delete", cmd) == 0) {
+        info(group_name);
+        delete_group(group_name);
+    } else if (strcmp("info", cmd) == 0) {
+        info(group_name);
+    } else {
+        cout << "Unknown option " << cmd << endl;
+        return -1;
     }
 
     return 0;
@@ -0,0 +1,341 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ * Persistent on-disk store of translated basic blocks, so repeated runs
+ * from the same checkpoint skip most of the x86 decoding.
+ */
+
+#include <globals.h>
+#include <ptlsim.h>
+#include <decode.h>
+#include <bbcache-store.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define BBSTORE_MAGIC 0x31545342424c5450ULL /* 'PTLBBST1' */
+#define BBSTORE_VERSION 1
+
+/* One hash bucket for every this many bytes of the store */
+#define BBSTORE_BYTES_PER_BUCKET 1024
+
+BasicBlockStore bbstore;
+
+static W64 hash_bytes(const byte* bytes, int count)
+{
+    W64 hash = 0xcbf29ce484222325ULL;
+
+    foreach (i, count) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+//
+// Translations are only valid for the simulator binary that made them,
+// since uop encodings and assist numbers change between builds.
+//
+static W64 get_build_id()
+{
+    struct stat st;
+
+    if (stat("/proc/self/exe", &st) != 0)
+        return 0;
+
+    return (W64(st.st_mtime) << 32) ^ W64(st.st_size) ^
+        (W64(st.st_ino) << 16);
+}
+
+static W64 align8(W64 value)
+{
+    return (value + 7) & ~7ULL;
+}
+
+BasicBlockStore::BasicBlockStore()
+    : tried(false)
+    , header(NULL)
+    , buckets(NULL)
+    , map_size(0)
+    , fd(-1)
+    , writer(false)
+    , build_id(0)
+{ }
+
+bool BasicBlockStore::header_valid(W64 file_size) const
+{
+    return header->magic == BBSTORE_MAGIC &&
+        header->version == BBSTORE_VERSION &&
+        header->transop_size == sizeof(TransOp) &&
+        header->bbbase_size == sizeof(BasicBlockBase) &&
+        header->build_id == build_id &&
+        header->capacity == file_size &&
+        header->used <= file_size;
+}
+
+void BasicBlockStore::init_header(W64 capacity)
+{
+    W64 bucket_count = 1;
+    while (bucket_count * BBSTORE_BYTES_PER_BUCKET < capacity)
+        bucket_count <<= 1;
+
+    memset(header, 0, sizeof(BasicBlockStoreHeader));
+    memset(buckets, 0, bucket_count * sizeof(W64));
+
+    header->version = BBSTORE_VERSION;
+    header->transop_size = sizeof(TransOp);
+    header->bbbase_size = sizeof(BasicBlockBase);
+    header->bucket_count = bucket_count;
+    header->build_id = build_id;
+    header->capacity = capacity;
+    header->used = align8(sizeof(BasicBlockStoreHeader) +
+            bucket_count * sizeof(W64));
+    header->count = 0;
+
+    // Publish the header only once everything else is in place
+    __sync_synchronize();
+    header->magic = BBSTORE_MAGIC;
+}
+
+/**
+ * @brief Map the store file, creating it if needed
+ *
+ * Only one simulator process at a time adds new translations to a store;
+ * others that open the same file use it read-only. A store written by a
+ * different simulator binary is cleared by the writer and ignored by the
+ * readers.
+ *
+ * @return false if the store can not be used, simulation then continues
+ * without it
+ */
+bool BasicBlockStore::open(const char* filename, W64 size_mb)
+{
+    tried = true;
+    build_id = get_build_id();
+
+    fd = ::open(filename, O_RDWR | O_CREAT, 0666);
+    if (fd < 0) {
+        ptl_logfile << "Warning: unable to open bbcache store ", filename,
+                    ": ", strerror(errno), endl;
+        return false;
+    }
+
+    writer = (flock(fd, LOCK_EX | LOCK_NB) == 0);
+
+    struct stat st;
+    fstat(fd, &st);
+    W64 capacity = st.st_size;
+
+    if (writer && capacity == 0) {
+        capacity = size_mb << 20;
+        if (ftruncate(fd, capacity) != 0) {
+            ptl_logfile << "Warning: unable to resize bbcache store ",
+                        filename, ": ", strerror(errno), endl;
+            close();
+            return false;
+        }
+    }
+
+    if (capacity < sizeof(BasicBlockStoreHeader)) {
+        close();
+        return false;
+    }
+
+    int prot = writer ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void* mem = mmap(NULL, capacity, prot, MAP_SHARED, fd, 0);
+    if (mem == MAP_FAILED) {
+        ptl_logfile << "Warning: unable to map bbcache store ", filename,
+                    ": ", strerror(errno), endl;
+        close();
+        return false;
+    }
+
+    header = (BasicBlockStoreHeader*)mem;
+    map_size = capacity;
+    buckets = (W64*)(header + 1);
+
+    if (!header_valid(capacity)) {
+        if (!writer) {
+            ptl_logfile << "Warning: bbcache store ", filename, " was made ",
+                        "by another simulator build, not using it", endl;
+            close();
+            return false;
+        }
+
+        ptl_logfile << "Initializing bbcache store ", filename, endl;
+        init_header(capacity);
+    }
+
+    ptl_logfile << "Using bbcache store ", filename, (writer ? "" : " (read-only)"),
+                ": ", header->count, " basic blocks, ", header->used >> 10, " of ",
+                header->capacity >> 10, " KB used", endl;
+
+    return true;
+}
+
+void BasicBlockStore::close()
+{
+    if (header) {
+        if (writer)
+            msync(header, map_size, MS_ASYNC);
+        munmap(header, map_size);
+    }
+
+    if (fd >= 0)
+        ::close(fd);
+
+    header = NULL;
+    buckets = NULL;
+    fd = -1;
+    writer = false;
+}
+
+W64& BasicBlockStore::bucket_of(const TraceDecoder& trans)
+{
+    const RIPVirtPhys& rvp = trans.bb.rip;
+    W64 key = (rvp.rip ^ (W64(rvp.mfnlo) << 20)) * 0x9e3779b97f4a7c15ULL;
+
+    return buckets[(key >> 32) & (header->bucket_count - 1)];
+}
+
+bool BasicBlockStore::key_matches(const BasicBlockStoreRecord& rec,
+        const TraceDecoder& trans) const
+{
+    const RIPVirtPhys& rvp = trans.bb.rip;
+
+    return rec.rip == rvp.rip &&
+        rec.mfnlo == rvp.mfnlo &&
+        rec.mfnhi == rvp.mfnhi &&
+        rec.use64 == trans.use64 &&
+        rec.use32 == trans.use32 &&
+        rec.ss32 == trans.ss32 &&
+        rec.kernel == trans.kernel &&
+        rec.dirflag == trans.dirflag &&
+        rec.pe == trans.pe &&
+        rec.vm86 == trans.vm86 &&
+        rec.hflags == trans.hflags;
+}
+
+/**
+ * @brief Find a stored translation of the block that trans is about to
+ * decode
+ *
+ * @param trans Decoder after fillbuf(), not yet translated
+ * @param insnbytes Instruction bytes fetched by fillbuf()
+ * @param stale Set if a translation for this block was found but the
+ * code in memory has changed since
+ *
+ * @return A new block like BasicBlock::clone() returns, or NULL
+ */
+BasicBlock* BasicBlockStore::lookup(const TraceDecoder& trans,
+        const byte* insnbytes, bool& stale)
+{
+    stale = false;
+
+    if unlikely (header->build_id != build_id)
+        return NULL;
+
+    W64 offset = bucket_of(trans);
+
+    while (offset && offset < header->used) {
+        const BasicBlockStoreRecord* rec = record_at(offset);
+        offset = rec->next;
+
+        if (!key_matches(*rec, trans))
+            continue;
+
+        if (rec->bytes > trans.valid_byte_count ||
+                rec->bytes_hash != hash_bytes(insnbytes, rec->bytes)) {
+            stale = true;
+            continue;
+        }
+
+        BasicBlock* bb = (BasicBlock*)malloc(sizeof(BasicBlockBase) +
+                (rec->count * sizeof(TransOp)));
+
+        memcpy(bb, &rec->base, sizeof(BasicBlockBase));
+        memcpy(bb->transops, rec->transops, rec->count * sizeof(TransOp));
+
+        bb->synthops = NULL;
+        bb->refcount = 0;
+        bb->hitcount = 0;
+        bb->predcount = 0;
+        bb->hashlink.reset();
+        bb->reset_checked();
+        bb->use(0);
+
+        return bb;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Add a new translation of the block decoded by trans
+ *
+ * Blocks that hit a fetch fault or an invalid instruction depend on more
+ * than the instruction bytes and are not stored.
+ *
+ * @return false if the block is not stored
+ */
+bool BasicBlockStore::insert(const TraceDecoder& trans,
+        const byte* insnbytes, const BasicBlock& bb)
+{
+    if (!writer)
+        return false;
+
+    if (bb.invalidblock || trans.pfec || bb.bytes > trans.valid_byte_count)
+        return false;
+
+    W64 size = align8(sizeof(BasicBlockStoreRecord) +
+            bb.count * sizeof(TransOp));
+
+    if unlikely (header->used + size > header->capacity)
+        return false;
+
+    W64 offset = header->used;
+    BasicBlockStoreRecord* rec = record_at(offset);
+    const RIPVirtPhys& rvp = trans.bb.rip;
+    W64& bucket = bucket_of(trans);
+
+    rec->next = bucket;
+    rec->rip = rvp.rip;
+    rec->mfnlo = rvp.mfnlo;
+    rec->mfnhi = rvp.mfnhi;
+    rec->hflags = trans.hflags;
+    rec->bytes_hash = hash_bytes(insnbytes, bb.bytes);
+    rec->bytes = bb.bytes;
+    rec->count = bb.count;
+    rec->use64 = trans.use64;
+    rec->use32 = trans.use32;
+    rec->ss32 = trans.ss32;
+    rec->kernel = trans.kernel;
+    rec->dirflag = trans.dirflag;
+    rec->pe = trans.pe;
+    rec->vm86 = trans.vm86;
+    rec->pad = 0;
+
+    memcpy(&rec->base, &bb, sizeof(BasicBlockBase));
+    rec->base.synthops = NULL;
+    rec->base.refcount = 0;
+    memcpy(rec->transops, bb.transops, bb.count * sizeof(TransOp));
+
+    //
+    // Readers in other processes follow the bucket without locking, so
+    // the record must be complete before it is linked in.
+    //
+    header->used += size;
+    header->count++;
+    __sync_synchronize();
+    bucket = offset;
+
+    return true;
+}
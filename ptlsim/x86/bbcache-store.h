@@ -0,0 +1,95 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ * Persistent on-disk store of translated basic blocks, so repeated runs
+ * from the same checkpoint skip most of the x86 decoding.
+ */
+
+#ifndef BBCACHE_STORE_H
+#define BBCACHE_STORE_H
+
+#include <globals.h>
+#include <ptlhwdef.h>
+
+struct TraceDecoder;
+
+//
+// The store file starts with this header, followed by the hash bucket
+// array (offsets of the newest record in each bucket) and then the
+// records themselves, appended one after the other until the file is
+// full. Records are never moved or freed; delete the file to start over.
+//
+struct BasicBlockStoreHeader {
+    W64 magic;
+    W32 version;
+    W32 transop_size;
+    W32 bbbase_size;
+    W32 bucket_count;
+    W64 build_id;
+    W64 capacity;
+    W64 used;
+    W64 count;
+};
+
+//
+// A translated basic block together with everything the decoder used
+// besides the instruction bytes themselves. The bytes are only kept as a
+// hash: a record is used when the bytes now in guest memory hash to the
+// same value, so code that changed since the record was written is
+// decoded again.
+//
+struct BasicBlockStoreRecord {
+    W64 next;
+    W64 rip;
+    W32 mfnlo;
+    W32 mfnhi;
+    W64 hflags;
+    W64 bytes_hash;
+    W16 bytes;
+    W16 count;
+    byte use64, use32, ss32, kernel, dirflag, pe, vm86, pad;
+    BasicBlockBase base;
+    TransOp transops[0];
+};
+
+class BasicBlockStore {
+public:
+    BasicBlockStore();
+
+    bool open(const char* filename, W64 size_mb);
+    void close();
+    bool active() const { return header != NULL; }
+    bool writable() const { return writer; }
+
+    BasicBlock* lookup(const TraceDecoder& trans, const byte* insnbytes,
+            bool& stale);
+    bool insert(const TraceDecoder& trans, const byte* insnbytes,
+            const BasicBlock& bb);
+
+    // Set once open() was called, even if it failed
+    bool tried;
+
+private:
+    BasicBlockStoreHeader* header;
+    W64* buckets;
+    W64 map_size;
+    int fd;
+    bool writer;
+    W64 build_id;
+
+    void init_header(W64 capacity);
+    bool header_valid(W64 file_size) const;
+    W64& bucket_of(const TraceDecoder& trans);
+    bool key_matches(const BasicBlockStoreRecord& rec,
+            const TraceDecoder& trans) const;
+
+    BasicBlockStoreRecord* record_at(W64 offset) const {
+        return (BasicBlockStoreRecord*)((byte*)header + offset);
+    }
+};
+
+extern BasicBlockStore bbstore;
+
+#endif // BBCACHE_STORE_H
@@ -554,7 +554,7 @@ W64 l_assist_pushf(Context& ctx, W64 ra, W64 rb, W64 rc, W16 raflags,
 	if(logable(4))
 		ptl_logfile << "[cpu ", ENV_GET_CPU(&ctx)->cpu_index, "]push stable_flags: ", hexstring(stable_flags, 64),
 					" flags: ", hexstring(flags, 16), " at rip: ",
-				   (void*)ctx.eip, " cycle: ", sim_cycle, endl;
+				   (void*)ctx.eip, " cycle: ", core_cycle(), endl;
 
 	return stable_flags;
 }
@@ -880,7 +880,7 @@ W64 l_assist_ioport_in(Context& ctx, W64 ra, W64 rb, W64 rc, W16 raflags,
 
 	if(logable(4))
 		ptl_logfile << "ioport in value: ", hexstring(value, 64), " at rip: ",
-				   (void*)ctx.eip, " cycle: ", sim_cycle, endl;
+				   (void*)ctx.eip, " cycle: ", core_cycle(), endl;
 
 	return value;
 }
@@ -931,7 +931,7 @@ W64 l_assist_ioport_out(Context& ctx, W64 ra, W64 rb, W64 rc, W16 raflags,
 
 	if(logable(4))
 		ptl_logfile << "ioport out value: ", hexstring(value, 64), " at rip: ",
-				   (void*)ctx.eip, " cycle: ", sim_cycle, endl;
+				   (void*)ctx.eip, " cycle: ", core_cycle(), endl;
 
 	return 0;
 }
@@ -8,12 +8,60 @@
 #include <globals.h>
 #include <ptlsim.h>
 #include <decode.h>
+#include <bbcache-store.h>
+#include <host-profile.h>
 
 #include <setjmp.h>
+#include <pthread.h>
 
 BasicBlockCache bbcache[NUM_SIM_CORES];
 W8 BasicBlockCache::cpuid_counter = 0;
 
+//
+// When cores run on their own threads (-parallel-quantum) and share one
+// basic block cache, lookups take the read side of this lock while
+// translation and invalidation take the write side. Writers always take
+// the QEMU lock (parallel_qemu_lock) first, so the lock order is fixed.
+// Translation can invalidate or reclaim blocks itself, so the write side
+// only locks at the outermost level of each thread.
+//
+static pthread_rwlock_t shared_bbcache_lock = PTHREAD_RWLOCK_INITIALIZER;
+static __thread int shared_bbcache_write_depth = 0;
+
+struct SharedBBCacheReadLock {
+    bool locked;
+
+    SharedBBCacheReadLock()
+        : locked(config.shared_bbcache && parallel_sim_active) {
+        if unlikely (locked) pthread_rwlock_rdlock(&shared_bbcache_lock);
+    }
+
+    ~SharedBBCacheReadLock() {
+        if unlikely (locked) pthread_rwlock_unlock(&shared_bbcache_lock);
+    }
+};
+
+struct SharedBBCacheWriteLock {
+    ParallelSection section;
+    bool locked;
+
+    SharedBBCacheWriteLock()
+        : section(parallel_qemu_lock)
+        , locked(config.shared_bbcache && parallel_sim_active) {
+        if unlikely (locked) {
+            if (shared_bbcache_write_depth++ == 0)
+                pthread_rwlock_wrlock(&shared_bbcache_lock);
+        }
+    }
+
+    ~SharedBBCacheWriteLock() {
+        if unlikely (locked) {
+            if (--shared_bbcache_write_depth == 0)
+                pthread_rwlock_unlock(&shared_bbcache_lock);
+        }
+    }
+};
+
 struct BasicBlockChunkListHashtableLinkManager {
     static inline BasicBlockChunkList* objof(selflistlink* link) {
         return baseof(BasicBlockChunkList, hashlink, link);
@@ -31,7 +79,6 @@ struct BasicBlockChunkListHashtableLinkManager {
 typedef SelfHashtable<W64, BasicBlockChunkList, 16384, BasicBlockChunkListHashtableLinkManager> BasicBlockPageCache;
 
 BasicBlockPageCache bbpages;
-CycleTimer translate_timer("translate");
 
 ofstream bbcache_dump_file;
 
@@ -1708,6 +1755,7 @@ bool BasicBlockCache::invalidate(BasicBlock* bb, int reason) {
         pagelist->remove(bb->mfnhi_loc);
     }
 
+    bb->unlink_checked();
     remove(bb);
     W64 ct = bbcache[cpuid].count;
     DECODERSTAT->bbcache.count = ct;
@@ -1718,6 +1766,8 @@ bool BasicBlockCache::invalidate(BasicBlock* bb, int reason) {
 }
 
 bool BasicBlockCache::invalidate(const RIPVirtPhys& rvp, int reason) {
+    SharedBBCacheWriteLock lock;
+
     BasicBlock* bb = get(rvp);
     // BasicBlock* bb = get(rvp.rip);
     if (!bb) return true;
@@ -1761,6 +1811,8 @@ bool BasicBlockCache::invalidate_page(Waddr mfn, int reason) {
     //
     if unlikely (mfn == RIPVirtPhys::INVALID) return 0;
 
+    SharedBBCacheWriteLock lock;
+
     BasicBlockChunkList* pagelist = bbpages.get(mfn);
 
     if (logable(3) | log_code_page_ops) ptl_logfile << "Invalidate page mfn ", mfn, ": pagelist ", pagelist, " has ", (pagelist ? pagelist->count() : 0), " entries", endl; // (dirty? ", smc_isdirty(mfn), ")", endl;
@@ -1801,9 +1853,11 @@ bool BasicBlockCache::invalidate_page(Waddr mfn, int reason) {
 int BasicBlockCache::reclaim(size_t bytesreq, int urgency) {
     bool DEBUG = 1; // logable(1);
 
+    SharedBBCacheWriteLock lock;
+
     if (!count) return 0;
 
-    if (DEBUG) ptl_logfile << "Reclaiming cached basic blocks at ", sim_cycle, " cycles, ", total_insns_committed, " commits:", endl;
+    if (DEBUG) ptl_logfile << "Reclaiming cached basic blocks at ", core_cycle(), " cycles, ", total_insns_committed, " commits:", endl;
 
     if (DECODERSTAT)
         DECODERSTAT->reclaim_rounds++;
@@ -1913,14 +1967,51 @@ int BasicBlockCache::reclaim(size_t bytesreq, int urgency) {
 }
 
 //
-// Flush the entire basic block cache immediately.
-// All basic blocks are flushed: no remaining
-// references are allowed.
+// Called when the guest flushes the TLB of a context (e.g. on every
+// address space switch). Translated blocks only depend on the x86 bytes
+// and the mode bits they were decoded with, so instead of discarding
+// them all we mark them as unchecked for this context: the next lookup
+// from it revalidates the block and only discards it if the bytes at its
+// rip or the mode changed. Only the blocks on the context's checked list
+// need marking, so the cost follows the blocks it used since its last
+// flush and not the cache size. A context_id of -1 marks all contexts.
 //
 void BasicBlockCache::flush(int8_t context_id) {
 
+    SharedBBCacheWriteLock lock;
+
     if (logable(1))
-        ptl_logfile << "Flushing basic block cache at ", sim_cycle, " cycles, ", total_insns_committed, " commits:", endl;
+        ptl_logfile << "Flushing basic block cache at ", core_cycle(), " cycles, ", total_insns_committed, " commits:", endl;
+
+    if (context_id >= 0 && decoder_stats[context_id])
+        decoder_stats[context_id]->tlb_flush.flushes++;
+
+    foreach (i, NUM_SIM_CORES) {
+        if ((context_id >= 0) && (i != context_id)) continue;
+
+        selflistlink* link = checked[i];
+        while (link) {
+            selflistlink* next = link->next;
+            BasicBlock* bb = baseof(BasicBlock, checkedlink[i], link);
+            bb->unchecked.set(i);
+            link->reset();
+            link = next;
+        }
+
+        checked[i] = NULL;
+    }
+}
+
+//
+// Invalidate and free every translated block, used at shutdown. Unlike
+// flush(), which only marks blocks for revalidation, nothing survives.
+//
+void BasicBlockCache::invalidate_all() {
+
+    SharedBBCacheWriteLock lock;
+
+    if (logable(1))
+        ptl_logfile << "Invalidating basic block cache at ", core_cycle(), " cycles, ", total_insns_committed, " commits:", endl;
 
     if (DECODERSTAT)
         DECODERSTAT->reclaim_rounds++;
@@ -1929,7 +2020,6 @@ void BasicBlockCache::flush(int8_t context_id) {
         Iterator iter(this);
         BasicBlock* bb;
         while ((bb = iter.next())) {
-            // if(bb->context_id == context_id || context_id == -1)
             invalidate(bb, INVALIDATE_REASON_RECLAIM);
         }
     }
@@ -1943,7 +2033,6 @@ void BasicBlockCache::flush(int8_t context_id) {
         BasicBlockChunkList* page;
 
         while ((page = iter.next())) {
-            //assert(page->empty());
             if(page->empty()) {
                 bbpages.remove(page);
                 delete page;
@@ -1952,6 +2041,49 @@ void BasicBlockCache::flush(int8_t context_id) {
     }
 }
 
+//
+// Let context_id use bb without checking it until its next TLB flush
+//
+void BasicBlockCache::mark_checked(BasicBlock* bb, int context_id) {
+    bb->unchecked.reset(context_id);
+
+    selflistlink& link = bb->checkedlink[context_id];
+    if (link.unlinked()) link.addto(checked[context_id]);
+}
+
+//
+// Check that a block marked by flush(), or translated by another context
+// in a shared cache, matches what context ctx would decode at rvp: same
+// mode bits and same x86 bytes. Returns false if the block must be
+// discarded.
+//
+bool BasicBlockCache::revalidate(Context& ctx, BasicBlock* bb, const RIPVirtPhys& rvp) {
+    int coreid = ENV_GET_CPU(&ctx)->cpu_index;
+
+    if unlikely ((bb->rip.use64 != rvp.use64) | (bb->rip.kernel != rvp.kernel) |
+            (bb->rip.df != rvp.df)) {
+        return false;
+    }
+
+    byte insnbuf[MAX_BB_BYTES];
+    PageFaultErrorCode pfec;
+    Waddr faultaddr;
+
+    /* Same QEMU code page lookups as fillbuf() */
+    ParallelSection section(parallel_qemu_lock);
+
+    int n = ctx.copy_from_vm(insnbuf, bb->rip, bb->bytes, pfec, faultaddr, true);
+    if unlikely (n < bb->bytes) return false;
+
+    CRC32 crc;
+    crc.update(insnbuf, bb->bytes);
+    if unlikely (W32(crc) != bb->insn_crc) return false;
+
+    mark_checked(bb, coreid);
+
+    return true;
+}
+
 bool assist_exec_page_fault(Context& ctx) {
     //
     // We need to check if faultaddr is now a valid page, since the page tables
@@ -1965,7 +2097,7 @@ bool assist_exec_page_fault(Context& ctx) {
     Waddr bbcache_rip = ctx.reg_ar2;
 
     ctx.eip = ctx.reg_selfrip;
-    assert(bbcache[ENV_GET_CPU(&ctx)->cpu_index].invalidate(RIPVirtPhys(bbcache_rip).update(ctx), INVALIDATE_REASON_SPURIOUS));
+    assert(bbcache_of(ENV_GET_CPU(&ctx)->cpu_index).invalidate(RIPVirtPhys(bbcache_rip).update(ctx), INVALIDATE_REASON_SPURIOUS));
     ctx.handle_page_fault(faultaddr, 2);
 
     return true;
@@ -2347,14 +2479,40 @@ BasicBlock* BasicBlockCache::translate(Context& ctx, const RIPVirtPhys& rvp) {
        }
        */
 
+    int coreid = ENV_GET_CPU(&ctx)->cpu_index;
+
     BasicBlock* bb = get(rvp);
-    if likely (bb && bb->context_id == ENV_GET_CPU(&ctx)->cpu_index) {
-        return bb;
+    if likely (bb && (bb->context_id == coreid || config.shared_bbcache)) {
+        if likely (!bb->unchecked.test(coreid)) return bb;
+
+        //
+        // Another core may run a different address space at the same
+        // virtual rip, so its blocks are only used once their bytes match.
+        //
+        bool shared = (bb->context_id != coreid);
+        bool valid = revalidate(ctx, bb, rvp);
+
+        if (shared) {
+            decoder_stats[coreid]->shared_checks++;
+            if likely (valid) return bb;
+            decoder_stats[coreid]->shared_mismatches++;
+        } else {
+            if likely (valid) {
+                decoder_stats[coreid]->tlb_flush.revalidated++;
+                return bb;
+            }
+            decoder_stats[coreid]->tlb_flush.discarded++;
+        }
+
+        invalidate(bb, INVALIDATE_REASON_TLB_FLUSH);
     }
 
     bb = NULL;
 
-    translate_timer.start();
+    /* Decoder state and QEMU code page lookups are shared between cores */
+    ParallelSection section(parallel_qemu_lock);
+
+    host_profile_scope(HPROF_TRANSLATE);
 
     byte insnbuf[MAX_BB_BYTES];
 
@@ -2364,7 +2522,7 @@ BasicBlock* BasicBlockCache::translate(Context& ctx, const RIPVirtPhys& rvp) {
     }
 
     if (logable(10) | log_code_page_ops) {
-        ptl_logfile << "Translating ", rvp, " (", trans.valid_byte_count, " bytes valid) at ", sim_cycle, " cycles, ", total_insns_committed, " commits", endl;
+        ptl_logfile << "Translating ", rvp, " (", trans.valid_byte_count, " bytes valid) at ", core_cycle(), " cycles, ", total_insns_committed, " commits", endl;
         ptl_logfile << "Instruction Buffer: 64[", trans.use64, "] \n";
         foreach(i, (int)sizeof(insnbuf)) {
             ptl_logfile << hexstring(insnbuf[i], 8), " ";
@@ -2376,17 +2534,47 @@ BasicBlock* BasicBlockCache::translate(Context& ctx, const RIPVirtPhys& rvp) {
         assert(trans.valid_byte_count == 0);
     }
 
-    for (;;) {
-        if (!trans.translate()) break;
+    if unlikely (config.bbcache_store_filename.set() && !bbstore.tried) {
+        bbstore.open(config.bbcache_store_filename, config.bbcache_store_size);
     }
 
-    if(trans.handle_exec_fault) {
-        return NULL;
+    if unlikely (bbstore.active()) {
+        bool stale;
+        bb = bbstore.lookup(trans, insnbuf, stale);
+
+        if (bb) {
+            decoder_stats[coreid]->bbstore.hits++;
+        } else {
+            decoder_stats[coreid]->bbstore.misses++;
+            if (stale) decoder_stats[coreid]->bbstore.stale++;
+        }
+    }
+
+    if likely (!bb) {
+        for (;;) {
+            if (!trans.translate()) break;
+        }
+
+        if(trans.handle_exec_fault) {
+            return NULL;
+        }
+
+        trans.bb.hitcount = 0;
+        trans.bb.predcount = 0;
+        bb = trans.bb.clone();
+
+        if unlikely (bbstore.active() && bbstore.insert(trans, insnbuf, *bb)) {
+            decoder_stats[coreid]->bbstore.inserts++;
+        }
+    }
+
+    {
+        CRC32 crc;
+        crc.update(insnbuf, bb->bytes);
+        bb->insn_crc = crc;
+        bb->unchecked.setall();
     }
 
-    trans.bb.hitcount = 0;
-    trans.bb.predcount = 0;
-    bb = trans.bb.clone();
     //
     // Acquire a reference to the new basic block right away,
     // since we make allocations below that might reclaim it
@@ -2395,10 +2583,12 @@ BasicBlock* BasicBlockCache::translate(Context& ctx, const RIPVirtPhys& rvp) {
     bb->acquire();
 
     add(bb);
+    mark_checked(bb, coreid);
     W64 ct = this->count;
     DECODERSTAT->bbcache.count = ct;
-    DECODERSTAT->bbcache.inserts++;
-    DECODERSTAT->throughput.basic_blocks++;
+    decoder_stats[coreid]->bbcache.inserts++;
+    decoder_stats[coreid]->throughput.basic_blocks++;
+    decoder_stats[coreid]->decode_misses++;
 
     BasicBlockChunkList* pagelist;
 
@@ -2447,18 +2637,53 @@ BasicBlock* BasicBlockCache::translate(Context& ctx, const RIPVirtPhys& rvp) {
     if (logable(10)) {
         ptl_logfile << "=====================================================================", endl;
         ptl_logfile << *bb, endl;
-        ptl_logfile << "End of basic block: rip ", trans.bb.rip, " -> taken rip 0x", (void*)(Waddr)trans.bb.rip_taken, ", not taken rip 0x", (void*)(Waddr)trans.bb.rip_not_taken, endl;
+        ptl_logfile << "End of basic block: rip ", bb->rip, " -> taken rip 0x", (void*)(Waddr)bb->rip_taken, ", not taken rip 0x", (void*)(Waddr)bb->rip_not_taken, endl;
     }
 
-    bb->context_id = ENV_GET_CPU(&ctx)->cpu_index;
-
-    translate_timer.stop();
+    bb->context_id = coreid;
 
     bb->release();
 
     return bb;
 }
 
+//
+// Find the basic block at rvp for the core of ctx, translating it if it is
+// not cached yet, and take a reference to it. The lookup and the reference
+// are taken under the shared cache lock so another core cannot invalidate
+// the block in between.
+//
+BasicBlock* BasicBlockCache::get_and_acquire(Context& ctx, const RIPVirtPhys& rvp) {
+    int coreid = ENV_GET_CPU(&ctx)->cpu_index;
+
+    {
+        SharedBBCacheReadLock lock;
+
+        BasicBlock* bb = get(rvp);
+        if likely (bb && !bb->unchecked.test(coreid)) {
+            if unlikely (bb->context_id != coreid)
+                decoder_stats[coreid]->shared_hits++;
+            bb->acquire();
+            return bb;
+        }
+    }
+
+    SharedBBCacheWriteLock lock;
+
+    BasicBlock* bb = translate(ctx, rvp);
+    if unlikely (!bb) return NULL;
+
+    bb->acquire();
+
+    //
+    // Synthesize here, under the lock, so two cores never race on
+    // the synthops of a newly shared block.
+    //
+    if unlikely (!bb->synthops) synth_uops_for_bb(*bb);
+
+    return bb;
+}
+
 //
 // Translate one basic block, just to get the uops: do not
 // allocate an entry in the BB cache and do not add the BB
@@ -2482,7 +2707,7 @@ void BasicBlockCache::translate_in_place(BasicBlock& targetbb, Context& ctx, Wad
     trans.fillbuf(ctx, insnbuf, sizeof(insnbuf));
 
     if (logable(5) | log_code_page_ops) {
-        ptl_logfile << "Translating ", rvp, " (", trans.valid_byte_count, " bytes valid) at ", sim_cycle, " cycles, ", total_insns_committed, " commits", endl;
+        ptl_logfile << "Translating ", rvp, " (", trans.valid_byte_count, " bytes valid) at ", core_cycle(), " cycles, ", total_insns_committed, " commits", endl;
     }
 
     for (;;) {
@@ -2517,7 +2742,7 @@ BasicBlock* BasicBlockCache::translate_and_clone(Context& ctx, Waddr rip) {
     trans.fillbuf(ctx, insnbuf, sizeof(insnbuf));
 
     if (logable(5) | log_code_page_ops) {
-        ptl_logfile << "Translating ", rvp, " (", trans.valid_byte_count, " bytes valid) at ", sim_cycle, " cycles, ", total_insns_committed, " commits", endl;
+        ptl_logfile << "Translating ", rvp, " (", trans.valid_byte_count, " bytes valid) at ", core_cycle(), " cycles, ", total_insns_committed, " commits", endl;
     }
 
     for (;;) {
@@ -2562,9 +2787,10 @@ void init_decode() {
 
 void shutdown_decode() {
     foreach(i, NUM_SIM_CORES) {
-        bbcache[i].flush(0);
+        bbcache[i].invalidate_all();
     }
     if (bbcache_dump_file) bbcache_dump_file.close();
+    bbstore.close();
 }
 
 void dump_bbcache_to_logfile() {
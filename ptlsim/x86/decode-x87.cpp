@@ -460,7 +460,7 @@ void check_warned_about_x87() {
     sb << endl,
       "//", endl,
       "// NOTE: This program is using a lot of legacy x87 floating point", endl,
-      "// at ", total_insns_committed, " commits, ", sim_cycle, " cycles.", endl,
+      "// at ", total_insns_committed, " commits, ", core_cycle(), " cycles.", endl,
       "// PTLsim executes x87 code very sub-optimally: it is HIGHLY recommended", endl,
       "// that you recompile the program with SSE/SSE2 support and/or update", endl,
       "// the standard libraries (libc, libm) to an SSE/SSE2-specific version.", endl,
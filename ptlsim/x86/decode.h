@@ -624,15 +624,18 @@ enum {
   INVALIDATE_REASON_RECLAIM,
   INVALIDATE_REASON_DIRTY,
   INVALIDATE_REASON_EMPTY,
+  INVALIDATE_REASON_TLB_FLUSH,
   INVALIDATE_REASON_COUNT
 };
 
 struct BasicBlockCache: public SelfHashtable<RIPVirtPhys, BasicBlock, BB_CACHE_SIZE, BasicBlockHashtableLinkManager> {
   BasicBlockCache(): SelfHashtable<RIPVirtPhys, BasicBlock, BB_CACHE_SIZE, BasicBlockHashtableLinkManager>() {
       cpuid = cpuid_counter++;
+      setzero(checked);
   }
 
   BasicBlock* translate(Context& ctx, const RIPVirtPhys& rvp);
+  BasicBlock* get_and_acquire(Context& ctx, const RIPVirtPhys& rvp);
   void translate_in_place(BasicBlock& targetbb, Context& ctx, Waddr rip);
   BasicBlock* translate_and_clone(Context& ctx, Waddr rip);
   bool invalidate(const RIPVirtPhys& rvp, int reason);
@@ -642,14 +645,29 @@ struct BasicBlockCache: public SelfHashtable<RIPVirtPhys, BasicBlock, BB_CACHE_S
   void add_page(BasicBlock* bb);
   int reclaim(size_t reqbytes = 0, int urgency = 0);
   void flush(int8_t context_id);
+  void invalidate_all();
+  bool revalidate(Context& ctx, BasicBlock* bb, const RIPVirtPhys& rvp);
+  void mark_checked(BasicBlock* bb, int context_id);
   W8 cpuid;
   static W8 cpuid_counter;
 
+  // Blocks each context may use without checking them, the only ones a
+  // TLB flush of that context has to visit
+  selflistlink* checked[NUM_SIM_CORES];
+
   ostream& print(ostream& os);
 };
 
 extern BasicBlockCache bbcache[NUM_SIM_CORES];
 
+//
+// Basic block cache used by a core: with -shared-bbcache all cores
+// share bbcache[0], so each block is decoded only once per machine.
+//
+static inline BasicBlockCache& bbcache_of(int coreid) {
+  return bbcache[config.shared_bbcache ? 0 : coreid];
+}
+
 extern ofstream bbcache_dump_file;
 
 static const char* decode_type_names[DECODE_TYPE_COUNT] = {
@@ -657,7 +675,7 @@ static const char* decode_type_names[DECODE_TYPE_COUNT] = {
 };
 
 static const char* invalidate_reason_names[INVALIDATE_REASON_COUNT] = {
-  "smc", "dma", "spurious", "reclaim", "dirty", "empty"
+  "smc", "dma", "spurious", "reclaim", "dirty", "empty", "tlbflush"
 };
 
 /* Decoder Stats */
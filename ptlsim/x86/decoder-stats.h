@@ -65,7 +65,41 @@ struct DecoderStats : public Statable
     cache bbcache;
     cache pagecache;
 
+    struct bbstore : public Statable
+    {
+        StatObj<W64> hits;
+        StatObj<W64> misses;
+        StatObj<W64> stale;
+        StatObj<W64> inserts;
+
+        bbstore(Statable *parent)
+            : Statable("bbstore", parent)
+              , hits("hits", this)
+              , misses("misses", this)
+              , stale("stale", this)
+              , inserts("inserts", this)
+        { }
+    } bbstore;
+
+    struct tlb_flush : public Statable
+    {
+        StatObj<W64> flushes;
+        StatObj<W64> revalidated;
+        StatObj<W64> discarded;
+
+        tlb_flush(Statable *parent)
+            : Statable("tlb_flush", parent)
+              , flushes("flushes", this)
+              , revalidated("revalidated", this)
+              , discarded("discarded", this)
+        { }
+    } tlb_flush;
+
     StatObj<W64> reclaim_rounds;
+    StatObj<W64> decode_misses;
+    StatObj<W64> shared_hits;
+    StatObj<W64> shared_checks;
+    StatObj<W64> shared_mismatches;
 
     DecoderStats(Statable *parent)
         : Statable("decode", parent)
@@ -75,7 +109,13 @@ struct DecoderStats : public Statable
           , page_crossings(this)
           , bbcache("bbcache", this)
           , pagecache("pagecache", this)
+          , bbstore(this)
+          , tlb_flush(this)
           , reclaim_rounds("reclaim_rounds", this)
+          , decode_misses("decode_misses", this)
+          , shared_hits("shared_hits", this)
+          , shared_checks("shared_checks", this)
+          , shared_mismatches("shared_mismatches", this)
     { }
 };
 
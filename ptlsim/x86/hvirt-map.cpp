@@ -0,0 +1,102 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ * Translation of QEMU host virtual addresses of guest RAM to guest
+ * physical addresses, used on every simulated load and store.
+ */
+
+#include <globals.h>
+#include <superstl.h>
+#include <hvirt-map.h>
+
+HvirtGphysMap hvirt_gphys_map;
+
+HvirtGphysMap::HvirtGphysMap()
+    : count(0)
+{
+    memset(roots, 0, sizeof(roots));
+    memset(front, 0, sizeof(front));
+}
+
+HvirtGphysMap::~HvirtGphysMap()
+{
+    clear();
+}
+
+//
+// Install a zeroed node in 'slot' unless another thread did it first,
+// and return the node now in the slot.
+//
+template <typename T>
+static T* install_node(T** slot)
+{
+    T* node = *slot;
+    if likely (node) return node;
+
+    node = new T();
+    memset(node, 0, sizeof(T));
+
+    if (!__sync_bool_compare_and_swap(slot, (T*)NULL, node)) {
+        delete node;
+        node = *slot;
+    }
+
+    return node;
+}
+
+/**
+ * @brief Map the page of 'host_vaddr' to the page of 'guest_paddr'
+ *
+ * Called by QEMU each time it fills a TLB entry, so the page is usually
+ * already mapped to the same address.
+ */
+void HvirtGphysMap::add(Waddr host_vaddr, Waddr guest_paddr)
+{
+    W64 page = host_vaddr & HVIRT_PAGE_MASK;
+    W64 value = (guest_paddr & HVIRT_PAGE_MASK) | 1;
+
+    Mid* mid = install_node(&roots[index_of(page, 2)]);
+    Leaf* leaf = install_node(&mid->leaves[index_of(page, 1)]);
+    W64& entry = leaf->values[index_of(page, 0)];
+
+    if likely (entry == value)
+        return;
+
+    bool remap = (entry != 0);
+    entry = value;
+
+    if (!remap)
+        __sync_fetch_and_add(&count, 1);
+
+    /* Guest RAM was remapped, drop the old translation everywhere */
+    if unlikely (remap) {
+        int index = (page >> HVIRT_PAGE_BITS) & (HVIRT_FRONT_SIZE - 1);
+        foreach (i, NUM_SIM_CORES) {
+            if (front[i][index].page == page)
+                front[i][index].value = 0;
+        }
+    }
+}
+
+/**
+ * @brief Remove all mappings and free the radix tree
+ */
+void HvirtGphysMap::clear()
+{
+    foreach (i, HVIRT_LEVEL_SIZE) {
+        Mid* mid = roots[i];
+        if (!mid) continue;
+
+        foreach (j, HVIRT_LEVEL_SIZE) {
+            delete mid->leaves[j];
+        }
+
+        delete mid;
+        roots[i] = NULL;
+    }
+
+    memset(front, 0, sizeof(front));
+    count = 0;
+}
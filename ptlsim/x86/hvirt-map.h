@@ -0,0 +1,109 @@
+/*
+ * MARSSx86 : A Full System Computer-Architecture Simulator
+ *
+ * This code is released under GPL.
+ *
+ * Translation of QEMU host virtual addresses of guest RAM to guest
+ * physical addresses, used on every simulated load and store.
+ */
+
+#ifndef HVIRT_MAP_H
+#define HVIRT_MAP_H
+
+#include <globals.h>
+
+#define HVIRT_PAGE_BITS   12
+#define HVIRT_PAGE_MASK   (~((W64(1) << HVIRT_PAGE_BITS) - 1))
+
+/* Host virtual page numbers are split in three 12 bit radix levels */
+#define HVIRT_LEVEL_BITS  12
+#define HVIRT_LEVEL_SIZE  (1 << HVIRT_LEVEL_BITS)
+
+/* Entries in the direct-mapped front cache of each context */
+#define HVIRT_FRONT_SIZE  256
+
+//
+// Guest RAM is one host mapping shared by all vCPUs, so a single table
+// serves every context. Pages are kept in a radix tree whose nodes are
+// never freed: a lookup never races with a resize, and a concurrent add
+// only ever installs a node or overwrites one leaf entry. Each context
+// first checks its own small direct-mapped cache of recent pages.
+//
+// Leaf entries hold the guest physical page address with bit 0 set, so
+// a zero entry means not mapped.
+//
+class HvirtGphysMap {
+public:
+    HvirtGphysMap();
+    ~HvirtGphysMap();
+
+    void add(Waddr host_vaddr, Waddr guest_paddr);
+    void clear();
+
+    W64 get_count() const { return count; }
+
+    /**
+     * @brief Translate 'host_vaddr' for context 'cpu_index'
+     *
+     * @return false if the page has not been mapped
+     */
+    bool lookup(int cpu_index, Waddr host_vaddr, Waddr& guest_paddr) {
+        W64 page = host_vaddr & HVIRT_PAGE_MASK;
+        FrontEntry& fe = front[cpu_index][(page >> HVIRT_PAGE_BITS) &
+            (HVIRT_FRONT_SIZE - 1)];
+
+        if likely (fe.page == page && fe.value) {
+            guest_paddr = (fe.value & HVIRT_PAGE_MASK) |
+                (host_vaddr & ~HVIRT_PAGE_MASK);
+            return true;
+        }
+
+        W64 value = find(page);
+        if unlikely (!value)
+            return false;
+
+        fe.page = page;
+        fe.value = value;
+
+        guest_paddr = (value & HVIRT_PAGE_MASK) |
+            (host_vaddr & ~HVIRT_PAGE_MASK);
+        return true;
+    }
+
+private:
+    struct FrontEntry {
+        W64 page;
+        W64 value;
+    };
+
+    struct Leaf {
+        W64 values[HVIRT_LEVEL_SIZE];
+    };
+
+    struct Mid {
+        Leaf* leaves[HVIRT_LEVEL_SIZE];
+    };
+
+    Mid* roots[HVIRT_LEVEL_SIZE];
+    FrontEntry front[NUM_SIM_CORES][HVIRT_FRONT_SIZE];
+    W64 count;
+
+    static int index_of(W64 page, int level) {
+        return (page >> (HVIRT_PAGE_BITS + level * HVIRT_LEVEL_BITS)) &
+            (HVIRT_LEVEL_SIZE - 1);
+    }
+
+    W64 find(W64 page) const {
+        Mid* mid = roots[index_of(page, 2)];
+        if unlikely (!mid) return 0;
+
+        Leaf* leaf = mid->leaves[index_of(page, 1)];
+        if unlikely (!leaf) return 0;
+
+        return leaf->values[index_of(page, 0)];
+    }
+};
+
+extern HvirtGphysMap hvirt_gphys_map;
+
+#endif // HVIRT_MAP_H
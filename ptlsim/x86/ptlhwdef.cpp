@@ -509,6 +509,7 @@ BasicBlock* BasicBlock::clone() {
   bb->synthops = NULL;
   // hashlink, mfnlo_loc, mfnhi_loc are always updated after cloning
   bb->hashlink.reset();
+  bb->reset_checked();
   bb->use(0);
 
   foreach (i, count) bb->transops[i] = this->transops[i];
@@ -49,9 +49,8 @@ static inline void tlb_protect_code(ram_addr_t ram_addr)
 #define CPU_NO_GLOBAL_REGS
 }
 
-// for virtual -> physical address mapping
-#include <map>
-using std::map;
+// for host virtual -> guest physical address mapping
+#include <hvirt-map.h>
 
 #define PTLSIM_VIRT_BASE 0x0000000000000000ULL // PML4 entry 0
 
@@ -226,6 +225,19 @@ using std::map;
 
 #include <globals.h>
 extern "C" W64 sim_cycle;
+
+//
+// Parallel workers (see BaseMachine::run_parallel) count the cycles of
+// their core in worker_cycle while the quantum runs, sim_cycle stays at
+// the start of the quantum for QEMU. Code that runs on a worker reads the
+// cycle with core_cycle().
+//
+extern bool parallel_sim_active;
+extern __thread W64 worker_cycle;
+
+static inline W64 core_cycle() {
+  return unlikely (parallel_sim_active) ? worker_cycle : sim_cycle;
+}
 #include <logic.h>
 #include <config.h>
 
@@ -830,8 +842,6 @@ enum {
 	CONTEXT_RUNNING = 1,
 };
 
-static map<Waddr, Waddr> hvirt_gphys_maps[NUM_SIM_CORES];
-
 struct Context: public CPUX86State {
   bool use32;
   bool use64;
@@ -941,15 +951,12 @@ struct Context: public CPUX86State {
 
   int get_phys_memory_address(Waddr host_vaddr, Waddr &guest_paddr)
   {
-    map<Waddr, Waddr>& hvirt_gphys_map = hvirt_gphys_maps[ENV_GET_CPU(this)->cpu_index];
-    map<Waddr, Waddr>::iterator it;
-    if ((it = hvirt_gphys_map.find(host_vaddr & TARGET_PAGE_MASK)) == hvirt_gphys_map.end())
-    {
+    if unlikely (!hvirt_gphys_map.lookup(ENV_GET_CPU(this)->cpu_index,
+                host_vaddr, guest_paddr)) {
       guest_paddr=0;
       return -1;
     }
 
-    guest_paddr = it->second + (host_vaddr & ~TARGET_PAGE_MASK);
     return 0;
   }
 
@@ -1734,15 +1741,33 @@ struct BasicBlockBase {
   W64 lastused;
   W64 lasttarget;
   W16 context_id;
+  // Checksum of the x86 bytes and contexts that must check the block against
+  // the bytes at its rip before using it: contexts whose TLB was flushed
+  // since their last check and, as the cache key is only the virtual rip,
+  // all contexts but the one that translated the block
+  W32 insn_crc;
+  bitvec<NUM_SIM_CORES> unchecked;
+  // Links into BasicBlockCache::checked, one per context whose bit in
+  // 'unchecked' is clear
+  selflistlink checkedlink[NUM_SIM_CORES];
+
+  void reset_checked() {
+    foreach (i, NUM_SIM_CORES) checkedlink[i].reset();
+  }
+
+  void unlink_checked() {
+    foreach (i, NUM_SIM_CORES) checkedlink[i].unlink();
+  }
 
+  // Atomic: a shared bbcache hands the same block to several core threads
   void acquire() {
-    refcount++;
+    __sync_add_and_fetch(&refcount, 1);
   }
 
   bool release() {
-    refcount--;
-    assert(refcount >= 0);
-    return (!refcount);
+    int refs = __sync_sub_and_fetch(&refcount, 1);
+    assert(refs >= 0);
+    return (!refs);
   }
 };
 
@@ -0,0 +1,111 @@
+#!/usr/bin/env python
+
+# bbv2simpoint.py
+#
+# Convert a basic block vector file written by Marss ('-bbv' option) to
+# the frequency vector text format read by SimPoint.
+#
+# The vectors of all threads in an interval are concatenated into one
+# frequency vector, block 'id' of thread 't' becomes dimension
+# t * blocks + id + 1.
+#
+# This script is provided under LGPL licence.
+#
+
+import sys
+import struct
+
+from optparse import OptionParser
+
+BBV_MAGIC = b"MARSSBBV"
+BBV_RECORD_BLOCK = 1
+BBV_RECORD_VECTOR = 2
+
+def error(msg):
+    print("[ERROR] : %s" % msg)
+    sys.exit(-1)
+
+def read_bbv(f):
+    """Read the file and return (threads, interval, blocks, intervals)
+    where each interval is a list of per thread {id: insns} vectors."""
+    if f.read(8) != BBV_MAGIC:
+        error("Not a Marss BBV file")
+
+    version, threads, interval = struct.unpack("<IIQ", f.read(16))
+    if version != 1:
+        error("Unsupported BBV file version %d" % version)
+
+    blocks = {}
+    intervals = []
+    vectors = []
+
+    while True:
+        rec = f.read(16)
+        if len(rec) < 16:
+            break
+
+        rtype, a, b, c = struct.unpack("<IIII", rec)
+
+        if rtype == BBV_RECORD_BLOCK:
+            blocks[a] = struct.unpack("<Q", rec[8:])[0]
+            continue
+
+        if rtype != BBV_RECORD_VECTOR:
+            error("Unknown record type %d" % rtype)
+
+        entries = b
+        data = f.read(entries * 12)
+        if len(data) < entries * 12:
+            break
+
+        ids = struct.unpack("<%dI" % entries, data[:entries * 4])
+        insns = struct.unpack("<%dQ" % entries, data[entries * 4:])
+        vectors.append(dict(zip(ids, insns)))
+
+        if len(vectors) == threads:
+            intervals.append(vectors)
+            vectors = []
+
+    return threads, interval, blocks, intervals
+
+def main():
+    opt = OptionParser("usage: %prog [options] bbv-file")
+    opt.add_option("-o", "--output", dest="output", default="-",
+            help="SimPoint frequency vector file (default: stdout)")
+    opt.add_option("-m", "--map", dest="map",
+            help="Write 'dimension thread rip' of each block to this file")
+
+    (options, args) = opt.parse_args()
+
+    if len(args) != 1:
+        opt.print_help()
+        sys.exit(-1)
+
+    with open(args[0], "rb") as f:
+        threads, interval, blocks, intervals = read_bbv(f)
+
+    nblocks = len(blocks)
+    out = sys.stdout if options.output == "-" else open(options.output, "w")
+
+    for vectors in intervals:
+        line = ["T"]
+        for thread, vec in enumerate(vectors):
+            for bid in sorted(vec.keys()):
+                line.append(":%d:%d " % (thread * nblocks + bid + 1, vec[bid]))
+        out.write("".join(line) + "\n")
+
+    if out != sys.stdout:
+        out.close()
+
+    if options.map:
+        with open(options.map, "w") as m:
+            for thread in range(threads):
+                for bid in sorted(blocks.keys()):
+                    m.write("%d %d 0x%x\n" % (thread * nblocks + bid + 1,
+                        thread, blocks[bid]))
+
+    sys.stderr.write("%d intervals of %d instructions, %d threads, "
+            "%d blocks\n" % (len(intervals), interval, threads, nblocks))
+
+if __name__ == "__main__":
+    main()
@@ -13,6 +13,8 @@
 import os
 import sys
 import re
+import struct
+import tempfile
 import operator
 
 from optparse import OptionParser,OptionGroup
@@ -193,6 +195,111 @@ class YAMLReader(Readers):
                     docs += self.load_yaml(st_f)
             return docs
 
+# Binary time-stats file format, see ptlsim/stats/statsBuilder.cpp
+TIME_STATS_MAGIC = b"MARSSTSB"
+TIME_STATS_VERSION = 1
+
+def is_time_stats_bin(filename):
+    """Check if given file is a binary time-stats file."""
+    with open(filename, 'rb') as f:
+        return f.read(len(TIME_STATS_MAGIC)) == TIME_STATS_MAGIC
+
+def read_time_stats_bin(filename):
+    """
+    Read a binary time-stats file written with -time-stats-format binary.
+
+    Returns a tuple (names, rows) where names are the column titles, same
+    as the header of the text format, and each row is a list starting with
+    sim_cycle followed by the value of each column in that period.
+    """
+    with open(filename, 'rb') as f:
+        data = f.read()
+
+    if data[:8] != TIME_STATS_MAGIC:
+        error("%s is not a binary time-stats file" % filename)
+
+    version, columns, num_fields, _ = struct.unpack_from("<IIII", data, 8)
+    if version != TIME_STATS_VERSION:
+        error("Unsupported time-stats version %d in %s" % (version, filename))
+
+    pos = 24
+    fields = []
+    for i in range(num_fields):
+        ftype, op, name_len = struct.unpack_from("<BBH", data, pos)
+        pos += 4
+        name = data[pos:pos + name_len].decode()
+        pos += name_len
+        if ftype == 0:
+            col, = struct.unpack_from("<I", data, pos)
+            pos += 4
+            fields.append((name, None, [col]))
+        else:
+            count, = struct.unpack_from("<H", data, pos)
+            pos += 2
+            cols = list(struct.unpack_from("<%dI" % count, data, pos))
+            pos += 4 * count
+            fields.append((name, op, cols))
+
+    words = (columns + 63) // 64
+    rows = []
+    while pos < len(data):
+        cycle, = struct.unpack_from("<Q", data, pos)
+        pos += 8
+        bitmap = struct.unpack_from("<%dQ" % words, data, pos)
+        pos += 8 * words
+
+        values = [0] * columns
+        for col in range(columns):
+            if bitmap[col // 64] & (1 << (col % 64)):
+                values[col], = struct.unpack_from("<Q", data, pos)
+                pos += 8
+
+        row = [cycle]
+        for name, op, cols in fields:
+            if op is None:
+                row.append(values[cols[0]])
+            elif op == 0:
+                row.append(sum(values[c] for c in cols))
+            else:
+                den = values[cols[1]]
+                row.append(float(values[cols[0]]) / den if den else 0.0)
+        rows.append(row)
+
+    return ["sim_cycle"] + [f[0] for f in fields], rows
+
+def write_time_stats_csv(names, rows, out):
+    """Write time-stats in the same CSV format as the text time-stats."""
+    fmt = lambda x: "%g" % x if type(x) == float else str(x)
+    out.write(",".join(names) + "\n")
+    for row in rows:
+        out.write(",".join([fmt(x) for x in row]) + "\n")
+
+class TimeStatsBinReader(Readers):
+    """
+    Convert binary time-stats files into CSV
+    """
+    def set_options(self, parser):
+        parser.add_option("--time-stats-bin", action="store_true",
+                default=False,
+                help="Convert binary time-stats files to CSV")
+        parser.add_option("--time-stats-csv", type="string", default=None,
+                help="Output CSV file for --time-stats-bin, default stdout")
+
+    def read(self, options, args):
+        if not options.time_stats_bin:
+            return
+
+        out = sys.stdout
+        if options.time_stats_csv:
+            out = open(options.time_stats_csv, 'w')
+
+        for tf in args:
+            names, rows = read_time_stats_bin(tf)
+            write_time_stats_csv(names, rows, out)
+
+        if out != sys.stdout:
+            out.close()
+
 class TimeGraphRead(Readers):
     """
     Generate a graph from periodic stats dump file
@@ -210,7 +317,15 @@ class TimeGraphRead(Readers):
     def read(self, options, args):
         if self.enabled and options.time_stats == True:
             assert(len(args) == 1)
-            options.sg = Graphs.SimpleGraph(args[0])
+            ts_file = args[0]
+            if is_time_stats_bin(ts_file):
+                names, rows = read_time_stats_bin(ts_file)
+                csv = tempfile.NamedTemporaryFile(mode='w', suffix='.csv',
+                        delete=False)
+                write_time_stats_csv(names, rows, csv)
+                csv.close()
+                ts_file = csv.name
+            options.sg = Graphs.SimpleGraph(ts_file)
         else:
             options.sg = None
 
@@ -0,0 +1,132 @@
+#!/usr/bin/env python
+
+# traffic_bench.py
+#
+# Benchmark the simulation speed of the memory hierarchy. For each machine
+# and traffic pattern, start Marss with '-traffic' so synthetic agents send
+# requests to the caches in place of the cores, and collect the simulated
+# requests per host second and the mean request latency.
+#
+# With '--baseline' the results are compared to a CSV file written by an
+# earlier run ('--output') and the script fails if any run got slower than
+# the allowed threshold.
+#
+# This script is provided under LGPL licence.
+#
+
+import os
+import re
+import sys
+import subprocess
+import tempfile
+
+from optparse import OptionParser
+
+MACHINES = ["single_core", "shared_l2", "shared_l2_bus", "private_L2",
+        "moesi_private_L2", "moesi_private_L2_mesh", "moesi_private_L2_ring"]
+PATTERNS = ["stream", "random", "chase", "prodcons", "falseshare"]
+
+RESULT_RE = re.compile(r"Traffic (\S+) on (\S+): (\d+) memory requests " +
+        r"from (\d+) agents in (\d+) cycles and \S+ seconds " +
+        r"\((\d+) requests/sec\)")
+LATENCY_RE = re.compile(r"Latency \(cycles\): mean ([\d.]+)")
+
+def error(msg):
+    print("[ERROR] : %s" % msg)
+    sys.exit(-1)
+
+def run_one(options, machine, pattern):
+    """Run one benchmark, return (requests/sec, cycles, mean latency)"""
+    smp = 1 if machine == "single_core" else options.cores
+
+    cfg = tempfile.NamedTemporaryFile(mode="w", suffix=".simcfg",
+            delete=False)
+    cfg.write("-machine %s\n" % machine)
+    cfg.write("-traffic %s\n" % pattern)
+    cfg.write("-traffic-requests %d\n" % options.requests)
+    cfg.write("-logfile /dev/null\n")
+    cfg.write("-run\n")
+    cfg.close()
+
+    cmd = [options.qemu, "-m", "64", "-nographic", "-smp", str(smp),
+            "-simconfig", cfg.name]
+
+    p = subprocess.Popen(cmd, stdout=subprocess.PIPE,
+            stderr=subprocess.STDOUT, stdin=subprocess.PIPE)
+    out = p.communicate()[0].decode("utf-8", "replace")
+    os.unlink(cfg.name)
+
+    result = RESULT_RE.search(out)
+    latency = LATENCY_RE.search(out)
+    if not result or not latency:
+        error("No result from %s %s:\n%s" % (machine, pattern, out))
+
+    return (int(result.group(6)), int(result.group(5)),
+            float(latency.group(1)))
+
+def read_baseline(filename):
+    baseline = {}
+    for line in open(filename):
+        fields = line.strip().split(",")
+        if len(fields) < 3 or fields[0] == "machine":
+            continue
+        baseline[(fields[0], fields[1])] = int(fields[2])
+    return baseline
+
+opt_parser = OptionParser("Usage: %prog [options]")
+opt_parser.add_option("-q", "--qemu", default="qemu/qemu-system-x86_64",
+        help="Marss qemu binary")
+opt_parser.add_option("-m", "--machines", default=",".join(MACHINES),
+        help="Comma separated machines to run")
+opt_parser.add_option("-p", "--patterns", default=",".join(PATTERNS),
+        help="Comma separated traffic patterns to run")
+opt_parser.add_option("-c", "--cores", type="int", default=4,
+        help="Agents of the multi-core machines")
+opt_parser.add_option("-n", "--requests", type="int", default=1000000,
+        help="Requests sent by each agent")
+opt_parser.add_option("-o", "--output", help="Write results to CSV file")
+opt_parser.add_option("-b", "--baseline",
+        help="Compare requests/sec to CSV file of an earlier run")
+opt_parser.add_option("-t", "--threshold", type="float", default=5.0,
+        help="Percent slowdown to baseline that counts as a regression")
+
+(options, args) = opt_parser.parse_args()
+
+if not os.path.exists(options.qemu):
+    error("Qemu binary %s doesn't exist" % options.qemu)
+
+baseline = read_baseline(options.baseline) if options.baseline else {}
+results = []
+regressions = 0
+
+print("%-18s %-11s %12s %12s %9s %8s" % ("machine", "pattern",
+    "requests/sec", "cycles", "latency", "change"))
+
+for machine in options.machines.split(","):
+    for pattern in options.patterns.split(","):
+        rate, cycles, latency = run_one(options, machine, pattern)
+        results.append((machine, pattern, rate, cycles, latency))
+
+        change = ""
+        base = baseline.get((machine, pattern))
+        if base:
+            percent = 100.0 * (rate - base) / base
+            change = "%+.1f%%" % percent
+            if percent < -options.threshold:
+                regressions += 1
+                change += " !"
+
+        print("%-18s %-11s %12d %12d %9.2f %8s" % (machine, pattern, rate,
+            cycles, latency, change))
+
+if options.output:
+    f = open(options.output, "w")
+    f.write("machine,pattern,requests_per_sec,cycles,mean_latency\n")
+    for r in results:
+        f.write("%s,%s,%d,%d,%.2f\n" % r)
+    f.close()
+
+if regressions:
+    print("%d runs slower than baseline by more than %.1f%%" %
+            (regressions, options.threshold))
+    sys.exit(1)